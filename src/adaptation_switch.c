@@ -48,23 +48,31 @@
 #include <stdio.h>
 #include <string.h>
 #include <err.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <ctype.h>
 #include <termios.h>
+#include <pthread.h>
+#include <time.h>
 
-#ifdef __OpenBSD__
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <sndio.h>
-#define PCAUDIO
-#endif
+#include "compat.h"
+
+/* the event log is drained every CTM_LOG_INTERVAL_MS by a thread of its own */
+#define CTM_LOG_INTERVAL_MS 10
+
+struct event_logger {
+  ctm_session_t *session;
+  pthread_t      thread;
+  int            done;      /* set once the session has finished */
+};
 
 /***********************************************************************/
 
 void usage()
 {
-  fprintf(stderr, "usage: ctm [-cbn]\n\t[-i file] [-o file] [-I file]\n\t[-O file] [-f device] [-N number]\n");
+  fprintf(stderr, "usage: ctm [-cbmns]\n\t[-i file] [-o file] [-I file]\n\t[-O file] [-f device] [-N number]\n\t[-B bytes] [-D delay] [-r rate] [-F | -gt]\n");
+  fprintf(stderr, "audio devices: backend[:argument], backends: %s\n", ctm_audio_backend_names());
   exit(1);
 }
 
@@ -74,7 +82,7 @@ open_file_or_stdio(const char *filename, int flags)
   int file_fd;
   if (!strncmp(filename, "-", 1))
   {
-    if (flags & O_WRONLY)
+    if (flags & (O_WRONLY | O_RDWR))
       file_fd = STDOUT_FILENO;
     else
       file_fd = STDIN_FILENO;
@@ -89,6 +97,37 @@ open_file_or_stdio(const char *filename, int flags)
   return file_fd;
 }
 
+/* Writes the text of the session events to stderr, as the session */
+/* used to print it while processing the frames.                    */
+static void *log_events(void *arg)
+{
+  struct event_logger *logger = arg;
+  ctm_event_t events[64];
+  char        text[64*64];
+  size_t      len;
+  int         num, cnt, done;
+  struct timespec pause = { 0, CTM_LOG_INTERVAL_MS*1000000L };
+
+  do {
+    /* drain once more after the session has finished */
+    done = __atomic_load_n(&logger->done, __ATOMIC_ACQUIRE);
+
+    while ((num = ctm_session_get_events(logger->session, events, 64)) > 0)
+    {
+      len = 0;
+      for (cnt=0; cnt<num; cnt++)
+        len += ctm_event_format(&events[cnt], text+len, sizeof(text)-len);
+      if (write(STDERR_FILENO, text, len) == -1)
+        break;
+    }
+
+    if (!done)
+      nanosleep(&pause, NULL);
+  } while (!done);
+
+  return NULL;
+}
+
 /***********************************************************************/
 
 int main(int argc, char** argv)
@@ -108,11 +147,25 @@ int main(int argc, char** argv)
   int ctm_file_mode_flag;
   int audio_mode_flag;
   int shutdown_on_eof_flag;
+  int map_flag;
+  int text_flush_bytes;
+  int text_flush_ms;
+  int sliding_dft_flag;
+  int lag_tracking_flag;
+  int float_demod_flag;
+  int sample_rate;
+  int output_flags;
+  char *audio_device;
+  const char *ctm_output_name;
+  const char *user_output_name;
 
   enum ctm_user_input_mode user_input_mode;
   enum ctm_output_mode ctm_mode;
   int num_samples;
 
+  ctm_session_t *session;
+  struct event_logger logger;
+
   /* set default behavior */
   user_input_fd = STDIN_FILENO;
   user_output_fd = STDOUT_FILENO;
@@ -125,9 +178,19 @@ int main(int argc, char** argv)
   audio_mode_flag = 1;
   num_samples = -1; /* by default, set to infinite */
   shutdown_on_eof_flag = 0;
+  map_flag = 0;
+  text_flush_bytes = 1; /* by default, every character is written as it comes */
+  text_flush_ms = 0;
+  sliding_dft_flag = 0;
+  lag_tracking_flag = 0;
+  float_demod_flag = 0;
+  sample_rate = 8000;
+  audio_device = NULL; /* default audio backend */
+  ctm_output_name = NULL;
+  user_output_name = NULL;
 
   int ch;
-  while ((ch = getopt(argc, argv, "scbni:o:f:I:O:N:")) != -1) {
+  while ((ch = getopt(argc, argv, "scbgtmFni:o:f:I:O:N:B:D:r:")) != -1) {
     switch (ch) {
       case 's':
         shutdown_on_eof_flag = 1;
@@ -141,6 +204,18 @@ int main(int argc, char** argv)
       case 'n':
         negotiation_flag = 1;
         break;
+      case 'm':
+        map_flag = 1;
+        break;
+      case 'g':
+        sliding_dft_flag = 1;
+        break;
+      case 't':
+        lag_tracking_flag = 1;
+        break;
+      case 'F':
+        float_demod_flag = 1;
+        break;
       case 'I':
         ctm_file_mode_flag = 1;
         audio_mode_flag = 0;
@@ -149,19 +224,37 @@ int main(int argc, char** argv)
       case 'O':
         ctm_file_mode_flag = 1;
         audio_mode_flag = 0;
-        ctm_output_fd = open_file_or_stdio(optarg, O_WRONLY | O_NONBLOCK | O_CREAT | O_TRUNC);
+        ctm_output_name = optarg;
+        break;
+      case 'f':
+        audio_device = optarg;
         break;
       case 'i':
         user_input_fd = open_file_or_stdio(optarg, O_RDONLY | O_NONBLOCK);
         break;
       case 'o':
-        user_output_fd = open_file_or_stdio(optarg, O_WRONLY | O_NONBLOCK | O_CREAT | O_TRUNC);
+        user_output_name = optarg;
         break;
       case 'N':
-        num_samples = strtonum(optarg, 1, ULONG_MAX, &errstr); 
+        num_samples = strtonum(optarg, 1, INT_MAX, &errstr); 
         if (errstr)
           errx(1, "number of samples is %s: %s", errstr, optarg);
         break;
+      case 'B':
+        text_flush_bytes = strtonum(optarg, 1, BUFIO_BUFFER_SIZE, &errstr);
+        if (errstr)
+          errx(1, "text flush size is %s: %s", errstr, optarg);
+        break;
+      case 'D':
+        text_flush_ms = strtonum(optarg, 0, 60000, &errstr);
+        if (errstr)
+          errx(1, "text flush delay is %s: %s", errstr, optarg);
+        break;
+      case 'r':
+        sample_rate = strtonum(optarg, 1, INT_MAX, &errstr);
+        if (errstr)
+          errx(1, "sample rate is %s: %s", errstr, optarg);
+        break;
       default:
         usage();
         /* NOTREACHED */
@@ -170,6 +263,13 @@ int main(int argc, char** argv)
   argc -= optind;
   argv += optind;
 
+  /* mapped output files have to be readable as well */
+  output_flags = (map_flag ? O_RDWR : O_WRONLY) | O_NONBLOCK | O_CREAT | O_TRUNC;
+  if (ctm_output_name != NULL)
+    ctm_output_fd = open_file_or_stdio(ctm_output_name, output_flags);
+  if (user_output_name != NULL)
+    user_output_fd = open_file_or_stdio(user_output_name, output_flags);
+
   /* check for sane argument combinations */
   if (audio_mode_flag == 1 && ctm_file_mode_flag == 1)
     errx(1, "invalid arguments: if using audio mode, no CTM files can be specified.");
@@ -180,6 +280,12 @@ int main(int argc, char** argv)
   else if (compat_flag == 1 && ctm_file_mode_flag == 0 && baudot_flag == 0)
     errx(1, "invalid arguments: compatibility mode is used only with baudot and/or CTM file modes.");
 
+  else if (map_flag == 1 && ctm_file_mode_flag == 0)
+    errx(1, "invalid arguments: mapped files are used only with the CTM file mode.");
+
+  else if (float_demod_flag == 1 && (sliding_dft_flag == 1 || lag_tracking_flag == 1))
+    errx(1, "invalid arguments: the single-precision demodulator (-F) has neither the sliding DFT correlator (-g) nor lag tracking (-t).");
+
   /* select the user input mode and CTM mode based on the input arguments. */
   if (ctm_file_mode_flag == 1) {
     if (compat_flag == 0)
@@ -203,13 +309,35 @@ int main(int argc, char** argv)
   /* Main processing loop                                       */
   /**************************************************************/
 
-  ctm_init(ctm_mode, user_input_mode, ctm_output_fd, ctm_input_fd, user_output_fd, user_input_fd, SIO_DEVANY);
-  ctm_set_negotiation(negotiation_flag);
-  ctm_set_shutdown_on_eof(shutdown_on_eof_flag);
-  ctm_set_num_samples(num_samples);
-  ctm_start();
+  session = ctm_session_create(ctm_mode, user_input_mode, ctm_output_fd, ctm_input_fd, user_output_fd, user_input_fd, audio_device);
+  ctm_session_set_negotiation(session, negotiation_flag);
+  ctm_session_set_shutdown_on_eof(session, shutdown_on_eof_flag);
+  ctm_session_set_num_samples(session, num_samples);
+  ctm_session_set_text_flush(session, text_flush_bytes, text_flush_ms);
+  ctm_session_set_rate(session, sample_rate);
+  if (sliding_dft_flag == 1)
+    ctm_session_set_correlator(session, TONEDEMOD_SLIDING_DFT);
+  if (lag_tracking_flag == 1)
+    ctm_session_set_lag_tracking(session, ON);
+  if (float_demod_flag == 1)
+    ctm_session_set_float_demod(session, ON);
+  if (map_flag == 1 && !ctm_session_map_files(session))
+    warnx("the CTM input is not a regular file, it is read instead of mapped.");
+
+  logger.session = session;
+  logger.done    = 0;
+  if ((errno = pthread_create(&logger.thread, NULL, log_events, &logger)) != 0)
+    err(1, "pthread_create");
+
+  ctm_session_run(session);
+
+  __atomic_store_n(&logger.done, 1, __ATOMIC_RELEASE);
+  pthread_join(logger.thread, NULL);
+  if (ctm_session_dropped_events(session) > 0)
+    warnx("%lu events have been dropped from the log.", (unsigned long)ctm_session_dropped_events(session));
 
   /* if in audio mode, this will never return. User must signal process to stop. */
 
+  ctm_session_destroy(session);
   exit(0);
 }
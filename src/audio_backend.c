@@ -0,0 +1,165 @@
+/*
+*******************************************************************************
+*
+*      File             : audio_backend.c
+*      Purpose          : selection of the audio backend and the generic
+*                         ctm_audio_* entry points
+*
+*******************************************************************************
+*/
+
+/*
+*******************************************************************************
+*                         MODULE INCLUDE FILE AND VERSION ID
+*******************************************************************************
+*/
+
+#include "audio_backend.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <err.h>
+
+const char audio_backend_id[] = "@(#)$Id: $" audio_backend_h;
+
+/*
+*******************************************************************************
+*                         LOCAL DATA
+*******************************************************************************
+*/
+
+/* the first entry is the default backend */
+static const struct ctm_audio_backend *backends[] = {
+#ifdef HAVE_SNDIO
+  &ctm_audio_sndio_backend,
+#endif
+  &ctm_audio_clock_backend,
+  &ctm_audio_null_backend,
+  &ctm_audio_fd_backend,
+  &ctm_audio_shm_backend,
+  NULL
+};
+
+static char backend_names[128];
+
+/*
+*******************************************************************************
+*                         PUBLIC PROGRAM CODE
+*******************************************************************************
+*/
+
+ctm_audio_t *ctm_audio_open(const char *device, int rate, int frame_len)
+{
+  const struct ctm_audio_backend *backend = NULL;
+  const char  *arg = NULL;
+  ctm_audio_t *audio;
+  size_t       len;
+  int          cnt;
+
+  if (device != NULL)
+  {
+    for (cnt=0; backends[cnt] != NULL; cnt++)
+    {
+      len = strlen(backends[cnt]->name);
+      if (strncmp(device, backends[cnt]->name, len) == 0 &&
+          (device[len] == '\0' || device[len] == ':'))
+      {
+        backend = backends[cnt];
+        arg = (device[len] == ':') ? &device[len+1] : NULL;
+        break;
+      }
+    }
+  }
+
+  if (backend == NULL)
+  {
+#ifdef HAVE_SNDIO
+    /* plain sndio device name, e.g. "snd/0" */
+    backend = &ctm_audio_sndio_backend;
+    arg = device;
+#else
+    if (device != NULL)
+      errx(1, "unknown audio device \"%s\" (available: %s)", device, ctm_audio_backend_names());
+    backend = backends[0];
+#endif
+  }
+
+  if ((audio = calloc(1, sizeof(ctm_audio_t))) == NULL)
+    err(1, "ctm_audio_open: calloc");
+
+  len = strlen(backend->name) + (arg != NULL ? strlen(arg) + 1 : 0) + 1;
+  if ((audio->name = malloc(len)) == NULL)
+    err(1, "ctm_audio_open: malloc");
+  if (arg != NULL)
+    snprintf(audio->name, len, "%s:%s", backend->name, arg);
+  else
+    snprintf(audio->name, len, "%s", backend->name);
+
+  audio->backend   = backend;
+  audio->rate      = rate;
+  audio->frame_len = frame_len;
+
+  backend->open(audio, arg);
+
+  return audio;
+}
+
+void ctm_audio_start(ctm_audio_t *audio)
+{
+  audio->backend->start(audio);
+}
+
+int ctm_audio_read(ctm_audio_t *audio, Shortint *samples, int num)
+{
+  return audio->backend->read(audio, samples, num);
+}
+
+int ctm_audio_write(ctm_audio_t *audio, const Shortint *samples, int num)
+{
+  return audio->backend->write(audio, samples, num);
+}
+
+int ctm_audio_pollfd(ctm_audio_t *audio, struct pollfd *pfd, int events)
+{
+  pfd->fd      = -1;
+  pfd->events  = 0;
+  pfd->revents = 0;
+
+  return audio->backend->pollfd(audio, pfd, events);
+}
+
+int ctm_audio_revents(ctm_audio_t *audio, struct pollfd *pfd)
+{
+  return audio->backend->revents(audio, pfd);
+}
+
+int ctm_audio_timeout(ctm_audio_t *audio)
+{
+  return audio->backend->timeout(audio);
+}
+
+void ctm_audio_close(ctm_audio_t *audio)
+{
+  if (audio == NULL)
+    return;
+
+  audio->backend->close(audio);
+  free(audio->name);
+  free(audio);
+}
+
+const char *ctm_audio_backend_names(void)
+{
+  int cnt;
+
+  if (backend_names[0] == '\0')
+    for (cnt=0; backends[cnt] != NULL; cnt++)
+    {
+      if (cnt > 0)
+        strncat(backend_names, ", ", sizeof(backend_names)-strlen(backend_names)-1);
+      strncat(backend_names, backends[cnt]->name, sizeof(backend_names)-strlen(backend_names)-1);
+    }
+
+  return backend_names;
+}
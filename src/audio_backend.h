@@ -0,0 +1,145 @@
+/*
+*******************************************************************************
+*
+*      File             : audio_backend.h
+*      Purpose          : pluggable audio I/O for the CTM signal
+*
+*      A backend is selected with a device string of the form
+*
+*          backend[:argument]
+*
+*      sndio[:device]   sndio device (default SIO_DEVANY), only if built
+*                       with HAVE_SNDIO
+*      fd:in[,out]      raw native-endian 16 bit samples on two already
+*                       open descriptors (one if both are the same, e.g.
+*                       a socket); one output frame per input frame
+*      shm:/name        POSIX shared memory with one sample ring in each
+*                       direction, see struct ctm_audio_shm below
+*      null             silence in, output discarded, never waits; for
+*                       benchmarking the signal processing
+*      clock            like null, but paced in real time
+*
+*      A device string without a known backend prefix is taken as an
+*      sndio device name. NULL selects sndio if available, clock otherwise.
+*
+*******************************************************************************
+*/
+#ifndef audio_backend_h
+#define audio_backend_h "$Id: $"
+
+/*
+*******************************************************************************
+*                         INCLUDE FILES
+*******************************************************************************
+*/
+
+#include <poll.h>
+#include <typedefs.h>
+
+/*
+*******************************************************************************
+*                         DECLARATION OF PROTOTYPES
+*******************************************************************************
+*/
+
+typedef struct ctm_audio ctm_audio_t;
+
+struct ctm_audio_backend {
+  const char *name;
+
+  /* open the device; errors are fatal, as for the other session I/O */
+  void (*open)(ctm_audio_t *, const char *arg);
+  void (*start)(ctm_audio_t *);
+  /* read/write up to num samples; read returns -1 at end of input */
+  int  (*read)(ctm_audio_t *, Shortint *samples, int num);
+  int  (*write)(ctm_audio_t *, const Shortint *samples, int num);
+  /* set up at most one pollfd; returns the number of descriptors used */
+  int  (*pollfd)(ctm_audio_t *, struct pollfd *, int events);
+  /* POLLIN: a frame can be read, POLLOUT: a frame can be written */
+  int  (*revents)(ctm_audio_t *, struct pollfd *);
+  /* ms until the backend becomes ready by itself, -1 if never */
+  int  (*timeout)(ctm_audio_t *);
+  void (*close)(ctm_audio_t *);
+};
+
+struct ctm_audio {
+  const struct ctm_audio_backend *backend;
+  char                           *name;       /* "backend:argument" */
+  int                             rate;       /* samples per second */
+  int                             frame_len;  /* samples per frame  */
+  void                           *priv;
+};
+
+/* ---------------------------------------------------------------------- */
+/* ctm_audio_open:                                                        */
+/* Opens the backend named by device (see above) for mono 16 bit I/O in  */
+/* frames of frame_len samples.                                           */
+/* ---------------------------------------------------------------------- */
+
+ctm_audio_t *ctm_audio_open(const char *device, int rate, int frame_len);
+
+void ctm_audio_start(ctm_audio_t *);
+int  ctm_audio_read(ctm_audio_t *, Shortint *samples, int num);
+int  ctm_audio_write(ctm_audio_t *, const Shortint *samples, int num);
+int  ctm_audio_pollfd(ctm_audio_t *, struct pollfd *, int events);
+int  ctm_audio_revents(ctm_audio_t *, struct pollfd *);
+int  ctm_audio_timeout(ctm_audio_t *);
+void ctm_audio_close(ctm_audio_t *);
+
+/* comma-separated list of the backends built in */
+const char *ctm_audio_backend_names(void);
+
+/*
+*******************************************************************************
+*                         SHARED MEMORY LAYOUT
+*******************************************************************************
+*
+* The shm backend creates (or attaches to) a shared memory object that
+* holds a struct ctm_audio_shm followed by the samples of the rx ring
+* (CTM input, written by the host) and of the tx ring (CTM output, read
+* by the host), ring_size samples each. ring_size is a power of two.
+* head is only advanced by the producer, tail only by the consumer; both
+* count samples and wrap around at 2^32.
+*
+* The object is set up by whoever first changes magic from 0 to
+* CTM_AUDIO_SHM_INIT (compare-and-swap); it fills in the rest of the
+* header and then stores CTM_AUDIO_SHM_MAGIC. A host that creates the
+* object itself sizes it before writing the header.
+*/
+
+#define CTM_AUDIO_SHM_MAGIC     0x43544d31      /* "CTM1" */
+#define CTM_AUDIO_SHM_INIT      0x43544d30      /* "CTM0", being set up */
+#define CTM_AUDIO_SHM_RING_SIZE 8192
+#define CTM_AUDIO_SHM_POLL_MS   5               /* poll interval when idle */
+
+struct ctm_audio_shm_ring {
+  ULongint head;
+  ULongint tail;
+};
+
+struct ctm_audio_shm {
+  ULongint                  magic;
+  ULongint                  rate;
+  ULongint                  ring_size;
+  struct ctm_audio_shm_ring rx;
+  struct ctm_audio_shm_ring tx;
+};
+
+#define CTM_AUDIO_SHM_RX(shm) ((Shortint *)((shm)+1))
+#define CTM_AUDIO_SHM_TX(shm) (CTM_AUDIO_SHM_RX(shm)+(shm)->ring_size)
+
+/*
+*******************************************************************************
+*                         BACKENDS
+*******************************************************************************
+*/
+
+#ifdef HAVE_SNDIO
+extern const struct ctm_audio_backend ctm_audio_sndio_backend;
+#endif
+extern const struct ctm_audio_backend ctm_audio_fd_backend;
+extern const struct ctm_audio_backend ctm_audio_shm_backend;
+extern const struct ctm_audio_backend ctm_audio_null_backend;
+extern const struct ctm_audio_backend ctm_audio_clock_backend;
+
+#endif
@@ -0,0 +1,193 @@
+/*
+*******************************************************************************
+*
+*      File             : audio_fd.c
+*      Purpose          : raw descriptor audio backend
+*
+*      The samples are read from and written to descriptors that the
+*      caller has already opened (pipes, a socket, a character device),
+*      in native byte order. Input is collected until a complete frame has
+*      arrived; every complete input frame releases one output frame, so
+*      the output runs at the pace of the input. After the end of the
+*      input, the output runs freely so that the session can drain.
+*
+*******************************************************************************
+*/
+
+#include "audio_backend.h"
+#include "compat.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <err.h>
+#include <errno.h>
+#include <unistd.h>
+
+const char audio_fd_id[] = "@(#)$Id: $" audio_backend_h;
+
+struct fd_priv {
+  int       in_fd;
+  int       out_fd;
+  Shortint *frame;        /* input frame being collected */
+  int       num_bytes;    /* bytes of it received so far */
+  Bool      eof;
+};
+
+static int parse_fd(const char *str, char **end)
+{
+  long value;
+
+  errno = 0;
+  value = strtol(str, end, 10);
+  if (errno != 0 || *end == str || value < 0 || value > 65535)
+    errx(1, "invalid descriptor in audio device \"fd:%s\"", str);
+
+  return (int)value;
+}
+
+static void fd_open(ctm_audio_t *audio, const char *arg)
+{
+  struct fd_priv *priv;
+  char           *end;
+
+  if (arg == NULL)
+    errx(1, "audio device \"fd\" needs the descriptors, e.g. \"fd:3,4\"");
+
+  if ((priv = calloc(1, sizeof(struct fd_priv))) == NULL ||
+      (priv->frame = calloc(audio->frame_len, sizeof(Shortint))) == NULL)
+    err(1, "fd_open: calloc");
+  audio->priv = priv;
+
+  priv->in_fd  = parse_fd(arg, &end);
+  priv->out_fd = priv->in_fd;
+  if (*end == ',')
+    priv->out_fd = parse_fd(end+1, &end);
+  if (*end != '\0')
+    errx(1, "invalid audio device \"fd:%s\"", arg);
+}
+
+static void fd_start(ctm_audio_t *audio)
+{
+}
+
+static int fd_read(ctm_audio_t *audio, Shortint *samples, int num)
+{
+  struct fd_priv *priv = audio->priv;
+  int             frame_bytes = audio->frame_len*sizeof(Shortint);
+
+  if (priv->num_bytes < frame_bytes)
+    return priv->eof ? -1 : 0;
+
+  if (num > audio->frame_len)
+    num = audio->frame_len;
+  memcpy(samples, priv->frame, num*sizeof(Shortint));
+  priv->num_bytes = 0;
+
+  return num;
+}
+
+static int fd_write(ctm_audio_t *audio, const Shortint *samples, int num)
+{
+  struct fd_priv *priv = audio->priv;
+  const char     *buffer = (const char *)samples;
+  size_t          left = num*sizeof(Shortint);
+  ssize_t         written;
+  struct pollfd   pfd;
+
+  while (left > 0)
+  {
+    if ((written = write(priv->out_fd, buffer, left)) == -1)
+    {
+      if (errno == EINTR)
+        continue;
+      if (errno != EAGAIN)
+        return (int)((num*sizeof(Shortint) - left) / sizeof(Shortint));
+
+      /* non-blocking descriptor: wait until it takes more */
+      pfd.fd     = priv->out_fd;
+      pfd.events = POLLOUT;
+      poll(&pfd, 1, INFTIM);
+      continue;
+    }
+    buffer += written;
+    left   -= written;
+  }
+
+  return num;
+}
+
+static int fd_pollfd(ctm_audio_t *audio, struct pollfd *pfd, int events)
+{
+  struct fd_priv *priv = audio->priv;
+
+  if (priv->eof)
+    return 0;
+
+  pfd->fd     = priv->in_fd;
+  pfd->events = POLLIN;
+  return 1;
+}
+
+static int fd_revents(ctm_audio_t *audio, struct pollfd *pfd)
+{
+  struct fd_priv *priv = audio->priv;
+  int             frame_bytes = audio->frame_len*sizeof(Shortint);
+  ssize_t         num;
+
+  if (priv->eof)
+    return POLLIN | POLLOUT;
+
+  if ((pfd->revents & (POLLIN | POLLHUP | POLLERR)) != 0)
+  {
+    num = read(priv->in_fd, (char *)priv->frame + priv->num_bytes,
+               frame_bytes - priv->num_bytes);
+    if (num == 0 || (num == -1 && errno != EAGAIN && errno != EINTR))
+    {
+      /* end of input: pass on what has been received, zero padded */
+      if (priv->num_bytes > 0)
+      {
+        memset((char *)priv->frame + priv->num_bytes, 0, frame_bytes - priv->num_bytes);
+        priv->num_bytes = frame_bytes;
+      }
+      priv->eof = true;
+      return POLLIN | POLLOUT;
+    }
+    if (num > 0)
+      priv->num_bytes += num;
+  }
+
+  if (priv->num_bytes == frame_bytes)
+    return POLLIN | POLLOUT;
+
+  return 0;
+}
+
+static int fd_timeout(ctm_audio_t *audio)
+{
+  struct fd_priv *priv = audio->priv;
+
+  return priv->eof ? 0 : -1;
+}
+
+static void fd_close(ctm_audio_t *audio)
+{
+  struct fd_priv *priv = audio->priv;
+
+  if (priv == NULL)
+    return;
+  free(priv->frame);
+  free(priv);
+}
+
+const struct ctm_audio_backend ctm_audio_fd_backend = {
+  "fd",
+  fd_open,
+  fd_start,
+  fd_read,
+  fd_write,
+  fd_pollfd,
+  fd_revents,
+  fd_timeout,
+  fd_close
+};
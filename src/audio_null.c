@@ -0,0 +1,155 @@
+/*
+*******************************************************************************
+*
+*      File             : audio_null.c
+*      Purpose          : null and clocked audio backends
+*
+*      Both read silence and discard the output. The null backend is
+*      always ready, so the session runs as fast as the signal processing
+*      allows (benchmarking). The clock backend releases one frame per
+*      frame_len/rate seconds of CLOCK_MONOTONIC, like a sound card would.
+*
+*******************************************************************************
+*/
+
+#include "audio_backend.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <err.h>
+#include <time.h>
+
+const char audio_null_id[] = "@(#)$Id: $" audio_backend_h;
+
+struct clock_priv {
+  struct timespec next;       /* time the next frame is due */
+  long            frame_ns;   /* duration of one frame      */
+};
+
+static void null_open(ctm_audio_t *audio, const char *arg)
+{
+  if (arg != NULL)
+    errx(1, "audio device \"%s\" takes no argument", audio->backend->name);
+}
+
+static void null_start(ctm_audio_t *audio)
+{
+}
+
+static int null_read(ctm_audio_t *audio, Shortint *samples, int num)
+{
+  memset(samples, 0, num*sizeof(Shortint));
+  return num;
+}
+
+static int null_write(ctm_audio_t *audio, const Shortint *samples, int num)
+{
+  return num;
+}
+
+static int null_pollfd(ctm_audio_t *audio, struct pollfd *pfd, int events)
+{
+  return 0;
+}
+
+static int null_revents(ctm_audio_t *audio, struct pollfd *pfd)
+{
+  return POLLIN | POLLOUT;
+}
+
+static int null_timeout(ctm_audio_t *audio)
+{
+  return 0;
+}
+
+static void null_close(ctm_audio_t *audio)
+{
+}
+
+const struct ctm_audio_backend ctm_audio_null_backend = {
+  "null",
+  null_open,
+  null_start,
+  null_read,
+  null_write,
+  null_pollfd,
+  null_revents,
+  null_timeout,
+  null_close
+};
+
+/* ---------------------------------------------------------------------- */
+
+/* nanoseconds from now until *t, negative if *t has passed */
+static long long clock_until(const struct timespec *t)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (long long)(t->tv_sec - now.tv_sec)*1000000000LL + (t->tv_nsec - now.tv_nsec);
+}
+
+static void clock_open(ctm_audio_t *audio, const char *arg)
+{
+  struct clock_priv *priv;
+
+  null_open(audio, arg);
+
+  if ((priv = calloc(1, sizeof(struct clock_priv))) == NULL)
+    err(1, "clock_open: calloc");
+  priv->frame_ns = (long)(1000000000LL*audio->frame_len/audio->rate);
+  audio->priv = priv;
+}
+
+static void clock_start(ctm_audio_t *audio)
+{
+  struct clock_priv *priv = audio->priv;
+
+  clock_gettime(CLOCK_MONOTONIC, &priv->next);
+}
+
+static int clock_read(ctm_audio_t *audio, Shortint *samples, int num)
+{
+  struct clock_priv *priv = audio->priv;
+
+  priv->next.tv_nsec += priv->frame_ns;
+  while (priv->next.tv_nsec >= 1000000000L)
+  {
+    priv->next.tv_nsec -= 1000000000L;
+    priv->next.tv_sec++;
+  }
+
+  return null_read(audio, samples, num);
+}
+
+static int clock_revents(ctm_audio_t *audio, struct pollfd *pfd)
+{
+  return (clock_until(&((struct clock_priv *)audio->priv)->next) <= 0) ?
+    (POLLIN | POLLOUT) : 0;
+}
+
+static int clock_timeout(ctm_audio_t *audio)
+{
+  long long ns = clock_until(&((struct clock_priv *)audio->priv)->next);
+
+  /* round up, so that the frame is due when poll() returns */
+  return (ns <= 0) ? 0 : (int)((ns + 999999) / 1000000);
+}
+
+static void clock_close(ctm_audio_t *audio)
+{
+  free(audio->priv);
+}
+
+const struct ctm_audio_backend ctm_audio_clock_backend = {
+  "clock",
+  clock_open,
+  clock_start,
+  clock_read,
+  null_write,
+  null_pollfd,
+  clock_revents,
+  clock_timeout,
+  clock_close
+};
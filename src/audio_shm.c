@@ -0,0 +1,196 @@
+/*
+*******************************************************************************
+*
+*      File             : audio_shm.c
+*      Purpose          : shared memory audio backend
+*
+*      The host (e.g. a media server in another process) writes the CTM
+*      input into the rx ring and reads the CTM output from the tx ring of
+*      a POSIX shared memory object, see struct ctm_audio_shm. As with the
+*      fd backend, each input frame releases one output frame. There is
+*      no descriptor to wait on, so the session looks at the rings every
+*      CTM_AUDIO_SHM_POLL_MS milliseconds while they are not ready.
+*
+*******************************************************************************
+*/
+
+#include "audio_backend.h"
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <err.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+const char audio_shm_id[] = "@(#)$Id: $" audio_backend_h;
+
+struct shm_priv {
+  struct ctm_audio_shm *shm;
+  size_t                size;
+};
+
+#define load_acquire(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define store_release(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+static void shm_open_backend(ctm_audio_t *audio, const char *arg)
+{
+  struct shm_priv      *priv;
+  struct ctm_audio_shm *shm;
+  struct stat           st;
+  ULongint              magic;
+  int                   fd;
+  int                   cnt;
+
+  if (arg == NULL || arg[0] != '/')
+    errx(1, "audio device \"shm\" needs an object name, e.g. \"shm:/ctm0\"");
+
+  if ((priv = calloc(1, sizeof(struct shm_priv))) == NULL)
+    err(1, "shm_open_backend: calloc");
+  audio->priv = priv;
+
+  if ((fd = shm_open(arg, O_RDWR | O_CREAT, 0600)) == -1)
+    err(1, "unable to open shared memory object \"%s\"", arg);
+  if (fstat(fd, &st) == -1)
+    err(1, "fstat");
+
+  /* a new object is sized here; the size of an existing one is only */
+  /* trusted after the header is known to fit                         */
+  if (st.st_size == 0)
+  {
+    if (ftruncate(fd, sizeof(struct ctm_audio_shm) +
+                  2*CTM_AUDIO_SHM_RING_SIZE*sizeof(Shortint)) == -1 ||
+        fstat(fd, &st) == -1)
+      err(1, "unable to size shared memory object \"%s\"", arg);
+  }
+  if ((size_t)st.st_size < sizeof(struct ctm_audio_shm))
+    errx(1, "shared memory object \"%s\" has an incompatible layout", arg);
+  priv->size = st.st_size;
+
+  shm = mmap(NULL, priv->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (shm == MAP_FAILED)
+    err(1, "unable to map shared memory object \"%s\"", arg);
+  close(fd);
+  priv->shm = shm;
+
+  /* Whoever turns magic from 0 to CTM_AUDIO_SHM_INIT sets up the      */
+  /* header; the others wait until it is published with the real magic. */
+  magic = 0;
+  if (__atomic_compare_exchange_n(&shm->magic, &magic, CTM_AUDIO_SHM_INIT, false,
+                                  __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+  {
+    shm->rate      = audio->rate;
+    shm->ring_size = CTM_AUDIO_SHM_RING_SIZE;
+    shm->rx.head = shm->rx.tail = 0;
+    shm->tx.head = shm->tx.tail = 0;
+    store_release(&shm->magic, CTM_AUDIO_SHM_MAGIC);
+  }
+  else
+  {
+    for (cnt=0; magic == CTM_AUDIO_SHM_INIT && cnt<1000; cnt++)
+    {
+      usleep(1000);
+      magic = load_acquire(&shm->magic);
+    }
+    if (magic != CTM_AUDIO_SHM_MAGIC)
+      errx(1, "shared memory object \"%s\" is not a CTM audio ring", arg);
+  }
+
+  if (shm->rate != (ULongint)audio->rate ||
+      shm->ring_size < (ULongint)audio->frame_len ||
+      (shm->ring_size & (shm->ring_size-1)) != 0 ||
+      (priv->size - sizeof(struct ctm_audio_shm)) / (2*sizeof(Shortint)) < shm->ring_size)
+    errx(1, "shared memory object \"%s\" has an incompatible layout", arg);
+}
+
+static void shm_start(ctm_audio_t *audio)
+{
+}
+
+static ULongint ring_fill(struct ctm_audio_shm_ring *ring)
+{
+  return load_acquire(&ring->head) - load_acquire(&ring->tail);
+}
+
+static int shm_read(ctm_audio_t *audio, Shortint *samples, int num)
+{
+  struct ctm_audio_shm *shm = ((struct shm_priv *)audio->priv)->shm;
+  Shortint             *data = CTM_AUDIO_SHM_RX(shm);
+  ULongint              tail = shm->rx.tail;
+  ULongint              avail = load_acquire(&shm->rx.head) - tail;
+  int                   cnt;
+
+  if ((ULongint)num > avail)
+    num = avail;
+  for (cnt=0; cnt<num; cnt++)
+    samples[cnt] = data[(tail+cnt) & (shm->ring_size-1)];
+  store_release(&shm->rx.tail, tail+num);
+
+  return num;
+}
+
+static int shm_write(ctm_audio_t *audio, const Shortint *samples, int num)
+{
+  struct ctm_audio_shm *shm = ((struct shm_priv *)audio->priv)->shm;
+  Shortint             *data = CTM_AUDIO_SHM_TX(shm);
+  ULongint              head = shm->tx.head;
+  ULongint              space = shm->ring_size - (head - load_acquire(&shm->tx.tail));
+  int                   cnt;
+
+  if ((ULongint)num > space)
+    num = space;
+  for (cnt=0; cnt<num; cnt++)
+    data[(head+cnt) & (shm->ring_size-1)] = samples[cnt];
+  store_release(&shm->tx.head, head+num);
+
+  return num;
+}
+
+static int shm_pollfd(ctm_audio_t *audio, struct pollfd *pfd, int events)
+{
+  return 0;
+}
+
+static int shm_revents(ctm_audio_t *audio, struct pollfd *pfd)
+{
+  struct ctm_audio_shm *shm = ((struct shm_priv *)audio->priv)->shm;
+
+  /* one output frame per input frame, as soon as both rings allow it */
+  if (ring_fill(&shm->rx) >= (ULongint)audio->frame_len &&
+      shm->ring_size - ring_fill(&shm->tx) >= (ULongint)audio->frame_len)
+    return POLLIN | POLLOUT;
+
+  return 0;
+}
+
+static int shm_timeout(ctm_audio_t *audio)
+{
+  return (shm_revents(audio, NULL) != 0) ? 0 : CTM_AUDIO_SHM_POLL_MS;
+}
+
+static void shm_close(ctm_audio_t *audio)
+{
+  struct shm_priv *priv = audio->priv;
+
+  if (priv == NULL)
+    return;
+  if (priv->shm != NULL)
+    munmap(priv->shm, priv->size);
+  free(priv);
+}
+
+const struct ctm_audio_backend ctm_audio_shm_backend = {
+  "shm",
+  shm_open_backend,
+  shm_start,
+  shm_read,
+  shm_write,
+  shm_pollfd,
+  shm_revents,
+  shm_timeout,
+  shm_close
+};
@@ -0,0 +1,145 @@
+/*
+*******************************************************************************
+*
+*      File             : audio_sndio.c
+*      Purpose          : sndio audio backend (duplex i/o on one device)
+*
+*******************************************************************************
+*/
+
+#include "audio_backend.h"
+
+const char audio_sndio_id[] = "@(#)$Id: $" audio_backend_h;
+
+#ifdef HAVE_SNDIO
+
+#include <sys/types.h>
+#include <sndio.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <err.h>
+
+struct sndio_priv {
+  struct sio_hdl *hdl;
+  struct sio_par  params;
+};
+
+static void sndio_open(ctm_audio_t *audio, const char *arg)
+{
+  struct sndio_priv *priv;
+  struct sio_par     dev_params;
+  const char        *device = (arg != NULL) ? arg : SIO_DEVANY;
+
+  if ((priv = calloc(1, sizeof(struct sndio_priv))) == NULL)
+    err(1, "sndio_open: calloc");
+  audio->priv = priv;
+
+  priv->hdl = sio_open(device, SIO_PLAY | SIO_REC, 1);
+  if (priv->hdl == NULL)
+  {
+    errx(1, "unable to open audio device \"%s\" for duplex i/o\n", device);
+  }
+
+  sio_initpar(&priv->params);
+  priv->params.rate = audio->rate;
+  priv->params.bits = 16;
+  priv->params.bps = 2;
+  priv->params.le = SIO_LE_NATIVE;
+  priv->params.rchan = 1;
+  priv->params.pchan = 1;
+  priv->params.appbufsz = audio->frame_len;
+
+  /* for over/underrun testing. */
+  //priv->params.xrun = SIO_ERROR;
+
+  /* attempt to set the device parameters. */
+  if (sio_setpar(priv->hdl, &priv->params) == 0)
+  {
+    errx(1, "unable to set device parameters on audio device \"%s\"\n", device);
+  }
+
+  /* check to see that the device parameters were actually set up correctly. Not all devices may support the required parameters. */
+  if (sio_getpar(priv->hdl, &dev_params) == 0)
+  {
+    errx(1, "unable to get device parameters on audio device \"%s\"\n", device);
+  }
+
+  else if ((priv->params.rate != dev_params.rate) || (priv->params.bits != dev_params.bits) || (priv->params.rchan != dev_params.rchan) || (priv->params.pchan != dev_params.pchan) || (priv->params.appbufsz != dev_params.appbufsz))
+
+  {
+    errx(1, "unable to set the correct parameters on audio device \"%s\"\n", device);
+  }
+}
+
+static void sndio_start(ctm_audio_t *audio)
+{
+  struct sndio_priv *priv = audio->priv;
+
+  if(sio_start(priv->hdl) == 0)
+    errx(1, "unable to start audio device \"%s\".\n", audio->name);
+
+  if(sio_setvol(priv->hdl, SIO_MAXVOL) == 0)
+    errx(1, "unable to set audio volume on device \"%s\".\n", audio->name);
+}
+
+static int sndio_read(ctm_audio_t *audio, Shortint *samples, int num)
+{
+  struct sndio_priv *priv = audio->priv;
+
+  return sio_read(priv->hdl, samples, num*sizeof(Shortint)) / sizeof(Shortint);
+}
+
+static int sndio_write(ctm_audio_t *audio, const Shortint *samples, int num)
+{
+  struct sndio_priv *priv = audio->priv;
+
+  return sio_write(priv->hdl, samples, num*sizeof(Shortint)) / sizeof(Shortint);
+}
+
+static int sndio_pollfd(ctm_audio_t *audio, struct pollfd *pfd, int events)
+{
+  struct sndio_priv *priv = audio->priv;
+
+  if (sio_pollfd(priv->hdl, pfd, events) != 1)
+    errx(1, "unable to setup audio device polling.");
+
+  return 1;
+}
+
+static int sndio_revents(ctm_audio_t *audio, struct pollfd *pfd)
+{
+  struct sndio_priv *priv = audio->priv;
+
+  return sio_revents(priv->hdl, pfd);
+}
+
+static int sndio_timeout(ctm_audio_t *audio)
+{
+  return -1;
+}
+
+static void sndio_close(ctm_audio_t *audio)
+{
+  struct sndio_priv *priv = audio->priv;
+
+  if (priv == NULL)
+    return;
+  if (priv->hdl != NULL)
+    sio_close(priv->hdl);
+  free(priv);
+}
+
+const struct ctm_audio_backend ctm_audio_sndio_backend = {
+  "sndio",
+  sndio_open,
+  sndio_start,
+  sndio_read,
+  sndio_write,
+  sndio_pollfd,
+  sndio_revents,
+  sndio_timeout,
+  sndio_close
+};
+
+#endif /* HAVE_SNDIO */
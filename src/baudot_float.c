@@ -0,0 +1,236 @@
+/*
+*******************************************************************************
+*
+*      File             : baudot_float.c
+*      Purpose          : Single-precision version of the demodulator for
+*                         Baudot Tones (see baudot_float.h)
+*
+*******************************************************************************
+*/
+
+/*
+*******************************************************************************
+*                         MODULE INCLUDE FILE AND VERSION ID
+*******************************************************************************
+*/
+
+#include "baudot_float.h"
+#include "baudot_functions.h"
+
+#include <typedefs.h>
+#include <fifo.h>
+#include <math.h>
+
+#if defined(__SSE2__) && !defined(BAUDOT_SCALAR)
+#define BAUDOT_FLOAT_SSE2
+#if defined(__FMA__)
+#include <immintrin.h>
+#define madd_ps(a, b, c)  _mm_fmadd_ps(a, b, c)
+#else
+#include <emmintrin.h>
+#define madd_ps(a, b, c)  _mm_add_ps(_mm_mul_ps(a, b), c)
+#endif
+#endif
+
+const char baudot_float_id[] = "@(#)$Id: $" baudot_float_h;
+
+/*
+*******************************************************************************
+*                         LOCAL DEFINES
+*******************************************************************************
+*/
+
+#define FLOAT_BLOCK_LEN  160    /* samples filtered at a time */
+
+/* filter states below this magnitude are cleared at the end of a call, */
+/* so that silence ends in zeros instead of denormal numbers             */
+#define FLOAT_MIN_STATE  (1.0f/1024.0f)
+
+/*
+*******************************************************************************
+*              PRIVATE PROGRAM CODE AND VARIABLES
+*******************************************************************************
+*/
+
+/* The floating point coefficients of baudot_functions.c, per lane       */
+/* (BP0, BP1, BP2, -, LP0, LP1, LP2, -), with the signs of a(1) and a(2)  */
+/* inverted:                                                              */
+/* y(n) = b(0)*x(n) + b(1)*x(n-1) + b(2)*x(n-2) + na(1)*y(n-1)           */
+/*        + na(2)*y(n-2)                                                  */
+
+#define LP_B   0.03046874709125f
+#define LP_NA  0.93906250581749f
+#define BP_B   0.05919070381841f
+#define BP_NA2 (-0.88161859236319f)
+
+static const float coeffB0[8]  = { LP_B,  BP_B,  BP_B, 0.0f, LP_B, LP_B, LP_B, 0.0f };
+static const float coeffB1[8]  = { LP_B,  0.0f,  0.0f, 0.0f, LP_B, LP_B, LP_B, 0.0f };
+static const float coeffB2[8]  = { 0.0f, -BP_B, -BP_B, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+static const float coeffNA1[8] = { LP_NA, 0.85592593938989f, 0.29493197879544f,
+                                   0.0f, LP_NA, LP_NA, LP_NA, 0.0f };
+static const float coeffNA2[8] = { 0.0f, BP_NA2, BP_NA2, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+/* the input of the filters in front: |x|/2 for BP0, x/2 for BP1 and BP2, */
+/* as in baudot_tonedemod()                                                */
+static const float inputAbs[8] = { 0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+static const float inputSig[8] = { 0.0f, 0.5f, 0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+/* ---------------------------------------------------------------------- */
+/* filter_block() runs the filters over numSamples samples and writes the */
+/* outputs of all lanes to out[cnt]: first the filters in front (lanes    */
+/* 0..3), then the lowpasses LP0..LP2 (lanes 4..6) on the magnitudes of   */
+/* their outputs.                                                         */
+/* ---------------------------------------------------------------------- */
+
+#if defined(BAUDOT_FLOAT_SSE2)
+
+static void filter_block(float out[][8], const Shortint *toneVec,
+                         Shortint numSamples, baudot_tonedemod_state_t *state)
+{
+  const __m128 abs_mask  = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+  const __m128 min_state = _mm_set1_ps(FLOAT_MIN_STATE);
+  const __m128 in_abs    = _mm_loadu_ps(inputAbs);
+  const __m128 in_sig    = _mm_loadu_ps(inputSig);
+  __m128   b0[2], b1[2], b2[2], na1[2], na2[2];
+  __m128   x1[2], x2[2], y1[2], y2[2];
+  __m128   x_in, x_lp, sum_bp, sum_lp;
+  Shortint cnt, half;
+  float    tone;
+
+  for (half=0; half<2; half++)
+    {
+      b0[half]  = _mm_loadu_ps(coeffB0+4*half);
+      b1[half]  = _mm_loadu_ps(coeffB1+4*half);
+      b2[half]  = _mm_loadu_ps(coeffB2+4*half);
+      na1[half] = _mm_loadu_ps(coeffNA1+4*half);
+      na2[half] = _mm_loadu_ps(coeffNA2+4*half);
+      x1[half]  = _mm_loadu_ps(state->fltIn[0]+4*half);
+      x2[half]  = _mm_loadu_ps(state->fltIn[1]+4*half);
+      y1[half]  = _mm_loadu_ps(state->fltOut[0]+4*half);
+      y2[half]  = _mm_loadu_ps(state->fltOut[1]+4*half);
+    }
+
+  for (cnt=0; cnt<numSamples; cnt++)
+    {
+      tone = (float)toneVec[cnt];
+      x_in = madd_ps(_mm_set1_ps(fabsf(tone)), in_abs,
+                     _mm_mul_ps(_mm_set1_ps(tone), in_sig));
+
+      /* y(n-1) is added last, it is the one the recursion waits for; */
+      /* the lowpasses are first order                                */
+      sum_bp = madd_ps(b2[0], x2[0], _mm_mul_ps(b1[0], x1[0]));
+      sum_bp = madd_ps(b0[0], x_in, madd_ps(na2[0], y2[0], sum_bp));
+      sum_bp = madd_ps(na1[0], y1[0], sum_bp);
+      x_lp   = _mm_and_ps(sum_bp, abs_mask);
+      sum_lp = madd_ps(b0[1], x_lp, _mm_mul_ps(b1[1], x1[1]));
+      sum_lp = madd_ps(na1[1], y1[1], sum_lp);
+      _mm_storeu_ps(out[cnt], sum_bp);
+      _mm_storeu_ps(out[cnt]+4, sum_lp);
+
+      x2[0] = x1[0];
+      x1[0] = x_in;
+      y2[0] = y1[0];
+      y1[0] = sum_bp;
+      x2[1] = x1[1];
+      x1[1] = x_lp;
+      y2[1] = y1[1];
+      y1[1] = sum_lp;
+    }
+
+  for (half=0; half<2; half++)
+    {
+      x1[half] = _mm_and_ps(x1[half], _mm_cmpge_ps(_mm_and_ps(x1[half], abs_mask), min_state));
+      x2[half] = _mm_and_ps(x2[half], _mm_cmpge_ps(_mm_and_ps(x2[half], abs_mask), min_state));
+      y1[half] = _mm_and_ps(y1[half], _mm_cmpge_ps(_mm_and_ps(y1[half], abs_mask), min_state));
+      y2[half] = _mm_and_ps(y2[half], _mm_cmpge_ps(_mm_and_ps(y2[half], abs_mask), min_state));
+      _mm_storeu_ps(state->fltIn[0]+4*half, x1[half]);
+      _mm_storeu_ps(state->fltIn[1]+4*half, x2[half]);
+      _mm_storeu_ps(state->fltOut[0]+4*half, y1[half]);
+      _mm_storeu_ps(state->fltOut[1]+4*half, y2[half]);
+    }
+}
+
+#else
+
+static void filter_block(float out[][8], const Shortint *toneVec,
+                         Shortint numSamples, baudot_tonedemod_state_t *state)
+{
+  Shortint cnt, lane;
+  float    tone;
+  float    x[8], x1[8], x2[8], y1[8], y2[8];
+
+  for (lane=0; lane<8; lane++)
+    {
+      x1[lane] = state->fltIn[0][lane];
+      x2[lane] = state->fltIn[1][lane];
+      y1[lane] = state->fltOut[0][lane];
+      y2[lane] = state->fltOut[1][lane];
+    }
+
+  for (cnt=0; cnt<numSamples; cnt++)
+    {
+      tone = (float)toneVec[cnt];
+      for (lane=0; lane<8; lane++)
+        {
+          if (lane<4)
+            x[lane] = fabsf(tone)*inputAbs[lane] + tone*inputSig[lane];
+          else
+            x[lane] = fabsf(out[cnt][lane-4]);
+          out[cnt][lane] = coeffB0[lane]*x[lane] + coeffB1[lane]*x1[lane] +
+                           coeffB2[lane]*x2[lane] + coeffNA2[lane]*y2[lane] +
+                           coeffNA1[lane]*y1[lane];
+          x2[lane] = x1[lane];
+          x1[lane] = x[lane];
+          y2[lane] = y1[lane];
+          y1[lane] = out[cnt][lane];
+        }
+    }
+
+  for (lane=0; lane<8; lane++)
+    {
+      state->fltIn[0][lane]  = fabsf(x1[lane]) < FLOAT_MIN_STATE ? 0.0f : x1[lane];
+      state->fltIn[1][lane]  = fabsf(x2[lane]) < FLOAT_MIN_STATE ? 0.0f : x2[lane];
+      state->fltOut[0][lane] = fabsf(y1[lane]) < FLOAT_MIN_STATE ? 0.0f : y1[lane];
+      state->fltOut[1][lane] = fabsf(y2[lane]) < FLOAT_MIN_STATE ? 0.0f : y2[lane];
+    }
+}
+
+#endif
+
+/*
+*******************************************************************************
+*                         PUBLIC PROGRAM CODE
+*******************************************************************************
+*/
+
+void baudot_tonedemod_float(Shortint* toneVec, Shortint numSamples,
+                            fifo_state_t* ptrOutFifoState,
+                            baudot_tonedemod_state_t* state)
+{
+  Shortint  cnt;
+  Shortint  cntBlock;
+  Shortint  numBlock;
+  float     diff;
+  float     out[FLOAT_BLOCK_LEN][8];
+
+  for (cntBlock=0; cntBlock<numSamples; cntBlock+=numBlock)
+    {
+      numBlock = numSamples-cntBlock < FLOAT_BLOCK_LEN ?
+        numSamples-cntBlock : FLOAT_BLOCK_LEN;
+
+      filter_block(out, toneVec+cntBlock, numBlock, state);
+
+      /* the normalized difference of the envelopes LP1 and LP2, see */
+      /* baudot_tonedemod()                                          */
+      for (cnt=0; cnt<numBlock; cnt++)
+        {
+          diff = (out[cnt][5]-out[cnt][6])*16384.0f /
+            (out[cnt][4]+(float)OFFSET_NORMALISATION);
+          if (diff > 32767.0f)
+            diff = 32767.0f;
+          else if (diff < -32767.0f)
+            diff = -32767.0f;
+          detect_baudot_bit((Shortint)diff, ptrOutFifoState, state);
+        }
+    }
+}
@@ -0,0 +1,60 @@
+/*
+*******************************************************************************
+*
+*      File             : baudot_float.h
+*      Purpose          : Single-precision version of the demodulator for
+*                         Baudot Tones
+*
+*      baudot_tonedemod_float() runs the six recursive filters of
+*      baudot_tonedemod() on float, one sample at a time, with the filters
+*      in front (BP0, BP1, BP2) in the four lanes of one SSE register and
+*      the lowpasses behind them (LP0, LP1, LP2) in those of another. The
+*      recursion of each filter waits for its own previous output only, so
+*      that the two registers, and consecutive samples, overlap in the
+*      pipeline; a single eight lane AVX register would need a permutation
+*      across its halves in the recursion, which costs more than it saves.
+*      The filter states are the fltIn/fltOut fields of
+*      baudot_tonedemod_state_t, the bit detection is detect_baudot_bit().
+*
+*      With __SSE2__, the filters run on explicit SSE intrinsics (with
+*      __FMA__, on fused multiply-adds); otherwise, or with BAUDOT_SCALAR,
+*      on plain C. The coefficients are the floating point values that
+*      those of baudot_tonedemod() approximate, so the signal diff is not
+*      bit-exact (ctmcompare reports the agreement with the fixed point
+*      version).
+*
+*******************************************************************************
+*/
+
+#ifndef baudot_float_h
+#define baudot_float_h "$Id: $"
+
+/*
+*******************************************************************************
+*                         INCLUDE FILES
+*******************************************************************************
+*/
+
+#include "baudot_functions.h"
+
+#include <typedefs.h>
+#include <fifo.h>
+
+/*
+*******************************************************************************
+*                         DECLARATION OF PROTOTYPES
+*******************************************************************************
+*/
+
+/* ----------------------------------------------------------------------- */
+/* FUNCTION baudot_tonedemod_float()                                       */
+/* *********************************                                       */
+/* Same interface as baudot_tonedemod(); the state must have been          */
+/* initialized by init_baudot_tonedemod().                                 */
+/* ----------------------------------------------------------------------- */
+
+void baudot_tonedemod_float(Shortint* toneVec, Shortint numSamples,
+                            fifo_state_t* ptrOutFifoState,
+                            baudot_tonedemod_state_t* state);
+
+#endif
@@ -30,6 +30,7 @@ const char baudot_functions_id[] = "@(#)$Id: $" baudot_functions_h;
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /*
 *******************************************************************************
@@ -44,7 +45,7 @@ const char baudot_functions_id[] = "@(#)$Id: $" baudot_functions_h;
 #endif
  
 /* definitions for demodulator only */
-#define OFFSET_NORMALISATION   60    /* ignore low-power audio samples  */
+#define BLOCK_LEN             160    /* samples filtered at a time           */
 #define THRESHOLD_DIFF       2300    /* 0.07*32767 reliability threshold*/
 #define THRESHOLD_STARTBIT      8    /* threshold for StartBit detection     */
 #define DURATION_STARTDETECT   70    /* time interval for start bit detector */
@@ -127,53 +128,82 @@ char convertTTYcode2char(Shortint ttyCode)
 
 
 
+#if BAUDOT_LP_FILTERORDER==1
+/* Coefficients for 1st order lowpass and 2nd order bandpass filters       */
+/* The corresponding floating point values are as follows:                 */
+/* aCoeffLowpass[]= {1.00000000000000,  -0.93906250581749};                */
+/* bCoeffLowpass[]= {0.03046874709125,   0.03046874709125};                */
+/* aCoeffBP1400[] = {1.00000000000000,-0.85592593938989, 0.88161859236319};*/
+/* bCoeffBP1400[] = {0.05919070381841,  0.0, -0.05919070381841};           */
+/* aCoeffBP1800[] = {1.00000000000000, -0.29493197879544,0.88161859236319};*/
+/* bCoeffBP1800[] = {0.05919070381841,  0.0, -0.05919070381841};           */
+/* The lowpass is run as a second order filter with a(2)=b(2)=0.           */
+
+const Shortint baudot_aCoeffLowpass[3] = {32767, -30770,     0};
+const Shortint baudot_bCoeffLowpass[3] = {  998,    998,     0};
+
+const Shortint baudot_aCoeffBP1400[3]  = {32767, -28046, 28888};
+const Shortint baudot_bCoeffBP1400[3]  = { 1940,      0, -1940};
+
+const Shortint baudot_aCoeffBP1800[3]  = {32767,  -9664, 28888};
+const Shortint baudot_bCoeffBP1800[3]  = { 1940,      0, -1940};
+#endif
+
+
+
 /****************************************************************************/
-/* iir_filt()                                                               */
-/* **********                                                               */
-/* Recursive (IIR, infinte impulse response) digital filter according to    */
-/* the following difference equation:                                       */
+/* iir_filt_block()                                                         */
+/* ****************                                                         */
+/* Recursive (IIR, infinte impulse response) digital filter of second order */
+/* according to the following difference equation:                         */
 /*                                                                          */
-/* y(n) = b(0)*x(n) + b(1)*x(n-1) + ... + b(filtOrder)*x(n-filtOrder)       */
-/*                  - a(1)*y(n-1) - ... - a(filtOrder)*y(n-filtOrder)       */
+/* y(n) = b(0)*x(n) + b(1)*x(n-1) + b(2)*x(n-2) - a(1)*y(n-1) - a(2)*y(n-2) */
 /*                                                                          */
-/* Note, that it is assumed that a(0)=0.                                    */
+/* Note, that it is assumed that a(0)=0. First order filters are run with   */
+/* a(2)=b(2)=0.                                                             */
 /*                                                                          */
 /* input variables:                                                         */
-/* - bufferIn   Vector with input samples [x(n), x(n-1),...x(n-filtOrder)]. */
-/*              This vector must be updated externally, i.e. before         */
-/*              calling iir_filt(), bufferIn has to be shifted to the       */
-/*              right and bufferIn[0] must be assigned to the value of      */
-/*              the actual input sample.                                    */
-/* - aCoeff     Vector with coefficients [   1, a(1), a(2),... a(filtOrder) */
-/* - bCoeff     Vector with coefficients [b(0), b(1), b(2),... b(filtOrder) */
-/* - filtOrder  Order of the filter                                         */
+/* - bufferIn   Vector with numSamples input samples                        */
+/* - aCoeff     Vector with coefficients [   1, a(1), a(2)]                 */
+/* - bCoeff     Vector with coefficients [b(0), b(1), b(2)]                 */
+/* - numSamples Length of bufferIn and bufferOut                            */
 /*                                                                          */
-/* input/output variables:                                                  */
-/* - bufferOut  Vector with output samples [y(n), y(n-1),...x(y-filtOrder)].*/
-/*              This vector is updated internally by iir_filt(), i.e. no    */
-/*              shift operations have to be performed externally. The       */
-/*              output sample can be obtained from bufferOut[0].            */
+/* output variables:                                                        */
+/* - bufferOut  Vector with the numSamples output samples                   */
 /*                                                                          */
-/* Matthias Doerbecker, Ericsson Eurolab Deutschland (EED/N/RV), 2000/02/17 */
+/* input/output variables:                                                  */
+/* - filter     the last two input and output samples of the previous       */
+/*              block, updated for the next one                             */
 /****************************************************************************/
 
-void iir_filt(Shortint* bufferOut, Shortint* bufferIn, 
-              Shortint* aCoeff,    Shortint* bCoeff, 
-              Shortint  filtOrder)
+static void iir_filt_block(Shortint* bufferOut, const Shortint* bufferIn,
+                           const Shortint* aCoeff, const Shortint* bCoeff,
+                           Shortint numSamples, baudot_filter_state_t* filter)
 {
   Shortint cnt;
+  Shortint x1 = filter->in[0];
+  Shortint x2 = filter->in[1];
+  Shortint y1 = filter->out[0];
+  Shortint y2 = filter->out[1];
   Longint  sum;
-  
-  /* Update the shift register for output */
-  for (cnt=filtOrder; cnt>0; cnt--)
-    bufferOut[cnt] = bufferOut[cnt-1];
-  
-  sum = (Longint)(bufferIn[0])*(Longint)(bCoeff[0]);
-  for (cnt=1; cnt<=filtOrder; cnt++)
-    sum += ((Longint)(bufferIn[cnt])*(Longint)(bCoeff[cnt]) - 
-            (Longint)(bufferOut[cnt])*(Longint)(aCoeff[cnt]));
-  
-  bufferOut[0] = (Shortint)(sum>>15);
+
+  for (cnt=0; cnt<numSamples; cnt++)
+    {
+      sum  = (Longint)(bufferIn[cnt])*(Longint)(bCoeff[0]);
+      sum += ((Longint)x1*(Longint)(bCoeff[1]) - (Longint)y1*(Longint)(aCoeff[1]));
+      sum += ((Longint)x2*(Longint)(bCoeff[2]) - (Longint)y2*(Longint)(aCoeff[2]));
+
+      x2 = x1;
+      x1 = bufferIn[cnt];
+      y2 = y1;
+      y1 = (Shortint)(sum>>15);
+      bufferOut[cnt] = y1;
+    }
+
+  filter->in[0]  = x1;
+  filter->in[1]  = x2;
+  filter->out[0] = y1;
+  filter->out[1] = y2;
 }
 
 
@@ -193,28 +223,34 @@ void iir_filt(Shortint* bufferOut, Shortint* bufferIn,
 void init_baudot_tonedemod(baudot_tonedemod_state_t* state)
 {
   Shortint cnt;
+  Shortint lane;
   
   for (cnt=0; cnt<=BAUDOT_BIT_DURATION; cnt++)
     state->bufferDiff[cnt] = 0;
+  state->posDiff = 0;
 
-  for (cnt=0; cnt<=BAUDOT_BP_FILTERORDER; cnt++)
+  for (cnt=0; cnt<BAUDOT_BP_FILTERORDER; cnt++)
     {
-      state->bufferToneVec[cnt] = 0;
-      state->bufferAbsToneVec[cnt] = 0;
-      state->bufferBP0out[cnt] = 0;
-      state->bufferBP1out[cnt] = 0;
-      state->bufferBP2out[cnt] = 0;
+      state->filterBP0.in[cnt]  = 0;
+      state->filterBP0.out[cnt] = 0;
+      state->filterBP1.in[cnt]  = 0;
+      state->filterBP1.out[cnt] = 0;
+      state->filterBP2.in[cnt]  = 0;
+      state->filterBP2.out[cnt] = 0;
+      state->filterLP0.in[cnt]  = 0;
+      state->filterLP0.out[cnt] = 0;
+      state->filterLP1.in[cnt]  = 0;
+      state->filterLP1.out[cnt] = 0;
+      state->filterLP2.in[cnt]  = 0;
+      state->filterLP2.out[cnt] = 0;
     }
+  for (cnt=0; cnt<BAUDOT_BP_FILTERORDER; cnt++)
+    for (lane=0; lane<8; lane++)
+      {
+        state->fltIn[cnt][lane]  = 0.0f;
+        state->fltOut[cnt][lane] = 0.0f;
+      }
   
-  for (cnt=0; cnt<=BAUDOT_LP_FILTERORDER; cnt++)
-    {
-      state->bufferLP0out[cnt] = 0;
-      state->bufferLP1out[cnt] = 0;
-      state->bufferLP2out[cnt] = 0;
-      state->bufferLP0in[cnt] = 0;
-      state->bufferLP1in[cnt] = 0;
-      state->bufferLP2in[cnt] = 0;
-    }
   state->cntSamplesForStartBit= 0;
   state->cntSamplesForNextBit = 0;
   state->startBitDetected     = false;
@@ -236,6 +272,113 @@ void reset_baudot_tonedemod(baudot_tonedemod_state_t* state)
 }
 
 
+/****************************************************************************/
+/* detect_baudot_bit()                                                      */
+/* *******************                                                      */
+/* Start bit detection and bit decisions of the Baudot demodulator, for one */
+/* sample of the signal diff (see baudot_tonedemod()).                      */
+/****************************************************************************/
+
+void detect_baudot_bit(Shortint diff, fifo_state_t* ptrOutFifoState,
+                       baudot_tonedemod_state_t* state)
+{
+  Shortint  diffOneBitAgo;
+
+  /* bufferDiff is circular: the entry after the actual one is the diff */
+  /* of BAUDOT_BIT_DURATION samples ago                                  */
+  if (++state->posDiff > BAUDOT_BIT_DURATION)
+    state->posDiff = 0;
+  state->bufferDiff[state->posDiff] = diff;
+  diffOneBitAgo = state->bufferDiff[state->posDiff<BAUDOT_BIT_DURATION ?
+                                    state->posDiff+1 : 0];
+  
+  if (!state->startBitDetected)
+    {
+      /* Start bit has not been detected yet: Since the start bit  */
+      /* is always 0 (1800 Hz), we can detect the start bit by     */
+      /* counting the number of samples for which diff is smaller  */
+      /* (more negative) than                                      */
+      /* THRESHOLD_STARTBIT*diff(n-bitDuration),                   */
+      /* i.e. diff is compared to its (scaled) value one bit ago   */
+      if ((Longint)diff < THRESHOLD_STARTBIT*
+          (Longint)(min(diffOneBitAgo, -328)))
+        state->cntSamplesForStartBit++;
+      else
+        state->cntSamplesForStartBit=0;
+      
+      if ((state->cntSamplesForStartBit>=DURATION_STARTDETECT) &
+          (abs(diff) > THRESHOLD_DIFF))
+        {
+          /* detectStartBit has exceeded its threshold for more than */
+          /* DURATION_STARTDETECT samples and magnitude of diff is   */
+          /* reliable enough --> This must be a start bit!!!         */ 
+          state->startBitDetected=true;
+          
+          /* Reset the counter for the received bits of the actual   */
+          /* character as well as the sample counter between         */
+          /* adjacent bits.                                          */
+          state->cntBitsActualChar = 0;
+          state->cntSamplesForNextBit=0;
+          state->ttyCode = 0;
+        }
+    }
+  else
+    {
+      /* Start bit has already been detected                         */
+      /* --> update the sample counter between adjacent bits         */
+      state->cntSamplesForNextBit++;
+      
+      if(state->cntSamplesForNextBit>=BAUDOT_BIT_DURATION)
+        {
+          /* The time interval between the last bit and the next     */
+          /* bit is over now --> check whether diff is reliable.     */
+          if (abs(diff) <= THRESHOLD_DIFF)
+            {
+              /* diff is not reliable enough -> discard all bits of  */
+              /* this character and wait for next start bit.         */
+              state->startBitDetected  = false;
+              state->cntBitsActualChar = 0;
+            }
+          else
+            {
+              /* Check, whether the actual bit is still an info bit */
+              if(state->cntBitsActualChar < BAUDOT_NUM_INFO_BITS)
+                {
+                  /* Receive and store the bit */
+                  if (diff>0)
+                    state->ttyCode =
+                      state->ttyCode + (1<<(state->cntBitsActualChar));
+                  
+                  state->cntBitsActualChar++;
+                  state->cntSamplesForNextBit=0;
+                }
+              else /* The actual bit is a stop bit */
+                {
+                  if (diff<0)
+                    /* The stop bit is not +1 (1400 Hz)          */
+                    /* --> forget this character and do nothing! */
+                    diff=diff;
+                  else if(state->ttyCode==BAUDOT_SHIFT_FIGURES)
+                    state->inFigureMode=true;
+                  else if(state->ttyCode==BAUDOT_SHIFT_LETTERS)
+                    state->inFigureMode=false;
+                  else
+                    {
+                      if(state->inFigureMode)
+                        state->ttyCode=state->ttyCode+32;
+                      Shortint_fifo_push(ptrOutFifoState, 
+                                         &(state->ttyCode), 1);
+                    }
+                  /* Now we have to wait again for the next start bit */
+                  state->startBitDetected  = false;
+                  state->cntBitsActualChar = 0;
+                }
+            }
+        }
+    }
+}
+
+
 /****************************************************************************/
 /* baudot_tonedemod()                                                       */
 /* ******************                                                       */
@@ -257,30 +400,18 @@ void baudot_tonedemod(Shortint* toneVec, Shortint numSamples,
                       fifo_state_t* ptrOutFifoState,
                       baudot_tonedemod_state_t* state)
 {
-#if BAUDOT_LP_FILTERORDER==1
-  /* Coefficients for 1st order lowpass and 2nd order bandpass filters       */
-  /* The corresponding floating point values are as follows:                 */
-  /* aCoeffLowpass[]= {1.00000000000000,  -0.93906250581749};                */
-  /* bCoeffLowpass[]= {0.03046874709125,   0.03046874709125};                */
-  /* aCoeffBP1400[] = {1.00000000000000,-0.85592593938989, 0.88161859236319};*/
-  /* bCoeffBP1400[] = {0.05919070381841,  0.0, -0.05919070381841};           */
-  /* aCoeffBP1800[] = {1.00000000000000, -0.29493197879544,0.88161859236319};*/
-  /* bCoeffBP1800[] = {0.05919070381841,  0.0, -0.05919070381841};           */
-  
-  static Shortint aCoeffLowpass[] = {32767, -30770};
-  static Shortint bCoeffLowpass[] = {  998,    998};
-  
-  static Shortint aCoeffBP1400[]  = {32767, -28046, 28888};
-  static Shortint bCoeffBP1400[]  = { 1940,      0, -1940};
-  
-  static Shortint aCoeffBP1800[]  = {32767,  -9664,  28888};
-  static Shortint bCoeffBP1800[]  = { 1940,      0, -1940};
-  
-#endif
-
   Shortint  cnt;
-  Shortint  cntSample;
+  Shortint  cntBlock;
+  Shortint  numBlock;
   Shortint  diff;
+  Shortint  toneIn[BLOCK_LEN];
+  Shortint  absToneIn[BLOCK_LEN];
+  Shortint  outBP0[BLOCK_LEN];
+  Shortint  outBP1[BLOCK_LEN];
+  Shortint  outBP2[BLOCK_LEN];
+  Shortint  outLP0[BLOCK_LEN];
+  Shortint  outLP1[BLOCK_LEN];
+  Shortint  outLP2[BLOCK_LEN];
   
 #ifdef DEBUG_OUTPUT
   static FILE  *baudot_info_file;
@@ -313,22 +444,23 @@ void baudot_tonedemod(Shortint* toneVec, Shortint numSamples,
   /*       +-->| abs |-->|  LP   |-->| LP |-----------------+              */
   /*           +-----+   +-------+   +----+                                */
   
-  for (cntSample=0; cntSample<numSamples; cntSample++)
+  for (cntBlock=0; cntBlock<numSamples; cntBlock+=numBlock)
     {
-      for (cnt=BAUDOT_BP_FILTERORDER; cnt>0; cnt--)
+      numBlock = min(numSamples-cntBlock, BLOCK_LEN);
+
+      /* The filters run over the whole block, one after the other. */
+      for (cnt=0; cnt<numBlock; cnt++)
         {
-          state->bufferToneVec[cnt]    = state->bufferToneVec[cnt-1];
-          state->bufferAbsToneVec[cnt] = state->bufferAbsToneVec[cnt-1];
+          toneIn[cnt]    = (toneVec[cntBlock+cnt])>>1;
+          absToneIn[cnt] = abs(toneVec[cntBlock+cnt]>>1);
         }
-      state->bufferToneVec[0]    = (toneVec[cntSample])>>1;
-      state->bufferAbsToneVec[0] = abs(toneVec[cntSample]>>1);
       
-      iir_filt(state->bufferBP1out, state->bufferToneVec,
-               aCoeffBP1400, bCoeffBP1400, BAUDOT_BP_FILTERORDER);
-      iir_filt(state->bufferBP2out, state->bufferToneVec,
-               aCoeffBP1800, bCoeffBP1800, BAUDOT_BP_FILTERORDER);
-      iir_filt(state->bufferBP0out, state->bufferAbsToneVec,
-               aCoeffLowpass, bCoeffLowpass, BAUDOT_LP_FILTERORDER);
+      iir_filt_block(outBP1, toneIn, baudot_aCoeffBP1400, baudot_bCoeffBP1400,
+                     numBlock, &state->filterBP1);
+      iir_filt_block(outBP2, toneIn, baudot_aCoeffBP1800, baudot_bCoeffBP1800,
+                     numBlock, &state->filterBP2);
+      iir_filt_block(outBP0, absToneIn, baudot_aCoeffLowpass, baudot_bCoeffLowpass,
+                     numBlock, &state->filterBP0);
       
       /* The filter "BP0" isn't really a bandpass. However, since it is */
       /* co-located in parallel to the bandpass filters BP1 and BP2, I  */
@@ -339,129 +471,39 @@ void baudot_tonedemod(Shortint* toneVec, Shortint numSamples,
       /* its impulse response is equal to the envelope of the           */
       /* bandpass filters BP1 and BP2.                                  */
       
-      for (cnt=BAUDOT_LP_FILTERORDER; cnt>0; cnt--)
-        {
-          state->bufferLP0in[cnt] = state->bufferLP0in[cnt-1];
-          state->bufferLP1in[cnt] = state->bufferLP1in[cnt-1];
-          state->bufferLP2in[cnt] = state->bufferLP2in[cnt-1];
-        }
-      
-      state->bufferLP0in[0] = abs(state->bufferBP0out[0]);
-      state->bufferLP1in[0] = abs(state->bufferBP1out[0]);
-      state->bufferLP2in[0] = abs(state->bufferBP2out[0]);
-
-      iir_filt(state->bufferLP0out, state->bufferLP0in,
-               aCoeffLowpass, bCoeffLowpass, BAUDOT_LP_FILTERORDER);
-      iir_filt(state->bufferLP1out, state->bufferLP1in,
-               aCoeffLowpass, bCoeffLowpass, BAUDOT_LP_FILTERORDER);
-      iir_filt(state->bufferLP2out, state->bufferLP2in,
-               aCoeffLowpass, bCoeffLowpass, BAUDOT_LP_FILTERORDER);
-      
-      /* diff is positive, if the power in the 1400 Hz band is higher than */
-      /* the power in the 1800 Hz band. diff is negative if the power in   */
-      /* the 1800 Hz band is higher. The magnnitude of diff provides       */
-      /* reliability information, i.e. it indicates which amount of the    */
-      /* input signal power is concentrated in the two band pass channels. */
-      diff = ((((Longint)(state->bufferLP1out[0]) - 
-                (Longint)(state->bufferLP2out[0]))<<14) /
-              ((Longint)(state->bufferLP0out[0])+OFFSET_NORMALISATION));
-      // fprintf(stderr, "%d, ", diff);
-            
-#ifdef DEBUG_OUTPUT
-      if (fwrite(&diff, sizeof(Shortint),1, baudot_info_file) == 0)
+      for (cnt=0; cnt<numBlock; cnt++)
         {
-          fprintf(stderr,"Error while writing to baudot_info.srt\n\n");
-          exit(1);
+          outBP0[cnt] = abs(outBP0[cnt]);
+          outBP1[cnt] = abs(outBP1[cnt]);
+          outBP2[cnt] = abs(outBP2[cnt]);
         }
-#endif
 
-      for (cnt=BAUDOT_BIT_DURATION; cnt>0; cnt--)
-        state->bufferDiff[cnt] = state->bufferDiff[cnt-1];
-      state->bufferDiff[0] = diff;
+      iir_filt_block(outLP0, outBP0, baudot_aCoeffLowpass, baudot_bCoeffLowpass,
+                     numBlock, &state->filterLP0);
+      iir_filt_block(outLP1, outBP1, baudot_aCoeffLowpass, baudot_bCoeffLowpass,
+                     numBlock, &state->filterLP1);
+      iir_filt_block(outLP2, outBP2, baudot_aCoeffLowpass, baudot_bCoeffLowpass,
+                     numBlock, &state->filterLP2);
       
-      if (!state->startBitDetected)
+      for (cnt=0; cnt<numBlock; cnt++)
         {
-          /* Start bit has not been detected yet: Since the start bit  */
-          /* is always 0 (1800 Hz), we can detect the start bit by     */
-          /* counting the number of samples for which diff is smaller  */
-          /* (more negative) than                                      */
-          /* THRESHOLD_STARTBIT*diff(n-bitDuration),                   */
-          /* i.e. diff is compared to its (scaled) value one bit ago   */
-          if ((Longint)diff < THRESHOLD_STARTBIT*
-              (Longint)(min(state->bufferDiff[BAUDOT_BIT_DURATION], -328)))
-            state->cntSamplesForStartBit++;
-          else
-            state->cntSamplesForStartBit=0;
-          
-          if ((state->cntSamplesForStartBit>=DURATION_STARTDETECT) &
-              (abs(diff) > THRESHOLD_DIFF))
+          /* diff is positive, if the power in the 1400 Hz band is higher than */
+          /* the power in the 1800 Hz band. diff is negative if the power in   */
+          /* the 1800 Hz band is higher. The magnnitude of diff provides       */
+          /* reliability information, i.e. it indicates which amount of the    */
+          /* input signal power is concentrated in the two band pass channels. */
+          diff = ((((Longint)(outLP1[cnt]) - (Longint)(outLP2[cnt]))<<14) /
+                  ((Longint)(outLP0[cnt])+OFFSET_NORMALISATION));
+            
+#ifdef DEBUG_OUTPUT
+          if (fwrite(&diff, sizeof(Shortint),1, baudot_info_file) == 0)
             {
-              /* detectStartBit has exceeded its threshold for more than */
-              /* DURATION_STARTDETECT samples and magnitude of diff is   */
-              /* reliable enough --> This must be a start bit!!!         */ 
-              state->startBitDetected=true;
-              
-              /* Reset the counter for the received bits of the actual   */
-              /* character as well as the sample counter between         */
-              /* adjacent bits.                                          */
-              state->cntBitsActualChar = 0;
-              state->cntSamplesForNextBit=0;
-              state->ttyCode = 0;
-            }
-        }
-      else
-        {
-          /* Start bit has already been detected                         */
-          /* --> update the sample counter between adjacent bits         */
-          state->cntSamplesForNextBit++;
-          
-          if(state->cntSamplesForNextBit>=BAUDOT_BIT_DURATION)
-            {
-              /* The time interval between the last bit and the next     */
-              /* bit is over now --> check whether diff is reliable.     */
-              if (abs(diff) <= THRESHOLD_DIFF)
-                {
-                  /* diff is not reliable enough -> discard all bits of  */
-                  /* this character and wait for next start bit.         */
-                  state->startBitDetected  = false;
-                  state->cntBitsActualChar = 0;
-                }
-              else
-                {
-                  /* Check, whether the actual bit is still an info bit */
-                  if(state->cntBitsActualChar < BAUDOT_NUM_INFO_BITS)
-                    {
-                      /* Receive and store the bit */
-                      if (diff>0)
-                        state->ttyCode =
-                          state->ttyCode + (1<<(state->cntBitsActualChar));
-                      
-                      state->cntBitsActualChar++;
-                      state->cntSamplesForNextBit=0;
-                    }
-                  else /* The actual bit is a stop bit */
-                    {
-                      if (diff<0)
-                        /* The stop bit is not +1 (1400 Hz)          */
-                        /* --> forget this character and do nothing! */
-                        diff=diff;
-                      else if(state->ttyCode==BAUDOT_SHIFT_FIGURES)
-                        state->inFigureMode=true;
-                      else if(state->ttyCode==BAUDOT_SHIFT_LETTERS)
-                        state->inFigureMode=false;
-                      else
-                        {
-                          if(state->inFigureMode)
-                            state->ttyCode=state->ttyCode+32;
-                          Shortint_fifo_push(ptrOutFifoState, 
-                                             &(state->ttyCode), 1);
-                        }
-                      /* Now we have to wait again for the next start bit */
-                      state->startBitDetected  = false;
-                      state->cntBitsActualChar = 0;
-                    }
-                }
+              fprintf(stderr,"Error while writing to baudot_info.srt\n\n");
+              exit(1);
             }
+#endif
+
+          detect_baudot_bit(diff, ptrOutFifoState, state);
         }
     }
 }
@@ -491,6 +533,15 @@ void init_baudot_tonemod(baudot_tonemod_state_t* state)
   Shortint_fifo_init(&(state->fifo_state), 32);
 }
 
+/****************************************************************************/
+/* exit_baudot_tonemod()                                                    */
+/****************************************************************************/
+
+void exit_baudot_tonemod(baudot_tonemod_state_t* state)
+{
+  Shortint_fifo_exit(&(state->fifo_state));
+}
+
 /****************************************************************************/
 /* reset_baudot_tonemod()                                                   */
 /****************************************************************************/
@@ -507,6 +558,37 @@ void reset_baudot_tonemod(baudot_tonemod_state_t* state)
   Shortint_fifo_reset(&(state->fifo_state));
 }
 
+/* Output of baudot_tonemod() for 1400 Hz and 1800 Hz (phase steps of 7 */
+/* and 9 per sample, see below): toneTab[k] = sinTable[(k*step)%40]>>1.  */
+/* Starting at phase p, the next samples are toneTab[k0+1], ...,         */
+/* toneTab[k0+40] with k0 = p*step^-1 mod 40 (23 for 7, 9 for 9); the    */
+/* period is repeated so that any start yields 40 contiguous samples.    */
+
+static const Shortint toneTab1400[80] =
+  {     0,  14598,  13254,  -2563, -15582, -11585,   5063,  16182,
+     9630,  -7438, -16384,  -7438,   9630,  16182,   5063, -11585,
+   -15582,  -2563,  13254,  14598,      0, -14598, -13255,   2563,
+    15581,  11585,  -5063, -16182,  -9630,   7438,  16383,   7438,
+    -9630, -16182,  -5063,  11585,  15581,   2563, -13255, -14598,
+        0,  14598,  13254,  -2563, -15582, -11585,   5063,  16182,
+     9630,  -7438, -16384,  -7438,   9630,  16182,   5063, -11585,
+   -15582,  -2563,  13254,  14598,      0, -14598, -13255,   2563,
+    15581,  11585,  -5063, -16182,  -9630,   7438,  16383,   7438,
+    -9630, -16182,  -5063,  11585,  15581,   2563, -13255, -14598};
+
+static const Shortint toneTab1800[80] =
+  {     0,  16182,   5063, -14598,  -9630,  11585,  13254,  -7438,
+   -15582,   2563,  16383,   2563, -15582,  -7438,  13254,  11585,
+    -9630, -14598,   5063,  16182,      0, -16182,  -5063,  14598,
+     9630, -11585, -13255,   7438,  15581,  -2563, -16384,  -2563,
+    15581,   7438, -13255, -11585,   9630,  14598,  -5063, -16182,
+        0,  16182,   5063, -14598,  -9630,  11585,  13254,  -7438,
+   -15582,   2563,  16383,   2563, -15582,  -7438,  13254,  11585,
+    -9630, -14598,   5063,  16182,      0, -16182,  -5063,  14598,
+     9630, -11585, -13255,   7438,  15581,  -2563, -16384,  -2563,
+    15581,   7438, -13255, -11585,   9630,  14598,  -5063, -16182};
+
+
 /****************************************************************************/
 /* baudot_tonemod()                                                         */
 /* ****************                                                         */
@@ -538,23 +620,22 @@ void baudot_tonemod(Shortint  inputTTYcode,
 {
   Shortint   cnt;
   Shortint   cntTxBits=0;
+  Shortint   cntOut;
+  Shortint   numRun;
+  Shortint   numChunk;
+  Shortint   step;
+  Shortint   k0;
+  const Shortint *toneTab;
   
-  const Shortint sinTable[] = 
-  {0,        5126,  10126,  14876,  19260,  
-   23170,   26509,  29196,  31163,  32364,  
-   32767,   32364,  31163,  29196,  26509, 
-   23170,   19260,  14876,  10126,   5126,
-   -0,      -5126, -10126, -14876, -19260,  
-   -23170, -26509, -29196, -31163, -32364,  
-   -32767, -32364, -31163, -29196, -26509, 
-   -23170, -19260, -14876, -10126,  -5126};
+  /* The samples are those of a walk through the following table: */
+  /* sinTable[] = {0, 5126, 10126, ... 32767, ..., -10126, -5126}, */
+  /* i.e. 32767*sin(2*pi*n/40), n=0..39, see toneTab1400[] and     */
+  /* toneTab1800[].                                                */
   
-  /* The following vector is static in order to prevent a reallocation   */
-  /* with each call of this function. The contents of the vector is not  */
-  /* required after leaving this function, therefore the use of static   */
-  /* variables does not prevent multiple instances of this function.     */
+  /* Scratch buffer; its contents is not required after leaving this    */
+  /* function, so it lives on the stack of the calling instance.         */
   
-  static Shortint  TxBitsBuffer[2*(1+BAUDOT_NUM_INFO_BITS+NUM_STOP_BITS_TX)];
+  Shortint  TxBitsBuffer[2*(1+BAUDOT_NUM_INFO_BITS+NUM_STOP_BITS_TX)];
   
   /* Check, whether actual character is valid */
   if ((inputTTYcode>=0) && (inputTTYcode<64))
@@ -614,9 +695,10 @@ void baudot_tonemod(Shortint  inputTTYcode,
         }
     }
   
-  /* Now the output samples are generated */
+  /* Now the output samples are generated, a run of samples of the same */
+  /* bit at a time                                                       */
   
-  for (cnt=0; cnt<lengthToneVec; cnt++)
+  for (cntOut=0; cntOut<lengthToneVec; cntOut+=numRun)
     {
       if (state->cntSample == 0)
         {
@@ -631,30 +713,43 @@ void baudot_tonemod(Shortint  inputTTYcode,
             state->txBitAvailable = false;
         }
       
-      /* Do the modulation or generate zero output */
-      /* if there is no bit available              */
+      /* Generate zero output if there is no bit available; nothing is  */
+      /* pushed to the fifo buffer before the next call.                */
+      if (!state->txBitAvailable)
+        {
+          state->phaseValue = 0;
+          memset(outputToneVec+cntOut, 0, (lengthToneVec-cntOut)*sizeof(Shortint));
+          break;
+        }
+      
+      /* phaseValue corresponds to the mathematical phase as follows: */
+      /* phase = 2*pi*phaseValue*200/8000; it advances by step per    */
+      /* sample, i.e. 1400 Hz for a one bit, 1800 Hz for a zero bit.  */
+      step    = 9-2*state->txBitActual;
+      numRun  = min(lengthToneVec-cntOut, BAUDOT_BIT_DURATION-state->cntSample);
       
-      if (state->txBitAvailable)
+      if (step == 7)
         {
-          /* phaseValue corresponds to the mathematical phase as follows: */
-          /* phase = 2*pi*phaseValue*200/8000                             */
-          state->phaseValue = state->phaseValue + 9-2*state->txBitActual;
-          
-          /* check whether phase is > 2*pi */
-          if (state->phaseValue >= 40)
-            state->phaseValue = state->phaseValue-40;
-          
-          outputToneVec[cnt] = (sinTable[state->phaseValue])>>1;
-          
-          state->cntSample++;
-          if (state->cntSample >= BAUDOT_BIT_DURATION)
-            state->cntSample = 0;
+          toneTab = toneTab1400;
+          k0      = (state->phaseValue*23) % 40;
         }
       else
         {
-          state->phaseValue  = 0;
-          outputToneVec[cnt] = 0;
+          toneTab = toneTab1800;
+          k0      = (state->phaseValue*9) % 40;
+        }
+      
+      for (cnt=0; cnt<numRun; cnt+=numChunk)
+        {
+          numChunk = min(numRun-cnt, 40);
+          memcpy(outputToneVec+cntOut+cnt, toneTab+k0+1, numChunk*sizeof(Shortint));
+          k0 = (k0+numChunk) % 40;
         }
+      
+      state->phaseValue = (state->phaseValue + numRun*step) % 40;
+      state->cntSample += numRun;
+      if (state->cntSample >= BAUDOT_BIT_DURATION)
+        state->cntSample = 0;
     }
   
   /* Determine, how many bits still have to be modulated (consider also */
@@ -47,6 +47,16 @@
 /* but required for the following typedefs)  */
 #define BAUDOT_LP_FILTERORDER      1
 #define BAUDOT_BP_FILTERORDER      2*BAUDOT_LP_FILTERORDER
+#define OFFSET_NORMALISATION      60  /* ignore low-power audio samples  */
+
+
+/* coefficients of the demodulator filters [1, a(1), a(2)], [b(0), b(1), b(2)] */
+extern const Shortint baudot_aCoeffLowpass[3];
+extern const Shortint baudot_bCoeffLowpass[3];
+extern const Shortint baudot_aCoeffBP1400[3];
+extern const Shortint baudot_bCoeffBP1400[3];
+extern const Shortint baudot_aCoeffBP1800[3];
+extern const Shortint baudot_bCoeffBP1800[3];
 
 
 /* ******************************************************************/
@@ -54,19 +64,31 @@
 /* Baudot demodulator and modulator, respectively                   */
 /* ******************************************************************/
 
+/* state of one recursive filter of the demodulator (see iir_filt_block()) */
 typedef struct {
-  Shortint    bufferToneVec[BAUDOT_BP_FILTERORDER+1];
-  Shortint    bufferAbsToneVec[BAUDOT_BP_FILTERORDER+1];
-  Shortint    bufferBP0out[BAUDOT_BP_FILTERORDER+1];
-  Shortint    bufferBP1out[BAUDOT_BP_FILTERORDER+1];
-  Shortint    bufferBP2out[BAUDOT_BP_FILTERORDER+1];
-  Shortint    bufferLP0out[BAUDOT_LP_FILTERORDER+1];
-  Shortint    bufferLP1out[BAUDOT_LP_FILTERORDER+1];
-  Shortint    bufferLP2out[BAUDOT_LP_FILTERORDER+1];
-  Shortint    bufferLP0in[BAUDOT_LP_FILTERORDER+1];
-  Shortint    bufferLP1in[BAUDOT_LP_FILTERORDER+1];
-  Shortint    bufferLP2in[BAUDOT_LP_FILTERORDER+1];
+  Shortint    in[BAUDOT_BP_FILTERORDER];   /* x(n-1), x(n-2)                */
+  Shortint    out[BAUDOT_BP_FILTERORDER];  /* y(n-1), y(n-2)                */
+} baudot_filter_state_t;
+
+typedef struct {
+  baudot_filter_state_t  filterBP0;   /* lowpass on the rectified signal   */
+  baudot_filter_state_t  filterBP1;   /* bandpass 1400 Hz                  */
+  baudot_filter_state_t  filterBP2;   /* bandpass 1800 Hz                  */
+  baudot_filter_state_t  filterLP0;   /* envelope lowpasses                */
+  baudot_filter_state_t  filterLP1;
+  baudot_filter_state_t  filterLP2;
+
+  /* the same filters in baudot_tonedemod_float(), see baudot_float.h: */
+  /* x(n-1), x(n-2) and y(n-1), y(n-2) of BP0, BP1, BP2, -, LP0, LP1,   */
+  /* LP2, -                                                             */
+  float       fltIn[BAUDOT_BP_FILTERORDER][8];
+  float       fltOut[BAUDOT_BP_FILTERORDER][8];
+
+  /* the signal diff of the last BAUDOT_BIT_DURATION+1 samples, circular; */
+  /* the actual value is bufferDiff[posDiff]                              */
   Shortint    bufferDiff[BAUDOT_BIT_DURATION+1];
+  Shortint    posDiff;
+
   Shortint    ttyCode;
   Shortint    cntBitsActualChar;
   Shortint    cntSamplesForStartBit;
@@ -164,6 +186,27 @@ void baudot_tonedemod(Shortint* toneVec, Shortint numSamples,
                       fifo_state_t* ptrOutFifoState,
                       baudot_tonedemod_state_t* state);
 
+
+/****************************************************************************/
+/* detect_baudot_bit()                                                      */
+/* *******************                                                      */
+/* Start bit detection and bit decisions of baudot_tonedemod(), for one     */
+/* sample of the signal diff; for baudot_tonedemod_multi(), which computes  */
+/* diff for several channels at once.                                       */
+/*                                                                          */
+/* input variables:                                                         */
+/* - diff              the normalized difference of the envelopes           */
+/*                                                                          */
+/* input/output variables:                                                  */
+/* - ptrOutFifoState   Pointer to the state of the output shift register    */
+/*                     containing the demodulated TTY codes                 */
+/* - state             Pointer to the state variable of baudot_tonedemod()  */
+/****************************************************************************/
+
+void detect_baudot_bit(Shortint diff, fifo_state_t* ptrOutFifoState,
+                       baudot_tonedemod_state_t* state);
+
+
 void reset_baudot_tonemod(baudot_tonemod_state_t* state);
 
 
@@ -181,6 +224,8 @@ void reset_baudot_tonemod(baudot_tonemod_state_t* state);
 
 void init_baudot_tonemod(baudot_tonemod_state_t* state);
 
+void exit_baudot_tonemod(baudot_tonemod_state_t* state);
+
 
 
 /****************************************************************************/
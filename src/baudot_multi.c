@@ -0,0 +1,394 @@
+/*
+*******************************************************************************
+*
+*      File             : baudot_multi.c
+*      Purpose          : Demodulator for Baudot Tones for several channels
+*                         at once, with an SSE2 version
+*
+*******************************************************************************
+*/
+
+/*
+*******************************************************************************
+*                         MODULE INCLUDE FILE AND VERSION ID
+*******************************************************************************
+*/
+
+#include "baudot_multi.h"
+#include "baudot_functions.h"
+
+#include <typedefs.h>
+#include <fifo.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The SSE2 version holds the eight lanes in one register of 16 bit */
+/* values; with AVX, the division takes four lanes at a time.       */
+#if !defined(BAUDOT_SCALAR) && BAUDOT_LANES == 8
+#if defined(__SSE2__)
+#define BAUDOT_MULTI_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+#define BAUDOT_MULTI_AVX
+#include <immintrin.h>
+#endif
+#endif
+
+const char baudot_multi_id[] = "@(#)$Id: $" baudot_multi_h;
+
+/*
+*******************************************************************************
+*                         LOCAL DEFINES
+*******************************************************************************
+*/
+
+#define MULTI_BLOCK_LEN  160    /* samples filtered at a time */
+
+/* index of the filters of a demodulator */
+enum { FILTER_BP0, FILTER_BP1, FILTER_BP2, FILTER_LP0, FILTER_LP1, FILTER_LP2,
+       NUM_FILTERS };
+
+/*
+*******************************************************************************
+*              PRIVATE PROGRAM CODE AND VARIABLES
+*******************************************************************************
+*/
+
+static baudot_filter_state_t *channel_filter(baudot_tonedemod_state_t *state,
+                                             Shortint filter)
+{
+  switch (filter) {
+  case FILTER_BP0: return &state->filterBP0;
+  case FILTER_BP1: return &state->filterBP1;
+  case FILTER_BP2: return &state->filterBP2;
+  case FILTER_LP0: return &state->filterLP0;
+  case FILTER_LP1: return &state->filterLP1;
+  default:         return &state->filterLP2;
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+/* baudot_lanes_t holds one Shortint of each lane. filter_lanes() runs a  */
+/* filter of all lanes for one sample, as iir_filt_block() in             */
+/* baudot_functions.c does for one lane; diff_lanes() normalises the      */
+/* difference of the envelopes as baudot_tonedemod() does.                */
+/* ---------------------------------------------------------------------- */
+
+#if defined(BAUDOT_MULTI_SSE2)
+
+typedef __m128i baudot_lanes_t;
+
+/* The coefficients as pairs of 16 bit values for _mm_madd_epi16(): */
+/*   (x(n), x(n-1)) * (b(0), b(1)) + (y(n-1), y(n-2)) * (-a(1), -a(2)) */
+/*   + (x(n-2), 0) * (b(2), 0)                                         */
+typedef struct {
+  __m128i  b01;
+  __m128i  a12;
+  __m128i  b2;
+  Bool     second_order;   /* b(2) != 0 */
+} coeff_lanes_t;
+
+static baudot_lanes_t bl_load(const Shortint *p)
+{
+  return _mm_loadu_si128((const __m128i *)p);
+}
+
+static void bl_store(Shortint *p, baudot_lanes_t a)
+{
+  _mm_storeu_si128((__m128i *)p, a);
+}
+
+static __m128i bl_pair(Shortint lo, Shortint hi)
+{
+  return _mm_set1_epi32((int)(((unsigned int)(unsigned short)hi << 16) |
+                              (unsigned short)lo));
+}
+
+static void coeff_lanes(coeff_lanes_t *c, const Shortint *aCoeff,
+                        const Shortint *bCoeff)
+{
+  c->b01 = bl_pair(bCoeff[0], bCoeff[1]);
+  c->a12 = bl_pair((Shortint)-aCoeff[1], (Shortint)-aCoeff[2]);
+  c->b2  = bl_pair(bCoeff[2], 0);
+  c->second_order = (bCoeff[2] != 0);
+}
+
+/* (Shortint)x of the eight Longint values in lo and hi */
+static inline baudot_lanes_t bl_narrow(__m128i lo, __m128i hi)
+{
+  lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+  hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+  return _mm_packs_epi32(lo, hi);
+}
+
+/* x sign extended to 32 bits, lanes 0..3 and 4..7 */
+static inline __m128i bl_widen_lo(baudot_lanes_t x)
+{
+  return _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+}
+
+static inline __m128i bl_widen_hi(baudot_lanes_t x)
+{
+  return _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+}
+
+/* -32768 stays -32768, as with abs() and a cast */
+static inline baudot_lanes_t bl_abs(baudot_lanes_t a)
+{
+  return _mm_max_epi16(a, _mm_sub_epi16(_mm_setzero_si128(), a));
+}
+
+static inline baudot_lanes_t bl_shift1(baudot_lanes_t a)
+{
+  return _mm_srai_epi16(a, 1);
+}
+
+/* in[0] holds x(n-1), in[1] x(n-2), out[0] y(n-1), out[1] y(n-2) */
+static inline baudot_lanes_t filter_lanes(baudot_lanes_t x, baudot_lanes_t in[2],
+                                     baudot_lanes_t out[2], const coeff_lanes_t *c)
+{
+  __m128i   lo, hi;
+  baudot_lanes_t y;
+
+  lo = _mm_madd_epi16(_mm_unpacklo_epi16(x, in[0]), c->b01);
+  hi = _mm_madd_epi16(_mm_unpackhi_epi16(x, in[0]), c->b01);
+  lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(out[0], out[1]), c->a12));
+  hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(out[0], out[1]), c->a12));
+  if (c->second_order)
+    {
+      lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(in[1], _mm_setzero_si128()), c->b2));
+      hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(in[1], _mm_setzero_si128()), c->b2));
+    }
+  y = bl_narrow(_mm_srai_epi32(lo, 15), _mm_srai_epi32(hi, 15));
+
+  in[1]  = in[0];
+  in[0]  = x;
+  out[1] = out[0];
+  out[0] = y;
+  return y;
+}
+
+/* a/b of four Longint values, rounded towards zero. The quotient in */
+/* double precision is exact enough: |a| < 2^31 and 0 < |b| < 2^16  */
+/* keep a non-integer quotient at least 2^-16 away from the next     */
+/* integer, far more than its rounding error.                        */
+static inline __m128i div_lanes(__m128i a, __m128i b)
+{
+#if defined(BAUDOT_MULTI_AVX)
+  return _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtepi32_pd(a),
+                                           _mm256_cvtepi32_pd(b)));
+#else
+  __m128i q0, q1;
+
+  q0 = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(a), _mm_cvtepi32_pd(b)));
+  a  = _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2));
+  b  = _mm_shuffle_epi32(b, _MM_SHUFFLE(1, 0, 3, 2));
+  q1 = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(a), _mm_cvtepi32_pd(b)));
+  return _mm_unpacklo_epi64(q0, q1);
+#endif
+}
+
+static inline baudot_lanes_t diff_lanes(baudot_lanes_t lp0, baudot_lanes_t lp1, baudot_lanes_t lp2)
+{
+  __m128i offset = _mm_set1_epi32(OFFSET_NORMALISATION);
+  __m128i lo, hi;
+
+  lo = div_lanes(_mm_slli_epi32(_mm_sub_epi32(bl_widen_lo(lp1), bl_widen_lo(lp2)), 14),
+                 _mm_add_epi32(bl_widen_lo(lp0), offset));
+  hi = div_lanes(_mm_slli_epi32(_mm_sub_epi32(bl_widen_hi(lp1), bl_widen_hi(lp2)), 14),
+                 _mm_add_epi32(bl_widen_hi(lp0), offset));
+  return bl_narrow(lo, hi);
+}
+
+#else
+
+typedef struct { Shortint v[BAUDOT_LANES]; } baudot_lanes_t;
+
+typedef struct {
+  const Shortint *aCoeff;
+  const Shortint *bCoeff;
+} coeff_lanes_t;
+
+static baudot_lanes_t bl_load(const Shortint *p)
+{
+  baudot_lanes_t r;
+
+  memcpy(r.v, p, sizeof(r.v));
+  return r;
+}
+
+static void bl_store(Shortint *p, baudot_lanes_t a)
+{
+  memcpy(p, a.v, sizeof(a.v));
+}
+
+static void coeff_lanes(coeff_lanes_t *c, const Shortint *aCoeff,
+                        const Shortint *bCoeff)
+{
+  c->aCoeff = aCoeff;
+  c->bCoeff = bCoeff;
+}
+
+static inline baudot_lanes_t bl_abs(baudot_lanes_t a)
+{
+  Shortint lane;
+
+  for (lane=0; lane<BAUDOT_LANES; lane++)
+    a.v[lane] = abs(a.v[lane]);
+  return a;
+}
+
+static inline baudot_lanes_t bl_shift1(baudot_lanes_t a)
+{
+  Shortint lane;
+
+  for (lane=0; lane<BAUDOT_LANES; lane++)
+    a.v[lane] = a.v[lane]>>1;
+  return a;
+}
+
+static inline baudot_lanes_t filter_lanes(baudot_lanes_t x, baudot_lanes_t in[2],
+                                     baudot_lanes_t out[2], const coeff_lanes_t *c)
+{
+  baudot_lanes_t y;
+  Shortint  lane;
+  Longint   sum;
+
+  for (lane=0; lane<BAUDOT_LANES; lane++)
+    {
+      sum  = (Longint)(x.v[lane])*(Longint)(c->bCoeff[0]);
+      sum += ((Longint)(in[0].v[lane])*(Longint)(c->bCoeff[1]) -
+              (Longint)(out[0].v[lane])*(Longint)(c->aCoeff[1]));
+      sum += ((Longint)(in[1].v[lane])*(Longint)(c->bCoeff[2]) -
+              (Longint)(out[1].v[lane])*(Longint)(c->aCoeff[2]));
+      y.v[lane] = (Shortint)(sum>>15);
+    }
+
+  in[1]  = in[0];
+  in[0]  = x;
+  out[1] = out[0];
+  out[0] = y;
+  return y;
+}
+
+static inline baudot_lanes_t diff_lanes(baudot_lanes_t lp0, baudot_lanes_t lp1, baudot_lanes_t lp2)
+{
+  baudot_lanes_t diff;
+  Shortint  lane;
+
+  for (lane=0; lane<BAUDOT_LANES; lane++)
+    diff.v[lane] = ((((Longint)(lp1.v[lane]) - (Longint)(lp2.v[lane]))<<14) /
+                    ((Longint)(lp0.v[lane])+OFFSET_NORMALISATION));
+  return diff;
+}
+
+#endif
+
+/*
+*******************************************************************************
+*                         PUBLIC PROGRAM CODE
+*******************************************************************************
+*/
+
+void baudot_tonedemod_multi(Shortint *const toneVec[BAUDOT_LANES],
+                            Shortint numSamples,
+                            fifo_state_t *const ptrOutFifoState[BAUDOT_LANES],
+                            baudot_tonedemod_state_t *const states[BAUDOT_LANES])
+{
+  baudot_filter_state_t *filter_state;
+  coeff_lanes_t  coeffLowpass, coeffBP1400, coeffBP1800;
+  baudot_lanes_t      in[NUM_FILTERS][BAUDOT_BP_FILTERORDER];
+  baudot_lanes_t      out[NUM_FILTERS][BAUDOT_BP_FILTERORDER];
+  baudot_lanes_t      toneIn, absToneIn;
+  baudot_lanes_t      outBP0, outBP1, outBP2, outLP0, outLP1, outLP2;
+  Shortint       samples[MULTI_BLOCK_LEN][BAUDOT_LANES];
+  Shortint       diff[MULTI_BLOCK_LEN][BAUDOT_LANES];
+  Shortint       values[2][NUM_FILTERS][BAUDOT_BP_FILTERORDER][BAUDOT_LANES];
+  Shortint       cnt, lane, filter, order;
+  Shortint       cntBlock, numBlock;
+
+  coeff_lanes(&coeffLowpass, baudot_aCoeffLowpass, baudot_bCoeffLowpass);
+  coeff_lanes(&coeffBP1400, baudot_aCoeffBP1400, baudot_bCoeffBP1400);
+  coeff_lanes(&coeffBP1800, baudot_aCoeffBP1800, baudot_bCoeffBP1800);
+
+  /* The filter states of the lanes; the lanes that are not used */
+  /* run on zeros from the initial state                          */
+  memset(values, 0, sizeof(values));
+  for (lane=0; lane<BAUDOT_LANES; lane++)
+    {
+      if (toneVec[lane] == NULL)
+        continue;
+      for (filter=0; filter<NUM_FILTERS; filter++)
+        {
+          filter_state = channel_filter(states[lane], filter);
+          for (order=0; order<BAUDOT_BP_FILTERORDER; order++)
+            {
+              values[0][filter][order][lane] = filter_state->in[order];
+              values[1][filter][order][lane] = filter_state->out[order];
+            }
+        }
+    }
+  for (filter=0; filter<NUM_FILTERS; filter++)
+    for (order=0; order<BAUDOT_BP_FILTERORDER; order++)
+      {
+        in[filter][order]  = bl_load(values[0][filter][order]);
+        out[filter][order] = bl_load(values[1][filter][order]);
+      }
+
+  for (cntBlock=0; cntBlock<numSamples; cntBlock+=numBlock)
+    {
+      numBlock = numSamples-cntBlock < MULTI_BLOCK_LEN ?
+        numSamples-cntBlock : MULTI_BLOCK_LEN;
+
+      for (lane=0; lane<BAUDOT_LANES; lane++)
+        for (cnt=0; cnt<numBlock; cnt++)
+          samples[cnt][lane] =
+            toneVec[lane] != NULL ? toneVec[lane][cntBlock+cnt] : 0;
+
+      /* The signal processing of baudot_tonedemod(), one sample of */
+      /* all lanes at a time                                        */
+      for (cnt=0; cnt<numBlock; cnt++)
+        {
+          toneIn    = bl_shift1(bl_load(samples[cnt]));
+          absToneIn = bl_abs(toneIn);
+
+          outBP1 = filter_lanes(toneIn, in[FILTER_BP1], out[FILTER_BP1], &coeffBP1400);
+          outBP2 = filter_lanes(toneIn, in[FILTER_BP2], out[FILTER_BP2], &coeffBP1800);
+          outBP0 = filter_lanes(absToneIn, in[FILTER_BP0], out[FILTER_BP0], &coeffLowpass);
+
+          outLP0 = filter_lanes(bl_abs(outBP0), in[FILTER_LP0], out[FILTER_LP0], &coeffLowpass);
+          outLP1 = filter_lanes(bl_abs(outBP1), in[FILTER_LP1], out[FILTER_LP1], &coeffLowpass);
+          outLP2 = filter_lanes(bl_abs(outBP2), in[FILTER_LP2], out[FILTER_LP2], &coeffLowpass);
+
+          bl_store(diff[cnt], diff_lanes(outLP0, outLP1, outLP2));
+        }
+
+      /* bit detection, lane by lane */
+      for (lane=0; lane<BAUDOT_LANES; lane++)
+        if (toneVec[lane] != NULL)
+          for (cnt=0; cnt<numBlock; cnt++)
+            detect_baudot_bit(diff[cnt][lane], ptrOutFifoState[lane], states[lane]);
+    }
+
+  for (filter=0; filter<NUM_FILTERS; filter++)
+    for (order=0; order<BAUDOT_BP_FILTERORDER; order++)
+      {
+        bl_store(values[0][filter][order], in[filter][order]);
+        bl_store(values[1][filter][order], out[filter][order]);
+      }
+  for (lane=0; lane<BAUDOT_LANES; lane++)
+    {
+      if (toneVec[lane] == NULL)
+        continue;
+      for (filter=0; filter<NUM_FILTERS; filter++)
+        {
+          filter_state = channel_filter(states[lane], filter);
+          for (order=0; order<BAUDOT_BP_FILTERORDER; order++)
+            {
+              filter_state->in[order]  = values[0][filter][order][lane];
+              filter_state->out[order] = values[1][filter][order][lane];
+            }
+        }
+    }
+}
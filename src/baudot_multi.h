@@ -0,0 +1,71 @@
+/*
+*******************************************************************************
+*
+*      File             : baudot_multi.h
+*      Purpose          : Demodulator for Baudot Tones for several channels
+*                         at once
+*
+*      baudot_tonedemod_multi() does what baudot_tonedemod() does, for up
+*      to BAUDOT_LANES channels and the same number of samples of each.
+*      The state of every channel stays in its own
+*      baudot_tonedemod_state_t. The six recursive filters run on one
+*      sample of all lanes at a time, with the states of the filters copied
+*      into structure of arrays form (element [lane]) for the call, so that
+*      each 16 bit multiply-add instruction of SSE2 works on all the lanes
+*      at once; the normalisation of the signal diff divides in double
+*      precision, which is exact for these operands. The bit detection
+*      runs lane by lane. The channels of one call need not be the same in
+*      the next one.
+*
+*      The TTY codes and the new states are the same, bit for bit, as those
+*      of baudot_tonedemod() with the same state. Unlike baudot_tonedemod(),
+*      the signal diff is not written with DEBUG_OUTPUT.
+*
+*******************************************************************************
+*/
+
+#ifndef baudot_multi_h
+#define baudot_multi_h "$Id: $"
+
+/*
+*******************************************************************************
+*                         INCLUDE FILES
+*******************************************************************************
+*/
+
+#include "baudot_functions.h"
+
+#include <typedefs.h>
+#include <fifo.h>
+
+/*
+*******************************************************************************
+*                         DECLARATION OF PROTOTYPES
+*******************************************************************************
+*/
+
+/* channels demodulated by one call of baudot_tonedemod_multi() */
+#define BAUDOT_LANES 8
+
+/* ----------------------------------------------------------------------- */
+/* FUNCTION baudot_tonedemod_multi()                                       */
+/* *********************************                                       */
+/* Runs baudot_tonedemod() for up to BAUDOT_LANES channels at once.        */
+/*                                                                         */
+/* input variables:                                                        */
+/* toneVec[lane]          the numSamples samples of the lane, or NULL if   */
+/*                        the lane is not used; the lanes that are not     */
+/*                        used are not touched                             */
+/* numSamples             number of samples of every lane                  */
+/*                                                                         */
+/* input/output variables:                                                 */
+/* ptrOutFifoState[lane]  the demodulated TTY codes of the lane            */
+/* states[lane]           the demodulator of the lane                      */
+/* ----------------------------------------------------------------------- */
+
+void baudot_tonedemod_multi(Shortint *const toneVec[BAUDOT_LANES],
+                            Shortint numSamples,
+                            fifo_state_t *const ptrOutFifoState[BAUDOT_LANES],
+                            baudot_tonedemod_state_t *const states[BAUDOT_LANES]);
+
+#endif
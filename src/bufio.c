@@ -0,0 +1,480 @@
+/*
+*******************************************************************************
+*
+*      File             : bufio.c
+*      Purpose          : buffered reading and writing of the session files
+*
+*******************************************************************************
+*/
+
+/*
+*******************************************************************************
+*                         MODULE INCLUDE FILE AND VERSION ID
+*******************************************************************************
+*/
+
+#include "bufio.h"
+
+const char bufio_id[] = "@(#)$Id: $" bufio_h;
+
+/*
+*******************************************************************************
+*                         INCLUDE FILES
+*******************************************************************************
+*/
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <err.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "compat.h"
+
+/*
+*******************************************************************************
+*                         LOCAL PROGRAM CODE
+*******************************************************************************
+*/
+
+/* size and current offset of a regular file, false for anything else */
+static Bool regular_file(int fd, size_t *size, size_t *offset)
+{
+  struct stat st;
+  off_t       pos;
+
+  if (fd < 0 || fstat(fd, &st) == -1 || !S_ISREG(st.st_mode))
+    return false;
+  if ((pos = lseek(fd, 0, SEEK_CUR)) == -1 || pos > st.st_size)
+    return false;
+
+  *size   = (size_t)st.st_size;
+  *offset = (size_t)pos;
+  return true;
+}
+
+/* length of the run of zero bytes at data[0 .. num-1] */
+static size_t zero_bytes(const char *data, size_t num)
+{
+  const unsigned long *words;
+  size_t               cnt = 0;
+  size_t               num_words;
+  size_t               idx;
+
+  while (cnt < num && ((size_t)(data+cnt) % sizeof(unsigned long)) != 0)
+  {
+    if (data[cnt] != 0)
+      return cnt;
+    cnt++;
+  }
+
+  /* blocks of eight words, which the compiler turns into vector code */
+  words     = (const unsigned long *)(data+cnt);
+  num_words = (num-cnt) / sizeof(unsigned long);
+  for (idx=0; idx+8 <= num_words; idx+=8)
+    if ((words[idx]   | words[idx+1] | words[idx+2] | words[idx+3] |
+         words[idx+4] | words[idx+5] | words[idx+6] | words[idx+7]) != 0)
+      break;
+  for (; idx < num_words; idx++)
+    if (words[idx] != 0)
+      break;
+  cnt += idx*sizeof(unsigned long);
+
+  while (cnt < num && data[cnt] == 0)
+    cnt++;
+
+  return cnt;
+}
+
+/*
+*******************************************************************************
+*                         PUBLIC PROGRAM CODE
+*******************************************************************************
+*/
+
+void init_bufio_reader(bufio_reader_t *reader, int fd, size_t frame_size)
+{
+  reader->fd         = fd;
+  reader->frame_size = frame_size;
+  reader->buffer     = NULL;
+  reader->start      = 0;
+  reader->end        = 0;
+  reader->eof        = false;
+  reader->mapped     = false;
+  reader->hole_end   = 0;
+  reader->data_end   = 0;
+}
+
+void exit_bufio_reader(bufio_reader_t *reader)
+{
+  if (reader->mapped)
+  {
+    if (reader->buffer != NULL)
+      munmap(reader->buffer, reader->end);
+  }
+  else
+    free(reader->buffer);
+  reader->buffer = NULL;
+  reader->mapped = false;
+}
+
+Bool bufio_map_reader(bufio_reader_t *reader)
+{
+  size_t size, offset;
+  void  *map = NULL;
+
+  if (reader->buffer != NULL || !regular_file(reader->fd, &size, &offset))
+    return false;
+
+  if (size > 0)
+  {
+    if ((map = mmap(NULL, size, PROT_READ, MAP_SHARED, reader->fd, 0)) == MAP_FAILED)
+      return false;
+    madvise(map, size, MADV_SEQUENTIAL);
+  }
+
+  reader->buffer   = map;
+  reader->start    = offset;
+  reader->end      = size;
+  reader->mapped   = true;
+  reader->hole_end = offset;
+  reader->data_end = offset;
+
+  return true;
+}
+
+size_t bufio_zero_frames(bufio_reader_t *reader, size_t max_frames)
+{
+  size_t num_frames, max_bytes, num_zero, pos, num, zero;
+#ifdef SEEK_DATA
+  off_t  next;
+#endif
+
+  if (!reader->mapped || reader->eof)
+    return 0;
+
+  num_frames = (reader->end - reader->start) / reader->frame_size;
+  if (num_frames > max_frames)
+    num_frames = max_frames;
+  max_bytes = num_frames*reader->frame_size;
+
+  for (num_zero = 0; num_zero < max_bytes; num_zero += num)
+  {
+    pos = reader->start + num_zero;
+
+    if (pos >= reader->hole_end && pos >= reader->data_end)
+    {
+      /* find out whether pos is in a hole or in data, and how far */
+      /* it extends. Without SEEK_DATA, everything counts as data. */
+      reader->hole_end = pos;
+      reader->data_end = reader->end;
+#ifdef SEEK_DATA
+      if ((next = lseek(reader->fd, (off_t)pos, SEEK_DATA)) == -1)
+      {
+        if (errno == ENXIO)
+          reader->hole_end = reader->end;
+      }
+      else if ((size_t)next > pos)
+      {
+        reader->hole_end = (size_t)next;
+        reader->data_end = (size_t)next;
+      }
+      else if ((next = lseek(reader->fd, (off_t)pos, SEEK_HOLE)) != -1)
+        reader->data_end = (size_t)next;
+#endif
+    }
+
+    if (pos < reader->hole_end)
+      num = reader->hole_end - pos;
+    else
+      num = reader->data_end - pos;
+    if (num > max_bytes - num_zero)
+      num = max_bytes - num_zero;
+
+    if (pos >= reader->hole_end && (zero = zero_bytes(reader->buffer + pos, num)) < num)
+    {
+      num_zero += zero;
+      break;
+    }
+  }
+
+  return num_zero / reader->frame_size;
+}
+
+void bufio_skip_frames(bufio_reader_t *reader, size_t num_frames)
+{
+  if (reader->mapped && num_frames*reader->frame_size <= reader->end - reader->start)
+    reader->start += num_frames*reader->frame_size;
+}
+
+Bool bufio_ready(bufio_reader_t *reader)
+{
+  return reader->mapped || reader->eof || (reader->end - reader->start >= reader->frame_size);
+}
+
+int bufio_read(bufio_reader_t *reader, void *frame)
+{
+  size_t  num_avail;
+  ssize_t num_read;
+
+  if (reader->mapped)
+  {
+    /* the whole file is at hand, so the end of the mapping is the */
+    /* end of the file                                             */
+    if (reader->end - reader->start < reader->frame_size)
+      reader->eof = true;
+  }
+  else if (reader->buffer == NULL &&
+           (reader->buffer = malloc(BUFIO_BUFFER_SIZE)) == NULL)
+    err(1, "bufio_read: malloc");
+
+  if (!bufio_ready(reader))
+  {
+    /* keep the partial frame, and fill the rest of the buffer */
+    memmove(reader->buffer, reader->buffer + reader->start,
+            reader->end - reader->start);
+    reader->end  -= reader->start;
+    reader->start = 0;
+
+    num_read = read(reader->fd, reader->buffer + reader->end,
+                    BUFIO_BUFFER_SIZE - reader->end);
+    if (num_read > 0)
+      reader->end += num_read;
+    else if (num_read == 0)
+      reader->eof = true;
+    else if (errno != EINTR && errno != EAGAIN)
+    {
+      warn("read error on descriptor %d", reader->fd);
+      reader->eof = true;
+    }
+  }
+
+  num_avail = reader->end - reader->start;
+  if (num_avail >= reader->frame_size)
+    num_avail = reader->frame_size;
+  else if (!reader->eof)
+    return -1;
+
+  /* hand out a frame, at the end of file the rest is zero-padded */
+  memcpy(frame, reader->buffer + reader->start, num_avail);
+  memset((char *)frame + num_avail, 0, reader->frame_size - num_avail);
+  reader->start += num_avail;
+
+  return (int)num_avail;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void init_bufio_writer(bufio_writer_t *writer, int fd)
+{
+  writer->fd          = fd;
+  writer->buffer      = NULL;
+  writer->buffer_size = 0;
+  writer->start       = 0;
+  writer->num_bytes   = 0;
+  writer->blocked     = false;
+  writer->failed      = false;
+  writer->mapped      = false;
+  writer->map_offset  = 0;
+  writer->map_size    = 0;
+}
+
+void exit_bufio_writer(bufio_writer_t *writer)
+{
+  if (writer->mapped)
+  {
+    /* give back what has been reserved but not written */
+    munmap(writer->buffer, writer->map_size);
+    if (ftruncate(writer->fd, (off_t)(writer->map_offset + writer->num_bytes)) == -1)
+      err(1, "unable to truncate output file, descriptor %d", writer->fd);
+    if (lseek(writer->fd, (off_t)(writer->map_offset + writer->num_bytes), SEEK_SET) == -1)
+      err(1, "lseek");
+  }
+  else
+  {
+    bufio_flush(writer);
+    if (bufio_pending(writer) > 0)
+      warnx("descriptor %d: %lu bytes not written", writer->fd,
+            (unsigned long)bufio_pending(writer));
+    free(writer->buffer);
+  }
+  writer->buffer = NULL;
+  writer->mapped = false;
+}
+
+/* maps the file with room for at least num_bytes more bytes */
+static void map_writer(bufio_writer_t *writer, size_t num_bytes)
+{
+  size_t map_size = writer->map_size;
+  void  *map;
+
+  if (map_size == 0)
+    map_size = writer->map_offset + BUFIO_BUFFER_SIZE;
+  while (map_size < writer->map_offset + writer->num_bytes + num_bytes)
+    map_size *= 2;
+
+  if (writer->buffer != NULL)
+    munmap(writer->buffer, writer->map_size);
+
+  /* the new part of the file is a hole, i.e. it reads as zeros */
+  if (ftruncate(writer->fd, (off_t)map_size) == -1)
+    err(1, "unable to size output file, descriptor %d", writer->fd);
+  map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, writer->fd, 0);
+  if (map == MAP_FAILED)
+    err(1, "unable to map output file, descriptor %d", writer->fd);
+
+  writer->buffer   = map;
+  writer->map_size = map_size;
+}
+
+Bool bufio_map_writer(bufio_writer_t *writer, size_t size_hint)
+{
+  size_t size, offset;
+  void  *map;
+
+  if (writer->buffer != NULL || !regular_file(writer->fd, &size, &offset))
+    return false;
+
+  /* check that the descriptor can be mapped for writing at all */
+  if ((map = mmap(NULL, 1, PROT_READ | PROT_WRITE, MAP_SHARED, writer->fd, 0)) == MAP_FAILED)
+    return false;
+  munmap(map, 1);
+
+  /* like O_TRUNC from the current offset on */
+  if (ftruncate(writer->fd, (off_t)offset) == -1)
+    return false;
+
+  writer->mapped     = true;
+  writer->map_offset = offset;
+  writer->num_bytes  = 0;
+  map_writer(writer, size_hint);
+
+  return true;
+}
+
+void bufio_flush(bufio_writer_t *writer)
+{
+  ssize_t num_written;
+
+  if (writer->mapped)
+    return;
+
+  writer->blocked = false;
+  while (writer->start < writer->num_bytes)
+  {
+    num_written = write(writer->fd, writer->buffer + writer->start,
+                        writer->num_bytes - writer->start);
+    if (num_written == -1)
+    {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN)
+      {
+        /* non-blocking descriptor: keep the rest for the next call */
+        writer->blocked = true;
+        return;
+      }
+
+      /* e.g. the reader has gone away: the output is lost, but the */
+      /* rest of the process goes on                                */
+      if (!writer->failed)
+        warn("write error on descriptor %d", writer->fd);
+      writer->failed = true;
+      break;
+    }
+    writer->start += num_written;
+  }
+
+  writer->start     = 0;
+  writer->num_bytes = 0;
+}
+
+size_t bufio_pending(const bufio_writer_t *writer)
+{
+  return writer->mapped ? 0 : writer->num_bytes - writer->start;
+}
+
+Bool bufio_blocked(const bufio_writer_t *writer)
+{
+  return writer->blocked;
+}
+
+/* makes room for num_bytes more bytes behind the pending ones */
+static void reserve_writer(bufio_writer_t *writer, size_t num_bytes)
+{
+  size_t buffer_size;
+  char  *buffer;
+
+  if (writer->num_bytes + num_bytes <= writer->buffer_size)
+    return;
+
+  /* move the pending bytes to the front */
+  if (writer->start > 0)
+  {
+    memmove(writer->buffer, writer->buffer + writer->start,
+            writer->num_bytes - writer->start);
+    writer->num_bytes -= writer->start;
+    writer->start      = 0;
+  }
+
+  /* the descriptor is behind: keep everything that is pending */
+  buffer_size = (writer->buffer_size > 0) ? writer->buffer_size : BUFIO_BUFFER_SIZE;
+  while (buffer_size < writer->num_bytes + num_bytes)
+    buffer_size *= 2;
+
+  if (buffer_size != writer->buffer_size)
+  {
+    if ((buffer = realloc(writer->buffer, buffer_size)) == NULL)
+      err(1, "bufio_write: realloc");
+    writer->buffer      = buffer;
+    writer->buffer_size = buffer_size;
+  }
+}
+
+void bufio_write(bufio_writer_t *writer, const void *data, size_t num_bytes)
+{
+  if (writer->mapped)
+  {
+    if (writer->map_offset + writer->num_bytes + num_bytes > writer->map_size)
+      map_writer(writer, num_bytes);
+    memcpy(writer->buffer + writer->map_offset + writer->num_bytes, data, num_bytes);
+    writer->num_bytes += num_bytes;
+    return;
+  }
+
+  if (writer->failed)
+    return;
+
+  reserve_writer(writer, num_bytes);
+  memcpy(writer->buffer + writer->num_bytes, data, num_bytes);
+  writer->num_bytes += num_bytes;
+
+  /* a blocked descriptor is only written again after POLLOUT */
+  if (writer->num_bytes - writer->start >= BUFIO_BUFFER_SIZE && !writer->blocked)
+    bufio_flush(writer);
+}
+
+void bufio_write_zero(bufio_writer_t *writer, size_t num_bytes)
+{
+  static const char zero[BUFIO_BUFFER_SIZE/16];
+  size_t            num;
+
+  if (writer->mapped)
+  {
+    /* nothing has been written behind num_bytes, so it is zero */
+    if (writer->map_offset + writer->num_bytes + num_bytes > writer->map_size)
+      map_writer(writer, num_bytes);
+    writer->num_bytes += num_bytes;
+    return;
+  }
+
+  for (; num_bytes > 0; num_bytes -= num)
+  {
+    num = (num_bytes < sizeof(zero)) ? num_bytes : sizeof(zero);
+    bufio_write(writer, zero, num);
+  }
+}
@@ -0,0 +1,244 @@
+/*
+*******************************************************************************
+*
+*      File             : bufio.h
+*      Purpose          : buffered reading and writing of the session files
+*
+*      A reader fetches large blocks from its descriptor and hands them
+*      out in frames of frame_size bytes, collecting partial reads (e.g.
+*      from pipes) until a frame is complete. Only the end of file ends
+*      the input. A writer collects frames and writes them in large
+*      blocks. The buffers are allocated on first use, so that sessions
+*      which do not use a file (audio devices, CTM_FRAMES) do not pay
+*      for them.
+*
+*      Neither side ever waits for its descriptor. A writer whose
+*      non-blocking descriptor does not take all bytes keeps the rest,
+*      growing its buffer as needed, and is marked blocked until the
+*      caller has seen POLLOUT and flushed it again (bufio_blocked(),
+*      bufio_pending()).
+*
+*      Regular files can be mapped instead (bufio_map_reader(),
+*      bufio_map_writer()), for offline processing without a system call
+*      per block. A mapped reader is always ready, and can tell runs of
+*      silence (all-zero frames, or holes in sparse files) without
+*      copying them. A mapped writer grows its file in large steps and
+*      leaves silence as holes.
+*
+*******************************************************************************
+*/
+#ifndef bufio_h
+#define bufio_h "$Id: $"
+
+/*
+*******************************************************************************
+*                         INCLUDE FILES
+*******************************************************************************
+*/
+
+#include <stddef.h>
+#include <typedefs.h>
+
+/*
+*******************************************************************************
+*                         DEFINITION OF CONSTANTS
+*******************************************************************************
+*/
+
+#define BUFIO_BUFFER_SIZE 65536   /* bytes per read() or write() */
+
+/*
+*******************************************************************************
+*                         DEFINITION OF DATA TYPES
+*******************************************************************************
+*/
+
+typedef struct
+{
+  int     fd;
+  size_t  frame_size;    /* bytes handed out per bufio_read()  */
+  char   *buffer;        /* BUFIO_BUFFER_SIZE bytes, NULL, or  */
+                         /* the mapped file                    */
+  size_t  start;         /* first byte not handed out yet      */
+  size_t  end;           /* behind the last byte read          */
+  Bool    eof;           /* read() has returned the end of file */
+
+  Bool    mapped;        /* buffer is the whole file           */
+  size_t  hole_end;      /* [start, hole_end) is a known hole  */
+  size_t  data_end;      /* [start, data_end) is known data    */
+}
+bufio_reader_t;
+
+typedef struct
+{
+  int     fd;
+  char   *buffer;        /* buffer_size bytes, NULL, or the    */
+                         /* mapped file                        */
+  size_t  buffer_size;
+  size_t  start;         /* first byte not written yet         */
+  size_t  num_bytes;     /* behind the last byte buffered, or  */
+                         /* bytes written into the mapping     */
+  Bool    blocked;       /* the descriptor has not taken all   */
+                         /* bytes (EAGAIN)                     */
+  Bool    failed;        /* write error, the output is dropped */
+
+  Bool    mapped;
+  size_t  map_offset;    /* file offset of the first byte      */
+  size_t  map_size;      /* bytes mapped (and file size)       */
+}
+bufio_writer_t;
+
+/*
+*******************************************************************************
+*                         DECLARATION OF PROTOTYPES
+*******************************************************************************
+*/
+
+void init_bufio_reader(bufio_reader_t *reader, int fd, size_t frame_size);
+void exit_bufio_reader(bufio_reader_t *reader);
+
+/*
+*******************************************************************************
+*
+*     Function        : bufio_map_reader
+*     In/Out          : reader        state variable, nothing read yet
+*     Calls           : fstat, lseek, mmap
+*     Return          : true, if the file is mapped from its current
+*                       offset on
+*     Information     : only regular files are mapped, for anything else
+*                       the reader stays buffered
+*
+*******************************************************************************
+*/
+
+Bool bufio_map_reader(bufio_reader_t *reader);
+
+/*
+*******************************************************************************
+*
+*     Function        : bufio_zero_frames
+*     In/Out          : reader        state variable
+*     In              : max_frames    upper limit of the result
+*     Calls           : lseek
+*     Return          : number of complete frames from the current
+*                       position on that contain only zeros (0 for a
+*                       reader that is not mapped)
+*     Information     : holes of sparse files are found with SEEK_DATA
+*                       and SEEK_HOLE and not touched, the data is
+*                       compared a word at a time
+*
+*******************************************************************************
+*/
+
+size_t bufio_zero_frames(bufio_reader_t *reader, size_t max_frames);
+
+/* passes over num_frames frames of a mapped reader without copying them */
+void bufio_skip_frames(bufio_reader_t *reader, size_t num_frames);
+
+/*
+*******************************************************************************
+*
+*     Function        : bufio_ready
+*     In/Out          : reader        state variable
+*     Return          : true, if bufio_read() can return without read(),
+*                       i.e. a frame or the end of file is buffered
+*     Information     : the descriptor only needs to be polled while the
+*                       reader is not ready
+*
+*******************************************************************************
+*/
+
+Bool bufio_ready(bufio_reader_t *reader);
+
+/*
+*******************************************************************************
+*
+*     Function        : bufio_read
+*     Out             : frame         frame_size bytes
+*     In/Out          : reader        state variable
+*     Calls           : read, warn
+*     Return          : frame_size if a frame has been read,
+*                       0 .. frame_size-1 at the end of file (the number
+*                       of bytes left in the file; the rest of the frame
+*                       is set to zero), or -1 if no complete frame has
+*                       been received yet
+*     Information     : calls read() once if less than a frame is
+*                       buffered, so it must only be called if the
+*                       descriptor is readable or bufio_ready() is true.
+*                       After the end of file, 0 is returned.
+*
+*******************************************************************************
+*/
+
+int bufio_read(bufio_reader_t *reader, void *frame);
+
+void init_bufio_writer(bufio_writer_t *writer, int fd);
+
+/*
+*******************************************************************************
+*
+*     Function        : bufio_map_writer
+*     In/Out          : writer        state variable, nothing written yet
+*     In              : size_hint     expected number of bytes
+*     Calls           : fstat, lseek, ftruncate, mmap
+*     Return          : true, if the file is mapped from its current
+*                       offset on
+*     Information     : the file must be a regular file that is open for
+*                       reading and writing. It is sized for size_hint
+*                       bytes, grown when needed and cut to the bytes
+*                       written by exit_bufio_writer().
+*
+*******************************************************************************
+*/
+
+Bool bufio_map_writer(bufio_writer_t *writer, size_t size_hint);
+
+/* tries once more to write the remaining bytes, and drops what the */
+/* descriptor does not take without waiting                         */
+void exit_bufio_writer(bufio_writer_t *writer);
+
+/*
+*******************************************************************************
+*
+*     Function        : bufio_write
+*     In              : data          num_bytes bytes to write
+*     In/Out          : writer        state variable
+*     Calls           : write, warn
+*     Return          : <none>
+*     Information     : appends the data to the buffer, which is written
+*                       once BUFIO_BUFFER_SIZE bytes are pending. After
+*                       a write error (other than EAGAIN), which is
+*                       reported once, the output is dropped.
+*
+*******************************************************************************
+*/
+
+void bufio_write(bufio_writer_t *writer, const void *data, size_t num_bytes);
+
+/* writes num_bytes zeros; a mapped writer leaves them as a hole */
+void bufio_write_zero(bufio_writer_t *writer, size_t num_bytes);
+
+/*
+*******************************************************************************
+*
+*     Function        : bufio_flush
+*     In/Out          : writer        state variable
+*     Calls           : write, warn
+*     Return          : <none>
+*     Information     : writes as many buffered bytes as the descriptor
+*                       takes without waiting. If some are left, the
+*                       writer is blocked until the next call.
+*
+*******************************************************************************
+*/
+
+void bufio_flush(bufio_writer_t *writer);
+
+/* bytes buffered but not written yet (0 for a mapped writer) */
+size_t bufio_pending(const bufio_writer_t *writer);
+
+/* true, if the last flush has left bytes behind, i.e. the caller */
+/* should poll the descriptor for POLLOUT and flush again         */
+Bool bufio_blocked(const bufio_writer_t *writer);
+
+#endif
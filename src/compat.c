@@ -0,0 +1,48 @@
+/*
+*******************************************************************************
+*
+*      File             : compat.c
+*      Purpose          : strtonum() for systems without it
+*
+*******************************************************************************
+*/
+
+#include "compat.h"
+
+const char compat_id[] = "@(#)$Id: $" compat_h;
+
+#ifndef __OpenBSD__
+
+#include <errno.h>
+#include <limits.h>
+
+/* same contract as strtonum(3) on OpenBSD */
+long long strtonum(const char *numstr, long long minval, long long maxval,
+                   const char **errstrp)
+{
+  long long  value = 0;
+  const char *errstr = NULL;
+  char       *end;
+
+  if (minval > maxval)
+    errstr = "invalid";
+  else
+  {
+    errno = 0;
+    value = strtoll(numstr, &end, 10);
+    if (numstr == end || *end != '\0')
+      errstr = "invalid";
+    else if ((value == LLONG_MIN && errno == ERANGE) || value < minval)
+      errstr = "too small";
+    else if ((value == LLONG_MAX && errno == ERANGE) || value > maxval)
+      errstr = "too large";
+  }
+
+  if (errstrp != NULL)
+    *errstrp = errstr;
+  errno = (errstr != NULL) ? ((errstr[0] == 'i') ? EINVAL : ERANGE) : 0;
+
+  return (errstr != NULL) ? 0 : value;
+}
+
+#endif /* __OpenBSD__ */
@@ -0,0 +1,33 @@
+/*
+*******************************************************************************
+*
+*      File             : compat.h
+*      Purpose          : OpenBSD interfaces that other systems (Linux)
+*                         lack: INFTIM, swap16() and strtonum()
+*
+*******************************************************************************
+*/
+#ifndef compat_h
+#define compat_h "$Id: $"
+
+#include <sys/types.h>
+#include <poll.h>
+#include <stdlib.h>
+
+#ifndef INFTIM
+#define INFTIM (-1)
+#endif
+
+#ifndef __OpenBSD__
+
+#ifndef swap16
+#define swap16(x) ((unsigned short)((((unsigned short)(x) & 0x00ffU) << 8) | \
+                                    (((unsigned short)(x) & 0xff00U) >> 8)))
+#endif
+
+long long strtonum(const char *numstr, long long minval, long long maxval,
+                   const char **errstrp);
+
+#endif /* __OpenBSD__ */
+
+#endif
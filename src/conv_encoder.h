@@ -57,7 +57,7 @@ void conv_encoder_reset(conv_encoder_t* ptr_state);
 /***********************************************************************/
 
 void conv_encoder_exec(conv_encoder_t* ptr_state, 
-                       Shortint* in,
+                       const Shortint* in,
                        Shortint  inbits, 
                        Shortint* out);
 
@@ -122,22 +122,22 @@ typedef struct
   Shortint temp[CHC_RATE*CHC_K]; 
 } conv_encoder_t;
 
-typedef struct
-{
-  Longint metric;                 /* Metric of the node after updating      */
-  Longint oldmetric;              /* Metric of the node before updating     */
-  Shortint base_output;           /* Output of the node when the input is 0 */
-  Shortint continue_path_from;    /* Last node from which the actual node
-                                     will continue the path                 */
-  Shortint new_entry;             /* Value to be added to the path (0 or 1) */
-  Shortint path[BLOCK*CHC_K];     /* Path ending in the node                */
-  Shortint temppath[BLOCK*CHC_K]; /* Temp path used for the updating        */
-  
-} node_t;
+/* The survivor memory holds one decision word per step, the last      */
+/* BLOCK*CHC_K of them in a circular buffer. Bit n of a word is set if */
+/* node n continues the path of node 2*(n%(NUM_NODES/2))+1 rather than */
+/* of node 2*(n%(NUM_NODES/2)); the bit added to the path of node n is */
+/* 1 for n>=NUM_NODES/2. The paths are traced back through it.         */
+
+#if NUM_NODES > 16
+#error "the decision words of viterbi_t have only 16 bits"
+#endif
 
 typedef struct
 {
-  node_t nodes[NUM_NODES];
+  Longint metric[NUM_NODES];        /* path metrics of the nodes, minus  */
+                                    /* the lowest one (renormalization)  */
+  UShortint decisions[BLOCK*CHC_K]; /* survivor memory                   */
+  Shortint newest;                  /* index of the latest decision word */
   Shortint number_of_steps;
 } viterbi_t;
 
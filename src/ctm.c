@@ -1,18 +1,15 @@
 #include <poll.h>
 
 #include "ctm.h"
+#include "compat.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <err.h>
+#include <errno.h>
 #include <unistd.h>
 
-#ifdef __OpenBSD__
-#include <sys/types.h>
-#include <sndio.h>
-#endif
-
 #include <ctype.h>
 #include <termios.h>
 
@@ -20,36 +17,80 @@
 #include "ctm_transmitter.h"
 #include "ctm_receiver.h"
 #include "baudot_functions.h"
+#include "baudot_multi.h"
 #include "ucs_functions.h"
+#include "wait_for_sync.h"
 #include <typedefs.h>
 #include <fifo.h>
 
+/* the engine as it went into a run of silent frames, see */
+/* process_silent_frame()                                 */
+typedef struct ctm_silent_snapshot {
+  rx_state_t               rx_state;
+  baudot_tonedemod_state_t baudot_tonedemod_state;
+  Shortint                *wait_regs;       /* the wait_for_sync() registers */
+  Bool                     sync_on_baudot;
+  Longint                  num_window;
+} ctm_silent_snapshot_t;
+
 /* external functions */
-extern void layer2_process_user_input(struct ctm_state *);
+extern Bool layer2_process_user_input(struct ctm_state *);
 extern void layer2_process_user_output(struct ctm_state *);
 extern void layer2_process_ctm_audio_in(struct ctm_state *);
 extern void layer2_process_ctm_audio_out(struct ctm_state *);
-extern void layer2_process_ctm_file_input(struct ctm_state *);
+extern Bool layer2_read_ctm_file_input(struct ctm_state *);
+extern Bool layer2_read_baudot_input(struct ctm_state *);
+extern Bool layer2_process_ctm_file_input(struct ctm_state *);
 extern void layer2_process_ctm_file_output(struct ctm_state *);
+extern void layer2_process_baudot_in(struct ctm_state *);
+extern void layer2_process_text_in(struct ctm_state *, char);
+extern Bool layer2_generate_user_output(struct ctm_state *);
+extern void layer2_process_ctm_in(struct ctm_state *);
+extern void layer2_process_ctm_out(struct ctm_state *);
 
 /* function prototypes */
-static void set_modes(enum ctm_output_mode, enum ctm_user_input_mode, int, int, int, int, char *);
-void open_audio_devices(void);
-void ctm_set_negotiation(enum on_off);
-void ctm_init(enum ctm_output_mode, enum ctm_user_input_mode, int, int, int, int, char *);
-static int setup_poll_fds(struct pollfd *, int);
-int ctm_start(void);
-void ctm_set_num_samples(int);
-void ctm_set_shutdown_on_eof(int);
+void ctm_session_set_correlator(ctm_session_t *state, enum tonedemod_correlator correlator)
+{
+  tonedemod_set_correlator(&(state->rx_state.tonedemod_state), correlator);
+}
+
+void ctm_session_set_lag_tracking(ctm_session_t *state, enum on_off flag)
+{
+  tonedemod_set_lag_tracking(&(state->rx_state.tonedemod_state), flag == ON);
+}
+
+void ctm_session_set_float_demod(ctm_session_t *state, enum on_off flag)
+{
+  state->floatDemod = (flag == ON);
+  state->rx_state.floatDemod = (flag == ON);
+}
 
-static struct ctm_state *state;
+void ctm_session_set_id(ctm_session_t *state, ULongint id)
+{
+  state->sessionId = id;
+}
 
-void ctm_set_num_samples(int num_samples)
+void ctm_session_set_text_flush(ctm_session_t *state, int max_bytes, int max_delay_ms)
+{
+  /* the writers write out a full buffer by themselves */
+  if (max_bytes < 1)
+    max_bytes = 1;
+  else if (max_bytes > BUFIO_BUFFER_SIZE)
+    max_bytes = BUFIO_BUFFER_SIZE;
+
+  state->textFlushThreshold = max_bytes;
+  state->textFlushDelay     = (max_delay_ms > 0) ? (ULongint)max_delay_ms*8000/1000 : 0;
+}
+
+static void set_modes(ctm_session_t *, enum ctm_output_mode, enum ctm_user_input_mode, int, int, int, int, char *);
+static void open_audio_devices(ctm_session_t *);
+
+void ctm_session_set_num_samples(ctm_session_t *state, int num_samples)
 {
   state->numSamplesToProcess = num_samples;
 }
 
-void ctm_set_shutdown_on_eof(int flag)
+void ctm_session_set_shutdown_on_eof(ctm_session_t *state, int flag)
 {
   if(flag == 1)
     state->shutdown_on_eof = true;
@@ -57,12 +98,12 @@ void ctm_set_shutdown_on_eof(int flag)
     state->shutdown_on_eof = false;
 }
 
-static void set_modes(enum ctm_output_mode ctm_output_mode, enum ctm_user_input_mode input_mode, int ctm_output_fd, int ctm_input_fd, int user_output_fd, int user_input_fd, char *device_name)
+static void set_modes(ctm_session_t *state, enum ctm_output_mode ctm_output_mode, enum ctm_user_input_mode input_mode, int ctm_output_fd, int ctm_input_fd, int user_output_fd, int user_input_fd, char *device_name)
 {
   switch(ctm_output_mode) {
     case CTM_AUDIO:
       /* this is the default mode. */
-      state->audio_device_name = device_name; 
+      state->audio_device_name = device_name;
       break;
     case CTM_FILE:
       state->ctmReadFromFile           = true;
@@ -81,6 +122,9 @@ static void set_modes(enum ctm_output_mode ctm_output_mode, enum ctm_user_input_
       state->ctmInputFileFp = ctm_input_fd;
       state->ctmOutputFileFp = ctm_output_fd;
       break;
+    case CTM_FRAMES:
+      state->ctm_audio_dev_mode        = false;
+      break;
     default:
       errx(1, "invalid CTM mode.");
       break;
@@ -115,40 +159,18 @@ static void set_modes(enum ctm_output_mode ctm_output_mode, enum ctm_user_input_
   }
 }
 
-void open_audio_devices(void)
+static void open_audio_devices(ctm_session_t *state)
 {
   if (state->ctm_audio_dev_mode)
   {
-    fprintf(stderr, "opening audio device for duplex i/o...\n");
-    state->audio_hdl = sio_open(state->audio_device_name, SIO_PLAY | SIO_REC, 1);
-    if (state->audio_hdl == NULL)
-    {
-      errx(1, "unable to open audio device \"%s\" for duplex i/o\n", state->audio_device_name);
-    }
-
-    /* attempt to set the device parameters. */
-    if (sio_setpar(state->audio_hdl, &state->audio_params) == 0)
-    {
-      errx(1, "unable to set device parameters on audio device \"%s\"\n", state->audio_device_name);
-    }
-
-    /* check to see that the device parameters were actually set up correctly. Not all devices may support the required parameters. */
-    struct sio_par dev_params;
-    if (sio_getpar(state->audio_hdl, &dev_params) == 0)
-    {
-      errx(1, "unable to get device parameters on audio device \"%s\"\n", state->audio_device_name);
-    }
-
-    else if ((state->audio_params.rate != dev_params.rate) || (state->audio_params.bits != dev_params.bits) || (state->audio_params.rchan != dev_params.rchan) || (state->audio_params.pchan != dev_params.pchan) || (state->audio_params.appbufsz != dev_params.appbufsz))
-
-    {
-      errx(1, "unable to set the correct parameters on audio device \"%s\"\n", state->audio_device_name);
-    } 
+    state->audio = ctm_audio_open(state->audio_device_name,
+        8000*state->rateFactor, state->audio_frame_len);
+    fprintf(stderr, "opened audio device \"%s\" for duplex i/o\n", state->audio->name);
   }
 }
 
 /* enable/disable CTM negotiation (ENQUIRIES). */
-void ctm_set_negotiation(enum on_off flag)
+void ctm_session_set_negotiation(ctm_session_t *state, enum on_off flag)
 {
   switch(flag) {
     case ON:
@@ -162,10 +184,78 @@ void ctm_set_negotiation(enum on_off flag)
   }
 }
 
-void ctm_init(enum ctm_output_mode output_mode, enum ctm_user_input_mode input_mode, int ctm_output_fd, int ctm_input_fd, int user_output_fd, int user_input_fd, char *device_name)
+/* the frames at the external rate, if they are not the 8 kHz buffers */
+static void free_ext_buffers(ctm_session_t *state)
 {
+  if (state->rateFactor == 1)
+    return;
+
+  free(state->ctm_input_ext_buffer);
+  free(state->ctm_output_ext_buffer);
+  free(state->baudot_input_ext_buffer);
+  free(state->baudot_output_ext_buffer);
+}
+
+void ctm_session_set_rate(ctm_session_t *state, int rate)
+{
+  Shortint factor;
+
+  switch (rate) {
+    case 8000:
+      factor = 1;
+      break;
+    case 16000:
+      factor = 2;
+      break;
+    case 48000:
+      factor = 6;
+      break;
+    default:
+      errx(1, "unsupported sample rate %d.", rate);
+  }
+
+  free_ext_buffers(state);
+
+  state->rateFactor        = factor;
+  state->audio_frame_len   = factor*LENGTH_TONE_VEC;
+  state->audio_buffer_size = state->audio_frame_len*sizeof(Shortint);
+
+  if (factor == 1)
+  {
+    state->ctm_input_ext_buffer = state->ctm_input_buffer;
+    state->ctm_output_ext_buffer = state->ctm_output_buffer;
+    state->baudot_input_ext_buffer = state->baudot_input_buffer;
+    state->baudot_output_ext_buffer = state->baudot_output_buffer;
+  }
+  else
+  {
+    state->ctm_input_ext_buffer = calloc(state->audio_frame_len, sizeof(Shortint));
+    state->ctm_output_ext_buffer = calloc(state->audio_frame_len, sizeof(Shortint));
+    state->baudot_input_ext_buffer = calloc(state->audio_frame_len, sizeof(Shortint));
+    state->baudot_output_ext_buffer = calloc(state->audio_frame_len, sizeof(Shortint));
+    if (state->ctm_input_ext_buffer == NULL || state->ctm_output_ext_buffer == NULL ||
+        state->baudot_input_ext_buffer == NULL || state->baudot_output_ext_buffer == NULL)
+      err(1, "ctm_session_set_rate: calloc");
+
+    init_resample_down(&(state->ctmInResampler), factor);
+    init_resample_down(&(state->baudotInResampler), factor);
+    init_resample_up(&(state->ctmOutResampler), factor);
+    init_resample_up(&(state->baudotOutResampler), factor);
+  }
+
+  /* nothing has been read yet, so the readers just take the new frame size */
+  state->ctmInputReader.frame_size = state->audio_buffer_size;
+  if (state->baudotReadFromFile)
+    state->userInputReader.frame_size = state->audio_buffer_size;
+}
+
+ctm_session_t *ctm_session_create(enum ctm_output_mode output_mode, enum ctm_user_input_mode input_mode, int ctm_output_fd, int ctm_input_fd, int user_output_fd, int user_input_fd, char *device_name)
+{
+  ctm_session_t *state;
+
   /* initialize the ctm_state structure here. */
-  state = calloc(1, sizeof(struct ctm_state));
+  if ((state = calloc(1, sizeof(struct ctm_state))) == NULL)
+    err(1, "ctm_session_create: calloc");
 
   /* setup some defaults */
   state->numSamplesToProcess           = maxULongint;
@@ -199,11 +289,17 @@ void ctm_init(enum ctm_output_mode output_mode, enum ctm_user_input_mode input_m
   state->ctmEOF                        = false;
   state->disableNegotiation            = false;
   state->disableBypass                 = false;
+  state->floatDemod                    = false;
   state->earlyMutingRequired           = false;
   state->baudotAlreadyReceived         = false;
   state->actualBaudotCharDetected      = false;
   state->baudotOutTTYCodeFifoLength    = 50;
+  state->textFlushThreshold            = 1;
+  state->textFlushDelay                = 0;
+  state->textBurstActive               = false;
 
+  state->rateFactor                    = 1;
+  state->audio_frame_len               = LENGTH_TONE_VEC;
   state->audio_buffer_size             = LENGTH_TONE_VEC * sizeof(Shortint);
 
   /* initialize the audio buffers. */
@@ -211,68 +307,134 @@ void ctm_init(enum ctm_output_mode output_mode, enum ctm_user_input_mode input_m
   state->ctm_output_buffer = calloc(LENGTH_TONE_VEC, sizeof(Shortint));
   state->baudot_input_buffer = calloc(LENGTH_TONE_VEC, sizeof(Shortint));
   state->baudot_output_buffer = calloc(LENGTH_TONE_VEC, sizeof(Shortint));
+  state->ctm_input_ext_buffer = state->ctm_input_buffer;
+  state->ctm_output_ext_buffer = state->ctm_output_buffer;
+  state->baudot_input_ext_buffer = state->baudot_input_buffer;
+  state->baudot_output_ext_buffer = state->baudot_output_buffer;
 
   /* set the i/o modes. */
-  set_modes(output_mode, input_mode, ctm_output_fd, ctm_input_fd, user_output_fd, user_input_fd, device_name);
+  set_modes(state, output_mode, input_mode, ctm_output_fd, ctm_input_fd, user_output_fd, user_input_fd, device_name);
 
-  state->audio_hdl                     = NULL;
+  init_bufio_reader(&(state->ctmInputReader), state->ctmInputFileFp, state->audio_buffer_size);
+  init_bufio_reader(&(state->userInputReader), state->userInputFileFp,
+      state->baudotReadFromFile ? state->audio_buffer_size : 1);
+  init_bufio_writer(&(state->ctmOutputWriter), state->ctmOutputFileFp);
+  init_bufio_writer(&(state->userOutputWriter), state->userOutputFileFp);
+  init_ctm_event_ring(&(state->events));
+  state->sessionId                     = 0;
 
-  sio_initpar(&state->audio_params);
-  state->audio_params.rate = 8000;
-  state->audio_params.bits = 16;
-  state->audio_params.bps = 2;
-  state->audio_params.le = SIO_LE_NATIVE;
-  state->audio_params.rchan = 1;
-  state->audio_params.pchan = 1;
-  state->audio_params.appbufsz = LENGTH_TONE_VEC;
-
-  /* for over/underrun testing. */
-  //state->audio_params.xrun = SIO_ERROR;
-
-  /* if the user has specified to use an audio device, open it here */
-  open_audio_devices();
+  state->audio                         = NULL;
 
   /* set up transmitter & receiver */
   init_baudot_tonedemod(&(state->baudot_tonedemod_state));
   init_baudot_tonemod(&(state->baudot_tonemod_state));
   init_ctm_transmitter(&(state->tx_state));
-  init_ctm_receiver(&(state->rx_state));  
+  init_ctm_receiver(&(state->rx_state));
 
-  Shortint_fifo_init(&(state->signalFifoState), SYMB_LEN+LENGTH_TONE_VEC);
+  Shortint_window_init(&(state->signalWindowState), TONEDEMOD_HISTORY_LEN, SYMB_LEN+LENGTH_TONE_VEC);
   Shortint_fifo_init(&(state->baudotOutTTYCodeFifoState), state->baudotOutTTYCodeFifoLength);
   Shortint_fifo_init(&(state->ctmOutTTYCodeFifoState),  2);
   Shortint_fifo_init(&(state->ctmToBaudotFifoState),  4000);
   Shortint_fifo_init(&(state->baudotToCtmFifoState),  3);
+
+  return state;
 }
 
-static int setup_poll_fds(struct pollfd *pfds, int nfds)
+void ctm_session_destroy(ctm_session_t *state)
+{
+  if (state == NULL)
+    return;
+
+  ctm_audio_close(state->audio);
+
+  exit_bufio_reader(&(state->ctmInputReader));
+  exit_bufio_reader(&(state->userInputReader));
+  exit_bufio_writer(&(state->ctmOutputWriter));
+  exit_bufio_writer(&(state->userOutputWriter));
+  exit_ctm_event_ring(&(state->events));
+
+  exit_ctm_receiver(&(state->rx_state));
+  exit_ctm_transmitter(&(state->tx_state));
+  exit_baudot_tonemod(&(state->baudot_tonemod_state));
+
+  Shortint_window_exit(&(state->signalWindowState));
+  Shortint_fifo_exit(&(state->baudotOutTTYCodeFifoState));
+  Shortint_fifo_exit(&(state->ctmOutTTYCodeFifoState));
+  Shortint_fifo_exit(&(state->ctmToBaudotFifoState));
+  Shortint_fifo_exit(&(state->baudotToCtmFifoState));
+
+  if (state->silentSnapshot != NULL)
+    free(state->silentSnapshot->wait_regs);
+  free(state->silentSnapshot);
+  free(state->ctm_input_buffer);
+  free(state->ctm_output_buffer);
+  free(state->baudot_input_buffer);
+  free(state->baudot_output_buffer);
+  free_ext_buffers(state);
+
+  free(state);
+}
+
+/* true, if an input can be processed without waiting for its descriptor */
+static Bool user_input_buffered(ctm_session_t *state)
+{
+  return !state->baudotEOF && bufio_ready(&(state->userInputReader));
+}
+
+static Bool ctm_input_buffered(ctm_session_t *state)
+{
+  return state->ctmReadFromFile && !state->ctmEOF && bufio_ready(&(state->ctmInputReader));
+}
+
+/* a writer is only polled after it has left bytes behind */
+static int writer_pollfd(bufio_writer_t *writer, struct pollfd *pfd)
+{
+  pfd->revents = 0;
+  if (!bufio_blocked(writer))
+  {
+    pfd->fd     = -1;
+    pfd->events = 0;
+    return 0;
+  }
+  pfd->fd     = writer->fd;
+  pfd->events = POLLOUT;
+  return 1;
+}
+
+int ctm_session_pollfd(ctm_session_t *state, struct pollfd *pfds)
 {
   /* setup POLL structs:
    * 0 = user input (baudot or text)
    * 1 = ctm input OR ctm audio
+   * 2 = ctm output, while it is blocked
+   * 3 = user output, while it is blocked
    */
 
-  int active_nfds = nfds;
+  int active_nfds = 2;
 
-  if (nfds > 0)
-    pfds[0].fd = state->userInputFileFp;
+  pfds[0].fd = state->userInputFileFp;
+  pfds[0].revents = 0;
+  pfds[1].fd = -1;
+  pfds[1].events = 0;
+  pfds[1].revents = 0;
 
-  /* if we have already hit an EOF condition on the input, stop polling. 
-   * This avoids high cpu usage.
+  /* if we have already hit an EOF condition on the input, stop polling.
+   * This avoids high cpu usage. The same holds while the input still
+   * has a buffered frame (see ctm_session_timeout()).
    * */
-  if (!state->baudotEOF)
+  if (!state->baudotEOF && !user_input_buffered(state))
     pfds[0].events = POLLIN;
   else
   {
+    pfds[0].fd = -1;
     pfds[0].events = 0;
     active_nfds -= 1;
   }
 
-  if (state->ctmReadFromFile && nfds > 1)
+  if (state->ctmReadFromFile)
   {
-    if(state->ctmEOF) {
+    if(state->ctmEOF || ctm_input_buffered(state)) {
       /* stop polling at CTM EOF. */
-      pfds[1].events = 0;
       active_nfds -= 1;
     }
     else
@@ -282,96 +444,705 @@ static int setup_poll_fds(struct pollfd *pfds, int nfds)
     }
   }
 
-  if (state->ctm_audio_dev_mode && nfds > 1) {
-    if (sio_pollfd(state->audio_hdl, &pfds[1], POLLIN|POLLOUT) != 1)
-      errx(1, "unable to setup audio device polling.");
+  if (state->ctm_audio_dev_mode) {
+    if (ctm_audio_pollfd(state->audio, &pfds[1], POLLIN|POLLOUT) == 0)
+      active_nfds -= 1;
   }
 
+  active_nfds += writer_pollfd(&(state->ctmOutputWriter), &pfds[2]);
+  active_nfds += writer_pollfd(&(state->userOutputWriter), &pfds[3]);
+
   return active_nfds;
 }
 
-int ctm_start(void)
+size_t ctm_session_backlog(ctm_session_t *state)
+{
+  return bufio_pending(&(state->ctmOutputWriter)) +
+         bufio_pending(&(state->userOutputWriter));
+}
+
+void ctm_session_start(ctm_session_t *state)
+{
+  /* the audio device is opened here, at the rate that has been set */
+  open_audio_devices(state);
+
+  if (state->ctm_audio_dev_mode)
+  {
+    fprintf(stderr, "starting audio device \"%s\"...\n", state->audio->name);
+    ctm_audio_start(state->audio);
+  }
+
+  if (state->disableNegotiation)
+    state->ctmFromFarEndDetected = true;
+}
+
+/* A hangup or an error is taken as readable, so that the following read() */
+/* sees the end of file instead of the session spinning on the descriptor. */
+#define POLL_READABLE (POLLIN | POLLHUP | POLLERR)
+
+int ctm_session_process(ctm_session_t *state, struct pollfd *pfds)
 {
-  struct pollfd *pfds = NULL;
-  int nfds;
-  int r_nfds;
   int index;
-  int active_nfds;
+  int revents;
+  int num_inputs = 0;       /* inputs that were ready          */
+  int num_incomplete = 0;   /* ... but had only a partial frame */
+  int num_flushed = 0;      /* blocked outputs that were polled */
+  int audio_revents = 0;
+
+  for (index=0; index < CTM_SESSION_NFDS; index++) {
+
+    switch (index) {
+      case 0:
+        if (state->userInputReadAhead || (pfds[index].revents & POLL_READABLE) != 0 || user_input_buffered(state))
+        {
+          num_inputs++;
+          if (layer2_process_user_input(state))
+            num_incomplete++;
+        }
+        break;
+      case 1:
+        if (state->ctm_audio_dev_mode) {
+          revents = ctm_audio_revents(state->audio, &pfds[index]);
+          audio_revents = revents;
+          if((revents & POLLIN) == POLLIN) {
+            num_inputs++;
+            layer2_process_ctm_audio_in(state);
+          }
+          if((revents & POLLOUT) == POLLOUT) {
+            layer2_process_ctm_audio_out(state);
+          }
+        }
+        else
+          if (state->ctmInputReadAhead || (pfds[index].revents & POLL_READABLE) != 0 || ctm_input_buffered(state))
+          {
+            num_inputs++;
+            if (layer2_process_ctm_file_input(state))
+              num_incomplete++;
+          }
+        break;
+      case 2:
+        if ((pfds[index].revents & (POLLOUT | POLLHUP | POLLERR)) != 0)
+        {
+          num_flushed++;
+          bufio_flush(&(state->ctmOutputWriter));
+        }
+        break;
+      case 3:
+        if ((pfds[index].revents & (POLLOUT | POLLHUP | POLLERR)) != 0)
+        {
+          num_flushed++;
+          bufio_flush(&(state->userOutputWriter));
+        }
+        break;
+      default:
+        errx(1, "ctm_session_process: invalid pollfd index.");
+        break;
+    }
+  }
+
+  /* Nothing has changed if the inputs have only delivered parts of a */
+  /* frame (e.g. from a pipe), so no output is due either.            */
+  if (num_inputs > 0 && num_incomplete == num_inputs)
+    return 0;
+
+  /* The same if only blocked outputs have become writable, they do */
+  /* not clock the session.                                         */
+  if (num_flushed > 0 && num_inputs == 0 && audio_revents == 0)
+    return 0;
+
+  /* process output files here, as these never block. */
+  layer2_process_user_output(state);
+
+  if (!state->ctm_audio_dev_mode)
+    layer2_process_ctm_file_output(state);
 
-  nfds = 2;
+  /* The output files are written in large blocks while the inputs are */
+  /* buffered (e.g. offline decoding), but not held back when the      */
+  /* session is going to wait for more input. The text output follows  */
+  /* its own flush policy (see layer2_process_text_flush()). Blocked   */
+  /* outputs are only written again on POLLOUT.                        */
+  if (ctm_session_timeout(state) != 0)
+  {
+    if (!bufio_blocked(&(state->ctmOutputWriter)))
+      bufio_flush(&(state->ctmOutputWriter));
+    if (state->baudotWriteToFile && !bufio_blocked(&(state->userOutputWriter)))
+      bufio_flush(&(state->userOutputWriter));
+  }
+
+  /* conditions to finish the session */
+  if ((state->numSamplesToProcess > 0 && state->numSamplesToProcess <= state->cntProcessedSamples) ||
+      (state->baudotEOF && state->ctmEOF && state->ctmTransmitterIsIdle && (Shortint_fifo_check(&(state->ctmToBaudotFifoState)) == 0) &&
+       (state->numBaudotBitsStillToModulate == 0)))
+    return 1;
+  /* finish on user text input EOF, if desired. */
+  if (state->shutdown_on_eof && state->baudotEOF && state->ctmTransmitterIsIdle && (Shortint_fifo_check(&(state->ctmToBaudotFifoState)) == 0))
+    return 1;
+
+  return 0;
+}
+
+/* Reads the next frame of the Baudot input file of every session that */
+/* ctm_session_process() would read it for, and demodulates them        */
+/* BAUDOT_LANES at a time.                                              */
+static void read_ahead_baudot_input(ctm_session_t *const *sessions, struct pollfd *const *pfds, int num)
+{
+  ctm_session_t            *state;
+  Shortint                 *tones[BAUDOT_LANES];
+  fifo_state_t             *fifos[BAUDOT_LANES];
+  baudot_tonedemod_state_t *demods[BAUDOT_LANES];
+  int                       index;
+  int                       num_read = 0;
+
+  for (index=0; index < num; index++)
+  {
+    state = sessions[index];
+    if (!state->baudotReadFromFile || state->userInputReadAhead || state->floatDemod)
+      continue;
+    if ((pfds[index][0].revents & POLL_READABLE) == 0 && !user_input_buffered(state))
+      continue;
+    if (Shortint_fifo_check(&(state->baudotOutTTYCodeFifoState)) >= state->baudotOutTTYCodeFifoLength)
+      continue;
 
-  if ((pfds = calloc(nfds, sizeof(struct pollfd))) == NULL)
-    err(1, "ctm_start: pfds == NULL");
+    state->userInputReadAhead  = true;
+    state->userInputIncomplete = layer2_read_baudot_input(state);
+    if (state->userInputIncomplete)
+      continue;
+    tones[num_read]  = state->baudot_input_buffer;
+    fifos[num_read]  = &(state->baudotOutTTYCodeFifoState);
+    demods[num_read] = &(state->baudot_tonedemod_state);
+    if (++num_read == BAUDOT_LANES)
+    {
+      baudot_tonedemod_multi(tones, LENGTH_TONE_VEC, fifos, demods);
+      num_read = 0;
+    }
+  }
+  if (num_read > 0)
+  {
+    for (index=num_read; index < BAUDOT_LANES; index++)
+    {
+      tones[index]  = NULL;
+      fifos[index]  = NULL;
+      demods[index] = NULL;
+    }
+    baudot_tonedemod_multi(tones, LENGTH_TONE_VEC, fifos, demods);
+  }
+}
+
+void ctm_session_process_multi(ctm_session_t *const *sessions, struct pollfd *const *pfds, int *finished, int num)
+{
+  ctm_session_t  *state;
+  window_state_t *windows[TONEDEMOD_LANES];
+  rx_state_t     *rx_states[TONEDEMOD_LANES];
+  int            index;
+  int            num_read = 0;
+
+  read_ahead_baudot_input(sessions, pfds, num);
+
+  /* read the CTM input frames, as ctm_session_process() would, and */
+  /* demodulate them whenever there are enough for all lanes        */
+  for (index=0; index < num; index++)
+  {
+    state = sessions[index];
+    if (state->ctm_audio_dev_mode || !state->ctmReadFromFile || state->ctmEOF ||
+        state->ctmInputReadAhead)
+      continue;
+    if ((pfds[index][1].revents & POLL_READABLE) == 0 && !ctm_input_buffered(state))
+      continue;
+
+    state->ctmInputReadAhead  = true;
+    state->ctmInputIncomplete = layer2_read_ctm_file_input(state);
+    windows[num_read]   = &(state->signalWindowState);
+    rx_states[num_read] = &(state->rx_state);
+    if (++num_read == TONEDEMOD_LANES)
+    {
+      ctm_receiver_demodulate(windows, rx_states, num_read);
+      num_read = 0;
+    }
+  }
+  if (num_read > 0)
+    ctm_receiver_demodulate(windows, rx_states, num_read);
+
+  for (index=0; index < num; index++)
+    finished[index] = ctm_session_process(sessions[index], pfds[index]);
+}
+
+int ctm_session_timeout(ctm_session_t *state)
+{
+  if (user_input_buffered(state) || ctm_input_buffered(state))
+    return 0;
 
   if (state->ctm_audio_dev_mode)
+    return ctm_audio_timeout(state->audio);
+
+  return INFTIM;
+}
+
+int ctm_session_map_files(ctm_session_t *state)
+{
+  size_t size_hint, num_bytes;
+
+  if (!state->ctmReadFromFile || !bufio_map_reader(&(state->ctmInputReader)))
+    return 0;
+  bufio_map_reader(&(state->userInputReader));
+
+  /* The session runs until both inputs have ended, so the outputs */
+  /* get about as long as the longer input (a character of text    */
+  /* takes at least one frame).                                    */
+  size_hint = state->ctmInputReader.end - state->ctmInputReader.start;
+  num_bytes = state->userInputReader.end - state->userInputReader.start;
+  if (!state->baudotReadFromFile)
+    num_bytes *= state->audio_buffer_size;
+  if (state->userInputReader.mapped && num_bytes > size_hint)
+    size_hint = num_bytes;
+  size_hint += 8000*state->rateFactor*sizeof(Shortint);
+
+  bufio_map_writer(&(state->ctmOutputWriter), size_hint);
+  if (state->baudotWriteToFile)
+    bufio_map_writer(&(state->userOutputWriter), size_hint);
+
+  state->silentSnapshot = calloc(1, sizeof(ctm_silent_snapshot_t));
+  if (state->silentSnapshot == NULL ||
+      (state->silentSnapshot->wait_regs = calloc(3*state->rx_state.wait_state.length_shift_reg,
+                                                 sizeof(Shortint))) == NULL)
+    err(1, "ctm_session_map_files: calloc");
+
+  return 1;
+}
+
+/*
+ * Silence in mapped input files is passed over without running the
+ * engine, but only once the engine has been seen to come out of a few
+ * silent frames exactly as it went in, apart from its frame and symbol
+ * counters (see process_silent_frame()). Every further run of as many
+ * silent frames would do the same, so it is enough to advance the
+ * counters and the files. Whether the engine gets there depends on its
+ * filters having decayed to zero or to a short limit cycle, so the
+ * output does not depend on the skipping.
+ */
+
+/* longest limit cycle of the filters that is passed over */
+#define MAX_SILENT_PERIOD 16
+
+/* wait_for_sync() counts the two bits of each symbol */
+#define SILENT_FRAME_SYNC_BITS (2*(LENGTH_TONE_VEC/SYMB_LEN))
+
+/* number of frames, up to max_frames, in which both inputs are silent */
+static size_t silent_frames(ctm_session_t *state, size_t max_frames)
+{
+  ULongint num_left;
+
+  if (state->ctmEOF ||
+      (state->shutdown_on_eof && state->baudotEOF))
+    return 0;
+
+  /* stop in front of the frame that ends the session */
+  if (state->numSamplesToProcess > 0)
   {
-    fprintf(stderr, "starting audio device \"%s\"...\n", state->audio_device_name);
+    if (state->numSamplesToProcess <= state->cntProcessedSamples)
+      return 0;
+    num_left = (state->numSamplesToProcess - state->cntProcessedSamples - 1) / LENGTH_TONE_VEC;
+    if (max_frames > num_left)
+      max_frames = num_left;
+  }
+
+  /* after its end, the Baudot input is zero-padded, the text input is */
+  /* not read any more                                                 */
+  if (!state->baudotEOF)
+  {
+    if (!state->baudotReadFromFile)
+      return 0;
+    max_frames = bufio_zero_frames(&(state->userInputReader), max_frames);
+  }
 
-    if(sio_start(state->audio_hdl) == 0)
-      errx(1, "unable to start audio device \"%s\".\n", state->audio_device_name);
+  return bufio_zero_frames(&(state->ctmInputReader), max_frames);
+}
 
-    if(sio_setvol(state->audio_hdl, SIO_MAXVOL) == 0)
-      errx(1, "unable to set audio volume on device \"%s\".\n", state->audio_device_name);
-  } 
+/* true if nothing is going on in the engine, apart from its filters */
+static Bool engine_idle(ctm_session_t *state)
+{
+  return state->ctmTransmitterIsIdle && !state->tx_state.burstActive &&
+    (state->numCTMBitsStillToModulate == 0) &&
+    (state->numBaudotBitsStillToModulate == 0) &&
+    !state->earlyMutingRequired && !state->actualBaudotCharDetected &&
+    (state->cntHangoverFramesForMuteBaudot == 0) &&
+    !state->enquiryFromFarEndDetected &&
+    (Shortint_fifo_check(&(state->baudotOutTTYCodeFifoState)) == 0) &&
+    (Shortint_fifo_check(&(state->ctmOutTTYCodeFifoState)) == 0) &&
+    (Shortint_fifo_check(&(state->baudotToCtmFifoState)) == 0) &&
+    (Shortint_fifo_check(&(state->ctmToBaudotFifoState)) == 0) &&
+    !state->rx_state.wait_state.sync_found &&
+    (state->rx_state.samplingCorrection == 0) &&
+    (state->rx_state.wait_state.cntSymbolsSinceEndOfBurst >= NUM_SYMBOLS_AFTER_BURST);
+}
 
-  if (state->disableNegotiation)
-    state->ctmFromFarEndDetected = true;
+static Bool all_zero(const Shortint *samples, Longint num)
+{
+  Longint cnt;
+
+  for (cnt=0; cnt<num; cnt++)
+    if (samples[cnt] != 0)
+      return false;
+  return true;
+}
+
+/* true if the resamplers, if any, put out silence for silence */
+static Bool resamplers_silent(ctm_session_t *state)
+{
+  return (state->rateFactor == 1) ||
+    (resample_silent(&(state->ctmInResampler)) &&
+     resample_silent(&(state->ctmOutResampler)) &&
+     resample_silent(&(state->baudotInResampler)) &&
+     resample_silent(&(state->baudotOutResampler)));
+}
+
+/* true if the signal window, including its history, holds only zeros */
+static Bool window_silent(window_state_t *window)
+{
+  return all_zero(Shortint_window_view(window) - window->length_history,
+                  window->length_history + Shortint_window_check(window));
+}
+
+/* The diff buffer of the Baudot demodulator is circular, and its write */
+/* position moves on with every sample. Once the buffer holds a single  */
+/* value (the filters settle on a constant diff in silence) the         */
+/* position makes no difference, and is set back to 0 so that silence   */
+/* can leave the state unchanged.                                       */
+static void normalize_baudot_tonedemod(baudot_tonedemod_state_t *baudot_state)
+{
+  Shortint cnt;
+
+  for (cnt=1; cnt<=BAUDOT_BIT_DURATION; cnt++)
+    if (baudot_state->bufferDiff[cnt] != baudot_state->bufferDiff[0])
+      return;
+  baudot_state->posDiff = 0;
+}
+
+/* takes the snapshot that the following silent frames are compared to */
+static void take_silent_snapshot(ctm_session_t *state)
+{
+  ctm_silent_snapshot_t *snapshot   = state->silentSnapshot;
+  wait_for_sync_state_t *wait_state = &(state->rx_state.wait_state);
+  Longint                len        = wait_state->length_shift_reg;
+
+  normalize_baudot_tonedemod(&(state->baudot_tonedemod_state));
+  memcpy(&(snapshot->rx_state), &(state->rx_state), sizeof(rx_state_t));
+  memcpy(&(snapshot->baudot_tonedemod_state), &(state->baudot_tonedemod_state),
+         sizeof(baudot_tonedemod_state_t));
+  memcpy(snapshot->wait_regs,       wait_state->shift_reg,       len*sizeof(Shortint));
+  memcpy(snapshot->wait_regs+len,   wait_state->xcorr1_shiftreg, len*sizeof(Shortint));
+  memcpy(snapshot->wait_regs+2*len, wait_state->xcorr2_shiftreg, len*sizeof(Shortint));
+  snapshot->sync_on_baudot = state->syncOnBaudot;
+  snapshot->num_window     = Shortint_window_check(&(state->signalWindowState));
+}
+
+/* true if the engine is back at the snapshot, num_frames silent frames */
+/* later, apart from the counters that skip_silent_frames() advances    */
+static Bool back_at_silent_snapshot(ctm_session_t *state, Shortint num_frames)
+{
+  ctm_silent_snapshot_t *snapshot   = state->silentSnapshot;
+  wait_for_sync_state_t *wait_state = &(state->rx_state.wait_state);
+  Longint                len        = wait_state->length_shift_reg;
+  ULongint               num_symbols;
+
+  num_symbols = snapshot->rx_state.wait_state.cntSymbolsSinceEndOfBurst +
+    num_frames*SILENT_FRAME_SYNC_BITS;
+  if (num_symbols > maxUShortint)
+    num_symbols = maxUShortint;
+  if (wait_state->cntSymbolsSinceEndOfBurst != num_symbols)
+    return false;
+  snapshot->rx_state.wait_state.cntSymbolsSinceEndOfBurst = wait_state->cntSymbolsSinceEndOfBurst;
+  normalize_baudot_tonedemod(&(state->baudot_tonedemod_state));
+
+  return (state->syncOnBaudot == snapshot->sync_on_baudot) &&
+    (Shortint_window_check(&(state->signalWindowState)) == snapshot->num_window) &&
+    !memcmp(&(snapshot->rx_state), &(state->rx_state), sizeof(rx_state_t)) &&
+    !memcmp(&(snapshot->baudot_tonedemod_state), &(state->baudot_tonedemod_state),
+            sizeof(baudot_tonedemod_state_t)) &&
+    !memcmp(snapshot->wait_regs,       wait_state->shift_reg,       len*sizeof(Shortint)) &&
+    !memcmp(snapshot->wait_regs+len,   wait_state->xcorr1_shiftreg, len*sizeof(Shortint)) &&
+    !memcmp(snapshot->wait_regs+2*len, wait_state->xcorr2_shiftreg, len*sizeof(Shortint));
+}
+
+/*
+ * Processes one silent frame. A fixed point filter can end up in a limit
+ * cycle instead of decaying to zero (the 1800 Hz bandpass of the Baudot
+ * demodulator does, with a period of 9 frames), so the engine is compared
+ * with a snapshot taken up to MAX_SILENT_PERIOD frames before.
+ * state->quiescent is set, and state->silentPeriod to the number of
+ * frames, if the engine has come back to it, having put out only silence
+ * in between.
+ */
+static int process_silent_frame(ctm_session_t *state, struct pollfd *pfds)
+{
+  int finished;
+
+  state->quiescent = false;
+  if (!engine_idle(state) || !window_silent(&(state->signalWindowState)))
+  {
+    state->cntSilentFrames = 0;
+    return ctm_session_process(state, pfds);
+  }
+
+  if (state->cntSilentFrames == 0 || state->cntSilentFrames >= MAX_SILENT_PERIOD)
+  {
+    take_silent_snapshot(state);
+    state->cntSilentFrames = 0;
+  }
+
+  if ((finished = ctm_session_process(state, pfds)) != 0)
+    return finished;
+
+  /* the silence in between must have been silence out, too */
+  if (!engine_idle(state) ||
+      !window_silent(&(state->signalWindowState)) ||
+      !resamplers_silent(state) ||
+      !all_zero(state->ctm_output_buffer, LENGTH_TONE_VEC) ||
+      (state->baudotWriteToFile && !all_zero(state->baudot_output_buffer, LENGTH_TONE_VEC)))
+  {
+    state->cntSilentFrames = 0;
+    return 0;
+  }
+
+  state->cntSilentFrames++;
+  if (back_at_silent_snapshot(state, state->cntSilentFrames))
+  {
+    state->quiescent       = true;
+    state->silentPeriod    = state->cntSilentFrames;
+    state->cntSilentFrames = 0;
+  }
+
+  return 0;
+}
+
+/* does what num_frames silent frames would do to a quiescent session, */
+/* num_frames being a multiple of its silentPeriod                     */
+static void skip_silent_frames(ctm_session_t *state, size_t num_frames)
+{
+  wait_for_sync_state_t *wait_state = &(state->rx_state.wait_state);
+  ULongint               num;
+
+  bufio_skip_frames(&(state->ctmInputReader), num_frames);
+  if (!state->baudotEOF)
+    bufio_skip_frames(&(state->userInputReader), num_frames);
+
+  bufio_write_zero(&(state->ctmOutputWriter), num_frames*state->audio_buffer_size);
+  if (state->baudotWriteToFile)
+    bufio_write_zero(&(state->userOutputWriter), num_frames*state->audio_buffer_size);
+
+  state->cntProcessedSamples += num_frames*LENGTH_TONE_VEC;
+
+  num = state->cntFramesSinceBurstInit + num_frames;
+  state->cntFramesSinceBurstInit = (num < maxShortint) ? num : maxShortint;
+  num = state->cntFramesSinceEnquiryDetected + num_frames;
+  state->cntFramesSinceEnquiryDetected = (num < maxShortint) ? num : maxShortint;
+  num = wait_state->cntSymbolsSinceEndOfBurst + num_frames*SILENT_FRAME_SYNC_BITS;
+  wait_state->cntSymbolsSinceEndOfBurst = (num < maxUShortint) ? num : maxUShortint;
+}
+
+/* Waits until the blocked outputs have taken their bytes, down to */
+/* max_backlog bytes.                                              */
+static void wait_for_outputs(ctm_session_t *state, size_t max_backlog)
+{
+  struct pollfd pfds[CTM_SESSION_NFDS];
+
+  while (ctm_session_backlog(state) > max_backlog)
+  {
+    ctm_session_pollfd(state, pfds);
+    pfds[0].fd = -1;
+    pfds[1].fd = -1;
+    if (pfds[2].fd < 0 && pfds[3].fd < 0)
+    {
+      /* not blocked, only not flushed yet */
+      bufio_flush(&(state->ctmOutputWriter));
+      bufio_flush(&(state->userOutputWriter));
+      continue;
+    }
+    if (poll(pfds, CTM_SESSION_NFDS, INFTIM) == -1 && errno != EINTR)
+      err(1, "ctm_session_run: polling error");
+    if (pfds[2].revents != 0)
+      bufio_flush(&(state->ctmOutputWriter));
+    if (pfds[3].revents != 0)
+      bufio_flush(&(state->userOutputWriter));
+  }
+}
+
+int ctm_session_run(ctm_session_t *state)
+{
+  struct pollfd pfds[CTM_SESSION_NFDS];
+  int nfds, timeout;
+  size_t num_silent;
+
+  ctm_session_start(state);
 
   /*
    * Main processing loop
    */
   for(;;) {
-    active_nfds = setup_poll_fds(pfds, nfds);
+    /* Outputs that do not keep up (e.g. a pipe to a slow reader) hold */
+    /* back the file inputs, instead of the backlog growing without    */
+    /* limit. An audio device cannot wait.                             */
+    if (!state->ctm_audio_dev_mode)
+      wait_for_outputs(state, CTM_SESSION_MAX_BACKLOG);
 
-    if (active_nfds > 0)
+    if (state->ctmInputReader.mapped && state->userInputReader.mapped)
     {
-      r_nfds = poll(pfds, nfds, INFTIM);
-
-      if (r_nfds == -1)
-        err(1, "ctm_start: polling error");
-
-      for (index=0; index < nfds; index++) {
-
-        switch (index) {
-          case 0:
-            if ((pfds[index].revents & POLLIN) == POLLIN)
-              layer2_process_user_input(state);
-            break;
-          case 1:
-            if (state->ctm_audio_dev_mode) {
-              if((sio_revents(state->audio_hdl, &pfds[index]) & POLLIN) == POLLIN) {
-                layer2_process_ctm_audio_in(state);
-              }
-              if((sio_revents(state->audio_hdl, &pfds[index]) & POLLOUT) == POLLOUT) {
-                layer2_process_ctm_audio_out(state);
-              }
-            }
-            else
-              if ((pfds[index].revents & POLLIN) == POLLIN)
-                layer2_process_ctm_file_input(state);
-            break;
-          default:
-            errx(1, "ctm_start: invalid pollfd index.");
-            break;
-        }
+      /* offline: nothing to wait for, the inputs are in memory */
+      nfds = ctm_session_pollfd(state, pfds);
+
+      num_silent = silent_frames(state, state->quiescent ? (size_t)-1 : 1);
+      if (state->quiescent && num_silent >= (size_t)state->silentPeriod)
+        skip_silent_frames(state, num_silent - num_silent % state->silentPeriod);
+      else if (num_silent > 0)
+      {
+        if (process_silent_frame(state, pfds))
+          break;
       }
+      else
+      {
+        state->quiescent = false;
+        if (ctm_session_process(state, pfds))
+          break;
+      }
+      continue;
     }
 
-    /* process output files here, as these never block. */
-    layer2_process_user_output(state);
-
-    if (!state->ctm_audio_dev_mode)
-      layer2_process_ctm_file_output(state);
+    nfds = ctm_session_pollfd(state, pfds);
+    timeout = ctm_session_timeout(state);
+    if (nfds > 0 || timeout > 0)
+    {
+      if (poll(pfds, CTM_SESSION_NFDS, timeout) == -1)
+        err(1, "ctm_session_run: polling error");
+    }
 
-    /* conditions to break the loop */
-    if ((state->numSamplesToProcess > 0 && state->numSamplesToProcess <= state->cntProcessedSamples) ||
-        (state->baudotEOF && state->ctmEOF && state->ctmTransmitterIsIdle && (Shortint_fifo_check(&(state->ctmToBaudotFifoState)) == 0) &&
-         (state->numBaudotBitsStillToModulate == 0)))
-      break;
-    /* break on user text input EOF, if desired. */
-    if (state->shutdown_on_eof && state->baudotEOF && state->ctmTransmitterIsIdle && (Shortint_fifo_check(&(state->ctmToBaudotFifoState)) == 0))
+    if (ctm_session_process(state, pfds))
       break;
   }
 
+  /* the session owns the process, so it can wait for its outputs */
+  wait_for_outputs(state, 0);
+
   return 0;
 }
+
+/* decimates a frame at the external rate, NULL is a silent frame */
+static void resample_frame_in(ctm_session_t *state, resample_state_t *resampler,
+    const Shortint *frame, Shortint *ext_buffer, Shortint *buffer)
+{
+  if (frame == NULL)
+  {
+    memset(ext_buffer, 0, state->audio_buffer_size);
+    frame = ext_buffer;
+  }
+  resample_down(resampler, frame, buffer, LENGTH_TONE_VEC);
+}
+
+void ctm_process_frame(ctm_session_t *state, const Shortint *ctm_in, const Shortint *user_in, Shortint *ctm_out, Shortint *user_out)
+{
+  Shortint *ctm_input_buffer     = state->ctm_input_buffer;
+  Shortint *ctm_output_buffer    = state->ctm_output_buffer;
+  Shortint *baudot_input_buffer  = state->baudot_input_buffer;
+  Shortint *baudot_output_buffer = state->baudot_output_buffer;
+
+  if (state->rateFactor > 1)
+  {
+    /* the engine works on its own buffers at 8 kHz */
+    resample_frame_in(state, &(state->ctmInResampler), ctm_in,
+        state->ctm_input_ext_buffer, state->ctm_input_buffer);
+    if (state->baudotReadFromFile)
+      resample_frame_in(state, &(state->baudotInResampler), user_in,
+          state->baudot_input_ext_buffer, state->baudot_input_buffer);
+  }
+  else
+  {
+    /* Let the engine work directly on the caller's frames. The input */
+    /* frames are only read by the engine.                            */
+    if (ctm_in != NULL)
+      state->ctm_input_buffer = (Shortint *)ctm_in;
+    else
+      memset(state->ctm_input_buffer, 0, state->audio_buffer_size);
+    if (ctm_out != NULL)
+      state->ctm_output_buffer = ctm_out;
+
+    if (state->baudotReadFromFile)
+    {
+      if (user_in != NULL)
+        state->baudot_input_buffer = (Shortint *)user_in;
+      else
+        memset(state->baudot_input_buffer, 0, state->audio_buffer_size);
+      if (user_out != NULL)
+        state->baudot_output_buffer = user_out;
+    }
+  }
+
+  if (state->baudotReadFromFile)
+    layer2_process_baudot_in(state);
+
+  Shortint_window_push(&(state->signalWindowState), state->ctm_input_buffer,
+      LENGTH_TONE_VEC);
+  layer2_process_ctm_in(state);
+
+  /* In text mode, received characters stay in the ctmToBaudotFifo */
+  /* until they are fetched with ctm_session_get_text().           */
+  if (state->baudotWriteToFile)
+    layer2_generate_user_output(state);
+
+  layer2_process_ctm_out(state);
+
+  if (state->rateFactor > 1)
+  {
+    resample_up(&(state->ctmOutResampler), state->ctm_output_buffer,
+        (ctm_out != NULL) ? ctm_out : state->ctm_output_ext_buffer, LENGTH_TONE_VEC);
+    if (state->baudotWriteToFile)
+      resample_up(&(state->baudotOutResampler), state->baudot_output_buffer,
+          (user_out != NULL) ? user_out : state->baudot_output_ext_buffer, LENGTH_TONE_VEC);
+  }
+
+  state->ctm_input_buffer     = ctm_input_buffer;
+  state->ctm_output_buffer    = ctm_output_buffer;
+  state->baudot_input_buffer  = baudot_input_buffer;
+  state->baudot_output_buffer = baudot_output_buffer;
+}
+
+int ctm_session_put_text(ctm_session_t *state, const char *text, int len)
+{
+  int cnt;
+
+  if (state->baudotReadFromFile)
+    return 0;
+
+  for (cnt=0; cnt<len; cnt++)
+  {
+    if (Shortint_fifo_check(&(state->baudotOutTTYCodeFifoState)) >= state->baudotOutTTYCodeFifoLength)
+      break;
+    layer2_process_text_in(state, text[cnt]);
+  }
+
+  return cnt;
+}
+
+int ctm_session_get_text(ctm_session_t *state, char *text, int len)
+{
+  int cnt = 0;
+
+  if (state->baudotWriteToFile)
+    return 0;
+
+  while (cnt<len && Shortint_fifo_check(&(state->ctmToBaudotFifoState)) > 0)
+  {
+    Shortint_fifo_pop(&(state->ctmToBaudotFifoState), &(state->ttyCode), 1);
+    if (state->ttyCode != -1)
+      text[cnt++] = convertTTYcode2char(state->ttyCode);
+  }
+
+  return cnt;
+}
+
+int ctm_session_get_events(ctm_session_t *state, ctm_event_t *events, int max_events)
+{
+  return ctm_event_get(&(state->events), events, max_events);
+}
+
+ULongint ctm_session_dropped_events(ctm_session_t *state)
+{
+  return ctm_event_dropped(&(state->events));
+}
@@ -1,21 +1,26 @@
 #ifndef ctm_h
 #define ctm_h
 
-#ifdef __OpenBSD__
-#include <sys/types.h>
-#include <sndio.h>
-#endif
-
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <err.h>
+#include <poll.h>
 
 #include "typedefs.h"
+#include "audio_backend.h"
+#include "bufio.h"
+#include "ctm_event.h"
 #include "ctm_transmitter.h"
 #include "ctm_receiver.h"
 #include "baudot_functions.h"
+#include "resample.h"
 
+/*
+ * All state of one CTM session (i.e. one call). Nothing in the engine is
+ * kept in global or function-level static variables, so any number of
+ * sessions can be run side by side in one process.
+ */
 struct ctm_state {
     Shortint     numCTMBitsStillToModulate;
     Shortint     numBaudotBitsStillToModulate;
@@ -55,8 +60,17 @@ struct ctm_state {
     Bool         actualBaudotCharDetected;
 
     Bool         compat_mode;
-    Bool         ctm_audio_dev_mode; /* by default, we will use the "default" system audio device for CTM I/O. */
+    Bool         ctm_audio_dev_mode; /* by default, the CTM signal goes through an audio backend, see audio_backend.h */
     Bool         shutdown_on_eof;
+    Bool         floatDemod;         /* single-precision demodulators, see ctm_session_set_float_demod() */
+
+    /* the next frame of the CTM input file has been read and demodulated */
+    /* by ctm_session_process_multi(), or only a part of it had arrived   */
+    Bool         ctmInputReadAhead;
+    Bool         ctmInputIncomplete;
+    /* the same for the next frame of the Baudot input file */
+    Bool         userInputReadAhead;
+    Bool         userInputIncomplete;
   
     tx_state_t   tx_state;
     rx_state_t   rx_state;
@@ -70,7 +84,7 @@ struct ctm_state {
   
     Shortint      baudotOutTTYCodeFifoLength;
     fifo_state_t  baudotOutTTYCodeFifoState;
-    fifo_state_t  signalFifoState;
+    window_state_t signalWindowState;
     fifo_state_t  ctmOutTTYCodeFifoState;
     fifo_state_t  baudotToCtmFifoState;
     fifo_state_t  ctmToBaudotFifoState;
@@ -80,7 +94,24 @@ struct ctm_state {
     Shortint   *baudot_output_buffer;
     Shortint   *ctm_output_buffer;
 
-    int        audio_buffer_size;
+    int        audio_buffer_size;  /* bytes of a frame at the external rate */
+
+    /* external sample rate, see ctm_session_set_rate(). The engine runs */
+    /* at 8 kHz on the buffers above; the frames at the external rate    */
+    /* are rateFactor times as long and are resampled on the way in and  */
+    /* out. With a rateFactor of 1, the *_ext_buffer are the same as the */
+    /* buffers above.                                                    */
+
+    Shortint   rateFactor;
+    Shortint   audio_frame_len;    /* samples of a frame at the external rate */
+    Shortint   *baudot_input_ext_buffer;
+    Shortint   *ctm_input_ext_buffer;
+    Shortint   *baudot_output_ext_buffer;
+    Shortint   *ctm_output_ext_buffer;
+    resample_state_t baudotInResampler;
+    resample_state_t ctmInResampler;
+    resample_state_t baudotOutResampler;
+    resample_state_t ctmOutResampler;
 
     /* Define file variables */
     
@@ -88,6 +119,33 @@ struct ctm_state {
     int ctmOutputFileFp;
     int userInputFileFp;
     int userOutputFileFp;
+
+    /* buffered I/O on the files above */
+
+    bufio_reader_t ctmInputReader;
+    bufio_reader_t userInputReader;
+    bufio_writer_t ctmOutputWriter;
+    bufio_writer_t userOutputWriter;
+
+    /* text output, written out according to the flush policy, */
+    /* see ctm_session_set_text_flush()                        */
+
+    size_t     textFlushThreshold; /* bytes, 1 = every character             */
+    ULongint   textFlushDelay;     /* samples, 0 = no limit                  */
+    ULongint   textPendingSince;   /* cntProcessedSamples at the oldest byte */
+    Bool       textBurstActive;    /* a burst was going on in the last frame */
+
+    /* event log, see ctm_session_get_events() */
+
+    ctm_event_ring_t events;
+    ULongint   sessionId;
+
+    /* offline processing of mapped files, see ctm_session_map_files() */
+
+    Bool       quiescent;        /* silentPeriod silent frames leave the engine as it was */
+    Shortint   silentPeriod;
+    Shortint   cntSilentFrames;  /* silent frames since the snapshot, 0 = none */
+    struct ctm_silent_snapshot *silentSnapshot;
   
     const char* ctmInputFileName;
     const char* baudotInputFileName;
@@ -97,8 +155,7 @@ struct ctm_state {
     const char* text_input_filename;
     const char* audio_device_name;
   
-    struct sio_hdl *audio_hdl;
-    struct sio_par audio_params; 
+    ctm_audio_t *audio;
 };
 
 /*
@@ -108,7 +165,8 @@ struct ctm_state {
 enum ctm_output_mode {
   CTM_AUDIO,
   CTM_FILE,
-  CTM_FILE_COMPAT
+  CTM_FILE_COMPAT,
+  CTM_FRAMES      /* no I/O of its own, driven by ctm_process_frame() */
 };
 
 enum ctm_user_input_mode {
@@ -127,15 +185,163 @@ enum on_off {
   OFF
 };
 
+typedef struct ctm_state ctm_session_t;
+
+/* number of pollfd structures used by one session */
+#define CTM_SESSION_NFDS 4
+
+/* output bytes ctm_session_run() lets pile up before it stops reading */
+/* its input files, see ctm_session_backlog()                          */
+#define CTM_SESSION_MAX_BACKLOG (4*BUFIO_BUFFER_SIZE)
+
 /* 
  * API functions
 */
 
-/* The first char* name is used for audio devices, if that is the mode enabled. */
-void ctm_init(enum ctm_output_mode output_mode, enum ctm_user_input_mode input_mode, int, int, int, int, char *);
-void ctm_set_negotiation(enum on_off);
-int ctm_start(void);
-void ctm_set_num_samples(int);
-void ctm_set_shutdown_on_eof(int);
+/* The char* is the audio device (see audio_backend.h) used in CTM_AUDIO mode, NULL for the default. */
+ctm_session_t *ctm_session_create(enum ctm_output_mode output_mode, enum ctm_user_input_mode input_mode, int, int, int, int, char *);
+void ctm_session_destroy(ctm_session_t *);
+void ctm_session_set_negotiation(ctm_session_t *, enum on_off);
+void ctm_session_set_num_samples(ctm_session_t *, int);
+void ctm_session_set_shutdown_on_eof(ctm_session_t *, int);
+
+/* correlator of the CTM tone demodulator, see tonedemod_set_correlator() */
+void ctm_session_set_correlator(ctm_session_t *, enum tonedemod_correlator);
+
+/* lag tracking of the CTM tone demodulator while in sync (default OFF), */
+/* see tonedemod_set_lag_tracking()                                      */
+void ctm_session_set_lag_tracking(ctm_session_t *, enum on_off);
+
+/*
+ * Single-precision versions of the CTM and Baudot demodulators (default
+ * OFF): faster on processors with AVX, but not bit-exact with the fixed
+ * point reference, see tonedemod_float.h, baudot_float.h and ctmcompare.
+ * The settings of ctm_session_set_correlator() and
+ * ctm_session_set_lag_tracking() do not apply to them, and
+ * ctm_session_process_multi() demodulates such a session on its own.
+ */
+void ctm_session_set_float_demod(ctm_session_t *, enum on_off);
+
+/* id stored in the events of the session (default 0) */
+void ctm_session_set_id(ctm_session_t *, ULongint);
+
+/*
+ * Flush policy of the text output. The buffered text is written out at
+ * the end of every burst (sent or received), once max_bytes are waiting,
+ * or when the oldest character has waited max_delay_ms of the sample
+ * clock (0 = no limit). The default, max_bytes = 1, writes every
+ * character as it comes.
+ */
+void ctm_session_set_text_flush(ctm_session_t *, int max_bytes, int max_delay_ms);
+
+/*
+ * Sample rate of the CTM and Baudot signals, 8000 (default), 16000 or
+ * 48000; anything else is fatal. The modem itself runs at 8 kHz, other
+ * rates are converted by the polyphase filters of resample.h, which add
+ * about 1.5 ms of delay in each direction. The frames of the files, the
+ * audio device and ctm_process_frame() then have rate/8000 times
+ * LENGTH_TONE_VEC samples. Sample counts (ctm_session_set_num_samples(),
+ * the flush delay, cntProcessedSamples) stay at 8 kHz. Call before
+ * ctm_session_map_files() and ctm_session_start().
+ */
+void ctm_session_set_rate(ctm_session_t *, int rate);
+
+/* start the session, opening the audio device if there is one; must be */
+/* called once before ctm_session_process().                             */
+void ctm_session_start(ctm_session_t *);
+
+/* 
+ * Fill in the CTM_SESSION_NFDS pollfd structures the session is waiting
+ * on. Returns the number of descriptors that are actually polled. The
+ * output files are asked for POLLOUT only while they are blocked, i.e.
+ * a non-blocking descriptor has not taken all bytes; nothing is read or
+ * written here.
+ */
+int ctm_session_pollfd(ctm_session_t *, struct pollfd *);
+
+/*
+ * Bytes of the output files that wait to be written. The outputs never
+ * block the session, so a host must limit this itself, e.g. stop feeding
+ * the session or close it.
+ */
+size_t ctm_session_backlog(ctm_session_t *);
+
+/*
+ * Run one iteration of the session, given the revents of the pollfd
+ * structures set up by ctm_session_pollfd(). Returns 1 if the session
+ * has finished, 0 otherwise.
+ */
+int ctm_session_process(ctm_session_t *, struct pollfd *);
+
+/*
+ * ctm_session_process() for num sessions at once, each with its own
+ * pollfd structures, which returns in finished[] whether each session
+ * has finished. The CTM input of the sessions that read it from a file
+ * is read first, and all of them are demodulated together, up to
+ * TONEDEMOD_LANES per instruction (see ctm_receiver_demodulate()); the
+ * same for the Baudot input, BAUDOT_LANES at a time (see
+ * baudot_tonedemod_multi()), except for sessions with the
+ * single-precision demodulators. The sessions then go on one after the
+ * other; their outputs are the same as from ctm_session_process().
+ */
+void ctm_session_process_multi(ctm_session_t *const *sessions, struct pollfd *const *pfds, int *finished, int num);
+
+/*
+ * Timeout for poll() in ms, -1 for none. It is 0 while an input has
+ * buffered data, and some audio backends have no descriptor and become
+ * ready by themselves (see ctm_audio_timeout()).
+ */
+int ctm_session_timeout(ctm_session_t *);
+
+/* poll and process until the session has finished. */
+int ctm_session_run(ctm_session_t *);
+
+/*
+ * Offline processing (CTM_FILE): map the input and output files that are
+ * regular files instead of reading and writing them. The output files
+ * must be open for reading and writing. Call before ctm_session_start().
+ * Returns 1 if the CTM input file has been mapped.
+ *
+ * ctm_session_run() then never waits, and passes over silence in the
+ * inputs without processing it, as soon as the engine is known to come
+ * out of a silent frame unchanged. The output is the same as without
+ * mapping; the silence in the mapped output files is left as holes.
+ */
+int ctm_session_map_files(ctm_session_t *);
+
+/*
+ * Pull-style interface for sessions created with CTM_FRAMES, for hosts
+ * that own the audio path themselves (a media gateway, a VoIP stack).
+ * The descriptors passed to ctm_session_create() are not used.
+ *
+ * ctm_process_frame() runs exactly one step of LENGTH_TONE_VEC samples:
+ * user input, CTM input, user output and CTM output, in the same order
+ * as ctm_session_process(). At 8 kHz, the frames are used in place,
+ * nothing is copied; at other rates (see ctm_session_set_rate()), they
+ * are resampled into and out of the session's own buffers. A NULL input
+ * frame is taken as silence, a NULL output frame is discarded. In text
+ * mode user_in and user_out are not used (pass NULL); text is exchanged
+ * with ctm_session_put_text() and ctm_session_get_text() between the
+ * frames.
+ */
+void ctm_process_frame(ctm_session_t *, const Shortint *ctm_in, const Shortint *user_in, Shortint *ctm_out, Shortint *user_out);
+
+/* queue up to len characters for transmission; returns the number accepted. */
+int ctm_session_put_text(ctm_session_t *, const char *, int len);
+
+/* fetch up to len received characters; returns the number fetched. */
+int ctm_session_get_text(ctm_session_t *, char *, int len);
+
+/*
+ * Event log (see ctm_event.h). The engine does not print anything while
+ * it runs; the detection of the far end, enquiries and the characters
+ * sent and received are stored in a ring of the session. It is drained
+ * with ctm_session_get_events(), also from another thread than the one
+ * running the session (one reader at a time), and ctm_event_format()
+ * gives the text of an event. Events that do not fit in the ring are
+ * dropped and counted by ctm_session_dropped_events().
+ */
+int ctm_session_get_events(ctm_session_t *, ctm_event_t *, int max_events);
+ULongint ctm_session_dropped_events(ctm_session_t *);
 
 #endif
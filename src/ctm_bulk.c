@@ -0,0 +1,328 @@
+/*
+*******************************************************************************
+*
+*      File             : ctm_bulk.c
+*      Purpose          : main function of the parallel offline decoder
+*                         (ctmbulk). It decodes the text of one long CTM
+*                         recording on all cores: a cheap pass over the
+*                         mapped recording finds the gaps between the
+*                         bursts and cuts it into segments there (see
+*                         ctm_bulk.h), every segment is decoded by its own
+*                         ctm_receiver() on the worker pool, and the text
+*                         of the segments is written out in order.
+*
+*                         The text is what "ctm -i /dev/null -o text -I
+*                         recording" writes for the same recording.
+*
+*******************************************************************************
+*
+* $Id: $
+*
+*/
+
+#include "ctm_bulk.h"
+#include "ctm_defines.h"
+#include "ctm_receiver.h"
+#include "tonedemod.h"
+#include "baudot_functions.h"
+#include "ucs_functions.h"
+#include "workpool.h"
+#include "compat.h"
+#include <typedefs.h>
+#include <fifo.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <err.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const char ctm_bulk_id[] = "@(#)$Id: $" ctm_bulk_h;
+
+/***********************************************************************/
+
+void usage()
+{
+  fprintf(stderr, "usage: ctmbulk [-cv] [-l level] [-o file] [-w workers] file\n");
+  exit(1);
+}
+
+static Shortint sample_at(const Shortint *samples, size_t index, Bool swap_bytes)
+{
+  return swap_bytes ? (Shortint)swap16(samples[index]) : samples[index];
+}
+
+/* ---------------------------------------------------------------------- */
+/* find_cuts:                                                             */
+/* The cheap pass: returns the number of segments, and in *cuts the       */
+/* sample index at which each segment but the first starts. A cut is made */
+/* BULK_LEAD_SYMBOLS in front of the end of every run of at least         */
+/* BULK_MIN_GAP_SYMBOLS silent symbols.                                   */
+/* ---------------------------------------------------------------------- */
+
+static size_t find_cuts(const Shortint *samples, size_t num_samples,
+                        Bool swap_bytes, Longint level, size_t **cuts)
+{
+  size_t num_symbols = num_samples / SYMB_LEN;
+  size_t num_cuts = 0;
+  size_t max_cuts = 16;
+  size_t symbol, run_start, cut, cnt;
+  Longint sum;
+
+  if ((*cuts = calloc(max_cuts, sizeof(size_t))) == NULL)
+    err(1, "find_cuts: calloc");
+
+  run_start = 0;
+  for (symbol = 0; symbol < num_symbols; symbol++)
+    {
+      sum = 0;
+      for (cnt = 0; cnt < SYMB_LEN; cnt++)
+        sum += abs(sample_at(samples, symbol*SYMB_LEN + cnt, swap_bytes));
+
+      if (sum <= level*SYMB_LEN)
+        continue;
+
+      /* end of a silent run */
+      if (symbol - run_start >= BULK_MIN_GAP_SYMBOLS)
+        {
+          cut = (symbol - BULK_LEAD_SYMBOLS)*SYMB_LEN;
+          cut -= cut % LENGTH_TONE_VEC;
+          if (cut > 0 && (num_cuts == 0 || cut > (*cuts)[num_cuts-1]))
+            {
+              if (num_cuts == max_cuts)
+                {
+                  max_cuts *= 2;
+                  if ((*cuts = realloc(*cuts, max_cuts*sizeof(size_t))) == NULL)
+                    err(1, "find_cuts: realloc");
+                }
+              (*cuts)[num_cuts++] = cut;
+            }
+        }
+      run_start = symbol+1;
+    }
+
+  return num_cuts+1;
+}
+
+static void append_char(bulk_segment_t *segment, char character)
+{
+  if (segment->text_len == segment->text_size)
+    {
+      segment->text_size = segment->text_size ? 2*segment->text_size : 256;
+      if ((segment->text = realloc(segment->text, segment->text_size)) == NULL)
+        err(1, "append_char: realloc");
+    }
+  segment->text[segment->text_len++] = character;
+}
+
+/* ---------------------------------------------------------------------- */
+/* decode_segment:                                                        */
+/* Runs a fresh receiver over the segment, frame by frame as the session  */
+/* does, and collects the characters that the session would write to its  */
+/* text output (see layer2_process_ctm_in()). The last frame of the       */
+/* recording is padded with zeros.                                        */
+/* ---------------------------------------------------------------------- */
+
+static void decode_segment(void *arg)
+{
+  bulk_segment_t *segment = arg;
+  rx_state_t      rx_state;
+  window_state_t  signal_window;
+  fifo_state_t    char_fifo;
+  Bool            early_muting;
+  Shortint        frame[LENGTH_TONE_VEC];
+  Shortint        ucs_code;
+  Shortint        tty_code;
+  char            character;
+  size_t          pos, cnt, num;
+
+  init_ctm_receiver(&rx_state);
+  rx_state.wait_state.alreadyCTMreceived = segment->ctm_received;
+  Shortint_window_init(&signal_window, TONEDEMOD_HISTORY_LEN, SYMB_LEN+LENGTH_TONE_VEC);
+  Shortint_fifo_init(&char_fifo, 16);
+
+  segment->sync_found = false;
+  segment->text_len = 0;
+
+  for (pos = 0; pos < segment->num_samples; pos += LENGTH_TONE_VEC)
+    {
+      num = segment->num_samples - pos;
+      if (num > LENGTH_TONE_VEC)
+        num = LENGTH_TONE_VEC;
+      for (cnt = 0; cnt < num; cnt++)
+        frame[cnt] = sample_at(segment->samples, pos+cnt, segment->swap_bytes);
+      for (; cnt < LENGTH_TONE_VEC; cnt++)
+        frame[cnt] = 0;
+
+      Shortint_window_push(&signal_window, frame, LENGTH_TONE_VEC);
+      ctm_receiver(&signal_window, &char_fifo, &early_muting, &rx_state);
+
+      if (rx_state.wait_state.sync_found)
+        segment->sync_found = true;
+
+      while (Shortint_fifo_check(&char_fifo) > 0)
+        {
+          Shortint_fifo_pop(&char_fifo, &ucs_code, 1);
+          character = toupper(convertUCScode2char(ucs_code));
+          if ((tty_code = convertChar2ttyCode(character)) >= 0)
+            append_char(segment, convertTTYcode2char(tty_code));
+        }
+    }
+
+  Shortint_fifo_exit(&char_fifo);
+  Shortint_window_exit(&signal_window);
+  exit_ctm_receiver(&rx_state);
+}
+
+/***********************************************************************/
+
+int main(int argc, char** argv)
+{
+  const char     *errstr;
+  const char     *output_name;
+  bulk_segment_t *segments;
+  workpool_t     *pool;
+  struct stat     st;
+  const Shortint *samples;
+  size_t          num_samples, num_segments, index, first_sync;
+  size_t         *cuts;
+  Longint         level;
+  int             swap_flag;
+  int             verbose_flag;
+  int             num_workers;
+  int             input_fd, output_fd;
+  int             ch;
+
+  swap_flag = 0;
+  verbose_flag = 0;
+  level = BULK_SILENCE_LEVEL;
+  output_name = NULL;
+  num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+
+  while ((ch = getopt(argc, argv, "cvl:o:w:")) != -1) {
+    switch (ch) {
+      case 'c':
+        swap_flag = 1;
+        break;
+      case 'v':
+        verbose_flag = 1;
+        break;
+      case 'l':
+        level = strtonum(optarg, 0, 32767, &errstr);
+        if (errstr)
+          errx(1, "silence level is %s: %s", errstr, optarg);
+        break;
+      case 'o':
+        output_name = optarg;
+        break;
+      case 'w':
+        num_workers = strtonum(optarg, 0, 1024, &errstr);
+        if (errstr)
+          errx(1, "number of workers is %s: %s", errstr, optarg);
+        break;
+      default:
+        usage();
+        /* NOTREACHED */
+    }
+  }
+  argc -= optind;
+  argv += optind;
+
+  if (argc != 1)
+    usage();
+
+  if ((input_fd = open(argv[0], O_RDONLY)) == -1)
+    err(1, "unable to open %s", argv[0]);
+  if (fstat(input_fd, &st) == -1)
+    err(1, "fstat");
+  if (!S_ISREG(st.st_mode))
+    errx(1, "%s is not a regular file", argv[0]);
+
+  output_fd = STDOUT_FILENO;
+  if (output_name != NULL && strcmp(output_name, "-") &&
+      (output_fd = open(output_name, O_WRONLY | O_CREAT | O_TRUNC, 0666)) == -1)
+    err(1, "unable to open %s", output_name);
+
+  /* an odd byte at the end is dropped, as the session would read it as */
+  /* part of a zero-padded frame                                        */
+  num_samples = st.st_size / sizeof(Shortint);
+  samples = NULL;
+  if (num_samples > 0)
+    {
+      samples = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, input_fd, 0);
+      if (samples == MAP_FAILED)
+        err(1, "unable to map %s", argv[0]);
+    }
+
+  num_segments = find_cuts(samples, num_samples, swap_flag, level, &cuts);
+  if ((segments = calloc(num_segments, sizeof(bulk_segment_t))) == NULL)
+    err(1, "calloc");
+
+  /* Later segments are decoded as if a burst had been received before, */
+  /* which is wrong up to the first segment that syncs with the higher   */
+  /* threshold of a receiver that has not received any. These segments   */
+  /* are decoded again below. A segment without a sync with the lower    */
+  /* threshold has none with the higher one either, and no text.         */
+  for (index = 0; index < num_segments; index++)
+    {
+      segments[index].samples      = samples + (index > 0 ? cuts[index-1] : 0);
+      segments[index].num_samples  = (index < num_segments-1 ? cuts[index] : num_samples)
+                                     - (index > 0 ? cuts[index-1] : 0);
+      segments[index].swap_bytes   = swap_flag;
+      segments[index].ctm_received = (index > 0);
+    }
+
+  if (verbose_flag)
+    fprintf(stderr, "ctmbulk: %lu samples, %lu segments, %d workers\n",
+            (unsigned long)num_samples, (unsigned long)num_segments, num_workers);
+
+  /* with -w 0, the main thread decodes all segments */
+  if (num_workers > 0)
+    {
+      pool = workpool_create(num_workers);
+      for (index = 0; index < num_segments; index++)
+        workpool_submit(pool, decode_segment, &segments[index]);
+      workpool_wait(pool);
+      workpool_destroy(pool);
+    }
+  else
+    for (index = 0; index < num_segments; index++)
+      decode_segment(&segments[index]);
+
+  /* a sync found with the lower threshold may be a false one: decode   */
+  /* that segment again as not received, until one syncs without it     */
+  for (first_sync = 0; first_sync < num_segments; first_sync++)
+    {
+      if (segments[first_sync].sync_found && segments[first_sync].ctm_received)
+        {
+          segments[first_sync].ctm_received = false;
+          decode_segment(&segments[first_sync]);
+        }
+      if (segments[first_sync].sync_found)
+        break;
+    }
+
+  for (index = 0; index < num_segments; index++)
+    {
+      if (segments[index].text_len > 0 &&
+          write(output_fd, segments[index].text, segments[index].text_len) == -1)
+        err(1, "error writing the text output");
+      free(segments[index].text);
+    }
+
+  if (num_samples > 0)
+    munmap((void *)samples, st.st_size);
+  free(segments);
+  free(cuts);
+  close(input_fd);
+  if (output_fd != STDOUT_FILENO)
+    close(output_fd);
+
+  exit(0);
+}
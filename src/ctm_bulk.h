@@ -0,0 +1,70 @@
+/*
+*******************************************************************************
+*
+*      File             : ctm_bulk.h
+*      Purpose          : segments of the parallel offline decoder (ctmbulk)
+*
+*      A long CTM recording is cut into segments at gaps between the
+*      bursts, and every segment is decoded by its own receiver. A cut is
+*      only made where a receiver running over the whole recording would
+*      have lost the synchronization and counted at least
+*      NUM_SYMBOLS_AFTER_BURST bits since (see wait_for_sync()), and its
+*      filters would have seen silence for a while. A fresh receiver is in
+*      the same position then, except for alreadyCTMreceived, which is
+*      carried over from the segments in front.
+*
+*******************************************************************************
+*/
+#ifndef ctm_bulk_h
+#define ctm_bulk_h "$Id: $"
+
+/*
+*******************************************************************************
+*                         INCLUDE FILES
+*******************************************************************************
+*/
+
+#include <stddef.h>
+#include <typedefs.h>
+#include "wait_for_sync.h"
+
+/*
+*******************************************************************************
+*                         DEFINITION OF CONSTANTS
+*******************************************************************************
+*/
+
+/* silence that is left in front of a segment, in symbols (1 s)          */
+#define BULK_LEAD_SYMBOLS     200
+
+/* Shortest gap that is cut, in symbols. wait_for_sync() counts two bits */
+/* per symbol, so NUM_SYMBOLS_AFTER_BURST symbols leave half of the gap  */
+/* for the receiver to drop out of sync, and the lead of the next one.   */
+#define BULK_MIN_GAP_SYMBOLS  (NUM_SYMBOLS_AFTER_BURST + BULK_LEAD_SYMBOLS)
+
+/* a symbol is silent if its mean magnitude is not above this level      */
+#define BULK_SILENCE_LEVEL    8
+
+/*
+*******************************************************************************
+*                         DEFINITION OF DATA TYPES
+*******************************************************************************
+*/
+
+typedef struct
+{
+  const Shortint *samples;       /* start of the segment in the recording */
+  size_t          num_samples;   /* LENGTH_TONE_VEC multiple, except for  */
+                                 /* the last segment                      */
+  Bool            swap_bytes;    /* big-endian recording (-c)             */
+  Bool            ctm_received;  /* alreadyCTMreceived at the start       */
+
+  /* results */
+  Bool            sync_found;    /* the receiver has been in sync         */
+  char           *text;          /* decoded characters                    */
+  size_t          text_len;
+  size_t          text_size;     /* bytes allocated for text              */
+}
+bulk_segment_t;
+
+#endif
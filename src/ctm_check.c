@@ -0,0 +1,816 @@
+/*
+*******************************************************************************
+*
+*      File             : ctm_check.c
+*      Purpose          : main function of the self tests (ctmcheck), see
+*                         ctm_check.h; "make check" builds and runs them.
+*
+*                         lag tracking: a text is sent through a CTM
+*                         signal with a clock drift of about 1660 ppm and
+*                         white noise, and must be received the same with
+*                         and without the lag tracking of the tone
+*                         demodulator (see tonedemod_set_lag_tracking()).
+*
+*                         SIMD kernels: the kernels of the tone
+*                         demodulator (tonedemod_kernels.h) for the SIMD
+*                         instruction sets of the machine must give the
+*                         same results as the scalar ones for random
+*                         inputs, and the division by 6 of
+*                         tonedemod_diff() must be exact for every sum.
+*
+*                         multi-channel tone demodulator: tonedemod_multi()
+*                         of every instruction set must give the same bits,
+*                         sampling corrections and demodulator states as
+*                         tonedemod_in_place(), on CTM signals, noise and
+*                         random samples, with random lanes left idle.
+*
+*                         multi-channel Baudot demodulator:
+*                         baudot_tonedemod_multi() of every instruction set
+*                         must give the same TTY codes and demodulator
+*                         states as baudot_tonedemod(), on the same kinds
+*                         of inputs made from a Baudot signal, with random
+*                         numbers of samples per call.
+*
+*                         Viterbi decoder: viterbi_exec() must decode the
+*                         same bits as the reference decoder with path
+*                         copying (ctm_check_viterbi.c) from random soft
+*                         bits and from noisy encoded ones, with the
+*                         add-compare-select of every instruction set.
+*
+*******************************************************************************
+*
+* $Id: $
+*
+*/
+
+#include "ctm_check.h"
+#include "ctm_defines.h"
+#include "ctm.h"
+#include "tonedemod.h"
+#include "tonedemod_multi.h"
+#include "baudot_functions.h"
+#include "baudot_multi.h"
+#include "conv_encoder.h"
+#include <typedefs.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <err.h>
+
+const char ctm_check_id[] = "@(#)$Id: $" ctm_check_h;
+
+/***********************************************************************/
+
+/* ---------------------------------------------------------------------- */
+/* Reproducible pseudo random numbers, the same on every platform: a     */
+/* linear congruential generator and gaussian values from it (Box-Muller) */
+/* ---------------------------------------------------------------------- */
+
+static ULongint check_seed;
+
+static double check_uniform(void)
+{
+  check_seed = (check_seed*1664525UL + 1013904223UL) & 0xffffffffUL;
+  return ((double)(check_seed >> 8) + 0.5) / 16777216.0;
+}
+
+static double check_gauss(void)
+{
+  double u1 = check_uniform();
+  double u2 = check_uniform();
+
+  return sqrt(-2.0*log(u1)) * cos(2.0*M_PI*u2);
+}
+
+/* ---------------------------------------------------------------------- */
+/* lag tracking                                                           */
+/* ---------------------------------------------------------------------- */
+
+/* The CTM signal of text, up to the end of the burst. Returns the number */
+/* of samples, a multiple of LENGTH_TONE_VEC.                             */
+static size_t transmit_text(const char *text, int len, Shortint **signal)
+{
+  ctm_session_t *session;
+  Shortint       frame[LENGTH_TONE_VEC];
+  size_t         num_samples, size, last_sound;
+  int            sent, cnt;
+
+  session = ctm_session_create(CTM_FRAMES, CTM_TEXT_IN, -1, -1, -1, -1, NULL);
+  ctm_session_set_negotiation(session, OFF);
+  ctm_session_start(session);
+
+  size = 64*LENGTH_TONE_VEC;
+  if ((*signal = malloc(size*sizeof(Shortint))) == NULL)
+    err(1, "transmit_text: malloc");
+
+  num_samples = 0;
+  last_sound = 0;
+  sent = 0;
+  while (sent < len || num_samples < last_sound + CHECK_TAIL_FRAMES*LENGTH_TONE_VEC)
+    {
+      sent += ctm_session_put_text(session, text+sent, len-sent);
+      ctm_process_frame(session, NULL, NULL, frame, NULL);
+
+      if (num_samples+LENGTH_TONE_VEC > size)
+        {
+          size *= 2;
+          if ((*signal = realloc(*signal, size*sizeof(Shortint))) == NULL)
+            err(1, "transmit_text: realloc");
+        }
+      memcpy(*signal+num_samples, frame, sizeof(frame));
+      num_samples += LENGTH_TONE_VEC;
+
+      for (cnt=0; cnt<LENGTH_TONE_VEC; cnt++)
+        if (frame[cnt] != 0)
+          last_sound = num_samples;
+    }
+
+  ctm_session_destroy(session);
+  return last_sound;
+}
+
+/* Drops (drift < 0) or repeats (drift > 0) every CHECK_DRIFT_PERIOD-th  */
+/* sample of signal and adds white noise of the standard deviation      */
+/* sigma. The result is padded to full frames.                          */
+static size_t distort(const Shortint *signal, size_t num_samples, int drift,
+                      double sigma, Shortint **distorted)
+{
+  size_t  num_out, cnt;
+  double  value;
+
+  num_out = num_samples + num_samples/CHECK_DRIFT_PERIOD + LENGTH_TONE_VEC;
+  if ((*distorted = calloc(num_out, sizeof(Shortint))) == NULL)
+    err(1, "distort: calloc");
+
+  num_out = 0;
+  for (cnt=0; cnt<num_samples; cnt++)
+    {
+      if (cnt%CHECK_DRIFT_PERIOD == CHECK_DRIFT_PERIOD-1 && drift < 0)
+        continue;
+      (*distorted)[num_out++] = signal[cnt];
+      if (cnt%CHECK_DRIFT_PERIOD == CHECK_DRIFT_PERIOD-1 && drift > 0)
+        (*distorted)[num_out++] = signal[cnt];
+    }
+  num_out = (num_out+LENGTH_TONE_VEC-1) / LENGTH_TONE_VEC * LENGTH_TONE_VEC;
+
+  for (cnt=0; cnt<num_out; cnt++)
+    {
+      value = (*distorted)[cnt] + sigma*check_gauss();
+      if (value > 32767.0)
+        value = 32767.0;
+      if (value < -32768.0)
+        value = -32768.0;
+      (*distorted)[cnt] = (Shortint)floor(value+0.5);
+    }
+
+  return num_out;
+}
+
+/* The text received from signal; returns the number of characters */
+static int receive_text(const Shortint *signal, size_t num_samples,
+                        enum on_off lag_tracking, char *text, int len)
+{
+  ctm_session_t *session;
+  size_t         pos;
+  int            received;
+
+  session = ctm_session_create(CTM_FRAMES, CTM_TEXT_IN, -1, -1, -1, -1, NULL);
+  ctm_session_set_negotiation(session, OFF);
+  ctm_session_set_lag_tracking(session, lag_tracking);
+  ctm_session_start(session);
+
+  received = 0;
+  for (pos=0; pos < num_samples + CHECK_TAIL_FRAMES*LENGTH_TONE_VEC;
+       pos += LENGTH_TONE_VEC)
+    {
+      ctm_process_frame(session, (pos < num_samples) ? signal+pos : NULL,
+                        NULL, NULL, NULL);
+      received += ctm_session_get_text(session, text+received, len-received);
+    }
+
+  ctm_session_destroy(session);
+  return received;
+}
+
+static Bool check_lag_tracking(void)
+{
+  static const char words[] = "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 0123456789 ";
+  static const int drifts[] = {-1, 1};
+  static const double sigmas[] = {2000.0, 3600.0};
+
+  char      text[CHECK_TEXT_LEN];
+  char      received[2*CHECK_TEXT_LEN];
+  Shortint *signal, *distorted;
+  size_t    num_samples, num_distorted;
+  Bool      passed;
+  int       cnt, drift, noise, tracking, len;
+
+  for (cnt=0; cnt<CHECK_TEXT_LEN-1; cnt++)
+    text[cnt] = words[cnt%(sizeof(words)-1)];
+  text[CHECK_TEXT_LEN-1] = '\n';
+
+  num_samples = transmit_text(text, CHECK_TEXT_LEN, &signal);
+
+  passed = true;
+  check_seed = 1;
+  for (drift=0; drift<2; drift++)
+    for (noise=0; noise<2; noise++)
+      {
+        num_distorted = distort(signal, num_samples, drifts[drift],
+                                sigmas[noise], &distorted);
+        for (tracking=0; tracking<2; tracking++)
+          {
+            len = receive_text(distorted, num_distorted,
+                               tracking ? ON : OFF, received, sizeof(received));
+            if (len != CHECK_TEXT_LEN || memcmp(received, text, len) != 0)
+              {
+                printf("  %s sample every %d, noise %.0f, lag tracking %s: "
+                       "%d of %d characters received, text differs\n",
+                       drifts[drift] < 0 ? "dropped one" : "repeated one",
+                       CHECK_DRIFT_PERIOD, sigmas[noise],
+                       tracking ? "on" : "off", len, CHECK_TEXT_LEN);
+                passed = false;
+              }
+          }
+        free(distorted);
+      }
+
+  free(signal);
+  return passed;
+}
+
+/* ---------------------------------------------------------------------- */
+/* SIMD kernels                                                           */
+/* ---------------------------------------------------------------------- */
+
+/* Random samples: over the full range (kind 0), only the extreme values */
+/* (kind 1) or small ones (kind 2)                                       */
+static void random_samples(Shortint *samples, int len, int kind)
+{
+  static const Shortint extremes[4] = {-32768, -32767, 0, 32767};
+  int cnt;
+
+  for (cnt=0; cnt<len; cnt++)
+    {
+      if (kind == 0)
+        samples[cnt] = (Shortint)(floor(check_uniform()*65536.0) - 32768.0);
+      else if (kind == 1)
+        samples[cnt] = extremes[(int)floor(check_uniform()*4.0)];
+      else
+        samples[cnt] = (Shortint)(floor(check_uniform()*201.0) - 100.0);
+    }
+}
+
+static int random_int(int max)
+{
+  return (int)floor(check_uniform()*max);
+}
+
+static Bool differs(const check_variant_t *variant, const char *kernel,
+                    const Shortint *result, const Shortint *expected, int len)
+{
+  if (memcmp(result, expected, len*sizeof(Shortint)) == 0)
+    return false;
+
+  printf("  %s %s(), %d values: differs from the scalar version\n",
+         variant->kernels_isa, kernel, len);
+  return true;
+}
+
+/* Compares the kernels of variant with the scalar ones */
+static Bool check_variant(const check_variant_t *variant)
+{
+  const check_variant_t *scalar = &check_variant_scalar;
+  const Shortint *const waveforms[4] = { tonedemod_waveforms[0],
+                                         tonedemod_waveforms[1],
+                                         tonedemod_waveforms[2],
+                                         tonedemod_waveforms[3] };
+  Shortint  in[5][CHECK_BUFFER_LEN];
+  Shortint  out[2][5][CHECK_MAX_LAGS];
+  Shortint *out_ptr[2][5];
+  const Shortint *in_ptr[5];
+  int       round, kind, len, offset, cnt, run;
+
+  for (run=0; run<2; run++)
+    for (cnt=0; cnt<5; cnt++)
+      out_ptr[run][cnt] = out[run][cnt];
+
+  for (round=0; round<CHECK_KERNEL_ROUNDS; round++)
+    {
+      kind   = round%3;
+      len    = 1+random_int(CHECK_MAX_LAGS);
+      offset = random_int(8);
+      for (cnt=0; cnt<5; cnt++)
+        {
+          random_samples(in[cnt], CHECK_BUFFER_LEN, kind);
+          in_ptr[cnt] = in[cnt]+offset;
+        }
+
+      scalar->correlate(out_ptr[0], out_ptr[0][4], in_ptr[0], waveforms, len);
+      variant->correlate(out_ptr[1], out_ptr[1][4], in_ptr[0], waveforms, len);
+      for (cnt=0; cnt<5; cnt++)
+        if (differs(variant, "tonedemod_correlate", out[1][cnt], out[0][cnt], len))
+          return false;
+
+      scalar->abs(out[0][0], in_ptr[0], len);
+      variant->abs(out[1][0], in_ptr[0], len);
+      if (differs(variant, "tonedemod_abs", out[1][0], out[0][0], len))
+        return false;
+
+      scalar->lowpass(out_ptr[0], in_ptr, tonedemod_lowpass_ir_rev, len);
+      variant->lowpass(out_ptr[1], in_ptr, tonedemod_lowpass_ir_rev, len);
+      for (cnt=0; cnt<5; cnt++)
+        if (differs(variant, "tonedemod_lowpass", out[1][cnt], out[0][cnt], len))
+          return false;
+
+      scalar->diff(out[0][0], in_ptr, len);
+      variant->diff(out[1][0], in_ptr, len);
+      if (differs(variant, "tonedemod_diff", out[1][0], out[0][0], len))
+        return false;
+    }
+
+  printf("  %s kernels: same as the scalar ones\n", variant->kernels_isa);
+  return true;
+}
+
+static Bool check_kernels(void)
+{
+  const check_variant_t *variant = &check_variant_simd;
+  unsigned long long     sum;
+  Bool                   passed;
+
+  /* the division of tonedemod_diff(), for the sums of six differences */
+  for (sum=0; sum<=6*65535ULL; sum++)
+    if ((sum*variant->div6_mul) >> variant->div6_shift != sum/6)
+      {
+        printf("  %llu/6 is not (%llu*%ld)>>%d\n", sum, sum,
+               (long)variant->div6_mul, variant->div6_shift);
+        return false;
+      }
+
+  check_seed = 1;
+  passed = check_variant(variant);
+
+#if defined(__x86_64__) || defined(__amd64__)
+  if (__builtin_cpu_supports("avx2"))
+    passed = check_variant(&check_variant_avx2) && passed;
+  else
+    printf("  AVX2 kernels: not checked, the CPU has no AVX2\n");
+#endif
+
+  return passed;
+}
+
+/* ---------------------------------------------------------------------- */
+/* multi-channel tone demodulator                                         */
+/* ---------------------------------------------------------------------- */
+
+/* The inputs of the lanes, len samples each, behind TONEDEMOD_HISTORY_LEN */
+/* zeros: the signal from a random position, clean (lane%4 == 0) or        */
+/* louder and with noise (1), random samples over the full range (2), or   */
+/* bursts of the signal at a large gain between small random samples (3)   */
+static void multi_inputs(Shortint *inputs, size_t len, const Shortint *signal,
+                         size_t num_samples)
+{
+  Shortint *input;
+  size_t    pos, cnt;
+  double    value;
+  int       lane;
+
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    {
+      input = inputs + lane*len;
+      memset(input, 0, TONEDEMOD_HISTORY_LEN*sizeof(Shortint));
+      pos = random_int(num_samples);
+      for (cnt=TONEDEMOD_HISTORY_LEN; cnt<len; cnt++)
+        {
+          value = signal[(pos+cnt)%num_samples];
+          if (lane%4 == 1)
+            value = 3.0*value + 1000.0*check_gauss();
+          else if (lane%4 == 3)
+            value = (cnt/3000)%2 ? 40.0*value : 100.0*check_gauss();
+          if (value > 32767.0)
+            value = 32767.0;
+          if (value < -32768.0)
+            value = -32768.0;
+          input[cnt] = (Shortint)floor(value+0.5);
+        }
+      if (lane%4 == 2)
+        random_samples(input+TONEDEMOD_HISTORY_LEN, len-TONEDEMOD_HISTORY_LEN, 0);
+    }
+}
+
+/* Compares tonedemod_multi() of variant with tonedemod_in_place() */
+static Bool check_multi_variant(const check_variant_t *variant,
+                                const Shortint *inputs, size_t len)
+{
+  static demod_state_t states[TONEDEMOD_LANES];
+  static demod_state_t ref_states[TONEDEMOD_LANES];
+  demod_state_t  *state_ptr[TONEDEMOD_LANES];
+  const Shortint *in_ptr[TONEDEMOD_LANES];
+  Shortint        num_in[TONEDEMOD_LANES];
+  Shortint        bits[TONEDEMOD_LANES][2];
+  Shortint        correction[TONEDEMOD_LANES];
+  Shortint        ref_bits[2], ref_correction;
+  size_t          pos[TONEDEMOD_LANES];
+  int             round, lane;
+
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    {
+      init_tonedemod(&states[lane]);
+      init_tonedemod(&ref_states[lane]);
+      state_ptr[lane]  = &states[lane];
+      correction[lane] = 0;
+      pos[lane]        = lane*len + TONEDEMOD_HISTORY_LEN;
+    }
+
+  check_seed = 2;
+  for (round=0; round<CHECK_MULTI_ROUNDS; round++)
+    {
+      for (lane=0; lane<TONEDEMOD_LANES; lane++)
+        {
+          num_in[lane] = SYMB_LEN+correction[lane];
+          in_ptr[lane] = random_int(CHECK_MULTI_IDLE) ? inputs+pos[lane] : NULL;
+        }
+
+      variant->multi(bits, in_ptr, num_in, correction, state_ptr);
+
+      for (lane=0; lane<TONEDEMOD_LANES; lane++)
+        {
+          if (in_ptr[lane] == NULL)
+            continue;
+
+          tonedemod_in_place(ref_bits, in_ptr[lane], num_in[lane],
+                             &ref_correction, &ref_states[lane]);
+          if (bits[lane][0] != ref_bits[0] || bits[lane][1] != ref_bits[1] ||
+              correction[lane] != ref_correction ||
+              memcmp(&states[lane], &ref_states[lane], sizeof(demod_state_t)) != 0)
+            {
+              printf("  %s tonedemod_multi(), lane %d, call %d: differs from "
+                     "tonedemod_in_place()\n", variant->multi_isa, lane, round);
+              return false;
+            }
+          pos[lane] += num_in[lane];
+        }
+    }
+
+  printf("  %s multi-channel demodulator: same as tonedemod_in_place()\n",
+         variant->multi_isa);
+  return true;
+}
+
+static Bool check_multi(void)
+{
+  static const char text[] = "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 0123456789\n";
+  demod_state_t state;
+  Shortint     *signal, *inputs;
+  size_t        num_samples, len;
+  unsigned long long sum;
+  Bool          passed;
+
+  /* the division of the wideband level */
+  for (sum=0; sum<=SYMB_LEN*32768ULL; sum++)
+    if ((sum*DIV_SYMB_MUL) >> DIV_SYMB_SHIFT != sum/SYMB_LEN)
+      {
+        printf("  %llu/%d is not (%llu*%ld)>>%d\n", sum, SYMB_LEN, sum,
+               (long)DIV_SYMB_MUL, DIV_SYMB_SHIFT);
+        return false;
+      }
+
+  /* only the direct correlator without lag tracking */
+  init_tonedemod(&state);
+  passed = tonedemod_multi_supported(&state);
+  tonedemod_set_lag_tracking(&state, true);
+  passed = passed && !tonedemod_multi_supported(&state);
+  init_tonedemod(&state);
+  tonedemod_set_correlator(&state, TONEDEMOD_SLIDING_DFT);
+  passed = passed && !tonedemod_multi_supported(&state);
+  if (!passed)
+    {
+      printf("  tonedemod_multi_supported(): wrong for the correlator or "
+             "the lag tracking\n");
+      return false;
+    }
+
+  num_samples = transmit_text(text, sizeof(text)-1, &signal);
+
+  /* every lane takes at most SYMB_LEN+1 samples per call */
+  len = TONEDEMOD_HISTORY_LEN + CHECK_MULTI_ROUNDS*(SYMB_LEN+1);
+  if ((inputs = malloc(TONEDEMOD_LANES*len*sizeof(Shortint))) == NULL)
+    err(1, "check_multi: malloc");
+  check_seed = 1;
+  multi_inputs(inputs, len, signal, num_samples);
+
+  passed = check_multi_variant(&check_variant_scalar, inputs, len);
+  passed = check_multi_variant(&check_variant_simd, inputs, len) && passed;
+
+#if defined(__x86_64__) || defined(__amd64__)
+  if (__builtin_cpu_supports("avx2"))
+    passed = check_multi_variant(&check_variant_avx2, inputs, len) && passed;
+  else
+    printf("  AVX2 multi-channel demodulator: not checked, the CPU has no AVX2\n");
+#endif
+
+  free(inputs);
+  free(signal);
+  return passed;
+}
+
+/* ---------------------------------------------------------------------- */
+/* multi-channel Baudot demodulator                                       */
+/* ---------------------------------------------------------------------- */
+
+/* The Baudot signal of text. Returns the number of samples. */
+static size_t baudot_signal(const char *text, int len, Shortint **signal)
+{
+  baudot_tonemod_state_t modulator;
+  Shortint               frame[LENGTH_TONE_VEC];
+  Shortint               code, bits_to_modulate;
+  size_t                 num_samples, size;
+  int                    sent;
+
+  init_baudot_tonemod(&modulator);
+
+  size = 64*LENGTH_TONE_VEC;
+  if ((*signal = malloc(size*sizeof(Shortint))) == NULL)
+    err(1, "baudot_signal: malloc");
+
+  num_samples = 0;
+  bits_to_modulate = 0;
+  sent = 0;
+  while (sent < len || bits_to_modulate > 0)
+    {
+      code = -1;
+      if (sent < len && bits_to_modulate <= 8)
+        code = convertChar2ttyCode(text[sent++]);
+      baudot_tonemod(code, frame, LENGTH_TONE_VEC, &bits_to_modulate,
+                     &modulator);
+
+      if (num_samples+LENGTH_TONE_VEC > size)
+        {
+          size *= 2;
+          if ((*signal = realloc(*signal, size*sizeof(Shortint))) == NULL)
+            err(1, "baudot_signal: realloc");
+        }
+      memcpy(*signal+num_samples, frame, sizeof(frame));
+      num_samples += LENGTH_TONE_VEC;
+    }
+
+  exit_baudot_tonemod(&modulator);
+  return num_samples;
+}
+
+/* Compares baudot_tonedemod_multi() of variant with baudot_tonedemod() */
+static Bool check_baudot_variant(const check_variant_t *variant,
+                                 Shortint *inputs, size_t len)
+{
+  static baudot_tonedemod_state_t states[BAUDOT_LANES];
+  static baudot_tonedemod_state_t ref_states[BAUDOT_LANES];
+  baudot_tonedemod_state_t *state_ptr[BAUDOT_LANES];
+  fifo_state_t    fifos[BAUDOT_LANES], ref_fifos[BAUDOT_LANES];
+  fifo_state_t   *fifo_ptr[BAUDOT_LANES];
+  Shortint       *in_ptr[BAUDOT_LANES];
+  Shortint        codes[CHECK_BAUDOT_SAMPLES], ref_codes[CHECK_BAUDOT_SAMPLES];
+  Shortint        num_samples;
+  Longint         num_codes, num_chars;
+  size_t          pos;
+  int             round, lane;
+  Bool            passed;
+
+  /* init_baudot_tonedemod() leaves the TTY code of the state as it is */
+  memset(states, 0, sizeof(states));
+  memset(ref_states, 0, sizeof(ref_states));
+  for (lane=0; lane<BAUDOT_LANES; lane++)
+    {
+      init_baudot_tonedemod(&states[lane]);
+      init_baudot_tonedemod(&ref_states[lane]);
+      Shortint_fifo_init(&fifos[lane], CHECK_BAUDOT_SAMPLES);
+      Shortint_fifo_init(&ref_fifos[lane], CHECK_BAUDOT_SAMPLES);
+      state_ptr[lane] = &states[lane];
+      fifo_ptr[lane]  = &fifos[lane];
+    }
+
+  check_seed = 3;
+  passed = true;
+  num_chars = 0;
+  pos = TONEDEMOD_HISTORY_LEN;
+  for (round=0; round<CHECK_BAUDOT_ROUNDS && passed; round++)
+    {
+      num_samples = 1+random_int(CHECK_BAUDOT_SAMPLES);
+      for (lane=0; lane<BAUDOT_LANES; lane++)
+        in_ptr[lane] = random_int(CHECK_MULTI_IDLE) ? inputs+lane*len+pos : NULL;
+
+      variant->baudot(in_ptr, num_samples, fifo_ptr, state_ptr);
+
+      for (lane=0; lane<BAUDOT_LANES && passed; lane++)
+        {
+          if (in_ptr[lane] == NULL)
+            continue;
+
+          baudot_tonedemod(in_ptr[lane], num_samples, &ref_fifos[lane],
+                           &ref_states[lane]);
+          num_codes = Shortint_fifo_check(&fifos[lane]);
+          passed = (num_codes == Shortint_fifo_check(&ref_fifos[lane]));
+          if (passed)
+            {
+              Shortint_fifo_pop(&fifos[lane], codes, num_codes);
+              Shortint_fifo_pop(&ref_fifos[lane], ref_codes, num_codes);
+              num_chars += num_codes;
+              passed = memcmp(codes, ref_codes, num_codes*sizeof(Shortint)) == 0 &&
+                memcmp(&states[lane], &ref_states[lane],
+                       sizeof(baudot_tonedemod_state_t)) == 0;
+            }
+          if (!passed)
+            printf("  %s baudot_tonedemod_multi(), lane %d, call %d: differs "
+                   "from baudot_tonedemod()\n", variant->baudot_isa, lane, round);
+        }
+      pos += num_samples;
+    }
+
+  for (lane=0; lane<BAUDOT_LANES; lane++)
+    {
+      Shortint_fifo_exit(&fifos[lane]);
+      Shortint_fifo_exit(&ref_fifos[lane]);
+    }
+
+  if (passed)
+    printf("  %s multi-channel Baudot demodulator: same as baudot_tonedemod() "
+           "(%ld characters)\n", variant->baudot_isa, (long)num_chars);
+  return passed;
+}
+
+static Bool check_baudot(void)
+{
+  static const char text[] = "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 0123456789\n";
+  Shortint *signal, *inputs;
+  size_t    num_samples, len;
+  Bool      passed;
+
+  num_samples = baudot_signal(text, sizeof(text)-1, &signal);
+
+  len = TONEDEMOD_HISTORY_LEN + CHECK_BAUDOT_ROUNDS*CHECK_BAUDOT_SAMPLES;
+  if ((inputs = malloc(BAUDOT_LANES*len*sizeof(Shortint))) == NULL)
+    err(1, "check_baudot: malloc");
+  check_seed = 1;
+  multi_inputs(inputs, len, signal, num_samples);
+
+  passed = check_baudot_variant(&check_variant_scalar, inputs, len);
+  passed = check_baudot_variant(&check_variant_simd, inputs, len) && passed;
+
+#if defined(__x86_64__) || defined(__amd64__)
+  if (__builtin_cpu_supports("avx2"))
+    passed = check_baudot_variant(&check_variant_avx2, inputs, len) && passed;
+  else
+    printf("  AVX multi-channel Baudot demodulator: not checked, the CPU has "
+           "no AVX2\n");
+#endif
+
+  free(inputs);
+  free(signal);
+  return passed;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Viterbi decoder                                                        */
+/* ---------------------------------------------------------------------- */
+
+/* Random soft bits: over the full range (kind 0), near the decision      */
+/* levels (kind 1), only the decision levels, with many equal metrics     */
+/* (kind 2), or the gross bits of random net bits with noise (kind 3)     */
+static void random_soft_bits(conv_encoder_t *encoder, Shortint *soft,
+                             int steps, int kind)
+{
+  Shortint net_bit, gross_bits[CHC_RATE];
+  double   value;
+  int      step, cnt;
+
+  for (step=0; step<steps; step++, soft+=CHC_RATE)
+    {
+      if (kind == 3)
+        {
+          net_bit = random_int(2);
+          conv_encoder_exec(encoder, &net_bit, 1, gross_bits);
+        }
+      for (cnt=0; cnt<CHC_RATE; cnt++)
+        {
+          if (kind == 0)
+            soft[cnt] = (Shortint)(floor(check_uniform()*65535.0) - 32767.0);
+          else if (kind == 1)
+            soft[cnt] = (random_int(2) ? 1 : -1) * (16000 + random_int(800));
+          else if (kind == 2)
+            soft[cnt] = random_int(2) ? 16383 : -16383;
+          else
+            {
+              value = (gross_bits[cnt] ? 16383.0 : -16383.0) + 8000.0*check_gauss();
+              if (value > 32767.0)
+                value = 32767.0;
+              if (value < -32767.0)
+                value = -32767.0;
+              soft[cnt] = (Shortint)floor(value+0.5);
+            }
+        }
+    }
+}
+
+/* Compares the Viterbi decoder of variant with the reference decoder */
+static Bool check_decoder(const check_variant_t *variant)
+{
+  static Shortint soft[CHECK_VITERBI_STEPS*CHC_RATE];
+  static viterbi_t       decoder;
+  static check_viterbi_t reference;
+  conv_encoder_t encoder;
+  Shortint out[CHECK_VITERBI_STEPS], ref_out[CHECK_VITERBI_STEPS];
+  Shortint num_out, num_ref_out;
+  int      block, steps, pos, len, cnt;
+
+  variant->viterbi_init(&decoder);
+  conv_encoder_init(&encoder);
+
+  check_seed = 1;
+  for (block=0; block<CHECK_VITERBI_BLOCKS; block++)
+    {
+      steps = 1+random_int(CHECK_VITERBI_STEPS);
+      random_soft_bits(&encoder, soft, steps, block%4);
+
+      variant->viterbi_reinit(&decoder);
+      check_viterbi_init(&reference);
+
+      /* one to four steps per call */
+      for (pos=0; pos<steps; pos+=len)
+        {
+          len = 1+random_int(4);
+          if (len > steps-pos)
+            len = steps-pos;
+          variant->viterbi_exec(soft+pos*CHC_RATE, len*CHC_RATE, out, &num_out,
+                                &decoder);
+          check_viterbi_exec(soft+pos*CHC_RATE, len*CHC_RATE, ref_out,
+                             &num_ref_out, &reference);
+
+          for (cnt=0; cnt<num_out && cnt<num_ref_out; cnt++)
+            if (out[cnt] != ref_out[cnt])
+              break;
+          if (num_out != num_ref_out || cnt < num_out)
+            {
+              printf("  %s Viterbi decoder, block %d, step %d: decoded bits "
+                     "differ from the reference decoder\n",
+                     variant->viterbi_isa, block, pos);
+              return false;
+            }
+        }
+    }
+
+  printf("  %s Viterbi decoder: same bits as the reference decoder\n",
+         variant->viterbi_isa);
+  return true;
+}
+
+static Bool check_viterbi(void)
+{
+  Bool passed;
+
+  passed = check_decoder(&check_variant_scalar);
+  passed = check_decoder(&check_variant_simd) && passed;
+
+#if defined(__x86_64__) || defined(__amd64__)
+  if (__builtin_cpu_supports("avx2"))
+    passed = check_decoder(&check_variant_avx2) && passed;
+  else
+    printf("  AVX2 Viterbi decoder: not checked, the CPU has no AVX2\n");
+#endif
+
+  return passed;
+}
+
+/***********************************************************************/
+
+static const check_t checks[] = {
+  { "lag tracking with clock drift", check_lag_tracking },
+  { "SIMD kernels", check_kernels },
+  { "multi-channel tone demodulator", check_multi },
+  { "multi-channel Baudot demodulator", check_baudot },
+  { "Viterbi decoder", check_viterbi },
+};
+
+int main(int argc, char** argv)
+{
+  size_t cnt;
+  int    failed;
+
+  failed = 0;
+  for (cnt=0; cnt<sizeof(checks)/sizeof(checks[0]); cnt++)
+    {
+      printf("%s...\n", checks[cnt].name);
+      fflush(stdout);
+      if (checks[cnt].run())
+        printf("%s: ok\n", checks[cnt].name);
+      else
+        {
+          printf("%s: FAILED\n", checks[cnt].name);
+          failed++;
+        }
+    }
+
+  return failed > 0;
+}
@@ -0,0 +1,174 @@
+/*
+*******************************************************************************
+*
+*      File             : ctm_check.h
+*      Purpose          : self tests of the modem (ctmcheck, "make check")
+*
+*      Every check runs a part of the modem on generated data, compares
+*      the result with a reference, and prints one line with the outcome.
+*      ctmcheck exits with 1 if any of them has failed.
+*
+*******************************************************************************
+*/
+#ifndef ctm_check_h
+#define ctm_check_h "$Id: $"
+
+/*
+*******************************************************************************
+*                         INCLUDE FILES
+*******************************************************************************
+*/
+
+#include "ctm_defines.h"
+#include "conv_poly.h"
+#include "tonedemod_multi.h"
+#include "baudot_multi.h"
+#include <typedefs.h>
+
+/*
+*******************************************************************************
+*                         DEFINITION OF CONSTANTS
+*******************************************************************************
+*/
+
+/* Clock drift of the lag tracking check: one sample of the CTM signal is */
+/* dropped (or repeated) every CHECK_DRIFT_PERIOD samples, about 1660 ppm */
+#define CHECK_DRIFT_PERIOD    601
+
+/* characters sent through the drifted CTM signal                         */
+#define CHECK_TEXT_LEN        187
+
+/* frames of silence behind the CTM signal, which let the receiver finish */
+#define CHECK_TAIL_FRAMES     200
+
+/* random inputs per kernel with which the SIMD variants are compared to */
+/* the scalar one                                                        */
+#define CHECK_KERNEL_ROUNDS   20000
+
+/* largest number of lags (values) per call of a kernel                  */
+#define CHECK_MAX_LAGS        (2*SYMB_LEN)
+
+/* input samples per call, with room for an offset of up to 7 samples    */
+#define CHECK_BUFFER_LEN      (CHECK_MAX_LAGS+SYMB_LEN+8)
+
+/* tonedemod_multi() is compared with tonedemod_in_place() on           */
+/* CHECK_MULTI_ROUNDS calls, in each of which a lane is idle with a      */
+/* probability of 1/CHECK_MULTI_IDLE                                     */
+#define CHECK_MULTI_ROUNDS    4000
+#define CHECK_MULTI_IDLE      4
+
+/* baudot_tonedemod_multi() is compared with baudot_tonedemod() on       */
+/* CHECK_BAUDOT_ROUNDS calls of up to CHECK_BAUDOT_SAMPLES samples each, */
+/* with idle lanes as for tonedemod_multi()                              */
+#define CHECK_BAUDOT_ROUNDS   3000
+#define CHECK_BAUDOT_SAMPLES  400
+
+/* The Viterbi decoder is compared with the reference decoder of         */
+/* ctm_check_viterbi.c on CHECK_VITERBI_BLOCKS blocks of random soft     */
+/* bits, each of up to CHECK_VITERBI_STEPS steps of CHC_RATE gross bits  */
+/* (the metrics of the reference are not renormalized and must not       */
+/* overflow)                                                             */
+#define CHECK_VITERBI_BLOCKS  400
+#define CHECK_VITERBI_STEPS   2000
+
+/*
+*******************************************************************************
+*                         DEFINITION OF DATA TYPES
+*******************************************************************************
+*/
+
+typedef struct
+{
+  const char *name;
+  Bool      (*run)(void);      /* true if the check has passed */
+}
+check_t;
+
+/* The SIMD code compiled for one instruction set (ctm_check_variant.c): */
+/* the kernels of the tone demodulator, the multi-channel demodulators   */
+/* and the Viterbi decoder                                               */
+typedef struct
+{
+  const char *kernels_isa;     /* "scalar", "SSE2", "AVX2" or "NEON"   */
+  void      (*correlate)(Shortint *const xcorr[4], Shortint *xcorr_wb,
+                         const Shortint *samples,
+                         const Shortint *const waveforms[4],
+                         Shortint num_lags);
+  void      (*abs)(Shortint *out, const Shortint *in, Shortint len);
+  void      (*lowpass)(Shortint *const out[5], const Shortint *const in[5],
+                       const Shortint *taps, Shortint num_lags);
+  void      (*diff)(Shortint *diff, const Shortint *const xcorr_lp[4],
+                    Shortint len);
+  Longint     div6_mul;        /* x/6 = (x*div6_mul)>>div6_shift       */
+  Shortint    div6_shift;
+  const char *multi_isa;       /* of tonedemod_multi(): "scalar",      */
+                               /* "SSE2" or "AVX2"                     */
+  void      (*multi)(Shortint bits_out[TONEDEMOD_LANES][2],
+                     const Shortint *const in_samples[TONEDEMOD_LANES],
+                     const Shortint num_in_samples[TONEDEMOD_LANES],
+                     Shortint sampling_correction[TONEDEMOD_LANES],
+                     demod_state_t *const demod_states[TONEDEMOD_LANES]);
+  const char *baudot_isa;      /* of baudot_tonedemod_multi():         */
+                               /* "scalar", "SSE2" or "AVX"            */
+  void      (*baudot)(Shortint *const toneVec[BAUDOT_LANES],
+                      Shortint numSamples,
+                      fifo_state_t *const ptrOutFifoState[BAUDOT_LANES],
+                      baudot_tonedemod_state_t *const states[BAUDOT_LANES]);
+  const char *viterbi_isa;     /* of the add-compare-select: "scalar", */
+                               /* "SSE2" or "AVX2"                     */
+  void      (*viterbi_init)(viterbi_t* viterbi_state);
+  void      (*viterbi_reinit)(viterbi_t* viterbi_state);
+  void      (*viterbi_exec)(Shortint*  inputword, Shortint  length_input,
+                            Shortint*  out,       Shortint* num_valid_out_bits,
+                            viterbi_t* viterbi_state);
+}
+check_variant_t;
+
+/* A node of the reference Viterbi decoder (ctm_check_viterbi.c) */
+typedef struct
+{
+  Longint  metric;                /* Metric of the node after updating      */
+  Longint  oldmetric;             /* Metric of the node before updating     */
+  Shortint continue_path_from;    /* Last node from which the actual node
+                                     will continue the path                 */
+  Shortint new_entry;             /* Value to be added to the path (0 or 1) */
+  Shortint path[BLOCK*CHC_K];     /* Path ending in the node                */
+  Shortint temppath[BLOCK*CHC_K]; /* Temp path used for the updating        */
+}
+check_node_t;
+
+typedef struct
+{
+  check_node_t nodes[NUM_NODES];
+  Shortint     number_of_steps;
+}
+check_viterbi_t;
+
+/*
+*******************************************************************************
+*                         DECLARATION OF VARIABLES
+*******************************************************************************
+*/
+
+/* plain C (TONEDEMOD_SCALAR), the default instruction set of the */
+/* machine (SSE2 or NEON) and, on x86-64, AVX2                    */
+extern const check_variant_t check_variant_scalar;
+extern const check_variant_t check_variant_simd;
+#if defined(__x86_64__) || defined(__amd64__)
+extern const check_variant_t check_variant_avx2;
+#endif
+
+/*
+*******************************************************************************
+*                         DECLARATION OF PROTOTYPES
+*******************************************************************************
+*/
+
+/* The reference Viterbi decoder, with the arguments of viterbi_init() */
+/* and viterbi_exec()                                                  */
+void check_viterbi_init(check_viterbi_t *viterbi_state);
+void check_viterbi_exec(const Shortint *inputword, Shortint length_input,
+                        Shortint *out, Shortint *num_valid_out_bits,
+                        check_viterbi_t *viterbi_state);
+
+#endif
@@ -0,0 +1,89 @@
+/*
+*******************************************************************************
+*
+*      File             : ctm_check_variant.c
+*      Purpose          : one instruction set variant of the SIMD code for
+*                         ctmcheck (see ctm_check.h)
+*
+*      This file is compiled once per variant, with CHECK_VARIANT set to
+*      its name (scalar, simd or avx2) and with the flags selecting its
+*      instruction set, see the Makefile. It includes the sources of the
+*      kernels of the tone demodulator, of the multi-channel demodulators
+*      and of the Viterbi decoder with their public symbols renamed, so
+*      that all variants can be linked into ctmcheck next to each other.
+*
+*******************************************************************************
+*
+* $Id: $
+*
+*/
+
+#include "ctm_check.h"
+
+#define CHECK_CONCAT2(a, b)   a##_##b
+#define CHECK_CONCAT(a, b)    CHECK_CONCAT2(a, b)
+#define CHECK_NAME(name)      CHECK_CONCAT(name, CHECK_VARIANT)
+
+#define tonedemod_kernels_id  CHECK_NAME(tonedemod_kernels_id)
+#define tonedemod_correlate   CHECK_NAME(tonedemod_correlate)
+#define tonedemod_abs         CHECK_NAME(tonedemod_abs)
+#define tonedemod_lowpass     CHECK_NAME(tonedemod_lowpass)
+#define tonedemod_diff        CHECK_NAME(tonedemod_diff)
+#define tonedemod_multi_id    CHECK_NAME(tonedemod_multi_id)
+#define tonedemod_multi_supported CHECK_NAME(tonedemod_multi_supported)
+#define tonedemod_multi       CHECK_NAME(tonedemod_multi)
+#define baudot_multi_id       CHECK_NAME(baudot_multi_id)
+#define baudot_tonedemod_multi CHECK_NAME(baudot_tonedemod_multi)
+#define viterbi_init          CHECK_NAME(viterbi_init)
+#define viterbi_reinit        CHECK_NAME(viterbi_reinit)
+#define viterbi_exec          CHECK_NAME(viterbi_exec)
+#define hamming_distance      CHECK_NAME(hamming_distance)
+
+#include "tonedemod_kernels.c"
+#include "tonedemod_multi.c"
+#include "baudot_multi.c"
+#include "viterbi.c"
+
+const check_variant_t CHECK_NAME(check_variant) = {
+#if defined(KERNELS_AVX2)
+  "AVX2",
+#elif defined(KERNELS_SSE2)
+  "SSE2",
+#elif defined(KERNELS_NEON)
+  "NEON",
+#else
+  "scalar",
+#endif
+  tonedemod_correlate,
+  tonedemod_abs,
+  tonedemod_lowpass,
+  tonedemod_diff,
+  DIV6_MUL,
+  DIV6_SHIFT,
+#if defined(MULTI_AVX2)
+  "AVX2",
+#elif defined(MULTI_SSE2)
+  "SSE2",
+#else
+  "scalar",
+#endif
+  tonedemod_multi,
+#if defined(BAUDOT_MULTI_AVX)
+  "AVX",
+#elif defined(BAUDOT_MULTI_SSE2)
+  "SSE2",
+#else
+  "scalar",
+#endif
+  baudot_tonedemod_multi,
+#if defined(VITERBI_AVX2)
+  "AVX2",
+#elif defined(VITERBI_SSE2)
+  "SSE2",
+#else
+  "scalar",
+#endif
+  viterbi_init,
+  viterbi_reinit,
+  viterbi_exec
+};
@@ -0,0 +1,171 @@
+/*
+*******************************************************************************
+*
+*      File             : ctm_check_viterbi.c
+*      Purpose          : reference Viterbi decoder of ctmcheck (see
+*                         ctm_check.h)
+*
+*      This is the decoder that viterbi.c had before the survivor memory
+*      and the traceback: every node keeps a copy of its path, and the
+*      paths are copied from node to node in every step. It is slow, but
+*      simple, and viterbi_exec() must decode the same bits.
+*
+*******************************************************************************
+*
+* $Id: $
+*
+*/
+
+#include "ctm_check.h"
+#include "conv_poly.h"
+#include <typedefs.h>
+#include <stdlib.h>
+
+/* Output of each node when the input is 0, as in viterbi.c */
+#if CHC_RATE==4 && CHC_K==5
+static const Shortint base_output[NUM_NODES] = {
+   0, 15,  7,  8, 13,  2, 10,  5,  3, 12,  4, 11, 14,  1,  9,  6 };
+#else
+#error "base_output[] has to be recalculated for CHC_RATE and CHC_K"
+#endif
+
+/* Soft-decision distance between the CHC_RATE gross bits in analog */
+/* and the encoder output binary                                    */
+static Longint distance(const Shortint *analog, Shortint binary)
+{
+  Shortint ii;
+  Shortint temp;
+  Shortint analog_tmp;
+  Longint  dist = 0;
+
+  binary &= (1<<CHC_RATE)-1;
+
+  /* We transform 0 -> -16383, 1 -> 16383 */
+  for (ii=0; ii<CHC_RATE; ii++)
+    {
+      temp = ((binary >> ii) & 0x1) ? 16383 : -16383;
+      analog_tmp = analog[CHC_RATE-1-ii];
+
+      if (analog_tmp > 16383)
+        analog_tmp = 16383;
+      else if (analog_tmp < -16383)
+        analog_tmp = -16383;
+
+      dist += abs(temp-analog_tmp);
+    }
+  return dist;
+}
+
+/* New metrics of the nodes num/2 and num/2+NUM_NODES/2, which continue */
+/* the paths of the nodes num and num+1                                 */
+static void butterfly(Shortint num, const Shortint *inputvalue,
+                      check_node_t *nodes)
+{
+  Longint my_metric         = nodes[num].oldmetric;
+  Longint my_friends_metric = nodes[num+1].oldmetric;
+  Longint path0, path1;
+
+  path0 = my_metric         + distance(inputvalue, base_output[num]);
+  path1 = my_friends_metric + distance(inputvalue, base_output[num+1]);
+
+  if (path0>path1)
+    {
+      nodes[num/2].metric = path1;
+      nodes[num/2].continue_path_from = num+1;
+    }
+  else
+    {
+      nodes[num/2].metric = path0;
+      nodes[num/2].continue_path_from = num;
+    }
+  nodes[num/2].new_entry = 0;
+
+  path0 = my_metric         + distance(inputvalue, (Shortint)(~base_output[num]));
+  path1 = my_friends_metric + distance(inputvalue, (Shortint)(~base_output[num+1]));
+
+  if (path0>path1)
+    {
+      nodes[num/2+NUM_NODES/2].metric = path1;
+      nodes[num/2+NUM_NODES/2].continue_path_from = num+1;
+    }
+  else
+    {
+      nodes[num/2+NUM_NODES/2].metric = path0;
+      nodes[num/2+NUM_NODES/2].continue_path_from = num;
+    }
+  nodes[num/2+NUM_NODES/2].new_entry = 1;
+}
+
+void check_viterbi_init(check_viterbi_t *viterbi_state)
+{
+  Shortint i, p;
+
+  viterbi_state->number_of_steps = 0;
+
+  for (i=0; i<NUM_NODES; i++)
+    {
+      viterbi_state->nodes[i].metric    = 0;
+      viterbi_state->nodes[i].oldmetric = 0;
+      for (p=0; p<BLOCK*CHC_K; p++)
+        {
+          viterbi_state->nodes[i].path[p]     = -1;
+          viterbi_state->nodes[i].temppath[p] = -1;
+        }
+    }
+}
+
+void check_viterbi_exec(const Shortint *inputword, Shortint length_input,
+                        Shortint *out, Shortint *num_valid_out_bits,
+                        check_viterbi_t *viterbi_state)
+{
+  check_node_t *nodes = viterbi_state->nodes;
+  Shortint      i, j, p;
+  Shortint      min_metric;
+  Longint       biggest;
+
+  *num_valid_out_bits = 0;
+
+  for (j=0; j<length_input/CHC_RATE; j++)
+    {
+      /* Calculate the new metrics */
+      for (i=0; i<NUM_NODES/2; i++)
+        butterfly((Shortint)(2*i), inputword+CHC_RATE*j, nodes);
+
+      /* Update the metrics and the paths */
+      for (i=0; i<NUM_NODES; i++)
+        {
+          nodes[i].oldmetric = nodes[i].metric;
+
+          for (p=0; p<viterbi_state->number_of_steps; p++)
+            nodes[i].temppath[p] = nodes[nodes[i].continue_path_from].path[p];
+          nodes[i].temppath[viterbi_state->number_of_steps] = nodes[i].new_entry;
+        }
+
+      /* Find the path with the lowest metric */
+      biggest = maxLongint;
+      min_metric = 0;
+
+      for (i=0; i<NUM_NODES; i++)
+        {
+          for (p=0; p<BLOCK*CHC_K; p++)
+            nodes[i].path[p] = nodes[i].temppath[p];
+
+          if (nodes[i].metric < biggest)
+            {
+              biggest = nodes[i].metric;
+              min_metric = i;
+            }
+        }
+
+      if (viterbi_state->number_of_steps >= BLOCK*CHC_K-1)
+        {
+          out[(*num_valid_out_bits)++] = nodes[min_metric].path[0];
+
+          for (i=0; i<NUM_NODES; i++)
+            for (p=0; p<BLOCK*CHC_K-1; p++)
+              nodes[i].path[p] = nodes[i].path[p+1];
+        }
+      else
+        viterbi_state->number_of_steps++;
+    }
+}
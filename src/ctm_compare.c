@@ -0,0 +1,309 @@
+/*
+*******************************************************************************
+*
+*      File             : ctm_compare.c
+*      Purpose          : main function of ctmcompare, which compares the
+*                         single-precision demodulators with the fixed
+*                         point reference on a recording (see
+*                         ctm_compare.h)
+*
+*******************************************************************************
+*
+* $Id: $
+*
+*/
+
+#include "ctm_compare.h"
+#include "ctm_defines.h"
+#include "ctm_receiver.h"
+#include "tonedemod.h"
+#include "tonedemod_float.h"
+#include "baudot_functions.h"
+#include "baudot_float.h"
+#include "ucs_functions.h"
+#include "compat.h"
+#include <typedefs.h>
+#include <fifo.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <err.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const char ctm_compare_id[] = "@(#)$Id: $" ctm_compare_h;
+
+/***********************************************************************/
+
+void usage()
+{
+  fprintf(stderr, "usage: ctmcompare [-bc] file\n");
+  exit(1);
+}
+
+/* the LENGTH_TONE_VEC samples of the recording from pos on, zero-padded */
+static void read_frame(Shortint *frame, const Shortint *samples,
+                       size_t num_samples, size_t pos, Bool swap_bytes)
+{
+  size_t cnt;
+
+  for (cnt = 0; cnt < LENGTH_TONE_VEC && pos+cnt < num_samples; cnt++)
+    frame[cnt] = swap_bytes ? (Shortint)swap16(samples[pos+cnt]) : samples[pos+cnt];
+  for (; cnt < LENGTH_TONE_VEC; cnt++)
+    frame[cnt] = 0;
+}
+
+static void append_char(compare_result_t *result, enum compare_version version,
+                        char character)
+{
+  if (result->text_len[version] == result->text_size[version])
+  {
+    result->text_size[version] = result->text_size[version] ? 2*result->text_size[version] : 256;
+    if ((result->text[version] = realloc(result->text[version], result->text_size[version])) == NULL)
+      err(1, "append_char: realloc");
+  }
+  result->text[version][result->text_len[version]++] = character;
+}
+
+/* number of insertions, deletions and substitutions from a to b */
+static size_t edit_distance(const char *a, size_t len_a, const char *b, size_t len_b)
+{
+  size_t *row;
+  size_t  i, j, diagonal, above, result;
+
+  if ((row = calloc(len_b+1, sizeof(size_t))) == NULL)
+    err(1, "edit_distance: calloc");
+  for (j = 0; j <= len_b; j++)
+    row[j] = j;
+  for (i = 1; i <= len_a; i++)
+  {
+    diagonal = row[0];
+    row[0] = i;
+    for (j = 1; j <= len_b; j++)
+    {
+      above = row[j];
+      row[j] = diagonal + (a[i-1] != b[j-1]);
+      if (above+1 < row[j])
+        row[j] = above+1;
+      if (row[j-1]+1 < row[j])
+        row[j] = row[j-1]+1;
+      diagonal = above;
+    }
+  }
+  result = row[len_b];
+  free(row);
+
+  return result;
+}
+
+/* ---------------------------------------------------------------------- */
+/* compare_ctm:                                                           */
+/* The hard decisions are compared on the same frames: the float version  */
+/* is run with the frame lengths of the fixed point version. The text is  */
+/* decoded by a receiver of each version on its own, as the session does. */
+/* ---------------------------------------------------------------------- */
+
+static void compare_ctm(const Shortint *samples, size_t num_samples,
+                        Bool swap_bytes, compare_result_t *result)
+{
+  static demod_state_t       fixed_state;
+  static demod_float_state_t float_state;
+  static rx_state_t          rx_state;
+  window_state_t             signal_window;
+  fifo_state_t               char_fifo;
+  Shortint                   frame[LENGTH_TONE_VEC];
+  Shortint                   bits_fixed[2], bits_float[2];
+  Shortint                   correction_fixed, correction_float;
+  Shortint                   num_in_samples;
+  Bool                       early_muting;
+  UShortint                  ucs_code;
+  size_t                     pos, cnt;
+  int                        version;
+
+  init_tonedemod(&fixed_state);
+  init_tonedemod_float(&float_state);
+  correction_fixed = 0;
+  for (pos = 0; pos+SYMB_LEN+1 <= num_samples; pos += num_in_samples)
+  {
+    num_in_samples = SYMB_LEN+correction_fixed;
+    for (cnt = 0; cnt < (size_t)num_in_samples; cnt++)
+      frame[cnt] = swap_bytes ? (Shortint)swap16(samples[pos+cnt]) : samples[pos+cnt];
+
+    tonedemod(bits_fixed, frame, num_in_samples, &correction_fixed, &fixed_state);
+    tonedemod_float(bits_float, frame, num_in_samples, &correction_float, &float_state);
+
+    for (cnt = 0; cnt < 2; cnt++)
+    {
+      result->num_decisions++;
+      if ((bits_fixed[cnt] < 0) == (bits_float[cnt] < 0))
+        result->num_agreements++;
+    }
+    result->num_frames++;
+    if (correction_fixed != correction_float)
+      result->num_corrections++;
+  }
+
+  for (version = COMPARE_FIXED; version <= COMPARE_FLOAT; version++)
+  {
+    init_ctm_receiver(&rx_state);
+    rx_state.floatDemod = (version == COMPARE_FLOAT);
+    Shortint_window_init(&signal_window, TONEDEMOD_HISTORY_LEN, SYMB_LEN+LENGTH_TONE_VEC);
+    Shortint_fifo_init(&char_fifo, 16);
+
+    for (pos = 0; pos < num_samples; pos += LENGTH_TONE_VEC)
+    {
+      read_frame(frame, samples, num_samples, pos, swap_bytes);
+      Shortint_window_push(&signal_window, frame, LENGTH_TONE_VEC);
+      ctm_receiver(&signal_window, &char_fifo, &early_muting, &rx_state);
+
+      while (Shortint_fifo_check(&char_fifo) > 0)
+      {
+        Shortint_fifo_pop(&char_fifo, (Shortint *)&ucs_code, 1);
+        append_char(result, version, convertUCScode2char(ucs_code));
+      }
+    }
+
+    Shortint_fifo_exit(&char_fifo);
+    Shortint_window_exit(&signal_window);
+    exit_ctm_receiver(&rx_state);
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+/* compare_baudot:                                                        */
+/* Both demodulators run sample by sample, the decisions are the signs    */
+/* of their actual signal diff (see detect_baudot_bit()) where the fixed  */
+/* point one is reliable.                                                 */
+/* ---------------------------------------------------------------------- */
+
+static void compare_baudot(const Shortint *samples, size_t num_samples,
+                           Bool swap_bytes, compare_result_t *result)
+{
+  baudot_tonedemod_state_t state[2];
+  fifo_state_t             tty_fifo[2];
+  Shortint                 frame[LENGTH_TONE_VEC];
+  Shortint                 tty_code;
+  Shortint                 diff_fixed, diff_float;
+  size_t                   pos, cnt;
+  int                      version;
+
+  for (version = COMPARE_FIXED; version <= COMPARE_FLOAT; version++)
+  {
+    init_baudot_tonedemod(&state[version]);
+    Shortint_fifo_init(&tty_fifo[version], 16);
+  }
+
+  for (pos = 0; pos < num_samples; pos += LENGTH_TONE_VEC)
+  {
+    read_frame(frame, samples, num_samples, pos, swap_bytes);
+    for (cnt = 0; cnt < LENGTH_TONE_VEC; cnt++)
+    {
+      baudot_tonedemod(frame+cnt, 1, &tty_fifo[COMPARE_FIXED], &state[COMPARE_FIXED]);
+      baudot_tonedemod_float(frame+cnt, 1, &tty_fifo[COMPARE_FLOAT], &state[COMPARE_FLOAT]);
+
+      diff_fixed = state[COMPARE_FIXED].bufferDiff[state[COMPARE_FIXED].posDiff];
+      diff_float = state[COMPARE_FLOAT].bufferDiff[state[COMPARE_FLOAT].posDiff];
+      if (abs(diff_fixed) <= COMPARE_BAUDOT_MIN_DIFF)
+        continue;
+      result->num_decisions++;
+      if ((diff_fixed < 0) == (diff_float < 0))
+        result->num_agreements++;
+    }
+
+    for (version = COMPARE_FIXED; version <= COMPARE_FLOAT; version++)
+      while (Shortint_fifo_check(&tty_fifo[version]) > 0)
+      {
+        Shortint_fifo_pop(&tty_fifo[version], &tty_code, 1);
+        append_char(result, version, convertTTYcode2char(tty_code));
+      }
+  }
+
+  for (version = COMPARE_FIXED; version <= COMPARE_FLOAT; version++)
+    Shortint_fifo_exit(&tty_fifo[version]);
+}
+
+/***********************************************************************/
+
+int main(int argc, char** argv)
+{
+  compare_result_t result;
+  struct stat      st;
+  const Shortint  *samples;
+  size_t           num_samples, edits;
+  int              baudot_flag;
+  int              swap_flag;
+  int              input_fd;
+  int              ch;
+
+  baudot_flag = 0;
+  swap_flag = 0;
+
+  while ((ch = getopt(argc, argv, "bc")) != -1) {
+    switch (ch) {
+      case 'b':
+        baudot_flag = 1;
+        break;
+      case 'c':
+        swap_flag = 1;
+        break;
+      default:
+        usage();
+        /* NOTREACHED */
+    }
+  }
+  argc -= optind;
+  argv += optind;
+
+  if (argc != 1)
+    usage();
+
+  if ((input_fd = open(argv[0], O_RDONLY)) == -1)
+    err(1, "unable to open %s", argv[0]);
+  if (fstat(input_fd, &st) == -1)
+    err(1, "fstat");
+  if (!S_ISREG(st.st_mode))
+    errx(1, "%s is not a regular file", argv[0]);
+
+  num_samples = st.st_size / sizeof(Shortint);
+  samples = NULL;
+  if (num_samples > 0)
+  {
+    samples = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, input_fd, 0);
+    if (samples == MAP_FAILED)
+      err(1, "unable to map %s", argv[0]);
+  }
+
+  memset(&result, 0, sizeof(result));
+  if (baudot_flag)
+    compare_baudot(samples, num_samples, swap_flag, &result);
+  else
+    compare_ctm(samples, num_samples, swap_flag, &result);
+
+  edits = edit_distance(result.text[COMPARE_FIXED], result.text_len[COMPARE_FIXED],
+                        result.text[COMPARE_FLOAT], result.text_len[COMPARE_FLOAT]);
+
+  printf("%s: %lu samples\n", argv[0], (unsigned long)num_samples);
+  printf("hard decisions: %lu of %lu agree (%.3f%%)\n",
+         (unsigned long)result.num_agreements, (unsigned long)result.num_decisions,
+         result.num_decisions ? 100.0*result.num_agreements/result.num_decisions : 100.0);
+  if (!baudot_flag)
+    printf("sampling corrections: %lu of %lu frames differ\n",
+           (unsigned long)result.num_corrections, (unsigned long)result.num_frames);
+  printf("text: %lu characters fixed point, %lu float, %lu edits, CER %.3f%%\n",
+         (unsigned long)result.text_len[COMPARE_FIXED],
+         (unsigned long)result.text_len[COMPARE_FLOAT], (unsigned long)edits,
+         result.text_len[COMPARE_FIXED] ? 100.0*edits/result.text_len[COMPARE_FIXED] :
+         (edits ? 100.0 : 0.0));
+
+  if (num_samples > 0)
+    munmap((void *)samples, st.st_size);
+  free(result.text[COMPARE_FIXED]);
+  free(result.text[COMPARE_FLOAT]);
+  close(input_fd);
+
+  exit(0);
+}
@@ -0,0 +1,70 @@
+/*
+*******************************************************************************
+*
+*      File             : ctm_compare.h
+*      Purpose          : results of the comparison of the fixed point and
+*                         the single-precision demodulators (ctmcompare)
+*
+*      ctmcompare runs both versions of the CTM demodulator (tonedemod()
+*      and tonedemod_float()) or of the Baudot demodulator
+*      (baudot_tonedemod() and baudot_tonedemod_float()) over the same
+*      recording, and reports how often their hard decisions agree, and the
+*      character error rate of the text of the float version, taking the
+*      text of the fixed point version as the reference.
+*
+*******************************************************************************
+*/
+#ifndef ctm_compare_h
+#define ctm_compare_h "$Id: $"
+
+/*
+*******************************************************************************
+*                         INCLUDE FILES
+*******************************************************************************
+*/
+
+#include <stddef.h>
+#include <typedefs.h>
+
+/*
+*******************************************************************************
+*                         DEFINITIONS
+*******************************************************************************
+*/
+
+/* Baudot: the samples for which the fixed point signal diff exceeds the     */
+/* reliability threshold of baudot_tonedemod() (0.07*32767) are compared     */
+/* only, the sign of the diff in the pauses is meaningless                   */
+#define COMPARE_BAUDOT_MIN_DIFF  2300
+
+/*
+*******************************************************************************
+*                         DEFINITION OF DATA TYPES
+*******************************************************************************
+*/
+
+/* index of the versions in compare_result_t */
+enum compare_version {
+  COMPARE_FIXED,
+  COMPARE_FLOAT
+};
+
+typedef struct
+{
+  /* hard decisions: the signs of the soft bits of tonedemod(), or of the */
+  /* signal diff of the Baudot demodulator (see COMPARE_BAUDOT_MIN_DIFF)  */
+  ULongint  num_decisions;
+  ULongint  num_agreements;
+
+  /* CTM only: frames for which the sampling corrections differ */
+  ULongint  num_frames;
+  ULongint  num_corrections;
+
+  /* decoded text of both versions */
+  char     *text[2];
+  size_t    text_len[2];
+  size_t    text_size[2];     /* bytes allocated for text */
+}
+compare_result_t;
+
+#endif
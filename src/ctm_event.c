@@ -0,0 +1,111 @@
+/*
+*******************************************************************************
+*
+*      File             : ctm_event.c
+*      Purpose          : lock-free single producer, single consumer ring
+*                         of session events
+*
+*******************************************************************************
+*/
+
+#include "ctm_event.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <err.h>
+
+const char ctm_event_id[] = "@(#)$Id: $" ctm_event_h;
+
+/* head is only written by the producer, tail only by the consumer */
+#define load_acquire(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define store_release(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+void init_ctm_event_ring(ctm_event_ring_t *ring)
+{
+  if ((ring->records = calloc(CTM_EVENT_RING_SIZE, sizeof(ctm_event_t))) == NULL)
+    err(1, "init_ctm_event_ring: calloc");
+  ring->head    = 0;
+  ring->tail    = 0;
+  ring->dropped = 0;
+}
+
+void exit_ctm_event_ring(ctm_event_ring_t *ring)
+{
+  free(ring->records);
+  ring->records = NULL;
+}
+
+Bool ctm_event_put(ctm_event_ring_t *ring, enum ctm_event_type type,
+                   ULongint session_id, ULongint timestamp, UShortint payload)
+{
+  ULongint     head = ring->head;
+  ctm_event_t *record;
+
+  if (head - load_acquire(&ring->tail) >= CTM_EVENT_RING_SIZE)
+  {
+    store_release(&ring->dropped, ring->dropped+1);
+    return false;
+  }
+
+  record = &ring->records[head & (CTM_EVENT_RING_SIZE-1)];
+  record->type       = type;
+  record->payload    = payload;
+  record->session_id = session_id;
+  record->timestamp  = timestamp;
+  store_release(&ring->head, head+1);
+
+  return true;
+}
+
+int ctm_event_get(ctm_event_ring_t *ring, ctm_event_t *events, int max_events)
+{
+  ULongint tail = ring->tail;
+  ULongint avail = load_acquire(&ring->head) - tail;
+  int      cnt;
+
+  if ((ULongint)max_events > avail)
+    max_events = avail;
+  for (cnt=0; cnt<max_events; cnt++)
+    events[cnt] = ring->records[(tail+cnt) & (CTM_EVENT_RING_SIZE-1)];
+  store_release(&ring->tail, tail+max_events);
+
+  return max_events;
+}
+
+ULongint ctm_event_dropped(ctm_event_ring_t *ring)
+{
+  return load_acquire(&ring->dropped);
+}
+
+size_t ctm_event_format(const ctm_event_t *event, char *text, size_t size)
+{
+  const char *line;
+  size_t      len;
+
+  switch (event->type) {
+    case CTM_EVENT_FAR_END_CTM:
+      line = ">>> CTM from far-end detected! <<<\n";
+      break;
+    case CTM_EVENT_FAR_END_ENQUIRY:
+      line = ">>> Enquiry From Far End Detected! <<<\n";
+      break;
+    case CTM_EVENT_ENQUIRY_SENT:
+      line = ">>> Enquiry Burst generated! <<<\n";
+      break;
+    case CTM_EVENT_CHAR_RECEIVED:
+    case CTM_EVENT_CHAR_SENT:
+      if (size < 1)
+        return 0;
+      text[0] = (char)event->payload;
+      return 1;
+    default:
+      return 0;
+  }
+
+  len = strlen(line);
+  if (len > size)
+    len = size;
+  memcpy(text, line, len);
+
+  return len;
+}
@@ -0,0 +1,129 @@
+/*
+*******************************************************************************
+*
+*      File             : ctm_event.h
+*      Purpose          : event log of a session
+*
+*      The engine reports what it does (far-end CTM detected, enquiries,
+*      every character sent or received) as compact binary records in a
+*      ring of its own session, instead of printing them from the frame
+*      processing. The ring has one producer, the thread that runs the
+*      session, and one consumer, e.g. a logging thread of the host, and
+*      needs no lock. The producer never waits: when the ring is full,
+*      the event is dropped and counted.
+*
+*******************************************************************************
+*/
+#ifndef ctm_event_h
+#define ctm_event_h "$Id: $"
+
+/*
+*******************************************************************************
+*                         INCLUDE FILES
+*******************************************************************************
+*/
+
+#include <stddef.h>
+#include <typedefs.h>
+
+/*
+*******************************************************************************
+*                         DEFINITION OF CONSTANTS
+*******************************************************************************
+*/
+
+#define CTM_EVENT_RING_SIZE 1024   /* records per session, power of two */
+
+enum ctm_event_type {
+  CTM_EVENT_FAR_END_CTM,      /* CTM signal from the far end detected   */
+  CTM_EVENT_FAR_END_ENQUIRY,  /* ... before any CTM has been sent        */
+  CTM_EVENT_ENQUIRY_SENT,     /* enquiry burst generated                 */
+  CTM_EVENT_CHAR_RECEIVED,    /* payload: character from the CTM side    */
+  CTM_EVENT_CHAR_SENT         /* payload: character to the CTM side      */
+};
+
+/*
+*******************************************************************************
+*                         DEFINITION OF DATA TYPES
+*******************************************************************************
+*/
+
+typedef struct
+{
+  UShortint type;          /* enum ctm_event_type                    */
+  UShortint payload;
+  ULongint  session_id;    /* see ctm_session_set_id()               */
+  ULongint  timestamp;     /* cntProcessedSamples of the session     */
+}
+ctm_event_t;
+
+typedef struct
+{
+  ctm_event_t *records;    /* CTM_EVENT_RING_SIZE records            */
+  ULongint     head;       /* next record to write (producer)        */
+  ULongint     tail;       /* next record to read (consumer)         */
+  ULongint     dropped;    /* events lost to a full ring (producer)  */
+}
+ctm_event_ring_t;
+
+/*
+*******************************************************************************
+*                         DECLARATION OF PROTOTYPES
+*******************************************************************************
+*/
+
+void init_ctm_event_ring(ctm_event_ring_t *ring);
+void exit_ctm_event_ring(ctm_event_ring_t *ring);
+
+/*
+*******************************************************************************
+*
+*     Function        : ctm_event_put
+*     In              : type, session_id, timestamp, payload
+*                                       contents of the record
+*     In/Out          : ring            state variable
+*     Return          : false, if the ring is full and the event has been
+*                       dropped
+*     Information     : producer side, never blocks
+*
+*******************************************************************************
+*/
+
+Bool ctm_event_put(ctm_event_ring_t *ring, enum ctm_event_type type,
+                   ULongint session_id, ULongint timestamp, UShortint payload);
+
+/*
+*******************************************************************************
+*
+*     Function        : ctm_event_get
+*     Out             : events          up to max_events records
+*     In/Out          : ring            state variable
+*     Return          : number of records taken from the ring
+*     Information     : consumer side, may run in another thread than
+*                       the producer
+*
+*******************************************************************************
+*/
+
+int ctm_event_get(ctm_event_ring_t *ring, ctm_event_t *events, int max_events);
+
+/* number of events dropped so far; may be called by the consumer */
+ULongint ctm_event_dropped(ctm_event_ring_t *ring);
+
+/*
+*******************************************************************************
+*
+*     Function        : ctm_event_format
+*     In              : event           record to format
+*     Out             : text            size bytes at most, not terminated
+*     Return          : number of bytes in text
+*     Information     : the text is what the session used to print on
+*                       stderr for the event: the character itself, or a
+*                       ">>> ... <<<" line
+*
+*******************************************************************************
+*/
+
+size_t ctm_event_format(const ctm_event_t *event, char *text, size_t size);
+
+#endif
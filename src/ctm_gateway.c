@@ -0,0 +1,796 @@
+/*
+*******************************************************************************
+*
+*      File             : ctm_gateway.c
+*      Purpose          : main function of the multi-session CTM gateway
+*                         daemon (ctmd). One daemon hosts many calls: the
+*                         CTM and user descriptors of all sessions are
+*                         multiplexed over a single epoll set, and each
+*                         session is driven by ctm_session_process() just
+*                         like the single-call loop in ctm_session_run().
+*
+*                         The per-frame work of the channels that are ready
+*                         is spread over a pool of worker threads with work
+*                         stealing (see workpool.h); the epoll set itself is
+*                         only touched by the main thread. A task runs up to
+*                         TONEDEMOD_LANES channels with
+*                         ctm_session_process_multi(), which demodulates
+*                         their CTM inputs together.
+*
+*                         Calls are handed to the daemon over a UNIX domain
+*                         socket, see ctm_gateway.h for the protocol. The
+*                         number of active channels is returned by a
+*                         CTMD_STATUS request (ctmd -q) and is logged on
+*                         SIGUSR1.
+*
+*******************************************************************************
+*
+* $Id: $
+*
+*/
+
+#include "ctm.h"
+#include "ctm_gateway.h"
+#include "workpool.h"
+#include "compat.h"
+#include <typedefs.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/resource.h>
+#include <sys/epoll.h>
+
+const char ctm_gateway_id[] = "@(#)$Id: $" ctm_gateway_h;
+
+#define CTMD_MAX_EVENTS 256
+
+/* a channel whose peer does not read its output for this many bytes */
+/* (16 s of 8 kHz audio) is closed                                    */
+#define CTMD_MAX_BACKLOG (4*BUFIO_BUFFER_SIZE)
+
+/* what an epoll event refers to */
+enum gw_fd_type {
+  GW_LISTENER,
+  GW_CONTROL,
+  GW_CHANNEL
+};
+
+struct gw_channel;
+
+struct gw_fdref {
+  enum gw_fd_type     type;
+  int                 fd;
+  int                 index;    /* pollfd index within the session */
+  struct gw_channel  *channel;
+};
+
+struct gw_channel {
+  int                 id;
+  int                 slot;
+  ctm_session_t      *session;
+  int                 fds[CTMD_NUM_CHANNEL_FDS];
+  struct pollfd       pfds[CTM_SESSION_NFDS];
+  struct gw_fdref     ref[CTM_SESSION_NFDS];
+  int                 registered_fd[CTM_SESSION_NFDS];
+  uint32_t            registered_events[CTM_SESSION_NFDS];
+  Bool                always_ready[CTM_SESSION_NFDS];
+  Bool                spinning;  /* must run without waiting for an event */
+  Bool                ready;
+  Bool                finished;
+};
+
+/* ready channels that are run by one task */
+struct gw_batch {
+  struct gw_channel **channels;
+  int                 num;
+};
+
+struct gw_state {
+  int                  epoll_fd;
+  struct gw_fdref      listener;
+  const char          *socket_path;
+  struct gw_channel  **channels;
+  struct gw_channel  **ready;
+  int                  num_ready;
+  struct gw_batch     *batches;
+  workpool_t          *pool;
+  int                  max_channels;
+  int                  active_channels;
+  int                  spinning_channels;
+  int                  next_channel_id;
+  int                  text_flush_bytes;    /* flush policy of the text output */
+  int                  text_flush_ms;
+};
+
+static volatile sig_atomic_t report_status = 0;
+static volatile sig_atomic_t terminate     = 0;
+
+/***********************************************************************/
+
+void usage()
+{
+  fprintf(stderr, "usage: ctmd [-d] [-B bytes] [-D delay] [-m channels] [-s socket] [-w workers]\n       ctmd -q [-s socket]\n");
+  exit(1);
+}
+
+static void handle_signal(int sig)
+{
+  if (sig == SIGUSR1)
+    report_status = 1;
+  else
+    terminate = 1;
+}
+
+static void set_nonblocking(int fd)
+{
+  int flags;
+
+  if ((flags = fcntl(fd, F_GETFL)) == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+    err(1, "fcntl");
+}
+
+/* raise the descriptor limit, every channel needs four descriptors. */
+static void raise_fd_limit(int max_channels)
+{
+  struct rlimit rl;
+  rlim_t wanted;
+
+  if (getrlimit(RLIMIT_NOFILE, &rl) == -1)
+    err(1, "getrlimit");
+
+  wanted = (rlim_t)max_channels * CTMD_NUM_CHANNEL_FDS + 64;
+  if (rl.rlim_cur >= wanted)
+    return;
+
+  rl.rlim_cur = (rl.rlim_max < wanted) ? rl.rlim_max : wanted;
+  if (setrlimit(RLIMIT_NOFILE, &rl) == -1)
+    warn("setrlimit");
+  if (rl.rlim_cur < wanted)
+    warnx("descriptor limit %llu is too low for %d channels",
+        (unsigned long long)rl.rlim_cur, max_channels);
+}
+
+/* translate epoll events into the poll(2) events ctm_session_process() expects */
+static short gw_revents(uint32_t events)
+{
+  short revents = 0;
+
+  /* A hangup or an error is reported as readable, so that the following */
+  /* read() sees the end of file instead of the session spinning on a     */
+  /* descriptor that will never become readable again.                    */
+  if (events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+    revents |= POLLIN;
+  if (events & EPOLLOUT)
+    revents |= POLLOUT;
+  if (events & EPOLLHUP)
+    revents |= POLLHUP;
+  if (events & EPOLLERR)
+    revents |= POLLERR;
+  return revents;
+}
+
+static void gw_mark_ready(struct gw_state *gw, struct gw_channel *ch)
+{
+  if (!ch->ready)
+  {
+    ch->ready = true;
+    gw->ready[gw->num_ready++] = ch;
+  }
+}
+
+/*
+ * Bring the epoll registration of a channel in line with the pollfd
+ * structures the session currently asks for. Descriptors that cannot be
+ * used with epoll (regular files) are always ready, as with poll(2).
+ */
+static void gw_update_channel_fds(struct gw_state *gw, struct gw_channel *ch)
+{
+  struct epoll_event ev;
+  int active_nfds;
+  int index;
+  Bool spinning;
+
+  active_nfds = ctm_session_pollfd(ch->session, ch->pfds);
+  spinning = (active_nfds == 0 || ctm_session_timeout(ch->session) == 0);
+
+  for (index = 0; index < CTM_SESSION_NFDS; index++)
+  {
+    int fd = ch->pfds[index].fd;
+    uint32_t events = 0;
+
+    if (ch->pfds[index].events & POLLIN)
+      events |= EPOLLIN;
+    if (ch->pfds[index].events & POLLOUT)
+      events |= EPOLLOUT;
+    if (fd < 0)
+      events = 0;
+
+    if (ch->registered_fd[index] != -1 &&
+        (ch->registered_fd[index] != fd || events == 0))
+    {
+      epoll_ctl(gw->epoll_fd, EPOLL_CTL_DEL, ch->registered_fd[index], NULL);
+      ch->registered_fd[index] = -1;
+      ch->registered_events[index] = 0;
+    }
+
+    if (events == 0)
+      continue;
+
+    if (ch->registered_fd[index] != fd && !ch->always_ready[index])
+    {
+      ev.events = events;
+      ev.data.ptr = &ch->ref[index];
+      if (epoll_ctl(gw->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0)
+      {
+        ch->registered_fd[index] = fd;
+        ch->registered_events[index] = events;
+      }
+      else if (errno == EPERM)
+        ch->always_ready[index] = true;
+      else
+        err(1, "epoll_ctl: channel %d", ch->id);
+    }
+    else if (ch->registered_fd[index] == fd && ch->registered_events[index] != events)
+    {
+      ev.events = events;
+      ev.data.ptr = &ch->ref[index];
+      if (epoll_ctl(gw->epoll_fd, EPOLL_CTL_MOD, fd, &ev) == -1)
+        err(1, "epoll_ctl: channel %d", ch->id);
+      ch->registered_events[index] = events;
+    }
+
+    if (ch->always_ready[index])
+    {
+      ch->pfds[index].revents = ch->pfds[index].events;
+      spinning = true;
+    }
+  }
+
+  if (spinning != ch->spinning)
+  {
+    ch->spinning = spinning;
+    gw->spinning_channels += spinning ? 1 : -1;
+  }
+}
+
+static void gw_close_channel(struct gw_state *gw, struct gw_channel *ch)
+{
+  int index;
+
+  for (index = 0; index < CTM_SESSION_NFDS; index++)
+    if (ch->registered_fd[index] != -1)
+      epoll_ctl(gw->epoll_fd, EPOLL_CTL_DEL, ch->registered_fd[index], NULL);
+
+  if (ch->spinning)
+    gw->spinning_channels--;
+
+  if (ctm_session_dropped_events(ch->session) > 0)
+    fprintf(stderr, "ctmd: channel %d: %lu events dropped\n", ch->id,
+        (unsigned long)ctm_session_dropped_events(ch->session));
+
+  /* the session writes what its outputs still take */
+  ctm_session_destroy(ch->session);
+  for (index = 0; index < CTMD_NUM_CHANNEL_FDS; index++)
+    if (ch->fds[index] != -1)
+      close(ch->fds[index]);
+
+  gw->channels[ch->slot] = NULL;
+  gw->active_channels--;
+
+  fprintf(stderr, "ctmd: channel %d closed, %d active\n", ch->id, gw->active_channels);
+  free(ch);
+}
+
+/* run one iteration of the channels of a batch, given the events */
+/* collected so far. This may be called from any worker thread.    */
+static void gw_process_batch(void *arg)
+{
+  struct gw_batch *batch = arg;
+  ctm_session_t   *sessions[TONEDEMOD_LANES];
+  struct pollfd   *pfds[TONEDEMOD_LANES];
+  int              finished[TONEDEMOD_LANES];
+  int              index;
+
+  for (index = 0; index < batch->num; index++)
+  {
+    sessions[index] = batch->channels[index]->session;
+    pfds[index]     = batch->channels[index]->pfds;
+  }
+
+  ctm_session_process_multi(sessions, pfds, finished, batch->num);
+
+  for (index = 0; index < batch->num; index++)
+    batch->channels[index]->finished = finished[index];
+}
+
+/* Logs the events of a channel. The characters of the calls are not */
+/* logged, only the negotiation.                                      */
+static void gw_log_channel_events(struct gw_channel *ch)
+{
+  ctm_event_t events[64];
+  char        text[64];
+  size_t      len;
+  int         num, cnt;
+
+  while ((num = ctm_session_get_events(ch->session, events, 64)) > 0)
+    for (cnt = 0; cnt < num; cnt++)
+    {
+      if (events[cnt].type == CTM_EVENT_CHAR_RECEIVED ||
+          events[cnt].type == CTM_EVENT_CHAR_SENT)
+        continue;
+      len = ctm_event_format(&events[cnt], text, sizeof(text));
+      fprintf(stderr, "ctmd: channel %d: %.*s", ch->id, (int)len, text);
+    }
+}
+
+/* run all ready channels, then update their epoll registrations */
+static void gw_run_ready_channels(struct gw_state *gw)
+{
+  struct gw_channel *ch;
+  struct gw_batch   *batch;
+  int index;
+  int num_batches = 0;
+
+  for (index = 0; index < gw->num_ready; index += TONEDEMOD_LANES)
+  {
+    batch = &(gw->batches[num_batches++]);
+    batch->channels = &(gw->ready[index]);
+    batch->num      = gw->num_ready - index;
+    if (batch->num > TONEDEMOD_LANES)
+      batch->num = TONEDEMOD_LANES;
+  }
+
+  if (gw->pool != NULL)
+  {
+    for (index = 0; index < num_batches; index++)
+      workpool_submit(gw->pool, gw_process_batch, &(gw->batches[index]));
+    workpool_wait(gw->pool);
+  }
+  else
+    for (index = 0; index < num_batches; index++)
+      gw_process_batch(&(gw->batches[index]));
+
+  for (index = 0; index < gw->num_ready; index++)
+  {
+    ch = gw->ready[index];
+    ch->ready = false;
+    gw_log_channel_events(ch);
+
+    /* the outputs never block the event loop, a stalled peer costs */
+    /* only memory, up to the limit                                 */
+    if (!ch->finished && ctm_session_backlog(ch->session) > CTMD_MAX_BACKLOG)
+    {
+      fprintf(stderr, "ctmd: channel %d: output not read, %lu bytes waiting\n",
+          ch->id, (unsigned long)ctm_session_backlog(ch->session));
+      ch->finished = true;
+    }
+
+    if (ch->finished)
+      gw_close_channel(gw, ch);
+    else
+      gw_update_channel_fds(gw, ch);
+  }
+
+  gw->num_ready = 0;
+}
+
+static void gw_report_status(struct gw_state *gw)
+{
+  int index;
+
+  fprintf(stderr, "ctmd: %d active channels\n", gw->active_channels);
+
+  if (gw->pool != NULL)
+    for (index = 0; index < workpool_num_workers(gw->pool); index++)
+      fprintf(stderr, "ctmd: worker %d: queue depth %d (max %d), %lu frames, %lu stolen\n",
+          index, workpool_queue_depth(gw->pool, index),
+          workpool_max_queue_depth(gw->pool, index),
+          (unsigned long)workpool_executed(gw->pool, index),
+          (unsigned long)workpool_stolen(gw->pool, index));
+}
+
+static int gw_open_channel(struct gw_state *gw, struct ctmd_request *req, int *fds)
+{
+  struct gw_channel *ch;
+  int slot;
+  int index;
+
+  if (gw->active_channels >= gw->max_channels)
+  {
+    warnx("channel limit of %d reached", gw->max_channels);
+    return -1;
+  }
+
+  if ((req->ctm_mode != CTM_FILE && req->ctm_mode != CTM_FILE_COMPAT) ||
+      (req->user_mode != CTM_BAUDOT_IN && req->user_mode != CTM_BAUDOT_IN_COMPAT &&
+       req->user_mode != CTM_TEXT_IN) ||
+      (req->negotiation != ON && req->negotiation != OFF))
+  {
+    warnx("invalid channel request");
+    return -1;
+  }
+
+  for (slot = 0; slot < gw->max_channels; slot++)
+    if (gw->channels[slot] == NULL)
+      break;
+
+  if ((ch = calloc(1, sizeof(struct gw_channel))) == NULL)
+  {
+    warn("calloc");
+    return -1;
+  }
+
+  for (index = 0; index < CTMD_NUM_CHANNEL_FDS; index++)
+  {
+    set_nonblocking(fds[index]);
+    ch->fds[index] = fds[index];
+  }
+
+  ch->id   = gw->next_channel_id++;
+  ch->slot = slot;
+  ch->session = ctm_session_create(req->ctm_mode, req->user_mode,
+      fds[1], fds[0], fds[3], fds[2], NULL);
+  ctm_session_set_negotiation(ch->session, req->negotiation);
+  ctm_session_set_shutdown_on_eof(ch->session, req->shutdown_on_eof);
+  ctm_session_set_num_samples(ch->session, req->num_samples);
+  ctm_session_set_text_flush(ch->session, gw->text_flush_bytes, gw->text_flush_ms);
+  ctm_session_set_id(ch->session, ch->id);
+  ctm_session_start(ch->session);
+
+  for (index = 0; index < CTM_SESSION_NFDS; index++)
+  {
+    ch->ref[index].type    = GW_CHANNEL;
+    ch->ref[index].index   = index;
+    ch->ref[index].channel = ch;
+    ch->registered_fd[index] = -1;
+  }
+
+  gw->channels[slot] = ch;
+  gw->active_channels++;
+
+  fprintf(stderr, "ctmd: channel %d opened, %d active\n", ch->id, gw->active_channels);
+
+  gw_update_channel_fds(gw, ch);
+  return ch->id;
+}
+
+/* receive one request from a control connection and answer it */
+static void gw_handle_control(struct gw_state *gw, struct gw_fdref *ref)
+{
+  struct ctmd_request req;
+  struct ctmd_reply   reply;
+  struct msghdr       msg;
+  struct iovec        iov;
+  struct cmsghdr     *cmsg;
+  union {
+    struct cmsghdr hdr;
+    char           buf[CMSG_SPACE(CTMD_NUM_CHANNEL_FDS * sizeof(int))];
+  } control;
+  int fds[CTMD_NUM_CHANNEL_FDS];
+  int num_fds = 0;
+  int index;
+  ssize_t len;
+
+  memset(&msg, 0, sizeof(msg));
+  memset(&reply, 0, sizeof(reply));
+  iov.iov_base = &req;
+  iov.iov_len = sizeof(req);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  len = recvmsg(ref->fd, &msg, 0);
+  if (len == -1 && (errno == EAGAIN || errno == EINTR))
+    return;
+
+  for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+  {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+    {
+      num_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      if (num_fds > CTMD_NUM_CHANNEL_FDS)
+        num_fds = CTMD_NUM_CHANNEL_FDS;
+      memcpy(fds, CMSG_DATA(cmsg), num_fds * sizeof(int));
+    }
+  }
+
+  reply.status = -1;
+
+  if (len == sizeof(req) && !(msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)))
+  {
+    switch (req.command) {
+      case CTMD_OPEN_CHANNEL:
+        if (num_fds == CTMD_NUM_CHANNEL_FDS &&
+            (reply.channel_id = gw_open_channel(gw, &req, fds)) >= 0)
+        {
+          reply.status = 0;
+          num_fds = 0;   /* descriptors are owned by the channel now */
+        }
+        break;
+      case CTMD_STATUS:
+        reply.status = 0;
+        break;
+      default:
+        warnx("invalid control command %d", req.command);
+        break;
+    }
+  }
+
+  for (index = 0; index < num_fds; index++)
+    close(fds[index]);
+
+  reply.active_channels = gw->active_channels;
+  reply.max_channels    = gw->max_channels;
+  if (len > 0 && write(ref->fd, &reply, sizeof(reply)) == -1)
+    warn("unable to answer control request");
+
+  epoll_ctl(gw->epoll_fd, EPOLL_CTL_DEL, ref->fd, NULL);
+  close(ref->fd);
+  free(ref);
+}
+
+static void gw_accept(struct gw_state *gw)
+{
+  struct epoll_event ev;
+  struct gw_fdref *ref;
+  int fd;
+
+  while ((fd = accept(gw->listener.fd, NULL, NULL)) != -1)
+  {
+    set_nonblocking(fd);
+
+    if ((ref = calloc(1, sizeof(struct gw_fdref))) == NULL)
+    {
+      warn("calloc");
+      close(fd);
+      continue;
+    }
+    ref->type = GW_CONTROL;
+    ref->fd = fd;
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = ref;
+    if (epoll_ctl(gw->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1)
+      err(1, "epoll_ctl: control connection");
+  }
+
+  if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED)
+    warn("accept");
+}
+
+static int gw_connect(const char *socket_path)
+{
+  struct sockaddr_un sun;
+  int fd;
+
+  memset(&sun, 0, sizeof(sun));
+  sun.sun_family = AF_UNIX;
+  if (snprintf(sun.sun_path, sizeof(sun.sun_path), "%s", socket_path) >= (int)sizeof(sun.sun_path))
+    errx(1, "socket path too long: %s", socket_path);
+
+  if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+    err(1, "socket");
+  if (connect(fd, (struct sockaddr *)&sun, sizeof(sun)) == -1)
+    err(1, "connect: %s", socket_path);
+
+  return fd;
+}
+
+static void gw_listen(struct gw_state *gw)
+{
+  struct sockaddr_un sun;
+  struct epoll_event ev;
+  int fd;
+
+  memset(&sun, 0, sizeof(sun));
+  sun.sun_family = AF_UNIX;
+  if (snprintf(sun.sun_path, sizeof(sun.sun_path), "%s", gw->socket_path) >= (int)sizeof(sun.sun_path))
+    errx(1, "socket path too long: %s", gw->socket_path);
+
+  if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+    err(1, "socket");
+
+  unlink(gw->socket_path);
+  if (bind(fd, (struct sockaddr *)&sun, sizeof(sun)) == -1)
+    err(1, "bind: %s", gw->socket_path);
+  if (listen(fd, 128) == -1)
+    err(1, "listen");
+  set_nonblocking(fd);
+
+  gw->listener.type = GW_LISTENER;
+  gw->listener.fd = fd;
+
+  ev.events = EPOLLIN;
+  ev.data.ptr = &gw->listener;
+  if (epoll_ctl(gw->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1)
+    err(1, "epoll_ctl: listener");
+}
+
+/* ctmd -q: ask a running daemon for its number of active channels */
+static int gw_query_status(const char *socket_path)
+{
+  struct ctmd_request req;
+  struct ctmd_reply reply;
+  int fd;
+
+  memset(&req, 0, sizeof(req));
+  req.command = CTMD_STATUS;
+
+  fd = gw_connect(socket_path);
+  if (write(fd, &req, sizeof(req)) != sizeof(req))
+    err(1, "write");
+  if (read(fd, &reply, sizeof(reply)) != sizeof(reply) || reply.status != 0)
+    errx(1, "invalid reply from %s", socket_path);
+  close(fd);
+
+  printf("%d active channels (maximum %d)\n", reply.active_channels, reply.max_channels);
+  return 0;
+}
+
+/***********************************************************************/
+
+int main(int argc, char** argv)
+{
+  struct gw_state gw;
+  struct epoll_event events[CTMD_MAX_EVENTS];
+  struct sigaction sa;
+  const char *errstr;
+  int daemon_flag;
+  int query_flag;
+  int num_workers;
+  int num_events;
+  int index;
+  int ch;
+
+  memset(&gw, 0, sizeof(gw));
+  gw.socket_path  = CTMD_SOCKET_PATH;
+  gw.max_channels = CTMD_DEFAULT_CHANNELS;
+  gw.text_flush_bytes = 1;
+  gw.text_flush_ms = 0;
+  daemon_flag = 0;
+  query_flag = 0;
+  num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+
+  while ((ch = getopt(argc, argv, "dqB:D:m:s:w:")) != -1) {
+    switch (ch) {
+      case 'B':
+        gw.text_flush_bytes = strtonum(optarg, 1, BUFIO_BUFFER_SIZE, &errstr);
+        if (errstr)
+          errx(1, "text flush size is %s: %s", errstr, optarg);
+        break;
+      case 'D':
+        gw.text_flush_ms = strtonum(optarg, 0, 60000, &errstr);
+        if (errstr)
+          errx(1, "text flush delay is %s: %s", errstr, optarg);
+        break;
+      case 'd':
+        daemon_flag = 1;
+        break;
+      case 'q':
+        query_flag = 1;
+        break;
+      case 'm':
+        gw.max_channels = strtonum(optarg, 1, 65536, &errstr);
+        if (errstr)
+          errx(1, "number of channels is %s: %s", errstr, optarg);
+        break;
+      case 's':
+        gw.socket_path = optarg;
+        break;
+      case 'w':
+        num_workers = strtonum(optarg, 0, 1024, &errstr);
+        if (errstr)
+          errx(1, "number of workers is %s: %s", errstr, optarg);
+        break;
+      default:
+        usage();
+        /* NOTREACHED */
+    }
+  }
+  argc -= optind;
+  argv += optind;
+
+  if (argc != 0)
+    usage();
+
+  if (query_flag)
+    exit(gw_query_status(gw.socket_path));
+
+  raise_fd_limit(gw.max_channels);
+
+  if ((gw.channels = calloc(gw.max_channels, sizeof(struct gw_channel *))) == NULL ||
+      (gw.ready = calloc(gw.max_channels, sizeof(struct gw_channel *))) == NULL ||
+      (gw.batches = calloc((gw.max_channels+TONEDEMOD_LANES-1)/TONEDEMOD_LANES, sizeof(struct gw_batch))) == NULL)
+    err(1, "calloc");
+
+  if ((gw.epoll_fd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+    err(1, "epoll_create1");
+
+  gw_listen(&gw);
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = handle_signal;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGUSR1, &sa, NULL);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  if (daemon_flag && daemon(0, 0) == -1)
+    err(1, "daemon");
+
+  /* with -w 0, all channels are processed by the main thread */
+  if (num_workers > 0)
+    gw.pool = workpool_create(num_workers);
+
+  fprintf(stderr, "ctmd: listening on %s, up to %d channels, %d workers\n", gw.socket_path, gw.max_channels, num_workers);
+
+  /*
+   * Main processing loop
+   */
+  while (!terminate) {
+    /* do not block while some channel has work without any event */
+    num_events = epoll_wait(gw.epoll_fd, events, CTMD_MAX_EVENTS,
+        gw.spinning_channels > 0 ? 0 : -1);
+
+    if (num_events == -1)
+    {
+      if (errno != EINTR)
+        err(1, "epoll_wait");
+      num_events = 0;
+    }
+
+    if (report_status)
+    {
+      report_status = 0;
+      gw_report_status(&gw);
+    }
+
+    for (index = 0; index < num_events; index++)
+    {
+      struct gw_fdref *ref = events[index].data.ptr;
+
+      switch (ref->type) {
+        case GW_LISTENER:
+          gw_accept(&gw);
+          break;
+        case GW_CONTROL:
+          gw_handle_control(&gw, ref);
+          break;
+        case GW_CHANNEL:
+          ref->channel->pfds[ref->index].revents |= gw_revents(events[index].events);
+          gw_mark_ready(&gw, ref->channel);
+          break;
+      }
+    }
+
+    if (gw.spinning_channels > 0)
+      for (index = 0; index < gw.max_channels; index++)
+        if (gw.channels[index] != NULL && gw.channels[index]->spinning)
+          gw_mark_ready(&gw, gw.channels[index]);
+
+    /* run one iteration of every channel that has work to do */
+    gw_run_ready_channels(&gw);
+  }
+
+  if (gw.pool != NULL)
+    workpool_destroy(gw.pool);
+
+  for (index = 0; index < gw.max_channels; index++)
+    if (gw.channels[index] != NULL)
+      gw_close_channel(&gw, gw.channels[index]);
+
+  unlink(gw.socket_path);
+  exit(0);
+}
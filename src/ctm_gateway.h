@@ -0,0 +1,49 @@
+/*
+*******************************************************************************
+*
+*      File             : ctm_gateway.h
+*      Purpose          : control protocol of the multi-session CTM gateway
+*                         daemon (ctmd)
+*
+*      A client connects to the daemon's UNIX domain socket and sends one
+*      struct ctmd_request per connection. For CTMD_OPEN_CHANNEL, the four
+*      descriptors of the call are passed along with the request as
+*      SCM_RIGHTS ancillary data, in the order
+*
+*          CTM input, CTM output, user input, user output
+*
+*      The daemon takes over the descriptors, answers with a
+*      struct ctmd_reply and closes the connection. The descriptors are
+*      closed by the daemon when the channel has finished.
+*
+*******************************************************************************
+*/
+#ifndef ctm_gateway_h
+#define ctm_gateway_h "$Id: $"
+
+#define CTMD_SOCKET_PATH      "/tmp/ctmd.sock"
+#define CTMD_DEFAULT_CHANNELS 1024
+#define CTMD_NUM_CHANNEL_FDS  4
+
+enum ctmd_command {
+  CTMD_OPEN_CHANNEL = 1,
+  CTMD_STATUS       = 2
+};
+
+struct ctmd_request {
+  int command;          /* enum ctmd_command                              */
+  int ctm_mode;         /* enum ctm_output_mode, CTM_AUDIO is not allowed */
+  int user_mode;        /* enum ctm_user_input_mode                       */
+  int negotiation;      /* enum on_off                                    */
+  int shutdown_on_eof;  /* 1: finish the channel on user input EOF        */
+  int num_samples;      /* number of samples to process, -1 = infinite    */
+};
+
+struct ctmd_reply {
+  int status;           /* 0 on success, -1 on error                      */
+  int channel_id;       /* id of the new channel (CTMD_OPEN_CHANNEL)      */
+  int active_channels;  /* number of channels currently hosted            */
+  int max_channels;     /* maximum number of channels                     */
+};
+
+#endif
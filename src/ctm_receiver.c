@@ -41,6 +41,7 @@ const char ctm_receiver_id[] = "@(#)$Id: $" ctm_receiver_h;
 #include "init_interleaver.h"
 #include "diag_deinterleaver.h"
 #include "tonedemod.h"
+#include "tonedemod_multi.h"
 #include "m_sequence.h"
 #include "wait_for_sync.h"
 #include "conv_poly.h"
@@ -71,6 +72,7 @@ void init_ctm_receiver(rx_state_t* rx_state)
   rx_state->cntRXBits                 = 0;
   rx_state->syncCorrect               = 0;
   rx_state->cntUnreliableGrossBits    = 0;
+  rx_state->numDemodSymbols           = 0;
   
   /* set up fifo buffers */
   Shortint_fifo_init(&(rx_state->rx_bits_fifo_state), 
@@ -82,6 +84,8 @@ void init_ctm_receiver(rx_state_t* rx_state)
   
   /* Initialize the demodulator */
   init_tonedemod(&(rx_state->tonedemod_state));
+  init_tonedemod_float(&(rx_state->tonedemod_float_state));
+  rx_state->floatDemod = false;
 
   /* Initialize the viterbi decoder */
   viterbi_init(&(rx_state->viterbi_state));
@@ -121,6 +125,7 @@ void reset_ctm_receiver(rx_state_t* rx_state)
   rx_state->cntRXBits                 = 0;
   rx_state->syncCorrect               = 0;
   rx_state->cntUnreliableGrossBits    = 0;
+  rx_state->numDemodSymbols           = 0;
   
   /* reset fifo buffers */
   Shortint_fifo_reset(&(rx_state->rx_bits_fifo_state));
@@ -134,6 +139,19 @@ void reset_ctm_receiver(rx_state_t* rx_state)
   reinit_wait_for_sync(&(rx_state->wait_state));
 }
 
+void exit_ctm_receiver(rx_state_t* rx_state)
+{
+  Shortint_fifo_exit(&(rx_state->rx_bits_fifo_state));
+  Shortint_fifo_exit(&(rx_state->net_bits_fifo_state));
+  Shortint_fifo_exit(&(rx_state->octet_fifo_state));
+
+  exit_deinterleaver(&(rx_state->deintl_state));
+  exit_wait_for_sync(&(rx_state->wait_state));
+
+  free(rx_state->waitSyncOut);
+  free(rx_state->deintlOut);
+}
+
 
 /***************************************************************************/
 /* ctm_receiver()                                                          */
@@ -146,7 +164,8 @@ void reset_ctm_receiver(rx_state_t* rx_state)
 /* externally before using this function (see fifo.h for details).         */
 /*                                                                         */
 /* input/output variables:                                                 */
-/* *ptr_signal_fifo_state      fifo state for the input samples            */
+/* *ptr_signal_window_state    window with the input samples, which must   */
+/*                             keep a history of TONEDEMOD_HISTORY_LEN     */
 /* *ptr_output_char_fifo_state fifo state for the output characters        */
 /* *ptr_early_muting_required  returns whether the original audio signal   */
 /*                             must not be forwarded. This is to guarantee */
@@ -158,13 +177,14 @@ void reset_ctm_receiver(rx_state_t* rx_state)
 /*                             receiver states                             */
 /***************************************************************************/
 
-void ctm_receiver(fifo_state_t*  ptr_signal_fifo_state,
+void ctm_receiver(window_state_t* ptr_signal_window_state,
                   fifo_state_t*  ptr_output_char_fifo_state,
                   Bool*          ptr_early_muting_required,
                   rx_state_t*    rx_state)
 {
-  Shortint  toneVec[SYMB_LEN+1];
+  Shortint  numToneSamples;
   Shortint  bitsDemod[2];
+  Shortint  cntDemodSymbols = 0;
   Shortint  cnt;
   Shortint  numValidBits;
   Bool      actual_sync_found;
@@ -178,8 +198,8 @@ void ctm_receiver(fifo_state_t*  ptr_signal_fifo_state,
   Shortint  numViterbiOutBits;
   UShortint ucsCode  = 0;
 
-  static Shortint  ucsBits[BITS_PER_SYMB];
-  static Shortint  fecGrossBitsIn[CHC_RATE];
+  Shortint  ucsBits[BITS_PER_SYMB];
+  Shortint  fecGrossBitsIn[CHC_RATE];
 
 #ifdef DEBUG_OUTPUT
   static Bool      firsttime = true;
@@ -195,18 +215,39 @@ void ctm_receiver(fifo_state_t*  ptr_signal_fifo_state,
     } 
 #endif  
   
-  while (Shortint_fifo_check(ptr_signal_fifo_state)>SYMB_LEN)
+  while ((cntDemodSymbols < rx_state->numDemodSymbols) ||
+         (Shortint_window_check(ptr_signal_window_state)>SYMB_LEN))
     {
-      /* Pop SYMB_LEN-1, SYMB_LEN, or SYMB_LEN+1 samples from fifo, */
-      /* depending on the state of samplingCorrection.              */
-      Shortint_fifo_pop(ptr_signal_fifo_state, toneVec, 
-                        SYMB_LEN+rx_state->samplingCorrection);
-      
-      /* Run the tone demodulator */
-      tonedemod(bitsDemod, toneVec, 
-                (Shortint)(SYMB_LEN+rx_state->samplingCorrection), 
-                &(rx_state->samplingCorrection), 
-                &(rx_state->tonedemod_state));
+      if (cntDemodSymbols < rx_state->numDemodSymbols)
+        {
+          /* The symbol has been demodulated by ctm_receiver_demodulate() */
+          bitsDemod[0] = rx_state->demodBits[cntDemodSymbols][0];
+          bitsDemod[1] = rx_state->demodBits[cntDemodSymbols][1];
+          cntDemodSymbols++;
+        }
+      else
+        {
+          /* Demodulate SYMB_LEN-1, SYMB_LEN, or SYMB_LEN+1 samples,     */
+          /* depending on the state of samplingCorrection. The window    */
+          /* is read in place, it also holds the history the demodulator */
+          /* needs in front of the new samples.                          */
+          numToneSamples = SYMB_LEN+rx_state->samplingCorrection;
+          rx_state->tonedemod_state.locked = rx_state->wait_state.sync_found;
+          
+          if (rx_state->floatDemod)
+            tonedemod_float_in_place(bitsDemod, 
+                                     Shortint_window_view(ptr_signal_window_state), 
+                                     numToneSamples, 
+                                     &(rx_state->samplingCorrection), 
+                                     &(rx_state->tonedemod_float_state));
+          else
+            tonedemod_in_place(bitsDemod, 
+                               Shortint_window_view(ptr_signal_window_state), 
+                               numToneSamples, 
+                               &(rx_state->samplingCorrection), 
+                               &(rx_state->tonedemod_state));
+          Shortint_window_pop_commit(ptr_signal_window_state, numToneSamples);
+        }
       
 #ifdef DEBUG_OUTPUT
       if (fwrite(bitsDemod, sizeof(Shortint), 2, rx_bits_file) == 0)
@@ -368,6 +409,7 @@ void ctm_receiver(fifo_state_t*  ptr_signal_fifo_state,
               -= (NUM_BITS_BETWEEN_RESYNC+RESYNC_SEQ_LENGTH);
         } 
     }
+  rx_state->numDemodSymbols = 0;
   
   /* As long as there are gross bits in the fifo: pop them, run  */
   /* the channel decoder and pop the net bits into the next fifo */
@@ -460,3 +502,102 @@ void ctm_receiver(fifo_state_t*  ptr_signal_fifo_state,
     }
 }
 
+
+
+/***************************************************************************/
+/* ctm_receiver_demodulate()                                               */
+/* *************************                                               */
+/* Runs the tone demodulators of num receivers ahead of ctm_receiver(),    */
+/* TONEDEMOD_LANES at a time, see ctm_receiver.h.                          */
+/***************************************************************************/
+
+/* true, if the receiver has a symbol that tonedemod_multi() can demodulate; */
+/* the single-precision demodulator runs in ctm_receiver()                  */
+static Bool demodulate_ahead(window_state_t* window, rx_state_t* rx_state)
+{
+  return !rx_state->floatDemod &&
+         (rx_state->numDemodSymbols < DEMOD_QUEUE_LEN) &&
+         (Shortint_window_check(window) > SYMB_LEN) &&
+         tonedemod_multi_supported(&(rx_state->tonedemod_state));
+}
+
+/* Demodulates one symbol of each of num_lanes receivers */
+static void demodulate_lanes(window_state_t* const windows[],
+                             rx_state_t*     const rx_states[],
+                             Shortint        num_lanes)
+{
+  Shortint        bitsDemod[TONEDEMOD_LANES][2];
+  const Shortint* inSamples[TONEDEMOD_LANES];
+  Shortint        numToneSamples[TONEDEMOD_LANES];
+  Shortint        samplingCorrection[TONEDEMOD_LANES];
+  demod_state_t*  demodStates[TONEDEMOD_LANES];
+  rx_state_t*     rx_state;
+  Shortint        lane;
+
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    {
+      inSamples[lane]   = NULL;
+      demodStates[lane] = NULL;
+      if (lane < num_lanes)
+        {
+          /* as in ctm_receiver() */
+          rx_state = rx_states[lane];
+          numToneSamples[lane] = SYMB_LEN+rx_state->samplingCorrection;
+          rx_state->tonedemod_state.locked = rx_state->wait_state.sync_found;
+          inSamples[lane]   = Shortint_window_view(windows[lane]);
+          demodStates[lane] = &(rx_state->tonedemod_state);
+        }
+    }
+
+  tonedemod_multi(bitsDemod, inSamples, numToneSamples, samplingCorrection,
+                  demodStates);
+
+  for (lane=0; lane<num_lanes; lane++)
+    {
+      rx_state = rx_states[lane];
+      Shortint_window_pop_commit(windows[lane], numToneSamples[lane]);
+      rx_state->samplingCorrection = samplingCorrection[lane];
+      rx_state->demodBits[rx_state->numDemodSymbols][0] = bitsDemod[lane][0];
+      rx_state->demodBits[rx_state->numDemodSymbols][1] = bitsDemod[lane][1];
+      rx_state->numDemodSymbols++;
+    }
+}
+
+void ctm_receiver_demodulate(window_state_t* const windows[],
+                             rx_state_t*     const rx_states[],
+                             Shortint        num)
+{
+  window_state_t* laneWindows[TONEDEMOD_LANES];
+  rx_state_t*     laneRxStates[TONEDEMOD_LANES];
+  Shortint        numLanes;
+  Shortint        cnt;
+  Bool            demodulated = true;
+
+  /* Every round demodulates the next symbol of every receiver that */
+  /* still has one, until none is left.                             */
+  while (demodulated)
+    {
+      demodulated = false;
+      numLanes = 0;
+      for (cnt=0; cnt<num; cnt++)
+        {
+          if (!demodulate_ahead(windows[cnt], rx_states[cnt]))
+            continue;
+
+          laneWindows[numLanes]  = windows[cnt];
+          laneRxStates[numLanes] = rx_states[cnt];
+          numLanes++;
+          if (numLanes == TONEDEMOD_LANES)
+            {
+              demodulate_lanes(laneWindows, laneRxStates, numLanes);
+              demodulated = true;
+              numLanes = 0;
+            }
+        }
+      if (numLanes > 0)
+        {
+          demodulate_lanes(laneWindows, laneRxStates, numLanes);
+          demodulated = true;
+        }
+    }
+}
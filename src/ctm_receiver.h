@@ -28,9 +28,11 @@
 
 #include "init_interleaver.h"
 #include "tonedemod.h"
+#include "tonedemod_float.h"
 #include "wait_for_sync.h"
 #include "conv_poly.h"
 #include "viterbi.h"
+#include "tonedemod_multi.h"
 
 #include <typedefs.h>
 #include <fifo.h>
@@ -39,6 +41,11 @@
 #include <stdio.h> 
 
 
+/* Symbols that ctm_receiver_demodulate() can demodulate ahead: as many */
+/* as a frame of LENGTH_TONE_VEC samples and the rest of the last frame */
+/* (at most SYMB_LEN samples) hold, at SYMB_LEN-1 samples per symbol.  */
+#define DEMOD_QUEUE_LEN ((LENGTH_TONE_VEC+SYMB_LEN)/(SYMB_LEN-1))
+
 /* ******************************************************************/
 /* Type definitions for variables that contain all states of the    */
 /* Cellular Text Telephone Modem (CTM) Transmitter and Receiver,    */
@@ -55,12 +62,15 @@ typedef struct {
   Shortint              syncCorrect;
   Shortint              cntUnreliableGrossBits;
   Shortint              intl_delay;
+  Shortint              numDemodSymbols; /* symbols in demodBits */
   
   /* structs (state types) */
   fifo_state_t          rx_bits_fifo_state;
   fifo_state_t          octet_fifo_state;
   fifo_state_t          net_bits_fifo_state;
   demod_state_t         tonedemod_state;
+  demod_float_state_t   tonedemod_float_state;
+  Bool                  floatDemod;     /* use tonedemod_float() */
   // interleaver_state_t   intl_state;
   interleaver_state_t   deintl_state;
   wait_for_sync_state_t wait_state;
@@ -73,6 +83,10 @@ typedef struct {
   Shortint              mutePositions[1];
 #endif
 
+  /* soft bits of the symbols demodulated by ctm_receiver_demodulate(), */
+  /* which ctm_receiver() takes before it demodulates any more          */
+  Shortint              demodBits[DEMOD_QUEUE_LEN][2];
+
   /* vectors (to be allocated in init_ctm_receiver()) */
   Shortint              *waitSyncOut;
   Shortint              *deintlOut;
@@ -96,6 +110,14 @@ void init_ctm_receiver(rx_state_t* rx_state);
 
 void reset_ctm_receiver(rx_state_t* rx_state);
 
+/***********************************************************************/
+/* exit_ctm_receiver()                                                 */
+/* *******************                                                 */
+/* Releases all memory that has been allocated by init_ctm_receiver(). */
+/***********************************************************************/
+
+void exit_ctm_receiver(rx_state_t* rx_state);
+
 
 /***************************************************************************/
 /* ctm_receiver()                                                          */
@@ -108,7 +130,8 @@ void reset_ctm_receiver(rx_state_t* rx_state);
 /* externally before using this function (see fifo.h for details).         */
 /*                                                                         */
 /* input/output variables:                                                 */
-/* *ptr_signal_fifo_state      fifo state for the input samples            */
+/* *ptr_signal_window_state    window with the input samples, which must   */
+/*                             keep a history of TONEDEMOD_HISTORY_LEN     */
 /* *ptr_output_char_fifo_state fifo state for the output characters        */
 /* *ptr_early_muting_required  returns whether the original audio signal   */
 /*                             must not be forwarded. This is to guarantee */
@@ -120,9 +143,33 @@ void reset_ctm_receiver(rx_state_t* rx_state);
 /*                             receiver states                             */
 /***************************************************************************/
 
-void ctm_receiver(fifo_state_t*  ptr_signal_fifo_state,
+void ctm_receiver(window_state_t* ptr_signal_window_state,
                   fifo_state_t*  ptr_output_char_fifo_state,
                   Bool*          ptr_early_muting_required,
                   rx_state_t*    rx_state);
 
+
+/***************************************************************************/
+/* ctm_receiver_demodulate()                                               */
+/* *************************                                               */
+/* Runs the tone demodulators of num receivers ahead of ctm_receiver(),    */
+/* TONEDEMOD_LANES at a time with tonedemod_multi(). All symbols that the  */
+/* windows hold are demodulated and popped, and their bits are kept in     */
+/* rx_state->demodBits until the next ctm_receiver() of the receiver,      */
+/* which then goes on as if it had demodulated them itself. The bits are   */
+/* the same, so the receivers decode the same characters as without this   */
+/* function. Receivers that tonedemod_multi() cannot run (see              */
+/* tonedemod_multi_supported()) and those with floatDemod set are left to  */
+/* ctm_receiver().                                                         */
+/*                                                                         */
+/* input/output variables:                                                 */
+/* windows      the windows with the input samples, one per receiver       */
+/* rx_states    the receivers                                              */
+/* num          number of receivers                                        */
+/***************************************************************************/
+
+void ctm_receiver_demodulate(window_state_t* const windows[],
+                             rx_state_t*     const rx_states[],
+                             Shortint        num);
+
 #endif
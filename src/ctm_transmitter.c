@@ -132,6 +132,16 @@ void reset_ctm_transmitter(tx_state_t* tx_state)
 }
 
 
+void exit_ctm_transmitter(tx_state_t* tx_state)
+{
+  Shortint_fifo_exit(&(tx_state->fifo_state));
+  Shortint_fifo_exit(&(tx_state->octet_fifo_state));
+
+  exit_interleaver(&(tx_state->diag_int_state));
+  exit_tonemod(&(tx_state->mod_state));
+}
+
+
 
 /***********************************************************************/
 /* ctm_transmitter()                                                   */
@@ -197,19 +207,18 @@ void ctm_transmitter(UShortint  ucsCode,
   Shortint  utfOctet;
   Shortint  guardBit = GUARD_BIT_SYMBOL;
 
-  /* The folowing vectors are static in order to avoid time-consuming */
-  /* reallocation for each function call. The contents of these       */
-  /* vectors is not of any importance for the next function call,     */
-  /* therefore the use of static variables does not violate the use   */
-  /* of this function in multiple instances.                          */
+  /* The following vectors are scratch buffers only. Their contents is  */
+  /* not of any importance for the next function call, therefore they  */
+  /* are kept on the stack so that several transmitter instances can   */
+  /* run concurrently in different threads.                            */
   
-  static Shortint netBits[8];
-  static Shortint bitsEnc[8*CHC_RATE+(CHC_K-1)*CHC_RATE];
-  static Shortint bitsEncMuted[8*CHC_RATE+(CHC_K-1)*CHC_RATE+NUM_MUTE_ROWS*intlvB];
-  static Shortint bitsEncIntBuf[INTL_OUT_BUF_LEN];
-  static Shortint txBits[LENGTH_TX_BITS];
+  Shortint netBits[8];
+  Shortint bitsEnc[8*CHC_RATE+(CHC_K-1)*CHC_RATE];
+  Shortint bitsEncMuted[8*CHC_RATE+(CHC_K-1)*CHC_RATE+NUM_MUTE_ROWS*intlvB];
+  Shortint bitsEncIntBuf[INTL_OUT_BUF_LEN];
+  Shortint txBits[LENGTH_TX_BITS];
   
-  static Shortint zero_vec[] = {0,0,0,0,0,0,0,0,0,0};
+  static const Shortint zero_vec[] = {0,0,0,0,0,0,0,0,0,0};
   
 #ifdef DEBUG_OUTPUT
   static Bool      firsttime=true;
@@ -402,38 +411,32 @@ void ctm_transmitter(UShortint  ucsCode,
       tx_state->cntIdleSymbols=0;
     }
 
-  /* Check whether the modulator is able to accept new bits */
-  if (Shortint_fifo_check(&(tx_state->mod_state.txbits_fifo_state))
-      < LENGTH_TX_BITS)
+  /* Execute the modulator; it pops the bits directly from the fifo   */
+  /* buffer, i.e. up to LENGTH_TX_BITS bits within LENGTH_TONE_VEC     */
+  /* samples. For the sine output, the bits are discarded.             */
+  if (!sineOutput)
     {
-      /* pop LENGTH_TX_BITS (or less) bits from the fifo */
-      
+#ifdef DEBUG_OUTPUT
+      /* the bits that the modulator is going to take */
       numBitsToModulate = Shortint_fifo_check(&(tx_state->fifo_state));
       if (numBitsToModulate>=LENGTH_TX_BITS)
         numBitsToModulate = LENGTH_TX_BITS;
-      
-      Shortint_fifo_pop(&(tx_state->fifo_state), txBits, numBitsToModulate);
-    }
-  else
-    numBitsToModulate = 0;
-  
-  /* Execute the modulator */
-  if (!sineOutput)
-    {
-      tonemod(txToneVec, txBits, LENGTH_TONE_VEC, numBitsToModulate, 
+      Shortint_fifo_peek(&(tx_state->fifo_state), txBits, numBitsToModulate);
+#endif
+      tonemod(txToneVec, LENGTH_TONE_VEC, &(tx_state->fifo_state),
               &(tx_state->mod_state));
     }
   else
     {
-      for (cnt=0; cnt<LENGTH_TX_BITS; cnt++)
-        txBits[cnt]=1;
-      tonemod(txToneVec, txBits, LENGTH_TONE_VEC, LENGTH_TX_BITS, 
-              &(tx_state->mod_state));
+      numBitsToModulate = Shortint_fifo_check(&(tx_state->fifo_state));
+      if (numBitsToModulate>=LENGTH_TX_BITS)
+        numBitsToModulate = LENGTH_TX_BITS;
+      
+      Shortint_fifo_pop(&(tx_state->fifo_state), txBits, numBitsToModulate);
+      tonemod(txToneVec, LENGTH_TONE_VEC, NULL, &(tx_state->mod_state));
     }
   
-  *ptrNumBitsStillToModulate 
-    = (Shortint_fifo_check(&(tx_state->fifo_state)) + 
-       Shortint_fifo_check(&(tx_state->mod_state.txbits_fifo_state)));
+  *ptrNumBitsStillToModulate = Shortint_fifo_check(&(tx_state->fifo_state));
   
   /* NumBitsStillToModulate is increased, if the modulator is actually */
   /* active, i.e. the actual symbol is not terminated and both actual  */
@@ -76,6 +76,15 @@ void init_ctm_transmitter(tx_state_t* tx_state);
 
 void reset_ctm_transmitter(tx_state_t* tx_state);
 
+/***********************************************************************/
+/* exit_ctm_transmitter()                                              */
+/* **********************                                              */
+/* Releases all memory that has been allocated by                      */
+/* init_ctm_transmitter().                                             */
+/***********************************************************************/
+
+void exit_ctm_transmitter(tx_state_t* tx_state);
+
 
 /***********************************************************************/
 /* ctm_transmitter()                                                   */
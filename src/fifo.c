@@ -8,13 +8,15 @@
 *      File             : fifo.c
 *      Author           : Matthias Doerbecker
 *      Tested Platforms : Sun Solaris
-*      Description      : Fifo structures for Shortint and Float
+*      Description      : Fifo structures for Shortint, Float and Char
 *
 *      Revision history
 *
 *      Rev  Date       Name            Description
 *      -------------------------------------------------------------------
 *      pA1  14-Dec-99  M.Doerbecker    initial version
+*           2026            ring buffer instead of shifting the buffer
+*                                      on every pop, span access
 *
 *******************************************************************************
 */
@@ -33,6 +35,7 @@ const char fifo_id[] = "@(#)$Id: $";
 */
 #include <stdlib.h>    /* malloc, free */
 #include <stdio.h>
+#include <string.h>    /* memcpy */
 #include "fifo.h"
 
 #include <typedefs.h>  /* basic data type aliases */
@@ -44,6 +47,13 @@ const char fifo_id[] = "@(#)$Id: $";
 *******************************************************************************
 */
 
+#define FIFO_MAGIC_NUMBER 12345
+
+static const char *fifo_type_name[] = {"Shortint", "Float", "Char"};
+#ifdef FIFO_DEBUG
+static const char *fifo_type_id[]   = {"SHORTINT_FIFO", "FLOAT_FIFO", "CHAR_FIFO"};
+#endif
+
 
 /*
 *******************************************************************************
@@ -51,523 +61,457 @@ const char fifo_id[] = "@(#)$Id: $";
 *******************************************************************************
 */
 
+/* The functions below implement the fifo for elements of elem_size   */
+/* bytes. They are static, so that the compiler can specialize them    */
+/* for the constant sizeof() of each of the typed wrappers at the end   */
+/* of this file.                                                        */
 
-int Shortint_fifo_init(fifo_state_t *fifo_state,
-                       Longint length_fifo)
+#ifdef FIFO_DEBUG
+static void fifo_check_state(fifo_state_t *fifo_state,
+                             fifo_type_t  fifo_type,
+                             const char   *function)
 {
-  if (length_fifo<1)
+  if (fifo_state->magic_number != FIFO_MAGIC_NUMBER) 
     {
-      fprintf(stderr, "Error using Shortint_fifo_init; length_fifo ");
-      fprintf(stderr, "must be greater than 0!\n\n");
+      fprintf(stderr, "Function %s_fifo_%s(): \n", 
+              fifo_type_name[fifo_type], function);
+      fprintf(stderr, "Fifo must be initialized before use!\n\n");
       exit(1);
     }
   
-  fifo_state->buffer_Shortint 
-    = (Shortint*)calloc(length_fifo, sizeof(Shortint));
-  
-  if (fifo_state->buffer_Shortint == (Shortint*)NULL)
+  if (fifo_state->fifo_type != fifo_type) 
     {
-      fprintf(stderr, 
-              "Error while allocating memory for Shortint_fifo_init!\n\n");
+      fprintf(stderr, "Function %s_fifo_%s(): \n", 
+              fifo_type_name[fifo_type], function);
+      fprintf(stderr, "Initialization was not of type %s!\n\n",
+              fifo_type_id[fifo_type]);
       exit(1);
     }
-  
-  fifo_state->buffer_Float       = (Float*)NULL;
-  fifo_state->buffer_Char        = (Char*)NULL;
-  fifo_state->length_buffer      = length_fifo;
-  fifo_state->num_entries_actual = 0;
-  fifo_state->fifo_type          = SHORTINT_FIFO;
-  fifo_state->magic_number       = 12345;
-  return 0;
 }
+#else
+#define fifo_check_state(fifo_state, fifo_type, function)
+#endif
 
 /************************************************************************/
 
-int Shortint_fifo_reset(fifo_state_t *fifo_state)
+static int fifo_init(fifo_state_t *fifo_state,
+                     Longint      length_fifo,
+                     fifo_type_t  fifo_type,
+                     size_t       elem_size)
 {
-  fifo_state->num_entries_actual = 0;
-  return 0;
-}
-
-/************************************************************************/
+  ULongint size_ring;
 
-int Shortint_fifo_exit(fifo_state_t *fifo_state)
-{
-  if (fifo_state->magic_number != 12345) 
+  if (length_fifo<1)
     {
-      fprintf(stderr, "Function Shortint_fifo_exit(): \n");
-      fprintf(stderr, "Fifo must be initialized before exit!\n\n");
+      fprintf(stderr, "Error using %s_fifo_init; length_fifo ",
+              fifo_type_name[fifo_type]);
+      fprintf(stderr, "must be greater than 0!\n\n");
       exit(1);
     }
   
-  free(fifo_state->buffer_Shortint);
-  free(fifo_state->buffer_Float);
-  fifo_state->buffer_Shortint    = (Shortint*)NULL;
-  fifo_state->buffer_Float       = (Float*)NULL;
-  fifo_state->num_entries_actual = 0;
-  return 0;
-}
-  
-/************************************************************************/
+  /* smallest power of two holding length_fifo elements */
+  for (size_ring=1; size_ring<(ULongint)length_fifo; size_ring<<=1)
+    ;
 
-int Shortint_fifo_push(fifo_state_t *fifo_state, 
-                       Shortint     *elements_to_push,
-                       Longint      num_elements_to_push)
-{
-  Longint cnt;
-  
-  if (fifo_state->magic_number != 12345) 
-    {
-      fprintf(stderr, "Function Shortint_fifo_push(): \n");
-      fprintf(stderr, "Fifo must be initialized before use!\n\n");
-      exit(1);
-    }
+  fifo_state->buffer = calloc(size_ring, elem_size);
   
-  if (fifo_state->fifo_type != SHORTINT_FIFO) 
+  if (fifo_state->buffer == NULL)
     {
-      fprintf(stderr, "Function Shortint_fifo_push(): \n");
-      fprintf(stderr, "Initialization was not of type SHORTINT_FIFO!\n\n");
-      exit(1);
-    }
-
-  if (num_elements_to_push+fifo_state->num_entries_actual > 
-      fifo_state->length_buffer)
-    {
-      fprintf(stderr, "Function Shortint_fifo_push(): \n");
-      fprintf(stderr, "Overflow while pushing %d ", num_elements_to_push);
-      fprintf(stderr, "elements into buffer (buffer size=%d)\n\n", 
-              fifo_state->length_buffer);
+      fprintf(stderr, 
+              "Error while allocating memory for %s_fifo_init!\n\n",
+              fifo_type_name[fifo_type]);
       exit(1);
     }
   
-  /* append new elements at the end of the buffer */
-  for (cnt=0; cnt<num_elements_to_push; cnt++)
-    fifo_state->buffer_Shortint[fifo_state->num_entries_actual+cnt] 
-      = elements_to_push[cnt];
-  fifo_state->num_entries_actual += num_elements_to_push;
+  fifo_state->length_buffer      = length_fifo;
+  fifo_state->size_ring          = size_ring;
+  fifo_state->mask_ring          = size_ring-1;
+  fifo_state->idx_read           = 0;
+  fifo_state->idx_write          = 0;
+  fifo_state->fifo_type          = fifo_type;
+  fifo_state->magic_number       = FIFO_MAGIC_NUMBER;
   return 0;
 }
 
 /************************************************************************/
 
-int Shortint_fifo_pop(fifo_state_t *fifo_state, 
-                      Shortint     *popped_elements,
-                      Longint      num_elements_to_pop)
+static int fifo_exit(fifo_state_t *fifo_state,
+                     fifo_type_t  fifo_type)
 {
-  Longint cnt;
-  
-  if (fifo_state->magic_number != 12345) 
+  if (fifo_state->magic_number != FIFO_MAGIC_NUMBER) 
     {
-      fprintf(stderr, "Function Shortint_fifo_pop(): \n");
+      fprintf(stderr, "Function %s_fifo_exit(): \n", 
+              fifo_type_name[fifo_type]);
       fprintf(stderr, "Fifo must be initialized before exit!\n\n");
       exit(1);
     }
   
-  if (fifo_state->fifo_type != SHORTINT_FIFO) 
-    {
-      fprintf(stderr, "Function Shortint_fifo_pop(): \n");
-      fprintf(stderr, "Initialization was not of type SHORTINT_FIFO!\n\n");
-      exit(1);
-    }
-
-  if (num_elements_to_pop > fifo_state->num_entries_actual)
-    {
-      fprintf(stderr, "Function Shortint_fifo_pop(): \nBuffer underrun ");
-      fprintf(stderr, "while popping %d ", num_elements_to_pop);
-      fprintf(stderr, "elements; only ");
-      fprintf(stderr, "%d elements in buffer!\n\n", 
-              fifo_state->num_entries_actual);
-      exit(1);
-    }
-  
-  /* read out first (oldest) element from the buffer */
-  for (cnt=0; cnt<num_elements_to_pop; cnt++)
-    popped_elements[cnt] = fifo_state->buffer_Shortint[cnt];
-  
-  fifo_state->num_entries_actual -= num_elements_to_pop;
-
-  /* shift whole buffer to the left */
-  for (cnt=0; cnt<fifo_state->num_entries_actual; cnt++)
-    fifo_state->buffer_Shortint[cnt] = 
-      fifo_state->buffer_Shortint[cnt+num_elements_to_pop];
-  
-  return(0);
+  free(fifo_state->buffer);
+  fifo_state->buffer       = NULL;
+  fifo_state->idx_read     = 0;
+  fifo_state->idx_write    = 0;
+  fifo_state->magic_number = 0;
+  return 0;
 }
 
 /************************************************************************/
 
-int Shortint_fifo_peek(fifo_state_t *fifo_state, 
-                       Shortint     *peeked_elements,
-                       Longint      num_elements_to_peek)
+static void *fifo_peek_span(fifo_state_t *fifo_state,
+                            Longint      *num_elements,
+                            size_t       elem_size)
 {
-  Longint cnt;
-  
-  if (fifo_state->magic_number != 12345) 
-    {
-      fprintf(stderr, "Function Shortint_fifo_peek(): \n");
-      fprintf(stderr, "Fifo must be initialized before exit!\n\n");
-      exit(1);
-    }
-  
-  if (fifo_state->fifo_type != SHORTINT_FIFO) 
-    {
-      fprintf(stderr, "Function Shortint_fifo_peek(): \n");
-      fprintf(stderr, "Initialization was not of type SHORTINT_FIFO!\n\n");
-      exit(1);
-    }
+  ULongint offset    = fifo_state->idx_read & fifo_state->mask_ring;
+  ULongint num_avail = fifo_state->idx_write - fifo_state->idx_read;
 
-  if (num_elements_to_peek > fifo_state->num_entries_actual)
-    {
-      fprintf(stderr, "Function Shortint_fifo_peek(): \n");
-      fprintf(stderr, "Trying to peek %d ", num_elements_to_peek);
-      fprintf(stderr, "elements; only ");
-      fprintf(stderr, "%d elements in buffer!\n\n", 
-              fifo_state->num_entries_actual);
-      exit(1);
-    }
-  
-  /* read out first (oldest) element from the buffer */
-  for (cnt=0; cnt<num_elements_to_peek; cnt++)
-    peeked_elements[cnt] = fifo_state->buffer_Shortint[cnt];
-  
-  return(0);
-}
+  if (num_avail > fifo_state->size_ring-offset)
+    num_avail = fifo_state->size_ring-offset;
 
-/************************************************************************/
-  
-Longint Shortint_fifo_check(fifo_state_t *fifo_state)
-{
-  if (fifo_state->magic_number != 12345) 
-    {
-      fprintf(stderr, "Function Shortint_fifo_check(): \n");
-      fprintf(stderr, "Fifo must be initialized before use!\n\n");
-      exit(1);
-    }
-  
-  return(fifo_state->num_entries_actual);
+  *num_elements = (Longint)num_avail;
+  return (char *)fifo_state->buffer + offset*elem_size;
 }
 
-/************************************************************************/
-/************************************************************************/
-/************************************************************************/
 /************************************************************************/
 
-int Float_fifo_init(fifo_state_t *fifo_state,
-                    Longint length_fifo)
+static void *fifo_push_span(fifo_state_t *fifo_state,
+                            Longint      *num_elements,
+                            size_t       elem_size)
 {
-  if (length_fifo<1)
-    {
-      fprintf(stderr, "Error using Float_fifo_init; length_fifo ");
-      fprintf(stderr, "must be greater than 0!\n\n");
-      exit(1);
-    }
-  
-  fifo_state->buffer_Float 
-    = (Float*)calloc(length_fifo, sizeof(Float));
-  
-  if (fifo_state->buffer_Float == (Float*)NULL)
-    {
-      fprintf(stderr, 
-              "Error while allocating memory for Float_fifo_init!\n\n");
-      exit(1);
-    }
-  
-  fifo_state->buffer_Shortint    = (Shortint*)NULL;
-  fifo_state->buffer_Char        = (Char*)NULL;
-  fifo_state->length_buffer      = length_fifo;
-  fifo_state->num_entries_actual = 0;
-  fifo_state->fifo_type          = FLOAT_FIFO;
-  fifo_state->magic_number       = 12345;
-  return 0;
-}
+  ULongint offset    = fifo_state->idx_write & fifo_state->mask_ring;
+  ULongint num_space = fifo_state->length_buffer - 
+                       (fifo_state->idx_write - fifo_state->idx_read);
 
-/************************************************************************/
+  if (num_space > fifo_state->size_ring-offset)
+    num_space = fifo_state->size_ring-offset;
 
-int Float_fifo_reset(fifo_state_t *fifo_state)
-{
-  fifo_state->num_entries_actual = 0;
-  return 0;
+  *num_elements = (Longint)num_space;
+  return (char *)fifo_state->buffer + offset*elem_size;
 }
 
 /************************************************************************/
 
-int Float_fifo_exit(fifo_state_t *fifo_state)
-{
-  if (fifo_state->magic_number != 12345) 
-    {
-      fprintf(stderr, "Function Float_fifo_exit(): \n");
-      fprintf(stderr, "Fifo must be initialized before exit!\n\n");
-      exit(1);
-    }
-  
-  free(fifo_state->buffer_Shortint);
-  free(fifo_state->buffer_Float);
-  fifo_state->buffer_Shortint    = (Shortint*)NULL;
-  fifo_state->buffer_Float       = (Float*)NULL;
-  fifo_state->num_entries_actual = 0;
-  return 0;
-}
-  
-/************************************************************************/
-
-int Float_fifo_push(fifo_state_t *fifo_state, 
-                    Float     *elements_to_push,
-                    Longint      num_elements_to_push)
+static void fifo_check_overflow(fifo_state_t *fifo_state,
+                                Longint      num_elements_to_push,
+                                fifo_type_t  fifo_type,
+                                const char   *function)
 {
-  Longint cnt;
-  
-  if (fifo_state->magic_number != 12345) 
-    {
-      fprintf(stderr, "Function Float_fifo_push(): \n");
-      fprintf(stderr, "Fifo must be initialized before use!\n\n");
-      exit(1);
-    }
-  
-  if (fifo_state->fifo_type != FLOAT_FIFO) 
-    {
-      fprintf(stderr, "Function Float_fifo_push(): \n");
-      fprintf(stderr, "Initialization was not of type FLOAT_FIFO!\n\n");
-      exit(1);
-    }
-
-  if (num_elements_to_push+fifo_state->num_entries_actual > 
+  if (num_elements_to_push + 
+      (Longint)(fifo_state->idx_write - fifo_state->idx_read) > 
       fifo_state->length_buffer)
     {
-      fprintf(stderr, "Function Float_fifo_push(): \n");
+      fprintf(stderr, "Function %s_fifo_%s(): \n", 
+              fifo_type_name[fifo_type], function);
       fprintf(stderr, "Overflow while pushing %d ", num_elements_to_push);
       fprintf(stderr, "elements into buffer (buffer size=%d)\n\n", 
               fifo_state->length_buffer);
       exit(1);
     }
-  
-  /* append new elements at the end of the buffer */
-  for (cnt=0; cnt<num_elements_to_push; cnt++)
-    fifo_state->buffer_Float[fifo_state->num_entries_actual+cnt] 
-      = elements_to_push[cnt];
-  fifo_state->num_entries_actual += num_elements_to_push;
-  return 0;
 }
 
 /************************************************************************/
 
-int Float_fifo_pop(fifo_state_t *fifo_state, 
-                   Float     *popped_elements,
-                   Longint      num_elements_to_pop)
+static void fifo_check_underrun(fifo_state_t *fifo_state,
+                                Longint      num_elements_to_pop,
+                                fifo_type_t  fifo_type,
+                                const char   *function)
 {
-  Longint cnt;
-  
-  if (fifo_state->magic_number != 12345) 
+  if (num_elements_to_pop > 
+      (Longint)(fifo_state->idx_write - fifo_state->idx_read))
     {
-      fprintf(stderr, "Function Float_fifo_pop(): \n");
-      fprintf(stderr, "Fifo must be initialized before exit!\n\n");
-      exit(1);
-    }
-  
-  if (fifo_state->fifo_type != FLOAT_FIFO) 
-    {
-      fprintf(stderr, "Function Float_fifo_pop(): \n");
-      fprintf(stderr, "Initialization was not of type FLOAT_FIFO!\n\n");
-      exit(1);
-    }
-
-  if (num_elements_to_pop > fifo_state->num_entries_actual)
-    {
-      fprintf(stderr, "Function Float_fifo_pop(): \nBuffer underrun ");
+      fprintf(stderr, "Function %s_fifo_%s(): \nBuffer underrun ", 
+              fifo_type_name[fifo_type], function);
       fprintf(stderr, "while popping %d ", num_elements_to_pop);
       fprintf(stderr, "elements; only ");
       fprintf(stderr, "%d elements in buffer!\n\n", 
-              fifo_state->num_entries_actual);
+              (Longint)(fifo_state->idx_write - fifo_state->idx_read));
       exit(1);
     }
-  
-  /* read out first (oldest) element from the buffer */
-  for (cnt=0; cnt<num_elements_to_pop; cnt++)
-    popped_elements[cnt] = fifo_state->buffer_Float[cnt];
-  
-  fifo_state->num_entries_actual -= num_elements_to_pop;
+}
+
+/************************************************************************/
 
-  /* shift whole buffer to the left */
-  for (cnt=0; cnt<fifo_state->num_entries_actual; cnt++)
-    fifo_state->buffer_Float[cnt] = 
-      fifo_state->buffer_Float[cnt+num_elements_to_pop];
+static int fifo_push(fifo_state_t *fifo_state, 
+                     const void   *elements_to_push,
+                     Longint      num_elements_to_push,
+                     fifo_type_t  fifo_type,
+                     size_t       elem_size)
+{
+  ULongint offset, num_first;
+
+  fifo_check_state(fifo_state, fifo_type, "push");
+  fifo_check_overflow(fifo_state, num_elements_to_push, fifo_type, "push");
   
-  return(0);
+  /* append new elements at the end of the buffer, in two parts */
+  /* if the ring wraps around                                   */
+  offset    = fifo_state->idx_write & fifo_state->mask_ring;
+  num_first = fifo_state->size_ring - offset;
+  if (num_first > (ULongint)num_elements_to_push)
+    num_first = num_elements_to_push;
+
+  memcpy((char *)fifo_state->buffer + offset*elem_size, 
+         elements_to_push, num_first*elem_size);
+  memcpy(fifo_state->buffer, 
+         (const char *)elements_to_push + num_first*elem_size, 
+         (num_elements_to_push-num_first)*elem_size);
+
+  fifo_state->idx_write += num_elements_to_push;
+  return 0;
 }
 
 /************************************************************************/
-  
-Longint Float_fifo_check(fifo_state_t *fifo_state)
+
+static int fifo_peek(fifo_state_t *fifo_state, 
+                     void         *peeked_elements,
+                     Longint      num_elements_to_peek,
+                     fifo_type_t  fifo_type,
+                     size_t       elem_size,
+                     const char   *function)
 {
-  if (fifo_state->magic_number != 12345) 
-    {
-      fprintf(stderr, "Function Float_fifo_check(): \n");
-      fprintf(stderr, "Fifo must be initialized before use!\n\n");
-      exit(1);
-    }
-  
-  return(fifo_state->num_entries_actual);
+  ULongint offset, num_first;
+
+  fifo_check_state(fifo_state, fifo_type, function);
+  fifo_check_underrun(fifo_state, num_elements_to_peek, fifo_type, function);
+
+  /* read out the first (oldest) elements, in two parts if the */
+  /* ring wraps around                                         */
+  offset    = fifo_state->idx_read & fifo_state->mask_ring;
+  num_first = fifo_state->size_ring - offset;
+  if (num_first > (ULongint)num_elements_to_peek)
+    num_first = num_elements_to_peek;
+
+  memcpy(peeked_elements, 
+         (char *)fifo_state->buffer + offset*elem_size, num_first*elem_size);
+  memcpy((char *)peeked_elements + num_first*elem_size, fifo_state->buffer,
+         (num_elements_to_peek-num_first)*elem_size);
+  return 0;
 }
 
 /************************************************************************/
+
+static int fifo_pop(fifo_state_t *fifo_state, 
+                    void         *popped_elements,
+                    Longint      num_elements_to_pop,
+                    fifo_type_t  fifo_type,
+                    size_t       elem_size)
+{
+  fifo_peek(fifo_state, popped_elements, num_elements_to_pop, 
+            fifo_type, elem_size, "pop");
+  fifo_state->idx_read += num_elements_to_pop;
+  return 0;
+}
+
 /************************************************************************/
+/************************************************************************/
+
+/* The typed fifo functions, one set per element type */
+
+#define FIFO_FUNCTIONS(TYPE, FIFO_TYPE)                                      \
+                                                                             \
+int TYPE##_fifo_init(fifo_state_t *fifo_state, Longint length_fifo)          \
+{                                                                            \
+  return fifo_init(fifo_state, length_fifo, FIFO_TYPE, sizeof(TYPE));        \
+}                                                                            \
+                                                                             \
+int TYPE##_fifo_reset(fifo_state_t *fifo_state)                             \
+{                                                                            \
+  fifo_state->idx_read  = 0;                                                 \
+  fifo_state->idx_write = 0;                                                 \
+  return 0;                                                                  \
+}                                                                            \
+                                                                             \
+int TYPE##_fifo_exit(fifo_state_t *fifo_state)                              \
+{                                                                            \
+  return fifo_exit(fifo_state, FIFO_TYPE);                                   \
+}                                                                            \
+                                                                             \
+int TYPE##_fifo_push(fifo_state_t *fifo_state,                              \
+                     TYPE *elements_to_push, Longint num_elements_to_push)   \
+{                                                                            \
+  return fifo_push(fifo_state, elements_to_push, num_elements_to_push,       \
+                   FIFO_TYPE, sizeof(TYPE));                                 \
+}                                                                            \
+                                                                             \
+int TYPE##_fifo_pop(fifo_state_t *fifo_state,                               \
+                    TYPE *popped_elements, Longint num_elements_to_pop)      \
+{                                                                            \
+  return fifo_pop(fifo_state, popped_elements, num_elements_to_pop,          \
+                  FIFO_TYPE, sizeof(TYPE));                                  \
+}                                                                            \
+                                                                             \
+int TYPE##_fifo_peek(fifo_state_t *fifo_state,                              \
+                     TYPE *peeked_elements, Longint num_elements_to_peek)    \
+{                                                                            \
+  return fifo_peek(fifo_state, peeked_elements, num_elements_to_peek,        \
+                   FIFO_TYPE, sizeof(TYPE), "peek");                         \
+}                                                                            \
+                                                                             \
+Longint TYPE##_fifo_check(fifo_state_t *fifo_state)                         \
+{                                                                            \
+  fifo_check_state(fifo_state, FIFO_TYPE, "check");                          \
+  return (Longint)(fifo_state->idx_write - fifo_state->idx_read);            \
+}                                                                            \
+                                                                             \
+TYPE *TYPE##_fifo_peek_span(fifo_state_t *fifo_state, Longint *num_elements) \
+{                                                                            \
+  fifo_check_state(fifo_state, FIFO_TYPE, "peek_span");                      \
+  return (TYPE *)fifo_peek_span(fifo_state, num_elements, sizeof(TYPE));     \
+}                                                                            \
+                                                                             \
+int TYPE##_fifo_pop_commit(fifo_state_t *fifo_state,                        \
+                           Longint num_elements_to_pop)                      \
+{                                                                            \
+  fifo_check_state(fifo_state, FIFO_TYPE, "pop_commit");                     \
+  fifo_check_underrun(fifo_state, num_elements_to_pop,                       \
+                      FIFO_TYPE, "pop_commit");                              \
+  fifo_state->idx_read += num_elements_to_pop;                               \
+  return 0;                                                                  \
+}                                                                            \
+                                                                             \
+TYPE *TYPE##_fifo_push_span(fifo_state_t *fifo_state, Longint *num_elements) \
+{                                                                            \
+  fifo_check_state(fifo_state, FIFO_TYPE, "push_span");                      \
+  return (TYPE *)fifo_push_span(fifo_state, num_elements, sizeof(TYPE));     \
+}                                                                            \
+                                                                             \
+int TYPE##_fifo_push_commit(fifo_state_t *fifo_state,                       \
+                            Longint num_elements_to_push)                    \
+{                                                                            \
+  fifo_check_state(fifo_state, FIFO_TYPE, "push_commit");                    \
+  fifo_check_overflow(fifo_state, num_elements_to_push,                      \
+                      FIFO_TYPE, "push_commit");                             \
+  fifo_state->idx_write += num_elements_to_push;                             \
+  return 0;                                                                  \
+}
+
+FIFO_FUNCTIONS(Shortint, SHORTINT_FIFO)
+FIFO_FUNCTIONS(Float,    FLOAT_FIFO)
+FIFO_FUNCTIONS(Char,     CHAR_FIFO)
+
 /************************************************************************/
 /************************************************************************/
 
-int Char_fifo_init(fifo_state_t *fifo_state,
-                   Longint length_fifo)
+/* number of fifo lengths by which the window buffer exceeds the history */
+/* and the fifo; the larger, the less often the buffer is compacted      */
+#define WINDOW_SPARE_FACTOR 8
+
+int Shortint_window_init(window_state_t *window_state,
+                         Longint        length_history,
+                         Longint        length_fifo)
 {
-  if (length_fifo<1)
+  if (length_fifo<1 || length_history<0)
     {
-      fprintf(stderr, "Error using Char_fifo_init; length_fifo ");
+      fprintf(stderr, "Error using Shortint_window_init; length_fifo ");
       fprintf(stderr, "must be greater than 0!\n\n");
       exit(1);
     }
-  
-  fifo_state->buffer_Char 
-    = (Char*)calloc(length_fifo, sizeof(Char));
-  
-  if (fifo_state->buffer_Char == (Char*)NULL)
+
+  window_state->size_buffer = length_history + 
+                              (1+WINDOW_SPARE_FACTOR)*length_fifo;
+  window_state->buffer = 
+    (Shortint*)calloc(window_state->size_buffer, sizeof(Shortint));
+
+  if (window_state->buffer == (Shortint*)NULL)
     {
       fprintf(stderr, 
-              "Error while allocating memory for Char_fifo_init!\n\n");
+              "Error while allocating memory for Shortint_window_init!\n\n");
       exit(1);
     }
-  
-  fifo_state->buffer_Shortint    = (Shortint*)NULL;
-  fifo_state->buffer_Float       = (Float*)NULL;
-  fifo_state->length_buffer      = length_fifo;
-  fifo_state->num_entries_actual = 0;
-  fifo_state->fifo_type          = CHAR_FIFO;
-  fifo_state->magic_number       = 12345;
+
+  window_state->length_history = length_history;
+  window_state->length_buffer  = length_fifo;
+  window_state->idx_read       = length_history;
+  window_state->idx_write      = length_history;
   return 0;
 }
 
 /************************************************************************/
 
-int Char_fifo_reset(fifo_state_t *fifo_state)
+int Shortint_window_reset(window_state_t *window_state)
 {
-  fifo_state->num_entries_actual = 0;
+  memset(window_state->buffer, 0, 
+         window_state->length_history*sizeof(Shortint));
+  window_state->idx_read  = window_state->length_history;
+  window_state->idx_write = window_state->length_history;
   return 0;
 }
 
 /************************************************************************/
 
-int Char_fifo_exit(fifo_state_t *fifo_state)
+int Shortint_window_exit(window_state_t *window_state)
 {
-  if (fifo_state->magic_number != 12345) 
-    {
-      fprintf(stderr, "Function Char_fifo_exit(): \n");
-      fprintf(stderr, "Fifo must be initialized before exit!\n\n");
-      exit(1);
-    }
-  
-  free(fifo_state->buffer_Shortint);
-  free(fifo_state->buffer_Float);
-  free(fifo_state->buffer_Char);
-  fifo_state->buffer_Shortint    = (Shortint*)NULL;
-  fifo_state->buffer_Float       = (Float*)NULL;
-  fifo_state->buffer_Char        = (Char*)NULL;
-  fifo_state->num_entries_actual = 0;
+  free(window_state->buffer);
+  window_state->buffer = (Shortint*)NULL;
   return 0;
 }
 
 /************************************************************************/
 
-int Char_fifo_push(fifo_state_t *fifo_state, 
-                       Char     *elements_to_push,
-                       Longint      num_elements_to_push)
+int Shortint_window_push(window_state_t *window_state,
+                         Shortint       *elements_to_push,
+                         Longint        num_elements_to_push)
 {
-  Longint cnt;
-  
-  if (fifo_state->magic_number != 12345) 
-    {
-      fprintf(stderr, "Function Char_fifo_push(): \n");
-      fprintf(stderr, "Fifo must be initialized before use!\n\n");
-      exit(1);
-    }
-  
-  if (fifo_state->fifo_type != CHAR_FIFO) 
-    {
-      fprintf(stderr, "Function Char_fifo_push(): \n");
-      fprintf(stderr, "Initialization was not of type CHAR_FIFO!\n\n");
-      exit(1);
-    }
+  Longint num_keep;
 
-  if (num_elements_to_push+fifo_state->num_entries_actual > 
-      fifo_state->length_buffer)
+  if (num_elements_to_push + Shortint_window_check(window_state) > 
+      window_state->length_buffer)
     {
-      fprintf(stderr, "Function Char_fifo_push(): \n");
+      fprintf(stderr, "Function Shortint_window_push(): \n");
       fprintf(stderr, "Overflow while pushing %d ", num_elements_to_push);
       fprintf(stderr, "elements into buffer (buffer size=%d)\n\n", 
-              fifo_state->length_buffer);
+              window_state->length_buffer);
       exit(1);
     }
-  
-  /* append new elements at the end of the buffer */
-  for (cnt=0; cnt<num_elements_to_push; cnt++)
-    fifo_state->buffer_Char[fifo_state->num_entries_actual+cnt] 
-      = elements_to_push[cnt];
-  fifo_state->num_entries_actual += num_elements_to_push;
+
+  /* move the history and the unpopped elements to the start of the */
+  /* buffer, if the new elements do not fit behind them any more    */
+  if (window_state->idx_write+num_elements_to_push > 
+      window_state->size_buffer)
+    {
+      num_keep = window_state->idx_write - 
+                 (window_state->idx_read - window_state->length_history);
+      memmove(window_state->buffer, 
+              window_state->buffer + window_state->idx_write - num_keep,
+              num_keep*sizeof(Shortint));
+      window_state->idx_read  = window_state->length_history;
+      window_state->idx_write = num_keep;
+    }
+
+  memcpy(window_state->buffer + window_state->idx_write, elements_to_push,
+         num_elements_to_push*sizeof(Shortint));
+  window_state->idx_write += num_elements_to_push;
   return 0;
 }
 
 /************************************************************************/
 
-int Char_fifo_pop(fifo_state_t *fifo_state, 
-                      Char     *popped_elements,
-                      Longint      num_elements_to_pop)
+Longint Shortint_window_check(window_state_t *window_state)
 {
-  Longint cnt;
-  
-  if (fifo_state->magic_number != 12345) 
-    {
-      fprintf(stderr, "Function Char_fifo_pop(): \n");
-      fprintf(stderr, "Fifo must be initialized before exit!\n\n");
-      exit(1);
-    }
-  
-  if (fifo_state->fifo_type != CHAR_FIFO) 
-    {
-      fprintf(stderr, "Function Char_fifo_push(): \n");
-      fprintf(stderr, "Initialization was not of type CHAR_FIFO!\n\n");
-      exit(1);
-    }
+  return window_state->idx_write - window_state->idx_read;
+}
 
-  if (num_elements_to_pop > fifo_state->num_entries_actual)
-    {
-      fprintf(stderr, "Function Char_fifo_pop(): \nBuffer underrun ");
-      fprintf(stderr, "while popping %d ", num_elements_to_pop);
-      fprintf(stderr, "elements; only ");
-      fprintf(stderr, "%d elements in buffer!\n\n", 
-              fifo_state->num_entries_actual);
-      exit(1);
-    }
-  
-  /* read out first (oldest) element from the buffer */
-  for (cnt=0; cnt<num_elements_to_pop; cnt++)
-    popped_elements[cnt] = fifo_state->buffer_Char[cnt];
-  
-  fifo_state->num_entries_actual -= num_elements_to_pop;
+/************************************************************************/
 
-  /* shift whole buffer to the left */
-  for (cnt=0; cnt<fifo_state->num_entries_actual; cnt++)
-    fifo_state->buffer_Char[cnt] = 
-      fifo_state->buffer_Char[cnt+num_elements_to_pop];
-  
-  return(0);
+Shortint *Shortint_window_view(window_state_t *window_state)
+{
+  return window_state->buffer + window_state->idx_read;
 }
 
 /************************************************************************/
-  
-Longint Char_fifo_check(fifo_state_t *fifo_state)
+
+int Shortint_window_pop_commit(window_state_t *window_state,
+                               Longint        num_elements_to_pop)
 {
-  if (fifo_state->magic_number != 12345) 
+  if (num_elements_to_pop > Shortint_window_check(window_state))
     {
-      fprintf(stderr, "Function Char_fifo_check(): \n");
-      fprintf(stderr, "Fifo must be initialized before use!\n\n");
+      fprintf(stderr, "Function Shortint_window_pop_commit(): \n");
+      fprintf(stderr, "Buffer underrun while popping %d ", 
+              num_elements_to_pop);
+      fprintf(stderr, "elements; only ");
+      fprintf(stderr, "%d elements in buffer!\n\n", 
+              Shortint_window_check(window_state));
       exit(1);
     }
-  
-  return(fifo_state->num_entries_actual);
+
+  window_state->idx_read += num_elements_to_pop;
+  return 0;
 }
 
@@ -46,22 +46,52 @@
 typedef enum {SHORTINT_FIFO, FLOAT_FIFO, CHAR_FIFO} fifo_type_t;
 
 
-/* fifo_state_t is the state variable type that is used for both types */
-/* of fifo structures: Shortint_fifo as well as Float_fifo.            */
+/* fifo_state_t is the state variable type that is used for all types  */
+/* of fifo structures: Shortint_fifo, Float_fifo and Char_fifo.         */
+/*                                                                      */
+/* The elements are kept in a ring of size_ring elements (a power of    */
+/* two, at least length_buffer), so that push and pop only move the     */
+/* elements concerned. idx_read and idx_write count elements and are    */
+/* reduced modulo size_ring (mask_ring) when the ring is accessed; the  */
+/* number of elements in the fifo is idx_write-idx_read. length_buffer  */
+/* still limits the number of elements that can be pushed.              */
+/*                                                                      */
+/* The type and initialization checks (magic_number, fifo_type) are     */
+/* only done if FIFO_DEBUG is defined.                                  */
 
 typedef struct
 {
-  Shortint    *buffer_Shortint;  /* buffer for Shortint_fifo_xxx()           */
-  Float       *buffer_Float;     /* buffer for Float_fifo_xxx()              */
-  Char        *buffer_Char;      /* buffer for Char_fifo_xxx()               */
+  void        *buffer;           /* the ring, size_ring elements             */
   Longint     length_buffer;     /* maximum length of the fifo buffer        */
-  Longint     num_entries_actual;/* actual number of elements in fifo        */
-  fifo_type_t fifo_type;         /* either SHORTINT_FIFO or FLOAT_FIFO       */
+  ULongint    size_ring;         /* number of elements in the ring           */
+  ULongint    mask_ring;         /* size_ring-1                              */
+  ULongint    idx_read;          /* number of elements popped so far         */
+  ULongint    idx_write;         /* number of elements pushed so far         */
+  fifo_type_t fifo_type;         /* SHORTINT_FIFO, FLOAT_FIFO or CHAR_FIFO   */
   Longint     magic_number;      /* for detecting wheter fifo is initialized */
 }
 fifo_state_t;
 
 
+/* window_state_t is a fifo for Shortint samples that also keeps the    */
+/* length_history samples popped last in front of the oldest element,  */
+/* so that a consumer can work on a sliding window over the signal      */
+/* without copying it. The samples are stored linearly in size_buffer   */
+/* elements; when the end is reached, the history and the unconsumed    */
+/* samples are moved back to the start of the buffer.                   */
+
+typedef struct
+{
+  Shortint    *buffer;           /* history and elements of the fifo         */
+  Longint     length_history;    /* number of popped elements kept           */
+  Longint     length_buffer;     /* maximum length of the fifo buffer        */
+  Longint     size_buffer;       /* number of elements in buffer             */
+  Longint     idx_read;          /* position of the oldest element           */
+  Longint     idx_write;         /* position behind the newest element       */
+}
+window_state_t;
+
+
 /*
 *******************************************************************************
 *                         DECLARATION OF PROTOTYPES
@@ -209,6 +239,93 @@ int Shortint_fifo_peek(fifo_state_t *fifo_state,
 Longint Shortint_fifo_check(fifo_state_t *fifo_state);
 
 
+/*
+*******************************************************************************
+*
+*     Function        : Shortint_fifo_peek_span
+*     Out             : num_elements            number of elements in the span
+*     In/Out          : fifo_state              state variable
+*     Calls           : <none>
+*     Tables          : <none>
+*     Compile Defines : FIFO_DEBUG
+*     Return          : pointer to the oldest element in the fifo
+*     Information     : gives direct access to the oldest elements, without
+*                       copying them. The span ends where the ring wraps
+*                       around, so *num_elements may be less than
+*                       Shortint_fifo_check(). The elements remain in the
+*                       fifo until they are removed with
+*                       Shortint_fifo_pop_commit().
+*
+*******************************************************************************
+*/
+
+Shortint *Shortint_fifo_peek_span(fifo_state_t *fifo_state,
+                                  Longint      *num_elements);
+
+
+/*
+*******************************************************************************
+*
+*     Function        : Shortint_fifo_pop_commit
+*     In              : num_elements_to_pop     number of the elements
+*     In/Out          : fifo_state              state variable
+*     Calls           : fprintf, exit
+*     Tables          : <none>
+*     Compile Defines : FIFO_DEBUG
+*     Return          : 0 on success, 1 in case of an error
+*     Information     : removes the oldest elements from the fifo, e.g.
+*                       after they have been used via Shortint_fifo_peek_span
+*
+*******************************************************************************
+*/
+
+int Shortint_fifo_pop_commit(fifo_state_t *fifo_state,
+                             Longint      num_elements_to_pop);
+
+
+/*
+*******************************************************************************
+*
+*     Function        : Shortint_fifo_push_span
+*     Out             : num_elements            number of elements in the span
+*     In/Out          : fifo_state              state variable
+*     Calls           : <none>
+*     Tables          : <none>
+*     Compile Defines : FIFO_DEBUG
+*     Return          : pointer to the free space behind the newest element
+*     Information     : gives direct access to the free space of the fifo,
+*                       so that new elements can be written in place. The
+*                       span ends where the ring wraps around or where
+*                       length_fifo would be exceeded. The elements are
+*                       added to the fifo by Shortint_fifo_push_commit().
+*
+*******************************************************************************
+*/
+
+Shortint *Shortint_fifo_push_span(fifo_state_t *fifo_state,
+                                  Longint      *num_elements);
+
+
+/*
+*******************************************************************************
+*
+*     Function        : Shortint_fifo_push_commit
+*     In              : num_elements_to_push    number of the elements
+*     In/Out          : fifo_state              state variable
+*     Calls           : fprintf, exit
+*     Tables          : <none>
+*     Compile Defines : FIFO_DEBUG
+*     Return          : 0 on success, 1 in case of an error
+*     Information     : appends elements that have been written into the
+*                       span returned by Shortint_fifo_push_span
+*
+*******************************************************************************
+*/
+
+int Shortint_fifo_push_commit(fifo_state_t *fifo_state,
+                              Longint      num_elements_to_push);
+
+
 
 
 
@@ -315,6 +432,27 @@ int Float_fifo_pop(fifo_state_t *fifo_state,
                    Longint      num_elements_to_pop);
 
 
+/*
+*******************************************************************************
+*
+*     Function        : Float_fifo_peek
+*     In              : num_elements_to_peek    number of the elements
+*     Out             : peeked_elements         vector containing the elements
+*     In/Out          : fifo_state              state variable
+*     Calls           : fprintf, exit
+*     Tables          : <none>
+*     Compile Defines : <none>
+*     Return          : 0 on success, 1 in case of an error
+*     Information     : similar to pop, but elements are remaining in buffer
+*
+*******************************************************************************
+*/
+
+int Float_fifo_peek(fifo_state_t *fifo_state, 
+                    Float        *peeked_elements,
+                    Longint      num_elements_to_peek);
+
+
 /*
 *******************************************************************************
 *
@@ -332,6 +470,21 @@ int Float_fifo_pop(fifo_state_t *fifo_state,
 Longint Float_fifo_check(fifo_state_t *fifo_state);
 
 
+/* span access as for Shortint, see Shortint_fifo_peek_span() etc. */
+
+Float *Float_fifo_peek_span(fifo_state_t *fifo_state,
+                            Longint      *num_elements);
+
+int Float_fifo_pop_commit(fifo_state_t *fifo_state,
+                          Longint      num_elements_to_pop);
+
+Float *Float_fifo_push_span(fifo_state_t *fifo_state,
+                            Longint      *num_elements);
+
+int Float_fifo_push_commit(fifo_state_t *fifo_state,
+                           Longint      num_elements_to_push);
+
+
 
 /***********************************************************************/
 /* Now the same functions for type Char                                */
@@ -352,6 +505,84 @@ int Char_fifo_pop(fifo_state_t *fifo_state,
                   Char         *popped_elements,
                   Longint       num_elements_to_pop);
 
+int Char_fifo_peek(fifo_state_t *fifo_state, 
+                   Char         *peeked_elements,
+                   Longint       num_elements_to_peek);
+
 Longint Char_fifo_check(fifo_state_t *fifo_state);
 
+Char *Char_fifo_peek_span(fifo_state_t *fifo_state,
+                          Longint      *num_elements);
+
+int Char_fifo_pop_commit(fifo_state_t *fifo_state,
+                         Longint      num_elements_to_pop);
+
+Char *Char_fifo_push_span(fifo_state_t *fifo_state,
+                          Longint      *num_elements);
+
+int Char_fifo_push_commit(fifo_state_t *fifo_state,
+                          Longint      num_elements_to_push);
+
+
+/***********************************************************************/
+/* Sliding window over Shortint samples, see window_state_t            */
+/***********************************************************************/
+
+/*
+*******************************************************************************
+*
+*     Function        : Shortint_window_init
+*     In              : length_history  number of popped elements to keep
+*                       length_fifo     maximum number of elements
+*     Out             : window_state    initialized state variable
+*     Calls           : calloc, fprintf, exit
+*     Tables          : <none>
+*     Compile Defines : <none>
+*     Return          : 0 on success, 1 in case of an error
+*     Information     : initialization of a window; the history is set to
+*                       zeros
+*
+*******************************************************************************
+*/
+
+int Shortint_window_init(window_state_t *window_state,
+                         Longint        length_history,
+                         Longint        length_fifo);
+
+/* removes all elements and clears the history */
+int Shortint_window_reset(window_state_t *window_state);
+
+int Shortint_window_exit(window_state_t *window_state);
+
+/* appends elements, as Shortint_fifo_push() */
+int Shortint_window_push(window_state_t *window_state,
+                         Shortint       *elements_to_push,
+                         Longint        num_elements_to_push);
+
+/* number of elements that have not been popped yet */
+Longint Shortint_window_check(window_state_t *window_state);
+
+/*
+*******************************************************************************
+*
+*     Function        : Shortint_window_view
+*     In/Out          : window_state            state variable
+*     Calls           : <none>
+*     Tables          : <none>
+*     Compile Defines : <none>
+*     Return          : pointer to the oldest element in the window
+*     Information     : the elements ptr[0] ... ptr[check-1] are the ones
+*                       in the fifo, ptr[-length_history] ... ptr[-1] the
+*                       ones that were popped last. The pointer is valid
+*                       until the next push.
+*
+*******************************************************************************
+*/
+
+Shortint *Shortint_window_view(window_state_t *window_state);
+
+/* removes the oldest elements, which become the most recent history */
+int Shortint_window_pop_commit(window_state_t *window_state,
+                               Longint        num_elements_to_pop);
+
 #endif
@@ -18,12 +18,55 @@
 #include "typedefs.h"
 #include "init_interleaver.h"
 #include "m_sequence.h"
+#include "ctm_defines.h"
 
 #include <stdio.h>    
 #include <stdlib.h>
 
 const char init_interleaver_id[] = "@(#)$Id: $" init_interleaver_h;
 
+/*
+*******************************************************************************
+*                         CONSTANT TABLES
+*******************************************************************************
+*/
+
+static const Shortint scramble_sequence[] 
+  = {-1, 1, -1, -1, 1, 1, 
+     -1,-1,-1, 1,1,1, -1,-1,-1,-1, 1,1,1,1,-1,-1,-1,-1,-1,1,1,1,1,1};
+
+/* Positions of the sync bits of the interleaver of ctm_defines.h, as    */
+/* calculated by init_interleaver(): first the num_sync_lines2*B         */
+/* additional bits, then the dummy bits D*B*i + B*j + k for 0<=i<B-1,    */
+/* 0<=j<D and i<k<B, offset by the additional bits. The sync bits are    */
+/* the first elements of m_sequence_63.                                  */
+#if intlvB==8 && intlvD==2 && deintSyncLns==0
+#define NUM_SYNC_BITS 56
+static const Shortint sync_index_vec[NUM_SYNC_BITS] = {
+    1,   2,   3,   4,   5,   6,   7,   9,  10,  11,  12,  13,  14,  15,
+   18,  19,  20,  21,  22,  23,  26,  27,  28,  29,  30,  31,  35,  36,
+   37,  38,  39,  43,  44,  45,  46,  47,  52,  53,  54,  55,  60,  61,
+   62,  63,  69,  70,  71,  77,  78,  79,  86,  87,  94,  95, 103, 111 };
+#endif
+
+/*
+*******************************************************************************
+*                         PRIVATE PROGRAM CODE
+*******************************************************************************
+*/
+
+/* The scrambling sequence of length B, see generate_scrambling_sequence() */
+static const Shortint *scrambling_sequence(Shortint length)
+{
+  if ((length > 30) || (length < 1))
+    {
+      fprintf(stderr, "Error in generate_scrambling_sequence():\n");
+      fprintf(stderr, "No lengths > 30 supported yet!\n");
+      exit(1);
+    }
+  return scramble_sequence;
+}
+
 
 /*
 *******************************************************************************
@@ -39,10 +82,11 @@ void init_interleaver(interleaver_state_t *intl_state,
   
   Shortint cnt, num_dummy_bits, num_add_bits, num_avail_bits, seq_length;
   Shortint i,j,k;
+  Shortint *new_sequence, *new_index_vec;
       
   intl_state->B = B;
   intl_state->D = D;
-  intl_state->scramble_vec = (Shortint*)calloc(B, sizeof(Shortint));
+  intl_state->scramble_vec = scrambling_sequence(B);
   intl_state->vector 
     = (Shortint*)calloc((num_sync_lines1+num_sync_lines2+B)*B*D, 
                         sizeof(Shortint));
@@ -52,8 +96,6 @@ void init_interleaver(interleaver_state_t *intl_state,
   intl_state->num_sync_lines1 = num_sync_lines1;
   intl_state->num_sync_lines2 = num_sync_lines2;
   
-  generate_scrambling_sequence(intl_state->scramble_vec, B);
-  
   /* fill in the sync bits for the synchronization of the demodulator */
   
   for (cnt=0; cnt<num_sync_lines1*B; cnt++)
@@ -67,48 +109,62 @@ void init_interleaver(interleaver_state_t *intl_state,
   num_avail_bits  = num_dummy_bits+num_add_bits;
   
   intl_state->num_sync_bits = num_avail_bits;
-  
-  /* Determine the next value (2^n)-1 that is */
-  /* greater or equal to num_avail_bits        */
-  seq_length = 0;
-  for (cnt=2; cnt<10; cnt++)
-    if ((1<<cnt)-1 >=num_avail_bits)
-      {
-        seq_length = (1<<cnt)-1;
-        break;
-      }
-  
-  /* Calculate the m-sequence of the according length */
+  intl_state->sync_tables   = (Shortint*)NULL;
 
-  intl_state->sequence = (Shortint*)calloc(seq_length,sizeof(Shortint));
-  if (intl_state->sequence==(Shortint*)NULL)
+#ifdef NUM_SYNC_BITS
+  if (B==intlvB && D==intlvD && num_sync_lines2==deintSyncLns)
     {
-      fprintf(stderr,"Error while allocating memory for m-sequence\n");
-      exit(1);
+      /* the interleaver of ctm_defines.h: the tables are constant */
+      intl_state->sequence       = m_sequence_63;
+      intl_state->sync_index_vec = sync_index_vec;
     }
-  m_sequence(intl_state->sequence, seq_length);
-  
-  /* set-up a vector pointing to the bit positions that can be used for */
-  /* storing the sync bits                                              */
-  
-  intl_state->sync_index_vec
-    = (Shortint*)calloc(num_avail_bits, sizeof(Shortint));
-  
-  /* at first, the additional bits */
-
-  for (cnt=0; cnt<num_add_bits; cnt++)
-    intl_state->sync_index_vec[cnt] = cnt;
-  
-  /* now calculate the position of the interleaver's dummy bits */
-  cnt = num_add_bits;
-  
-  for (i=0; i<B-1; i++)
-    for (j=0; j<D; j++)
-      for (k=i+1; k<B; k++)
+  else
+#endif
+    {
+      /* Determine the next value (2^n)-1 that is */
+      /* greater or equal to num_avail_bits        */
+      seq_length = 0;
+      for (cnt=2; cnt<10; cnt++)
+        if ((1<<cnt)-1 >=num_avail_bits)
+          {
+            seq_length = (1<<cnt)-1;
+            break;
+          }
+      
+      /* Allocate the m-sequence of the according length and a vector  */
+      /* pointing to the bit positions that can be used for storing    */
+      /* the sync bits                                                 */
+      
+      intl_state->sync_tables
+        = (Shortint*)calloc(seq_length+num_avail_bits, sizeof(Shortint));
+      if (intl_state->sync_tables==(Shortint*)NULL)
         {
-          intl_state->sync_index_vec[cnt] = num_add_bits + D*B*i + B*j + k;
-          cnt++;
+          fprintf(stderr,"Error while allocating memory for m-sequence\n");
+          exit(1);
         }
+      new_sequence  = intl_state->sync_tables;
+      new_index_vec = intl_state->sync_tables+seq_length;
+      m_sequence(new_sequence, seq_length);
+      
+      /* at first, the additional bits */
+      
+      for (cnt=0; cnt<num_add_bits; cnt++)
+        new_index_vec[cnt] = cnt;
+      
+      /* now calculate the position of the interleaver's dummy bits */
+      cnt = num_add_bits;
+      
+      for (i=0; i<B-1; i++)
+        for (j=0; j<D; j++)
+          for (k=i+1; k<B; k++)
+            {
+              new_index_vec[cnt] = num_add_bits + D*B*i + B*j + k;
+              cnt++;
+            }
+      
+      intl_state->sequence       = new_sequence;
+      intl_state->sync_index_vec = new_index_vec;
+    }
 
   /* now fill all sync bits with the m_sequence */
 
@@ -146,16 +202,24 @@ void reinit_interleaver(interleaver_state_t *intl_state)
 
 
 
+void exit_interleaver(interleaver_state_t *intl_state)
+{
+  free(intl_state->vector);
+  free(intl_state->sync_tables);
+}
+
+
+
+
 void init_deinterleaver(interleaver_state_t *intl_state, 
                        Shortint B, Shortint D)
 {
   intl_state->B = B;
   intl_state->D = D;
-  intl_state->scramble_vec = (Shortint*)calloc(B, sizeof(Shortint));
+  intl_state->scramble_vec = scrambling_sequence(B);
   intl_state->vector = (Shortint*)calloc(B*B*D, sizeof(Shortint));
   intl_state->clmn = 0;
-
-  generate_scrambling_sequence(intl_state->scramble_vec, B);
+  intl_state->sync_tables = (Shortint*)NULL;
 }
 
 
@@ -165,6 +229,12 @@ void reinit_deinterleaver(interleaver_state_t *intl_state)
 }
 
 
+void exit_deinterleaver(interleaver_state_t *intl_state)
+{
+  free(intl_state->vector);
+}
+
+
 void calc_mute_positions(Shortint *mute_positions, 
                          Shortint num_rows_to_mute,
                          Shortint start_position,
@@ -202,18 +272,9 @@ Bool mutingRequired(Shortint  actualIndex,
 
 void generate_scrambling_sequence(Shortint *sequence, Shortint length)
 {
-  static const Shortint scramble_sequence[] 
-    = {-1, 1, -1, -1, 1, 1, 
-       -1,-1,-1, 1,1,1, -1,-1,-1,-1, 1,1,1,1,-1,-1,-1,-1,-1,1,1,1,1,1};
+  const Shortint *scramble_vec = scrambling_sequence(length);
   Shortint cnt;
   
-  if ((length > 30) || (length < 1))
-    {
-      fprintf(stderr, "Error in generate_scrambling_sequence():\n");
-      fprintf(stderr, "No lengths > 30 supported yet!\n");
-      exit(1);
-    }
-  
   for (cnt=0; cnt<length; cnt++)
-    sequence[cnt] = scramble_sequence[cnt];
+    sequence[cnt] = scramble_vec[cnt];
 }
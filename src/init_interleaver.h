@@ -42,10 +42,13 @@ typedef struct {
   Shortint num_sync_lines1;/* number of preceding lines in the interl. matrix*/
   Shortint num_sync_lines2;/* number of preceding lines in the interl. matrix*/
   Shortint num_sync_bits;  /* number of sync bits (demodulator sync)         */
-  Shortint *sync_index_vec;/* indices of the bits for deintl. synchronization*/
-  Shortint *scramble_vec;  /* sequence for scrambling                        */
-  Shortint *sequence;      /* m-sequence for synchronisation                 */
-  
+  const Shortint *sync_index_vec; /* indices of the bits for deintl. sync.   */
+  const Shortint *scramble_vec;   /* sequence for scrambling                 */
+  const Shortint *sequence;       /* m-sequence for synchronisation          */
+  Shortint *sync_tables;   /* memory of sync_index_vec and sequence, if they */
+                           /* are not the constant tables of the interleaver */
+                           /* of ctm_defines.h, or NULL                      */
+
 } interleaver_state_t;
 
 
@@ -111,12 +114,21 @@ void init_interleaver(interleaver_state_t *intl_state,
 
 void reinit_interleaver(interleaver_state_t *intl_state);
 
+/* --------------------------------------------------------------------- */
+/* exit_interleaver:                                                     */
+/* Releases the buffers that have been allocated by init_interleaver().  */
+/* --------------------------------------------------------------------- */
+
+void exit_interleaver(interleaver_state_t *intl_state);
+
 
 void init_deinterleaver(interleaver_state_t *intl_state, 
                         Shortint B, Shortint D);
 
 void reinit_deinterleaver(interleaver_state_t *intl_state);
 
+void exit_deinterleaver(interleaver_state_t *intl_state);
+
 /* --------------------------------------------------------------------- */
 /* calc_mute_positions:                                                  */
 /* Calculation of the indices of the bits that have to be muted within   */
@@ -5,135 +5,247 @@
 #include <err.h>
 #include <unistd.h>
 
-#ifdef __OpenBSD__
-#include <sys/types.h>
-#include <sndio.h>
-#endif
-
 #include <ctype.h>
 #include <termios.h>
 
 #include "ctm.h"
+#include "compat.h"
 #include "ctm_defines.h"
 #include "ctm_transmitter.h"
 #include "ctm_receiver.h"
 #include "baudot_functions.h"
+#include "baudot_float.h"
 #include "ucs_functions.h"
 #include <typedefs.h>
 #include <fifo.h>
 
-static Shortint ttyCode;
-static char character;
-static UShortint ucsCode;
-static Shortint cnt;
-
 /* function prototypes */
-static void layer2_process_ctm_in(struct ctm_state *);
-static void layer2_process_ctm_out(struct ctm_state *);
-void layer2_process_user_input(struct ctm_state *);
+void layer2_process_ctm_in(struct ctm_state *);
+void layer2_process_ctm_out(struct ctm_state *);
+Bool layer2_process_user_input(struct ctm_state *);
 void layer2_process_user_output(struct ctm_state *);
-void layer2_process_ctm_audio_in(struct ctm_state *);
+Bool layer2_read_baudot_input(struct ctm_state *);
+void layer2_process_baudot_in(struct ctm_state *);
+void layer2_process_baudot_codes(struct ctm_state *);
+void layer2_process_text_in(struct ctm_state *, char);
+Bool layer2_generate_user_output(struct ctm_state *);
 void layer2_process_ctm_audio_in(struct ctm_state *);
 void layer2_process_ctm_audio_out(struct ctm_state *);
-void layer2_process_ctm_file_input(struct ctm_state *);
+Bool layer2_read_ctm_file_input(struct ctm_state *);
+Bool layer2_process_ctm_file_input(struct ctm_state *);
 void layer2_process_ctm_file_output(struct ctm_state *);
-static void layer2_process_ctm_out(struct ctm_state *);
+void layer2_process_text_flush(struct ctm_state *);
+void layer2_flush_text(struct ctm_state *);
 
-void layer2_process_user_input(struct ctm_state *state)
+/* Both file input functions return true if only a part of the next */
+/* frame has been received, i.e. nothing could be processed.         */
+Bool layer2_process_user_input(struct ctm_state *state)
 {
+  int      num;
+
   if (state->baudotReadFromFile)
   {
+    if (state->userInputReadAhead)
+    {
+      /* read and demodulated by ctm_session_process_multi() */
+      state->userInputReadAhead = false;
+      if (state->userInputIncomplete)
+        return true;
+      layer2_process_baudot_codes(state);
+    }
     /* if the baudot out FIFO isn't already full, grab more samples. */
-    if (Shortint_fifo_check(&(state->baudotOutTTYCodeFifoState)) < state->baudotOutTTYCodeFifoLength) {
-      if(read(state->userInputFileFp, state->baudot_input_buffer, state->audio_buffer_size) < state->audio_buffer_size)
-      {
-        /* if EOF is reached, use buffer with zeros instead */
-        state->baudotEOF = true;
-        for (cnt=0; cnt<LENGTH_TONE_VEC; cnt++)
-          state->baudot_input_buffer[cnt]=0;
-      }
-
-#ifdef LSBFIRST
-      if (state->compat_mode)
-      {
-        /* The test pattern baudot PCM files are in big-endian. If we are on a little-endian machine, we will need to swap the bytes */
-        for (cnt=0; cnt<LENGTH_TONE_VEC; cnt++)
-        {
-          state->baudot_input_buffer[cnt] = swap16(state->baudot_input_buffer[cnt]);
-        }
-      }
-#endif
-
-      /* Run the Baudot demodulator */
-      baudot_tonedemod(state->baudot_input_buffer, LENGTH_TONE_VEC, 
-          &(state->baudotOutTTYCodeFifoState), &(state->baudot_tonedemod_state));
-      /* Adjust the Mode of the modulator according to the demodulator */
-      state->baudot_tonemod_state.inFigureMode = state->baudot_tonedemod_state.inFigureMode;
-
-      /* Set flag indicating that the demodulator has already */
-      /* decoded a Baudot character.                          */ 
-      if(Shortint_fifo_check(&(state->baudotOutTTYCodeFifoState))>0)
-        state->baudotAlreadyReceived = true;
-
-      /* Determine wheter the demodulator has detected that a Baudot */
-      /* character is actually received. This decision must be made  */
-      /* before the complete character has been received so that the */
-      /* original audio signal can be muted before a successive      */
-      /* Baudot detector is able to decode this character. We        */
-      /* make this decision after receiving the start bit and the    */
-      /* five information bits completely. However, for the          */
-      /* first character, we postulate additionally, that at least   */
-      /* one information bit is +1 (1400 Hz). Since the start bit    */
-      /* is always zero, this decision rule requires a transition    */
-      /* from 1800 Hz to 1400 Hz, which reduces the danger of false  */
-      /* alarms for pure voice calls. Since every Baudot             */
-      /* transmission shall start with a SHIFT symbol, this          */
-      /* assumption (at least one bit has to be +1) is fulfilled     */
-      /* for every Baudot transmission.                              */
-
-      //fprintf(stderr, "%d,", baudot_tonedemod_state.cntBitsActualChar);
-
-      if (state->baudot_tonedemod_state.cntBitsActualChar>=5)
-      {
-        if (state->baudotAlreadyReceived)
-          state->actualBaudotCharDetected = true;
-        else
-          state->actualBaudotCharDetected = (state->baudot_tonedemod_state.ttyCode>0);
-      }
-      else
-        state->actualBaudotCharDetected = false;
-
-      /* The next lines guarantee that the Baudot signal is muted even */
-      /* if the received character is a SHIFT symbol (a SHIFT symbol   */
-      /* would not set the CTM transmitter into an active state).      */ 
-      if (state->cntHangoverFramesForMuteBaudot>0) 
-        state->cntHangoverFramesForMuteBaudot--;
-      if (state->actualBaudotCharDetected)
-        state->cntHangoverFramesForMuteBaudot = 1+(320/LENGTH_TONE_VEC);
+    else if (Shortint_fifo_check(&(state->baudotOutTTYCodeFifoState)) < state->baudotOutTTYCodeFifoLength) {
+      if (layer2_read_baudot_input(state))
+        return true; /* frame not complete yet */
+      layer2_process_baudot_in(state);
     }
   }
 
   else {
-    /* otherwise we are reading text input */
-    if (Shortint_fifo_check(&(state->baudotOutTTYCodeFifoState)) < state->baudotOutTTYCodeFifoLength)
+    /* otherwise we are reading text input: take as many characters as */
+    /* the FIFO accepts. Only the first one may cost a read(), the     */
+    /* others are taken while the reader still has them buffered.      */
+    while (Shortint_fifo_check(&(state->baudotOutTTYCodeFifoState)) < state->baudotOutTTYCodeFifoLength)
     {
-
-      if (read(state->userInputFileFp, &character, 1) < 1)
+      num = bufio_read(&(state->userInputReader), &(state->character));
+      if (num == 0)
       {
         /* reuse baudot EOF flag to tell the program no more input */
         state->baudotEOF = true;
-
-      }
-      else {
-        ttyCode = convertChar2ttyCode(character);
-        Shortint_fifo_push(&(state->baudotOutTTYCodeFifoState), &ttyCode, 1);
+        break;
       }
+      else if (num < 0)
+        break;
+
+      layer2_process_text_in(state, state->character);
+      if (!bufio_ready(&(state->userInputReader)))
+        break;
     }
   }
+
+  return false;
 } 
 
-void layer2_process_user_output(struct ctm_state *state)
+/* Reads a frame of the Baudot input file into baudot_input_buffer. */
+/* Returns true if only a part of the frame has arrived.              */
+Bool layer2_read_baudot_input(struct ctm_state *state)
+{
+  Shortint cnt;
+  int      num;
+
+  num = bufio_read(&(state->userInputReader), state->baudot_input_ext_buffer);
+  if (num < 0)
+    return true; /* frame not complete yet */
+  if (num < state->audio_buffer_size)
+  {
+    /* if EOF is reached, use the rest of the file, padded with zeros */
+    state->baudotEOF = true;
+  }
+
+#ifdef LSBFIRST
+  if (state->compat_mode)
+  {
+    /* The test pattern baudot PCM files are in big-endian. If we are on a little-endian machine, we will need to swap the bytes */
+    for (cnt=0; cnt<state->audio_frame_len; cnt++)
+    {
+      state->baudot_input_ext_buffer[cnt] = swap16(state->baudot_input_ext_buffer[cnt]);
+    }
+  }
+#endif
+
+  if (state->rateFactor > 1)
+    resample_down(&(state->baudotInResampler), state->baudot_input_ext_buffer,
+        state->baudot_input_buffer, LENGTH_TONE_VEC);
+  return false;
+}
+
+/* Runs the Baudot demodulator on the LENGTH_TONE_VEC samples in */
+/* baudot_input_buffer.                                          */
+void layer2_process_baudot_in(struct ctm_state *state)
+{
+  /* Run the Baudot demodulator */
+  if (state->floatDemod)
+    baudot_tonedemod_float(state->baudot_input_buffer, LENGTH_TONE_VEC, 
+        &(state->baudotOutTTYCodeFifoState), &(state->baudot_tonedemod_state));
+  else
+    baudot_tonedemod(state->baudot_input_buffer, LENGTH_TONE_VEC, 
+        &(state->baudotOutTTYCodeFifoState), &(state->baudot_tonedemod_state));
+  layer2_process_baudot_codes(state);
+}
+
+/* Takes over what the Baudot demodulator has detected in the last */
+/* frame.                                                           */
+void layer2_process_baudot_codes(struct ctm_state *state)
+{
+  /* Adjust the Mode of the modulator according to the demodulator */
+  state->baudot_tonemod_state.inFigureMode = state->baudot_tonedemod_state.inFigureMode;
+
+  /* Set flag indicating that the demodulator has already */
+  /* decoded a Baudot character.                          */ 
+  if(Shortint_fifo_check(&(state->baudotOutTTYCodeFifoState))>0)
+    state->baudotAlreadyReceived = true;
+
+  /* Determine wheter the demodulator has detected that a Baudot */
+  /* character is actually received. This decision must be made  */
+  /* before the complete character has been received so that the */
+  /* original audio signal can be muted before a successive      */
+  /* Baudot detector is able to decode this character. We        */
+  /* make this decision after receiving the start bit and the    */
+  /* five information bits completely. However, for the          */
+  /* first character, we postulate additionally, that at least   */
+  /* one information bit is +1 (1400 Hz). Since the start bit    */
+  /* is always zero, this decision rule requires a transition    */
+  /* from 1800 Hz to 1400 Hz, which reduces the danger of false  */
+  /* alarms for pure voice calls. Since every Baudot             */
+  /* transmission shall start with a SHIFT symbol, this          */
+  /* assumption (at least one bit has to be +1) is fulfilled     */
+  /* for every Baudot transmission.                              */
+
+  //fprintf(stderr, "%d,", baudot_tonedemod_state.cntBitsActualChar);
+
+  if (state->baudot_tonedemod_state.cntBitsActualChar>=5)
+  {
+    if (state->baudotAlreadyReceived)
+      state->actualBaudotCharDetected = true;
+    else
+      state->actualBaudotCharDetected = (state->baudot_tonedemod_state.ttyCode>0);
+  }
+  else
+    state->actualBaudotCharDetected = false;
+
+  /* The next lines guarantee that the Baudot signal is muted even */
+  /* if the received character is a SHIFT symbol (a SHIFT symbol   */
+  /* would not set the CTM transmitter into an active state).      */ 
+  if (state->cntHangoverFramesForMuteBaudot>0) 
+    state->cntHangoverFramesForMuteBaudot--;
+  if (state->actualBaudotCharDetected)
+    state->cntHangoverFramesForMuteBaudot = 1+(320/LENGTH_TONE_VEC);
+}
+
+/* Stores an event in the event log of the session, see ctm_event.h. */
+static void layer2_log_event(struct ctm_state *state, enum ctm_event_type type, UShortint payload)
+{
+  ctm_event_put(&(state->events), type, state->sessionId,
+                state->cntProcessedSamples, payload);
+}
+
+/* Buffers one character of text output. */
+static void layer2_put_text(struct ctm_state *state, char character)
+{
+  /* the delay of the flush policy runs from the oldest waiting byte */
+  if (bufio_pending(&(state->userOutputWriter)) == 0)
+    state->textPendingSince = state->cntProcessedSamples;
+
+  bufio_write(&(state->userOutputWriter), &character, 1);
+}
+
+/* Writes out the buffered text output. */
+void layer2_flush_text(struct ctm_state *state)
 {
+  if (!state->baudotWriteToFile)
+    bufio_flush(&(state->userOutputWriter));
+}
+
+/* Applies the flush policy of the text output once per frame, see */
+/* ctm_session_set_text_flush(). A burst ends when the transmitter  */
+/* goes idle, or the receiver loses the synchronization.            */
+void layer2_process_text_flush(struct ctm_state *state)
+{
+  Bool   burstActive;
+  size_t num_bytes;
+
+  burstActive = state->tx_state.burstActive || state->rx_state.wait_state.sync_found;
+  num_bytes   = state->baudotWriteToFile ? 0 : bufio_pending(&(state->userOutputWriter));
+
+  /* a blocked output is written again on POLLOUT */
+  if (bufio_blocked(&(state->userOutputWriter)))
+    num_bytes = 0;
+
+  if (num_bytes > 0 &&
+      ((num_bytes >= state->textFlushThreshold) ||
+       (state->textBurstActive && !burstActive) ||
+       (state->textFlushDelay > 0 &&
+        state->cntProcessedSamples - state->textPendingSince >= state->textFlushDelay)))
+    layer2_flush_text(state);
+
+  state->textBurstActive = burstActive;
+}
+
+/* Pushes one character of text input towards the CTM transmitter. */
+void layer2_process_text_in(struct ctm_state *state, char character)
+{
+  state->ttyCode = convertChar2ttyCode(character);
+  Shortint_fifo_push(&(state->baudotOutTTYCodeFifoState), &(state->ttyCode), 1);
+}
+
+/* Runs the Baudot modulator (or the bypass) for one frame into     */
+/* baudot_output_buffer. In text mode, returns true if a character   */
+/* for the user has been popped; it is left in state->character.     */
+Bool layer2_generate_user_output(struct ctm_state *state)
+{
+  Shortint cnt;
+  Bool     charAvailable = false;
+
   /* If there are characters from the CTM receiver, or if the CTM     */
   /* receiver has detected a synchronisation preamble, or if the      */
   /* Baudot Modulator is still busy (i.e. there are still bits to     */
@@ -149,12 +261,12 @@ void layer2_process_user_output(struct ctm_state *state)
     if ((Shortint_fifo_check(&(state->ctmToBaudotFifoState)) >0) &&
         (((state->numBaudotBitsStillToModulate <= 8) &&
           (state->cntFramesSinceLastBypassFromCTM>=10*160/LENGTH_TONE_VEC)) || state->writeToTextFile))
-      Shortint_fifo_pop(&state->ctmToBaudotFifoState, &ttyCode, 1);
+      Shortint_fifo_pop(&state->ctmToBaudotFifoState, &(state->ttyCode), 1);
     else
-      ttyCode = -1;
+      state->ttyCode = -1;
 
     if (state->baudotWriteToFile) {
-      baudot_tonemod(ttyCode, state->baudot_output_buffer, LENGTH_TONE_VEC,
+      baudot_tonemod(state->ttyCode, state->baudot_output_buffer, LENGTH_TONE_VEC,
           &(state->numBaudotBitsStillToModulate),
           &(state->baudot_tonemod_state));
       /* Adjust the Mode of the demodulator according to the modulator */
@@ -164,10 +276,9 @@ void layer2_process_user_output(struct ctm_state *state)
       if (state->cntFramesSinceLastBypassFromCTM<maxShortint)
         state->cntFramesSinceLastBypassFromCTM++;
     }
-    else if (ttyCode != - 1) {
-      character = convertTTYcode2char(ttyCode);
-      if (write(state->userOutputFileFp, &character, 1) == -1)
-        errx(1, "error writing to text output file, file descriptor %d.", state->userOutputFileFp);
+    else if (state->ttyCode != - 1) {
+      state->character = convertTTYcode2char(state->ttyCode);
+      charAvailable = true;
     }
   }
   else
@@ -184,29 +295,62 @@ void layer2_process_user_output(struct ctm_state *state)
     state->cntFramesSinceLastBypassFromCTM = 0;
   }
 
+  return charAvailable;
+}
+
+void layer2_process_user_output(struct ctm_state *state)
+{
+  Shortint cnt;
+
+  if (layer2_generate_user_output(state))
+    layer2_put_text(state, state->character);
+
   /* decide which user output we are and write it. */
   if(state->baudotWriteToFile) {
+    if (state->rateFactor > 1)
+      resample_up(&(state->baudotOutResampler), state->baudot_output_buffer,
+          state->baudot_output_ext_buffer, LENGTH_TONE_VEC);
 #ifdef LSBFIRST
     if (state->compat_mode)
     {
       /* The test pattern baudot PCM files are in big-endian. If we are on a little-endian machine, we will need to swap the bytes */
-      for (cnt=0; cnt<LENGTH_TONE_VEC; cnt++)
+      for (cnt=0; cnt<state->audio_frame_len; cnt++)
       {
-        state->baudot_output_buffer[cnt] = swap16(state->baudot_output_buffer[cnt]);
+        state->baudot_output_ext_buffer[cnt] = swap16(state->baudot_output_ext_buffer[cnt]);
       }
     }
 #endif
-    if (write(state->userOutputFileFp, state->baudot_output_buffer, state->audio_buffer_size) == -1)
-      errx(1, "error writing to baudot output file.");
+    bufio_write(&(state->userOutputWriter), state->baudot_output_ext_buffer, state->audio_buffer_size);
   }
 }
 
 void layer2_process_ctm_audio_in(struct ctm_state *state)
 {
-  if (sio_read(state->audio_hdl, state->ctm_input_buffer, state->audio_buffer_size) < state->audio_buffer_size) {
-    warnx("underrun in audio input from device.");
+  Shortint cnt;
+  int      num;
+
+  if (state->ctmEOF)
+    return;
+
+  num = ctm_audio_read(state->audio, state->ctm_input_ext_buffer, state->audio_frame_len);
+  if (num < 0)
+  {
+    /* end of the audio input, use a buffer with zeros instead */
+    state->ctmEOF = true;
+    num = 0;
   }
+  else if (num < state->audio_frame_len)
+    warnx("underrun in audio input from device.");
 
+  for (cnt=num; cnt<state->audio_frame_len; cnt++)
+    state->ctm_input_ext_buffer[cnt] = 0;
+
+  if (state->rateFactor > 1)
+    resample_down(&(state->ctmInResampler), state->ctm_input_ext_buffer,
+        state->ctm_input_buffer, LENGTH_TONE_VEC);
+
+  Shortint_window_push(&(state->signalWindowState), state->ctm_input_buffer,
+      LENGTH_TONE_VEC);
   layer2_process_ctm_in(state);
 }
 
@@ -214,65 +358,99 @@ void layer2_process_ctm_audio_out(struct ctm_state *state)
 {
   layer2_process_ctm_out(state);
 
-  if (sio_write(state->audio_hdl, state->ctm_output_buffer, state->audio_buffer_size) < state->audio_buffer_size) {
+  if (state->rateFactor > 1)
+    resample_up(&(state->ctmOutResampler), state->ctm_output_buffer,
+        state->ctm_output_ext_buffer, LENGTH_TONE_VEC);
+
+  if (ctm_audio_write(state->audio, state->ctm_output_ext_buffer, state->audio_frame_len) < state->audio_frame_len) {
     warnx("overrun in audio output to device.");
   }
 }
 
-void layer2_process_ctm_file_input(struct ctm_state *state)
+/* Reads a frame of the CTM input file into the signal window of the */
+/* receiver. Returns true if only a part of the frame has arrived.    */
+Bool layer2_read_ctm_file_input(struct ctm_state *state)
 {
-  if (!state->ctmEOF)
+  Shortint cnt;
+  int      num;
+
+  num = bufio_read(&(state->ctmInputReader), state->ctm_input_ext_buffer);
+  if (num < 0)
+    return true; /* frame not complete yet */
+  if (num < state->audio_buffer_size)
   {
-    if(read(state->ctmInputFileFp, state->ctm_input_buffer, state->audio_buffer_size) < state->audio_buffer_size) 
-    {
-      /* if EOF is reached, use buffer with zeros instead */
-      state->ctmEOF = true;
-      for (cnt=0; cnt<LENGTH_TONE_VEC; cnt++)
-        state->ctm_input_buffer[cnt]=0;
-    }
+    /* if EOF is reached, use the rest of the file, padded with zeros */
+    state->ctmEOF = true;
+  }
 
 #ifdef LSBFIRST
-    if (state->compat_mode)
+  if (state->compat_mode)
+  {
+    /* The test pattern baudot PCM files are in big-endian. If we are on a little-endian machine, we will need to swap the bytes */
+    for (cnt=0; cnt<state->audio_frame_len; cnt++)
     {
-      /* The test pattern baudot PCM files are in big-endian. If we are on a little-endian machine, we will need to swap the bytes */
-      for (cnt=0; cnt<LENGTH_TONE_VEC; cnt++)
-      {
-        state->ctm_input_buffer[cnt] = swap16(state->ctm_input_buffer[cnt]);
-      }
+      state->ctm_input_ext_buffer[cnt] = swap16(state->ctm_input_ext_buffer[cnt]);
     }
+  }
 #endif
 
-    layer2_process_ctm_in(state);
+  if (state->rateFactor > 1)
+    resample_down(&(state->ctmInResampler), state->ctm_input_ext_buffer,
+        state->ctm_input_buffer, LENGTH_TONE_VEC);
+
+  Shortint_window_push(&(state->signalWindowState), state->ctm_input_buffer,
+      LENGTH_TONE_VEC);
+  return false;
+}
+
+Bool layer2_process_ctm_file_input(struct ctm_state *state)
+{
+  if (state->ctmInputReadAhead)
+  {
+    /* read by ctm_session_process_multi() */
+    state->ctmInputReadAhead = false;
+    if (state->ctmInputIncomplete)
+      return true;
   }
+  else if (state->ctmEOF)
+    return false;
+  else if (layer2_read_ctm_file_input(state))
+    return true; /* frame not complete yet */
+
+  layer2_process_ctm_in(state);
+  return false;
 }
 
 void layer2_process_ctm_file_output(struct ctm_state *state)
 {
+  Shortint cnt;
+
   layer2_process_ctm_out(state);
 
+  if (state->rateFactor > 1)
+    resample_up(&(state->ctmOutResampler), state->ctm_output_buffer,
+        state->ctm_output_ext_buffer, LENGTH_TONE_VEC);
+
 #ifdef LSBFIRST
   /* The test pattern baudot PCM files are in big-endian. If we are on a little-endian machine, we will need to swap the bytes */
   if (state->compat_mode)
   {
-    for (cnt=0; cnt<LENGTH_TONE_VEC; cnt++)
+    for (cnt=0; cnt<state->audio_frame_len; cnt++)
     {
-      state->ctm_output_buffer[cnt] = swap16(state->ctm_output_buffer[cnt]);
+      state->ctm_output_ext_buffer[cnt] = swap16(state->ctm_output_ext_buffer[cnt]);
     }
   }
 #endif
 
-  if (write(state->ctmOutputFileFp, state->ctm_output_buffer, state->audio_buffer_size) < state->audio_buffer_size)
-    errx(1, "layer2_process_ctm_file_output: write error.");
+  bufio_write(&(state->ctmOutputWriter), state->ctm_output_ext_buffer, state->audio_buffer_size);
 }
 
-static void layer2_process_ctm_in(struct ctm_state *state)
+void layer2_process_ctm_in(struct ctm_state *state)
 {
-  /* Run the CTM receiver */
+  /* Run the CTM receiver on the frame that has been pushed into */
+  /* the signal window                                           */
 
-  Shortint_fifo_push(&(state->signalFifoState), state->ctm_input_buffer, 
-      LENGTH_TONE_VEC);
-
-  ctm_receiver(&(state->signalFifoState), &(state->ctmOutTTYCodeFifoState), &(state->earlyMutingRequired), &(state->rx_state));
+  ctm_receiver(&(state->signalWindowState), &(state->ctmOutTTYCodeFifoState), &(state->earlyMutingRequired), &(state->rx_state));
 
   state->enquiryFromFarEndDetected = false;
 
@@ -280,13 +458,13 @@ static void layer2_process_ctm_in(struct ctm_state *state)
   if ((state->rx_state.wait_state.sync_found) && (!state->ctmFromFarEndDetected))
   {
     state->ctmFromFarEndDetected = true;
-    fprintf(stderr, ">>> CTM from far-end detected! <<<\n");
+    layer2_log_event(state, CTM_EVENT_FAR_END_CTM, 0);
 
     /* If we have not transmitted CTM tones so far, we should */
     /* treat the received burst as an enquiry burst.          */
     if (!state->ctmCharacterTransmitted)
     {
-      fprintf(stderr,">>> Enquiry From Far End Detected! <<<\n");
+      layer2_log_event(state, CTM_EVENT_FAR_END_ENQUIRY, 0);
       state->enquiryFromFarEndDetected=true;
       state->cntFramesSinceEnquiryDetected=0;
     }
@@ -296,12 +474,12 @@ static void layer2_process_ctm_in(struct ctm_state *state)
   /* --> print it on the screen and push it into the correct fifo.    */
   if (Shortint_fifo_check(&(state->ctmOutTTYCodeFifoState)) >0)
   {
-    Shortint_fifo_pop(&(state->ctmOutTTYCodeFifoState), &ucsCode, 1);
+    Shortint_fifo_pop(&(state->ctmOutTTYCodeFifoState), &(state->ucsCode), 1);
 
     /* Check whether this was an enquiry burst from the other */
     /* side. Ignore this enquiry, if the last enquiry has     */
     /* been detected less than 25 frames (500 ms) ago.        */
-    if ((ucsCode==ENQU_SYMB) && 
+    if ((state->ucsCode==ENQU_SYMB) && 
         (state->cntFramesSinceEnquiryDetected > 25*160/LENGTH_TONE_VEC))
     {
       state->enquiryFromFarEndDetected=true;
@@ -311,12 +489,12 @@ static void layer2_process_ctm_in(struct ctm_state *state)
     {
       /* Convert character from UCS to Baudot code, print   */
       /* it on the screen and push it into ctmToBaudotFifo. */ 
-      character = toupper(convertUCScode2char(ucsCode));
-      ttyCode   = convertChar2ttyCode(character);
-      if (ttyCode >= 0)
+      state->character = toupper(convertUCScode2char(state->ucsCode));
+      state->ttyCode   = convertChar2ttyCode(state->character);
+      if (state->ttyCode >= 0)
       {
-        fprintf(stderr, "%c", character);
-        Shortint_fifo_push(&(state->ctmToBaudotFifoState), &ttyCode, 1);
+        layer2_log_event(state, CTM_EVENT_CHAR_RECEIVED, (unsigned char)state->character);
+        Shortint_fifo_push(&(state->ctmToBaudotFifoState), &(state->ttyCode), 1);
       }
     }
   }
@@ -325,8 +503,10 @@ static void layer2_process_ctm_in(struct ctm_state *state)
     state->cntFramesSinceEnquiryDetected++;
 }
 
-static void layer2_process_ctm_out(struct ctm_state *state)
+void layer2_process_ctm_out(struct ctm_state *state)
 {
+  Shortint cnt;
+
   if (state->enquiryFromFarEndDetected)
   {
     /* Generate Acknowledgement burst, if Enquiry from the far side */
@@ -334,8 +514,8 @@ static void layer2_process_ctm_out(struct ctm_state *state)
     /* see description of function ctm_transmitter()                */
     if (Shortint_fifo_check(&(state->baudotToCtmFifoState))==0)
     {
-      ucsCode = 0xFFFF;
-      Shortint_fifo_push(&(state->baudotToCtmFifoState), &ucsCode, 1);
+      state->ucsCode = 0xFFFF;
+      Shortint_fifo_push(&(state->baudotToCtmFifoState), &(state->ucsCode), 1);
       state->ctmCharacterTransmitted   = true;
       state->enquiryFromFarEndDetected = false;
     }
@@ -355,9 +535,9 @@ static void layer2_process_ctm_out(struct ctm_state *state)
     /*   last Burst is finished and if the number of enquiry bursts  */
     /*   doesn't exceed NUM_ENQUIRY_BURSTS.                          */
 
-    fprintf(stderr, ">>> Enquiry Burst generated! <<<\n");
-    ucsCode = ENQU_SYMB;
-    Shortint_fifo_push(&(state->baudotToCtmFifoState), &ucsCode, 1);
+    layer2_log_event(state, CTM_EVENT_ENQUIRY_SENT, 0);
+    state->ucsCode = ENQU_SYMB;
+    Shortint_fifo_push(&(state->baudotToCtmFifoState), &(state->ucsCode), 1);
     state->ctmCharacterTransmitted = true;
     if (state->cntTransmittedEnquiries<maxShortint)
       state->cntTransmittedEnquiries++;
@@ -392,21 +572,21 @@ static void layer2_process_ctm_out(struct ctm_state *state)
     {
       if (Shortint_fifo_check(&(state->baudotOutTTYCodeFifoState))>0)
       {
-        Shortint_fifo_pop(&(state->baudotOutTTYCodeFifoState), &ttyCode, 1);
-        character = convertTTYcode2char(ttyCode);
-        fprintf(stderr, "%c", character);
-        ucsCode = convertChar2UCScode(character);
-        Shortint_fifo_push(&(state->baudotToCtmFifoState), &ucsCode, 1);
+        Shortint_fifo_pop(&(state->baudotOutTTYCodeFifoState), &(state->ttyCode), 1);
+        state->character = convertTTYcode2char(state->ttyCode);
+        layer2_log_event(state, CTM_EVENT_CHAR_SENT, (unsigned char)state->character);
+        state->ucsCode = convertChar2UCScode(state->character);
+        Shortint_fifo_push(&(state->baudotToCtmFifoState), &(state->ucsCode), 1);
       }
     }
 
     if ((Shortint_fifo_check(&(state->baudotToCtmFifoState))>0) &&
         (state->numCTMBitsStillToModulate<2*LENGTH_TX_BITS))
-      Shortint_fifo_pop(&(state->baudotToCtmFifoState), &ucsCode, 1);
+      Shortint_fifo_pop(&(state->baudotToCtmFifoState), &(state->ucsCode), 1);
     else
-      ucsCode = 0x0016;
+      state->ucsCode = 0x0016;
 
-    ctm_transmitter(ucsCode, state->ctm_output_buffer, &(state->tx_state), 
+    ctm_transmitter(state->ucsCode, state->ctm_output_buffer, &(state->tx_state), 
         &(state->numCTMBitsStillToModulate), state->sineOutput);
 
     state->ctmTransmitterIsIdle    
@@ -437,11 +617,13 @@ static void layer2_process_ctm_out(struct ctm_state *state)
     /* discard characters in oder to avoid FIFO buffer overflows */
     if (Shortint_fifo_check(&(state->baudotOutTTYCodeFifoState))>=
         state->baudotOutTTYCodeFifoLength-1)
-      Shortint_fifo_pop(&(state->baudotOutTTYCodeFifoState), &ttyCode, 1);
+      Shortint_fifo_pop(&(state->baudotOutTTYCodeFifoState), &(state->ttyCode), 1);
   }
 
   if (state->cntFramesSinceBurstInit<maxShortint)
     state->cntFramesSinceBurstInit++;
 
   state->cntProcessedSamples += LENGTH_TONE_VEC;
+
+  layer2_process_text_flush(state);
 }
@@ -26,6 +26,12 @@
 
 const char m_sequence_id[] = "@(#)$Id: $" m_sequence_h;
 
+const Shortint m_sequence_63[63] = {
+  -1,  1, -1,  1, -1,  1,  1, -1, -1,  1,  1, -1,  1,  1,  1, -1,
+   1,  1, -1,  1, -1, -1,  1, -1, -1,  1,  1,  1, -1, -1, -1,  1,
+  -1,  1,  1,  1,  1, -1, -1,  1, -1,  1, -1, -1, -1,  1,  1, -1,
+  -1, -1, -1,  1, -1, -1, -1, -1, -1,  1,  1,  1,  1,  1,  1 };
+
 /*
 *******************************************************************************
 *                         PUBLIC PROGRAM CODE
@@ -42,6 +42,15 @@
 
 void m_sequence(Shortint *sequence, Shortint length);
 
+/* -------------------------------------------------------------------- */
+/* m_sequence_63:                                                       */
+/* The sequence of length 63 as calculated by m_sequence(), for the     */
+/* synchronization sequences, which are shared by all instances of the  */
+/* (de)interleaver and of the sync detector.                            */
+/* -------------------------------------------------------------------- */
+
+extern const Shortint m_sequence_63[63];
+
 
 #endif
 
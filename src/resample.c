@@ -0,0 +1,230 @@
+/*
+*******************************************************************************
+*
+*      File             : resample.c
+*      Purpose          : Polyphase decimator and interpolator between the
+*                         8 kHz of the modem and the external sample rate
+*
+*******************************************************************************
+*/
+
+/*
+*******************************************************************************
+*                         MODULE INCLUDE FILE AND VERSION ID
+*******************************************************************************
+*/
+
+#include "resample.h"
+
+#include <typedefs.h>
+#include <stdlib.h>
+#include <string.h>
+#include <err.h>
+
+const char resample_id[] = "@(#)$Id: $" resample_h;
+
+/*
+*******************************************************************************
+*                         CONSTANT TABLES
+*******************************************************************************
+*/
+
+/* The coefficients are in Q14, so that even the sum of the magnitudes */
+/* of a phase times a full-scale sample fits into a Longint. Each      */
+/* table, and each phase of the interpolators, sums up to exactly      */
+/* 16384, i.e. a DC gain of one. The prototype is symmetric, so phase  */
+/* p of the interpolator is every factor-th tap from factor-1-p on.    */
+
+#define COEFF_SHIFT 14
+
+/* decimation by 2: the prototype, 48 taps */
+static const Shortint down2[2*RESAMPLE_TAPS] = {
+       -4,      1,     14,      0,    -30,     -2,     56,     10,
+      -95,    -26,    149,     56,   -224,   -106,    326,    190,
+     -470,   -332,    693,    603,  -1122,  -1286,   2572,   7219,
+     7219,   2572,  -1286,  -1122,    603,    693,   -332,   -470,
+      190,    326,   -106,   -224,     56,    149,    -26,    -95,
+       10,     56,     -2,    -30,      0,     14,      1,     -4 };
+
+/* interpolation by 2: the 2 phases of 2 times the prototype */
+static const Shortint up2[2*RESAMPLE_TAPS] = {
+        2,     -1,     -5,     20,    -53,    111,   -212,    379,
+     -665,   1206,  -2571,  14442,   5144,  -2244,   1386,   -939,
+      651,   -447,    298,   -190,    113,    -60,     28,     -9,
+       -9,     28,    -60,    113,   -190,    298,   -447,    651,
+     -939,   1386,  -2244,   5144,  14442,  -2571,   1206,   -665,
+      379,   -212,    111,    -53,     20,     -5,     -1,      2 };
+
+/* decimation by 6: the prototype, 144 taps */
+static const Shortint down6[6*RESAMPLE_TAPS] = {
+       -1,     -2,     -2,     -1,      0,      2,      4,      5,
+        5,      3,      0,     -4,     -8,    -11,    -11,     -7,
+       -1,      7,     15,     20,     20,     14,      4,    -10,
+      -24,    -33,    -34,    -26,     -9,     13,     35,     51,
+       55,     44,     19,    -15,    -50,    -76,    -85,    -71,
+      -36,     14,     68,    110,    128,    112,     64,     -9,
+      -90,   -158,   -191,   -177,   -111,     -5,    120,    232,
+      297,    291,    201,     38,   -170,   -375,   -520,   -551,
+     -429,   -138,    306,    858,   1447,   1990,   2407,   2634,
+     2634,   2407,   1990,   1447,    858,    306,   -138,   -429,
+     -551,   -520,   -375,   -170,     38,    201,    291,    297,
+      232,    120,     -5,   -111,   -177,   -191,   -158,    -90,
+       -9,     64,    112,    128,    110,     68,     14,    -36,
+      -71,    -85,    -76,    -50,    -15,     19,     44,     55,
+       51,     35,     13,     -9,    -26,    -34,    -33,    -24,
+      -10,      4,     14,     20,     20,     15,      7,     -1,
+       -7,    -11,    -11,     -8,     -4,      0,      3,      5,
+        5,      4,      2,      0,     -1,     -2,     -2,     -1 };
+
+/* interpolation by 6: the 6 phases of 6 times the prototype */
+static const Shortint up6[6*RESAMPLE_TAPS] = {
+       13,    -26,     43,    -62,     79,    -90,     86,    -55,
+      -28,    227,   -829,  15797,   1836,  -1020,    722,   -541,
+      407,   -299,    212,   -143,     89,    -50,     24,     -8,
+        2,     -1,     -5,     21,    -54,    114,   -215,    383,
+     -669,   1209,  -2573,  14442,   5146,  -2248,   1391,   -946,
+      659,   -456,    307,   -197,    119,    -65,     31,    -11,
+       -7,     19,    -44,     86,   -156,    264,   -427,    674,
+    -1063,   1746,  -3306,  11943,   8680,  -3118,   1785,  -1149,
+      765,   -508,    330,   -205,    120,    -64,     30,    -11,
+      -11,     30,    -64,    120,   -205,    330,   -508,    765,
+    -1149,   1785,  -3118,   8680,  11943,  -3306,   1746,  -1063,
+      674,   -427,    264,   -156,     86,    -44,     19,     -7,
+      -11,     31,    -65,    119,   -197,    307,   -456,    659,
+     -946,   1391,  -2248,   5146,  14442,  -2573,   1209,   -669,
+      383,   -215,    114,    -54,     21,     -5,     -1,      2,
+       -8,     24,    -50,     89,   -143,    212,   -299,    407,
+     -541,    722,  -1020,   1836,  15797,   -829,    227,    -28,
+      -55,     86,    -90,     79,    -62,     43,    -26,     13 };
+
+/*
+*******************************************************************************
+*              PRIVATE PROGRAM CODE AND VARIABLES
+*******************************************************************************
+*/
+
+static Longint dot(const Shortint *samples, const Shortint *coeffs, Shortint len)
+{
+  Longint  sum = 0;
+  Shortint cnt;
+
+  for (cnt=0; cnt<len; cnt++)
+    sum += (Longint)samples[cnt]*(Longint)coeffs[cnt];
+  return sum;
+}
+
+static Shortint round_saturate(Longint sum)
+{
+  sum = (sum + (1L<<(COEFF_SHIFT-1))) >> COEFF_SHIFT;
+  if (sum > maxShortint)
+    return maxShortint;
+  if (sum < minShortint)
+    return minShortint;
+  return (Shortint)sum;
+}
+
+static void init_resample(resample_state_t *state, Shortint factor,
+                          const Shortint *coeffs2, const Shortint *coeffs6)
+{
+  switch (factor) {
+  case 2:
+    state->coeffs = coeffs2;
+    break;
+  case 6:
+    state->coeffs = coeffs6;
+    break;
+  default:
+    errx(1, "init_resample: unsupported factor %d", factor);
+  }
+  state->factor = factor;
+  memset(state->buffer, 0, sizeof(state->buffer));
+}
+
+/*
+*******************************************************************************
+*                         PUBLIC PROGRAM CODE
+*******************************************************************************
+*/
+void init_resample_down(resample_state_t *state, Shortint factor)
+{
+  init_resample(state, factor, down2, down6);
+  state->length_history = factor*RESAMPLE_TAPS-1;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void init_resample_up(resample_state_t *state, Shortint factor)
+{
+  init_resample(state, factor, up2, up6);
+  state->length_history = RESAMPLE_TAPS-1;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void resample_down(resample_state_t *state, const Shortint *in_samples,
+                   Shortint *out_samples, Shortint num_out)
+{
+  Shortint  factor = state->factor;
+  Shortint  num_taps = factor*RESAMPLE_TAPS;
+  Shortint  num_history = state->length_history;
+  Shortint *buffer = state->buffer;
+  Shortint  cnt, num_block;
+
+  while (num_out > 0)
+    {
+      num_block = num_out < RESAMPLE_BLOCK_LEN ? num_out : RESAMPLE_BLOCK_LEN;
+
+      /* output cnt ends with input sample factor*cnt+factor-1 */
+      memcpy(buffer+num_history, in_samples, factor*num_block*sizeof(Shortint));
+      for (cnt=0; cnt<num_block; cnt++)
+        out_samples[cnt] = round_saturate(dot(buffer+factor*cnt+factor-1,
+                                              state->coeffs, num_taps));
+      memmove(buffer, buffer+factor*num_block, num_history*sizeof(Shortint));
+
+      in_samples  += factor*num_block;
+      out_samples += num_block;
+      num_out     -= num_block;
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+
+void resample_up(resample_state_t *state, const Shortint *in_samples,
+                 Shortint *out_samples, Shortint num_in)
+{
+  Shortint  factor = state->factor;
+  Shortint  num_history = state->length_history;
+  Shortint *buffer = state->buffer;
+  Shortint  cnt, phase, num_block;
+
+  while (num_in > 0)
+    {
+      num_block = num_in < RESAMPLE_BLOCK_LEN ? num_in : RESAMPLE_BLOCK_LEN;
+
+      /* the outputs of phase 0 to factor-1 follow input sample cnt, */
+      /* the last one of the window at buffer+cnt                     */
+      memcpy(buffer+num_history, in_samples, num_block*sizeof(Shortint));
+      for (cnt=0; cnt<num_block; cnt++)
+        for (phase=0; phase<factor; phase++)
+          out_samples[factor*cnt+phase] =
+            round_saturate(dot(buffer+cnt, state->coeffs+phase*RESAMPLE_TAPS,
+                               RESAMPLE_TAPS));
+      memmove(buffer, buffer+num_block, num_history*sizeof(Shortint));
+
+      in_samples  += num_block;
+      out_samples += factor*num_block;
+      num_in      -= num_block;
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+
+Bool resample_silent(const resample_state_t *state)
+{
+  Shortint cnt;
+
+  for (cnt=0; cnt<state->length_history; cnt++)
+    if (state->buffer[cnt] != 0)
+      return false;
+  return true;
+}
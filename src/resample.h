@@ -0,0 +1,107 @@
+/*
+*******************************************************************************
+*
+*      File             : resample.h
+*      Purpose          : Polyphase decimator and interpolator between the
+*                         8 kHz of the modem and the external sample rate
+*                         (16 kHz or 48 kHz) of the CTM and Baudot signals
+*
+*                         Definition of the type resample_state_t and of
+*                         the functions init_resample_down(),
+*                         init_resample_up(), resample_down(),
+*                         resample_up() and resample_silent()
+*
+*      Both directions use the same lowpass prototype (Kaiser window,
+*      RESAMPLE_TAPS taps per phase, cutoff 3.9 kHz): passband 0..3.4 kHz
+*      flat within 0.15 dB, at least 60 dB stopband attenuation from
+*      4.6 kHz on, and a delay of about 1.5 ms in each direction. The
+*      filters are FIR only, and the inner loops are plain dot products
+*      of 16 bit samples and coefficients over contiguous buffers, which
+*      the compiler vectorizes.
+*
+*******************************************************************************
+*/
+
+#ifndef resample_h
+#define resample_h "$Id: $"
+
+/*
+*******************************************************************************
+*                         INCLUDE FILES
+*******************************************************************************
+*/
+
+#include <typedefs.h>
+
+/*
+*******************************************************************************
+*                         DEFINITIONS
+*******************************************************************************
+*/
+
+#define RESAMPLE_TAPS        24   /* taps per polyphase branch               */
+#define RESAMPLE_MAX_FACTOR  6    /* 48 kHz                                  */
+#define RESAMPLE_BLOCK_LEN   40   /* 8 kHz samples filtered at a time        */
+
+/* samples of the buffer: the history in front of one block, at the */
+/* higher rate for the decimator                                     */
+#define RESAMPLE_BUFFER_LEN  (RESAMPLE_MAX_FACTOR*(RESAMPLE_TAPS+RESAMPLE_BLOCK_LEN))
+
+/*
+*******************************************************************************
+*                         DECLARATION OF PROTOTYPES
+*******************************************************************************
+*/
+
+typedef struct {
+  Shortint        factor;          /* external rate / 8 kHz: 2 or 6      */
+  Shortint        length_history;  /* samples kept in front of a block   */
+  const Shortint *coeffs;          /* prototype, or [factor][TAPS] phases */
+  Shortint        buffer[RESAMPLE_BUFFER_LEN];
+} resample_state_t;
+
+
+/* ----------------------------------------------------------------------- */
+/* FUNCTIONS init_resample_down() and init_resample_up()                   */
+/* *****************************************************                   */
+/* Initialization of a decimator (external rate to 8 kHz) or of an         */
+/* interpolator (8 kHz to the external rate) for the given factor, which   */
+/* must be 2 or 6. The history is cleared.                                 */
+/* ----------------------------------------------------------------------- */
+
+void init_resample_down(resample_state_t *state, Shortint factor);
+void init_resample_up(resample_state_t *state, Shortint factor);
+
+
+/* ----------------------------------------------------------------------- */
+/* FUNCTION resample_down()                                                */
+/* ************************                                                */
+/* Decimates factor*num_out samples of in_samples to the num_out samples   */
+/* of out_samples, which must not overlap with in_samples.                 */
+/* ----------------------------------------------------------------------- */
+
+void resample_down(resample_state_t *state, const Shortint *in_samples,
+                   Shortint *out_samples, Shortint num_out);
+
+
+/* ----------------------------------------------------------------------- */
+/* FUNCTION resample_up()                                                  */
+/* **********************                                                  */
+/* Interpolates the num_in samples of in_samples to the factor*num_in      */
+/* samples of out_samples, which must not overlap with in_samples.         */
+/* ----------------------------------------------------------------------- */
+
+void resample_up(resample_state_t *state, const Shortint *in_samples,
+                 Shortint *out_samples, Shortint num_in);
+
+
+/* ----------------------------------------------------------------------- */
+/* FUNCTION resample_silent()                                              */
+/* **************************                                              */
+/* true if the history holds only zeros, i.e. silence in gives silence     */
+/* out from now on.                                                        */
+/* ----------------------------------------------------------------------- */
+
+Bool resample_silent(const resample_state_t *state);
+
+#endif
@@ -20,8 +20,8 @@
 */
 
 #include "tonedemod.h"
+#include "tonedemod_kernels.h"
 #include "ctm_defines.h"
-#include "sin_fip.h"
 
 #include <typedefs.h>
 #include <stdlib.h>
@@ -29,12 +29,161 @@
 
 const char tonedemod_id[] = "@(#)$Id: $" tonedemod_h;
 
+/*
+*******************************************************************************
+*                         CONSTANT TABLES
+*******************************************************************************
+*/
+
+/* The waveforms of the four tones (0<=cnt<SYMB_LEN), shared by all       */
+/* instances of the demodulator:                                          */
+/* tonedemod_waveforms[k][cnt]                                            */
+/*   = sin_fip(((160/SYMB_LEN)*cnt*NCYCLES_k)%160)/SYMB_LEN               */
+/* tonedemod_waveforms_cos[k][cnt]                                        */
+/*   = sin_fip(((160/SYMB_LEN)*cnt*NCYCLES_k+40)%160)/SYMB_LEN            */
+/* i.e. the cosine waveforms are the same a quarter period ahead.         */
+/*                                                                        */
+/* The impulse response of the lowpass is the sinc function              */
+/*   floor(0.5+32767*sin(2*pi*(cnt-SYMB_LEN/2+1)/SYMB_LEN)/               */
+/*                   (2*pi*(cnt-SYMB_LEN/2+1)/SYMB_LEN))                  */
+/* normalized to the sum of its coefficients, resulting in a frequency    */
+/* response of 32767 (0 dB) for low frequencies; tonedemod_lowpass_ir_rev */
+/* is the same in reverse order.                                          */
+
+#if SYMB_LEN==40
+const Shortint tonedemod_waveforms[4][SYMB_LEN] = {
+  {
+        0,   253,   481,   662,   779,   819,   779,   662,   481,   253,
+        0,  -253,  -481,  -662,  -779,  -819,  -779,  -662,  -481,  -253,
+        0,   253,   481,   662,   779,   819,   779,   662,   481,   253,
+        0,  -253,  -481,  -662,  -779,  -819,  -779,  -662,  -481,  -253 },
+  {
+        0,   371,   662,   809,   779,   579,   253,  -128,  -481,  -729,
+     -819,  -729,  -481,  -128,   253,   579,   779,   809,   662,   371,
+        0,  -371,  -662,  -809,  -779,  -579,  -253,   128,   481,   729,
+      819,   729,   481,   128,  -253,  -579,  -779,  -809,  -662,  -371 },
+  {
+        0,   481,   779,   779,   481,     0,  -481,  -779,  -779,  -481,
+        0,   481,   779,   779,   481,     0,  -481,  -779,  -779,  -481,
+        0,   481,   779,   779,   481,     0,  -481,  -779,  -779,  -481,
+        0,   481,   779,   779,   481,     0,  -481,  -779,  -779,  -481 },
+  {
+        0,   579,   819,   579,     0,  -579,  -819,  -579,     0,   579,
+      819,   579,     0,  -579,  -819,  -579,     0,   579,   819,   579,
+        0,  -579,  -819,  -579,     0,   579,   819,   579,     0,  -579,
+     -819,  -579,     0,   579,   819,   579,     0,  -579,  -819,  -579 }};
+#endif
+#if SYMB_LEN==32
+const Shortint tonedemod_waveforms[4][SYMB_LEN] = {
+  {
+        0,   391,   724,   946,  1023,   946,   724,   391,     0,  -391,
+     -724,  -946, -1023,  -946,  -724,  -391,     0,   391,   724,   946,
+     1023,   946,   724,   391,     0,  -391,  -724,  -946, -1023,  -946,
+     -724,  -391 },
+  {
+        0,   568,   946,  1004,   724,   199,  -391,  -851, -1023,  -851,
+     -391,   199,   724,  1004,   946,   568,     0,  -568,  -946, -1004,
+     -724,  -199,   391,   851,  1023,   851,   391,  -199,  -724, -1004,
+     -946,  -568 },
+  {
+        0,   724,  1023,   724,     0,  -724, -1023,  -724,     0,   724,
+     1023,   724,     0,  -724, -1023,  -724,     0,   724,  1023,   724,
+        0,  -724, -1023,  -724,     0,   724,  1023,   724,     0,  -724,
+    -1023,  -724 },
+  {
+        0,   851,   946,   199,  -724, -1004,  -391,   568,  1023,   568,
+     -391, -1004,  -724,   199,   946,   851,     0,  -851,  -946,  -199,
+      724,  1004,   391,  -568, -1023,  -568,   391,  1004,   724,  -199,
+     -946,  -851 }};
+#endif
+
+#if SYMB_LEN==40
+const Shortint tonedemod_waveforms_cos[4][SYMB_LEN] = {
+  {
+      819,   779,   662,   481,   253,     0,  -253,  -481,  -662,  -779,
+     -819,  -779,  -662,  -481,  -253,     0,   253,   481,   662,   779,
+      819,   779,   662,   481,   253,     0,  -253,  -481,  -662,  -779,
+     -819,  -779,  -662,  -481,  -253,     0,   253,   481,   662,   779 },
+  {
+      819,   729,   481,   128,  -253,  -579,  -779,  -809,  -662,  -371,
+        0,   371,   662,   809,   779,   579,   253,  -128,  -481,  -729,
+     -819,  -729,  -481,  -128,   253,   579,   779,   809,   662,   371,
+        0,  -371,  -662,  -809,  -779,  -579,  -253,   128,   481,   729 },
+  {
+      819,   662,   253,  -253,  -662,  -819,  -662,  -253,   253,   662,
+      819,   662,   253,  -253,  -662,  -819,  -662,  -253,   253,   662,
+      819,   662,   253,  -253,  -662,  -819,  -662,  -253,   253,   662,
+      819,   662,   253,  -253,  -662,  -819,  -662,  -253,   253,   662 },
+  {
+      819,   579,     0,  -579,  -819,  -579,     0,   579,   819,   579,
+        0,  -579,  -819,  -579,     0,   579,   819,   579,     0,  -579,
+     -819,  -579,     0,   579,   819,   579,     0,  -579,  -819,  -579,
+        0,   579,   819,   579,     0,  -579,  -819,  -579,     0,   579 }};
+#endif
+#if SYMB_LEN==32
+const Shortint tonedemod_waveforms_cos[4][SYMB_LEN] = {
+  {
+     1023,   946,   724,   391,     0,  -391,  -724,  -946, -1023,  -946,
+     -724,  -391,     0,   391,   724,   946,  1023,   946,   724,   391,
+        0,  -391,  -724,  -946, -1023,  -946,  -724,  -391,     0,   391,
+      724,   946 },
+  {
+     1023,   851,   391,  -199,  -724, -1004,  -946,  -568,     0,   568,
+      946,  1004,   724,   199,  -391,  -851, -1023,  -851,  -391,   199,
+      724,  1004,   946,   568,     0,  -568,  -946, -1004,  -724,  -199,
+      391,   851 },
+  {
+     1023,   724,     0,  -724, -1023,  -724,     0,   724,  1023,   724,
+        0,  -724, -1023,  -724,     0,   724,  1023,   724,     0,  -724,
+    -1023,  -724,     0,   724,  1023,   724,     0,  -724, -1023,  -724,
+        0,   724 },
+  {
+     1023,   568,  -391, -1004,  -724,   199,   946,   851,     0,  -851,
+     -946,  -199,   724,  1004,   391,  -568, -1023,  -568,   391,  1004,
+      724,  -199,  -946,  -851,     0,   851,   946,   199,  -724, -1004,
+     -391,   568 }};
+#endif
+
+#if SYMB_LEN==40
+const Shortint tonedemod_lowpass_ir[SYMB_LEN] = {
+     72,   151,   236,   325,   417,   511,   606,   701,   794,   884,
+    971,  1052,  1126,  1193,  1251,  1300,  1339,  1367,  1384,  1390,
+   1384,  1367,  1339,  1300,  1251,  1193,  1126,  1052,   971,   884,
+    794,   701,   606,   511,   417,   325,   236,   151,    72,     0 };
+#endif
+#if SYMB_LEN==32
+const Shortint tonedemod_lowpass_ir[SYMB_LEN] = {
+    115,   241,   378,   521,   669,   817,   964,  1106,  1240,  1362,
+   1471,  1564,  1639,  1693,  1726,  1738,  1726,  1693,  1639,  1564,
+   1471,  1362,  1240,  1106,   964,   817,   669,   521,   378,   241,
+    115,     0 };
+#endif
+
+#if SYMB_LEN==40
+const Shortint tonedemod_lowpass_ir_rev[SYMB_LEN] = {
+      0,    72,   151,   236,   325,   417,   511,   606,   701,   794,
+    884,   971,  1052,  1126,  1193,  1251,  1300,  1339,  1367,  1384,
+   1390,  1384,  1367,  1339,  1300,  1251,  1193,  1126,  1052,   971,
+    884,   794,   701,   606,   511,   417,   325,   236,   151,    72 };
+#endif
+#if SYMB_LEN==32
+const Shortint tonedemod_lowpass_ir_rev[SYMB_LEN] = {
+      0,   115,   241,   378,   521,   669,   817,   964,  1106,  1240,
+   1362,  1471,  1564,  1639,  1693,  1726,  1738,  1726,  1693,  1639,
+   1564,  1471,  1362,  1240,  1106,   964,   817,   669,   521,   378,
+    241,   115 };
+#endif
+
+
 /*
 *******************************************************************************
 *              PRIVATE PROGRAM CODE AND VARIABLES
 *******************************************************************************
 */
 
+/* fractional bits of the rotations of the sliding DFT correlator */
+#define SDFT_ROT_BITS 30
+
 void rotate_right(Shortint *samples)
 {
   Shortint  cnt;
@@ -65,46 +214,12 @@ void rotate_left(Shortint *samples)
 */
 void init_tonedemod(demod_state_t *demod_state)
 {
-  /* Table with the sinc function (0<=cnt<SYMB_LEN)             */
-  /* (floor(0.5+32767*sin(2*pi*(cnt-SYMB_LEN/2+1)/SYMB_LEN)/    */
-  /*                     (2*pi*(cnt-SYMB_LEN/2+1)/SYMB_LEN)))   */
-#if SYMB_LEN==40
-  static const Shortint sinc_window[] = {
-    1717,   3581,   5571,   7663,   9834,  
-    12054,  14297,  16533,  18730,  20860,  
-    22893,  24799,  26552,  28127,  29501,  
-    30653,  31568,  32231,  32632,  32767,  
-    32632,  32231,  31568,  30653,  29501, 
-    28127,  26552,  24799,  22893,  20860,
-    18730,  16533,  14297,  12054,   9834, 
-    7663,   5571,   3581,   1717,      0};
-#endif
-#if SYMB_LEN==32
-  static const Shortint sinc_window[] = {
-    2170,   4562,    7132,   9834,   12614,
-    15418,  18186,  20860,  23382,   25696,  
-    27751,  29501,  30905,  31931,   32557,    
-    32767,  32557,  31931,  30905,   29501, 
-    27751,  25696,  23382,  20860,   18186, 
-    15418,  12614,   9834,   7132,    4562,
-    2170,     0};
-#endif
-  
   Shortint cnt;
-  Longint  sum_value;
   
   for (cnt=0 ; cnt<SYMB_LEN ; cnt++)
     {
-      demod_state->waveform_t0[cnt] 
-        = sin_fip((Shortint)(((160/SYMB_LEN)*cnt*NCYCLES_0)%160))/SYMB_LEN;
-      demod_state->waveform_t1[cnt] 
-        = sin_fip((Shortint)(((160/SYMB_LEN)*cnt*NCYCLES_1)%160))/SYMB_LEN;
-      demod_state->waveform_t2[cnt] 
-        = sin_fip((Shortint)(((160/SYMB_LEN)*cnt*NCYCLES_2)%160))/SYMB_LEN;
-      demod_state->waveform_t3[cnt] 
-        = sin_fip((Shortint)(((160/SYMB_LEN)*cnt*NCYCLES_3)%160))/SYMB_LEN;
-
       demod_state->diff_smooth[cnt] = 0;
+      demod_state->diff_age[cnt]    = 0;
     }
   for (cnt=0 ; cnt<2*SYMB_LEN ; cnt++)
     {
@@ -116,41 +231,155 @@ void init_tonedemod(demod_state_t *demod_state)
     }
   for (cnt=0 ; cnt<3*SYMB_LEN ; cnt++)
     demod_state->buffer_tone_rx[cnt] = 0;
-  
-  sum_value = 0;
-  for (cnt=0 ; cnt<SYMB_LEN ; cnt++)
+
+  demod_state->correlator = TONEDEMOD_DIRECT;
+
+  demod_state->lag_tracking = false;
+  demod_state->locked       = false;
+  demod_state->track_index  = -1;
+  demod_state->track_frames = 0;
+  demod_state->steady_frames = 0;
+}
+
+void tonedemod_set_correlator(demod_state_t *demod_state,
+                              enum tonedemod_correlator correlator)
+{
+  demod_state->correlator = correlator;
+}
+
+void tonedemod_set_lag_tracking(demod_state_t *demod_state, Bool on)
+{
+  demod_state->lag_tracking = on;
+  demod_state->track_index  = -1;
+  demod_state->track_frames = 0;
+  demod_state->steady_frames = 0;
+}
+
+/* ---------------------------------------------------------------------- */  
+
+/* Correlations of the lags SYMB_LEN-1 ... 2*SYMB_LEN-1 with the tone */
+/* waveforms, each over SYMB_LEN taps (TONEDEMOD_DIRECT).             */
+
+static void correlate_direct(const Shortint *buffer_tone_rx,
+                             demod_state_t *demod_state)
+{
+  Shortint *const xcorr[4] = { demod_state->xcorr_t0+SYMB_LEN-1,
+                               demod_state->xcorr_t1+SYMB_LEN-1,
+                               demod_state->xcorr_t2+SYMB_LEN-1,
+                               demod_state->xcorr_t3+SYMB_LEN-1 };
+  const Shortint *const waveforms[4] = { tonedemod_waveforms[0],
+                                         tonedemod_waveforms[1],
+                                         tonedemod_waveforms[2],
+                                         tonedemod_waveforms[3] };
+
+  tonedemod_correlate(xcorr, demod_state->xcorr_wb+SYMB_LEN-1,
+                      buffer_tone_rx+SYMB_LEN-1, waveforms, SYMB_LEN+1);
+}
+
+/* Same as correlate_direct(), but only the first lag is calculated over */
+/* SYMB_LEN taps, as the complex correlation with the tone (imaginary    */
+/* part: the sine waveform, real part: the cosine waveform). The window  */
+/* of the next lag loses the oldest sample and gains a new one; as every */
+/* tone has an integer number of periods within SYMB_LEN, the            */
+/* correlation of the next lag is the correlation of the actual lag,     */
+/* corrected by the difference of these two samples and rotated by one   */
+/* sample (TONEDEMOD_SLIDING_DFT).                                       */
+
+static void correlate_sliding_dft(const Shortint *buffer_tone_rx,
+                                  demod_state_t *demod_state)
+{
+  /* cos and sin of 2*pi*NCYCLES_x/SYMB_LEN, Q30 */
+#if SYMB_LEN==40
+  static const Longint rot_cos[4] = { 1021189159, 956710970, 868675383, 759250125 };
+  static const Longint rot_sin[4] = {  331804471, 487468587, 631129609, 759250125 };
+#endif
+#if SYMB_LEN==32
+  static const Longint rot_cos[4] = {  992008094, 892783698, 759250125, 596538995 };
+  static const Longint rot_sin[4] = {  410903207, 596538995, 759250125, 892783698 };
+#endif
+  static const long long round_rot = 1LL<<(SDFT_ROT_BITS-1);
+
+  Shortint  *xcorr[4];
+  Longint    sum_im[4], sum_re[4];
+  long long  xcorr_im[4], xcorr_re[4], re;
+  Longint    sumw, delta;
+  Shortint   tone, cnt, lag;
+
+  xcorr[0] = demod_state->xcorr_t0;
+  xcorr[1] = demod_state->xcorr_t1;
+  xcorr[2] = demod_state->xcorr_t2;
+  xcorr[3] = demod_state->xcorr_t3;
+
+  /* first lag: directly */
+  sumw = 0L;
+  for (tone=0; tone<4; tone++)
     {
-      demod_state->lowpass[cnt] = sinc_window[cnt];
-      sum_value    = sum_value + demod_state->lowpass[cnt];
+      sum_im[tone] = 0L;
+      sum_re[tone] = 0L;
+      for (cnt=0; cnt<SYMB_LEN; cnt++)
+        {
+          sum_im[tone] += (Longint)buffer_tone_rx[SYMB_LEN-1+cnt]*
+                          (Longint)tonedemod_waveforms[tone][cnt];
+          sum_re[tone] += (Longint)buffer_tone_rx[SYMB_LEN-1+cnt]*
+                          (Longint)tonedemod_waveforms_cos[tone][cnt];
+        }
+      xcorr_im[tone] = sum_im[tone];
+      xcorr_re[tone] = sum_re[tone];
+    }
+  for (cnt=0; cnt<SYMB_LEN; cnt++)
+    sumw += (Longint)abs(buffer_tone_rx[SYMB_LEN-1+cnt]);
+
+  for (lag=SYMB_LEN-1; ; lag++)
+    {
+      for (tone=0; tone<4; tone++)
+        xcorr[tone][lag] = (Shortint)(xcorr_im[tone]>>15);
+      demod_state->xcorr_wb[lag] = sumw/SYMB_LEN;
+
+      if (lag == 2*SYMB_LEN-1)
+        break;
+
+      /* slide the window by one sample */
+      delta = (Longint)buffer_tone_rx[lag+SYMB_LEN] - (Longint)buffer_tone_rx[lag];
+      sumw += (Longint)abs(buffer_tone_rx[lag+SYMB_LEN]) - (Longint)abs(buffer_tone_rx[lag]);
+
+      for (tone=0; tone<4; tone++)
+        {
+          /* the sine waveform starts with 0, the cosine with its peak */
+          re = xcorr_re[tone] + (long long)tonedemod_waveforms_cos[tone][0]*delta;
+          xcorr_re[tone] = ((long long)rot_cos[tone]*re +
+                            (long long)rot_sin[tone]*xcorr_im[tone] +
+                            round_rot) >> SDFT_ROT_BITS;
+          xcorr_im[tone] = ((long long)rot_cos[tone]*xcorr_im[tone] -
+                            (long long)rot_sin[tone]*re +
+                            round_rot) >> SDFT_ROT_BITS;
+        }
     }
-  
-  /* The lowpass impulse response is normalized to the sum of its */
-  /* coefficients, resulting in a frequency response of 32767 (0 dB)  */
-  /* for low frequencies                                          */
-  for (cnt=0 ; cnt<SYMB_LEN ; cnt++)
-    demod_state->lowpass[cnt] = 
-      (Shortint)(((Longint)(demod_state->lowpass[cnt])*32767)/sum_value);
 }
 
 /* ---------------------------------------------------------------------- */  
 
-void tonedemod(Shortint *bits_out,
-               Shortint *in_samples,
-               Shortint num_in_samples,
-               Shortint *ptr_sampling_correction,
-               demod_state_t *demod_state)
+/* buffer_tone_rx points to the last 3*SYMB_LEN input samples, the */
+/* newest num_in_samples of them have just arrived                   */
+
+static void demodulate(Shortint *bits_out,
+                       const Shortint *buffer_tone_rx,
+                       Shortint num_in_samples,
+                       Shortint *ptr_sampling_correction,
+                       demod_state_t *demod_state)
 {
   static const Longint alpha           = 32113; /* = 32768*0.98 */
   static const Longint one_minus_alpha = 655;   /* = 32768*0.02 */
   static const Longint alpha2          = 32440; /* = 32768*0.99 */
   
-  Longint sum0, sum1, sum2, sum3, sumw;
-  
-  Shortint  cnt, lag, index_max;
+  Shortint  lag, index_max;
+  Shortint  first_lag, last_lag;
   Shortint  gain;
   Shortint  max_diff;
   Shortint  max_diff_smooth;
   Shortint  soft_value;
+  Bool      reliable;
+  Shortint  cnt;
+  Longint   factor, weight;
   Shortint  xcorr0, xcorr1, xcorr2, xcorr3, xcorrw;
   
   Shortint  xcorr_abs_t0[2*SYMB_LEN];
@@ -165,6 +394,14 @@ void tonedemod(Shortint *bits_out,
   Shortint  xcorr_lp_t3[SYMB_LEN];
   Shortint  xcorr_lp_wb[SYMB_LEN];
   Shortint  diff[SYMB_LEN];
+
+  const Shortint *const xcorr_abs[5] = { xcorr_abs_t0+1, xcorr_abs_t1+1,
+                                         xcorr_abs_t2+1, xcorr_abs_t3+1,
+                                         xcorr_abs_wb+1 };
+  Shortint *const xcorr_lp[5] = { xcorr_lp_t0, xcorr_lp_t1, xcorr_lp_t2,
+                                  xcorr_lp_t3, xcorr_lp_wb };
+  const Shortint *xcorr_abs_window[5];
+  Shortint       *xcorr_lp_window[5];
   
   /* ################################################################### */
   /* ############### The following is for debugging only ############### */
@@ -203,9 +440,11 @@ void tonedemod(Shortint *bits_out,
   switch (num_in_samples) {
   case SYMB_LEN-1:
     rotate_right(demod_state->diff_smooth);
+    rotate_right(demod_state->diff_age);
     break;
   case SYMB_LEN+1:
     rotate_left(demod_state->diff_smooth);
+    rotate_left(demod_state->diff_age);
     break;
   case SYMB_LEN:
     /* do nothing special */
@@ -215,20 +454,6 @@ void tonedemod(Shortint *bits_out,
     exit(1);
   }
   
-  /* Read in the actual input samples. This can be either                 */
-  /* SYMB_LEN, SYMB_LEN+1, or SYMB_LEN-1. In order to make the            */
-  /* remaining code of this function independent of the number of input   */
-  /* samples, an input-buffer is used, which is shifted according to      */
-  /* the number of the new samples                                        */
-  
-  for (cnt=0; cnt<3*SYMB_LEN-num_in_samples; cnt++)
-    demod_state->buffer_tone_rx[cnt] 
-      = demod_state->buffer_tone_rx[cnt+num_in_samples];
-  
-  for (cnt=0; cnt<num_in_samples; cnt++)
-    demod_state->buffer_tone_rx[cnt+3*SYMB_LEN-num_in_samples] 
-      = in_samples[cnt];
-  
   /* Now calculate the cross-correlations. For each cross-correlation     */
   /* more than SYMB_LEN samples have to be caluclated because a lowpass   */
   /* filtering shall be applied in the next step.                         */
@@ -248,85 +473,61 @@ void tonedemod(Shortint *bits_out,
   
   /* Calculate the remaining correlation values. */
   
-  for (lag=SYMB_LEN-1; lag<2*SYMB_LEN; lag++)
-    {
-      sum0 = 0L;
-      sum1 = 0L;
-      sum2 = 0L;
-      sum3 = 0L;
-      sumw = 0L;
-      
-      for (cnt=0; cnt<SYMB_LEN; cnt++)
-        {
-          sum0 += ((Longint)demod_state->buffer_tone_rx[lag+cnt]*
-                   (Longint)demod_state->waveform_t0[cnt]);
-          sum1 += ((Longint)demod_state->buffer_tone_rx[lag+cnt]*
-                   (Longint)demod_state->waveform_t1[cnt]);
-          sum2 += ((Longint)demod_state->buffer_tone_rx[lag+cnt]*
-                   (Longint)demod_state->waveform_t2[cnt]);
-          sum3 += ((Longint)demod_state->buffer_tone_rx[lag+cnt]*
-                   (Longint)demod_state->waveform_t3[cnt]);
-          sumw += ((Longint)abs(demod_state->buffer_tone_rx[lag+cnt]));
-        }
-      demod_state->xcorr_t0[lag] =  sum0>>15;
-      demod_state->xcorr_t1[lag] =  sum1>>15;
-      demod_state->xcorr_t2[lag] =  sum2>>15;
-      demod_state->xcorr_t3[lag] =  sum3>>15;
-      demod_state->xcorr_wb[lag] =  sumw/SYMB_LEN;
-    } 
-  
-  for (lag=0; lag<2*SYMB_LEN; lag++)
+  if (demod_state->correlator == TONEDEMOD_SLIDING_DFT)
+    correlate_sliding_dft(buffer_tone_rx, demod_state);
+  else
+    correlate_direct(buffer_tone_rx, demod_state);
+  
+  tonedemod_abs(xcorr_abs_t0, demod_state->xcorr_t0, 2*SYMB_LEN);
+  tonedemod_abs(xcorr_abs_t1, demod_state->xcorr_t1, 2*SYMB_LEN);
+  tonedemod_abs(xcorr_abs_t2, demod_state->xcorr_t2, 2*SYMB_LEN);
+  tonedemod_abs(xcorr_abs_t3, demod_state->xcorr_t3, 2*SYMB_LEN);
+  tonedemod_abs(xcorr_abs_wb, demod_state->xcorr_wb, 2*SYMB_LEN);
+  
+  /* The lags to be evaluated: all of them, or only those around the   */
+  /* last maximum while the receiver is locked (lag tracking). Frames   */
+  /* with a sampling correction, the TONEDEMOD_TRACK_STEADY frames      */
+  /* after it and every TONEDEMOD_TRACK_PERIOD-th frame get the full    */
+  /* search, so that the lags outside the window do not go stale.       */
+  first_lag = 0;
+  last_lag  = SYMB_LEN-1;
+  if (num_in_samples != SYMB_LEN)
+    demod_state->steady_frames = 0;
+  else if (demod_state->steady_frames < TONEDEMOD_TRACK_STEADY)
+    demod_state->steady_frames++;
+  if (demod_state->lag_tracking && demod_state->locked &&
+      demod_state->track_index >= 0 &&
+      demod_state->steady_frames >= TONEDEMOD_TRACK_STEADY &&
+      demod_state->track_frames < TONEDEMOD_TRACK_PERIOD)
     {
-      xcorr_abs_t0[lag] = abs(demod_state->xcorr_t0[lag]);
-      xcorr_abs_t1[lag] = abs(demod_state->xcorr_t1[lag]);
-      xcorr_abs_t2[lag] = abs(demod_state->xcorr_t2[lag]);
-      xcorr_abs_t3[lag] = abs(demod_state->xcorr_t3[lag]);
-      xcorr_abs_wb[lag] = abs(demod_state->xcorr_wb[lag]);
+      first_lag = demod_state->track_index-TONEDEMOD_TRACK_WIDTH;
+      last_lag  = demod_state->track_index+TONEDEMOD_TRACK_WIDTH;
+      if (first_lag < 0)
+        first_lag = 0;
+      if (last_lag > SYMB_LEN-1)
+        last_lag = SYMB_LEN-1;
     }
-  
-  /* Calculate the low-pass filtered cross-correlations.       */
-  for (lag=0; lag<SYMB_LEN; lag++)
+  for (lag=0; lag<5; lag++)
     {
-      sum0 = 0L;
-      sum1 = 0L;
-      sum2 = 0L;
-      sum3 = 0L;
-      sumw = 0L;
-      for (cnt=0; cnt<SYMB_LEN; cnt++)
-        {
-          sum0 += ((Longint)xcorr_abs_t0[SYMB_LEN+lag-cnt]*
-                   (Longint)demod_state->lowpass[cnt]);
-          sum1 += ((Longint)xcorr_abs_t1[SYMB_LEN+lag-cnt]*
-                   (Longint)demod_state->lowpass[cnt]);
-          sum2 += ((Longint)xcorr_abs_t2[SYMB_LEN+lag-cnt]*
-                   (Longint)demod_state->lowpass[cnt]);
-          sum3 += ((Longint)xcorr_abs_t3[SYMB_LEN+lag-cnt]*
-                   (Longint)demod_state->lowpass[cnt]);
-          sumw += ((Longint)xcorr_abs_wb[SYMB_LEN+lag-cnt]*
-                   (Longint)demod_state->lowpass[cnt]);
-        }
-      xcorr_lp_t0[lag] = sum0>>15;
-      xcorr_lp_t1[lag] = sum1>>15;
-      xcorr_lp_t2[lag] = sum2>>15;
-      xcorr_lp_t3[lag] = sum3>>15;
-      xcorr_lp_wb[lag] = sumw>>15;
+      xcorr_abs_window[lag] = xcorr_abs[lag]+first_lag;
+      xcorr_lp_window[lag]  = xcorr_lp[lag]+first_lag;
     }
   
+  /* Calculate the low-pass filtered cross-correlations:       */
+  /* xcorr_lp[lag] = sum(xcorr_abs[SYMB_LEN+lag-cnt]*lowpass[cnt]) */
+  tonedemod_lowpass(xcorr_lp_window, xcorr_abs_window, 
+                    tonedemod_lowpass_ir_rev, last_lag-first_lag+1);
+  
   /* Calculate the sum of all possible differences between the */
   /* low-pass-filtered correlations.                           */
+  tonedemod_diff(diff+first_lag, (const Shortint *const *)xcorr_lp_window, 
+                 last_lag-first_lag+1);
   max_diff = 0;
   for (lag=0; lag<SYMB_LEN; lag++)
-    {
-      sum0 = (labs((Longint)xcorr_lp_t0[lag]-(Longint)xcorr_lp_t1[lag]) +
-              labs((Longint)xcorr_lp_t0[lag]-(Longint)xcorr_lp_t2[lag]) +
-              labs((Longint)xcorr_lp_t0[lag]-(Longint)xcorr_lp_t3[lag]) +
-              labs((Longint)xcorr_lp_t1[lag]-(Longint)xcorr_lp_t2[lag]) +
-              labs((Longint)xcorr_lp_t1[lag]-(Longint)xcorr_lp_t3[lag]) +
-              labs((Longint)xcorr_lp_t2[lag]-(Longint)xcorr_lp_t3[lag]));
-      diff[lag] = (Shortint)(sum0/6);
-      if (diff[lag]>max_diff)
-        max_diff = diff[lag];
-    }
+    if (lag < first_lag || lag > last_lag)
+      diff[lag] = 0;
+    else if (diff[lag]>max_diff)
+      max_diff = diff[lag];
   
   /* In order to improve the performance of the following IIR filter,   */
   /* an adaptive gain factor of 2^(gain) is applied to the vector diff. */
@@ -342,20 +543,47 @@ void tonedemod(Shortint *bits_out,
   else
     gain=0;
   
-  /* Update the smoothed difference */
+  /* Update the smoothed difference. The lags outside the window keep */
+  /* their value and count the updates they have missed (diff_age);   */
+  /* once they are evaluated again, they catch up with all of them at */
+  /* once, as if their difference had stayed the same meanwhile.      */
+  if (first_lag == 0 && last_lag == SYMB_LEN-1)
+    demod_state->track_frames = 0;
+  else
+    demod_state->track_frames++;
   for (lag=0; lag<SYMB_LEN; lag++)
-    if (max_diff > 4) 
-      demod_state->diff_smooth[lag] 
-        = (Shortint)((alpha*(Longint)((demod_state->diff_smooth[lag])) +
-                      one_minus_alpha*(Longint)(diff[lag]<<gain))>>15);
+    if (lag < first_lag || lag > last_lag)
+      demod_state->diff_age[lag]++;
+    else if (demod_state->diff_age[lag] == 0)
+      {
+        if (max_diff > 4) 
+          demod_state->diff_smooth[lag] 
+            = (Shortint)((alpha*(Longint)((demod_state->diff_smooth[lag])) +
+                          one_minus_alpha*(Longint)(diff[lag]<<gain))>>15);
+        else
+          demod_state->diff_smooth[lag] 
+            = (Shortint)((alpha2*(Longint)(demod_state->diff_smooth[lag]))>>15);
+      }
     else
-      demod_state->diff_smooth[lag] 
-        = (Shortint)((alpha2*(Longint)(demod_state->diff_smooth[lag]))>>15);
+      {
+        factor = (max_diff > 4) ? alpha : alpha2;
+        weight = factor;
+        for (cnt=0; cnt<demod_state->diff_age[lag]; cnt++)
+          weight = (weight*factor + 16384)>>15;
+        if (max_diff > 4) 
+          demod_state->diff_smooth[lag] 
+            = (Shortint)((weight*(Longint)((demod_state->diff_smooth[lag])) +
+                          (32768-weight)*(Longint)(diff[lag]<<gain))>>15);
+        else
+          demod_state->diff_smooth[lag] 
+            = (Shortint)((weight*(Longint)(demod_state->diff_smooth[lag]))>>15);
+        demod_state->diff_age[lag] = 0;
+      }
   
   /* Search the maximum of the smoothed difference */
-  index_max = 0;
+  index_max = first_lag;
   max_diff_smooth = 0;
-  for (lag=0; lag<SYMB_LEN; lag++)
+  for (lag=first_lag; lag<=last_lag; lag++)
     if (demod_state->diff_smooth[lag] > max_diff_smooth)
       {
         max_diff_smooth = demod_state->diff_smooth[lag];
@@ -399,7 +627,8 @@ void tonedemod(Shortint *bits_out,
       bits_out[1] =  soft_value;
     }
   
-  if (7L*(Longint)soft_value > (Longint)(xcorrw+10))
+  reliable = (7L*(Longint)soft_value > (Longint)(xcorrw+10));
+  if (reliable)
     {
       bits_out[0] = (bits_out[0] | 0x0001);
       bits_out[1] = (bits_out[1] | 0x0001);
@@ -410,6 +639,16 @@ void tonedemod(Shortint *bits_out,
       bits_out[1] = (bits_out[1] & 0xFFFE);
     }
 
+  /* The next frame may search around this maximum only if the signal  */
+  /* is strong enough, the bits of this symbol are reliable, and the   */
+  /* maximum is not at the edge of a window.                           */
+  if (max_diff > TONEDEMOD_TRACK_MIN_DIFF && reliable &&
+      (index_max > first_lag || first_lag == 0) &&
+      (index_max < last_lag || last_lag == SYMB_LEN-1))
+    demod_state->track_index = index_max;
+  else
+    demod_state->track_index = -1;
+
   /* Calculate the sampling_correction for the next frame. */
   /* This correction is either -1, 0, or +1.               */
   *ptr_sampling_correction = 0;
@@ -460,4 +699,45 @@ void tonedemod(Shortint *bits_out,
   
 }
 
+/* ---------------------------------------------------------------------- */
 
+void tonedemod(Shortint *bits_out,
+               Shortint *in_samples,
+               Shortint num_in_samples,
+               Shortint *ptr_sampling_correction,
+               demod_state_t *demod_state)
+{
+  Shortint cnt;
+
+  /* Read in the actual input samples. This can be either                 */
+  /* SYMB_LEN, SYMB_LEN+1, or SYMB_LEN-1. In order to make the            */
+  /* remaining code independent of the number of input samples, an        */
+  /* input-buffer is used, which is shifted according to the number of    */
+  /* the new samples (invalid numbers are reported by demodulate()).      */
+  
+  if ((num_in_samples>=SYMB_LEN-1) && (num_in_samples<=SYMB_LEN+1))
+    {
+      for (cnt=0; cnt<3*SYMB_LEN-num_in_samples; cnt++)
+        demod_state->buffer_tone_rx[cnt] 
+          = demod_state->buffer_tone_rx[cnt+num_in_samples];
+      
+      for (cnt=0; cnt<num_in_samples; cnt++)
+        demod_state->buffer_tone_rx[cnt+3*SYMB_LEN-num_in_samples] 
+          = in_samples[cnt];
+    }
+  
+  demodulate(bits_out, demod_state->buffer_tone_rx, num_in_samples, 
+             ptr_sampling_correction, demod_state);
+}
+
+/* ---------------------------------------------------------------------- */
+
+void tonedemod_in_place(Shortint *bits_out,
+                        const Shortint *in_samples,
+                        Shortint num_in_samples,
+                        Shortint *ptr_sampling_correction,
+                        demod_state_t *demod_state)
+{
+  demodulate(bits_out, in_samples+num_in_samples-TONEDEMOD_HISTORY_LEN, 
+             num_in_samples, ptr_sampling_correction, demod_state);
+}
@@ -35,6 +35,30 @@
 *******************************************************************************
 */
 
+/* lag tracking, see tonedemod_set_lag_tracking(): lags searched on    */
+/* either side of the last maximum, the least max_diff that keeps the  */
+/* tracking going, the frames between two full searches, and the       */
+/* frames without a sampling correction before the tracking starts     */
+#define TONEDEMOD_TRACK_WIDTH     4
+#define TONEDEMOD_TRACK_MIN_DIFF  40
+#define TONEDEMOD_TRACK_PERIOD    8
+#define TONEDEMOD_TRACK_STEADY    16
+
+/* correlators of tonedemod(), see tonedemod_set_correlator() */
+enum tonedemod_correlator {
+  TONEDEMOD_DIRECT,        /* SYMB_LEN taps for every lag (default)     */
+  TONEDEMOD_SLIDING_DFT    /* recursive update from lag to lag          */
+};
+
+/* The waveforms of the tones and the impulse response of the lowpass    */
+/* are constant tables, which are shared by all instances (see           */
+/* tonedemod.c). The cosine waveforms are used by the sliding DFT        */
+/* correlator only.                                                      */
+extern const Shortint tonedemod_waveforms[4][SYMB_LEN];
+extern const Shortint tonedemod_waveforms_cos[4][SYMB_LEN];
+extern const Shortint tonedemod_lowpass_ir[SYMB_LEN];
+extern const Shortint tonedemod_lowpass_ir_rev[SYMB_LEN]; /* reverse order */
+
 typedef struct {
   Shortint  buffer_tone_rx[3*SYMB_LEN];
   Shortint  xcorr_t0[2*SYMB_LEN];
@@ -42,12 +66,21 @@ typedef struct {
   Shortint  xcorr_t2[2*SYMB_LEN];
   Shortint  xcorr_t3[2*SYMB_LEN];
   Shortint  xcorr_wb[2*SYMB_LEN];
-  Shortint  lowpass[SYMB_LEN];
-  Shortint  waveform_t0[SYMB_LEN];
-  Shortint  waveform_t1[SYMB_LEN];
-  Shortint  waveform_t2[SYMB_LEN];
-  Shortint  waveform_t3[SYMB_LEN];
   Shortint  diff_smooth[SYMB_LEN];
+  Shortint  diff_age[SYMB_LEN];      /* updates missed, see demodulate() */
+  Shortint  correlator;
+
+  /* lag tracking; locked is set by the receiver in front of every     */
+  /* frame (wait_state.sync_found), track_index is the lag of the last */
+  /* maximum, or -1 if the next frame needs a full search,             */
+  /* track_frames counts the frames since the last full search, and    */
+  /* steady_frames those since the last sampling correction (up to     */
+  /* TONEDEMOD_TRACK_STEADY)                                           */
+  Bool      lag_tracking;
+  Bool      locked;
+  Shortint  track_index;
+  Shortint  track_frames;
+  Shortint  steady_frames;
 } demod_state_t;
 
 
@@ -98,5 +131,92 @@ void tonedemod(Shortint *bits_out,
 
 void init_tonedemod(demod_state_t *demod_state);
 
+
+/* ----------------------------------------------------------------------- */
+/* FUNCTION tonedemod_set_correlator()                                     */
+/* ***********************************                                     */
+/* Selects how the correlations with the four tones are calculated.        */
+/*                                                                         */
+/* TONEDEMOD_DIRECT correlates every lag with the tonedemod_waveforms      */
+/* over SYMB_LEN taps. TONEDEMOD_SLIDING_DFT calculates only the first new */
+/* lag of each frame that way, together with the correlation with the      */
+/* matching cosine waveform, and gets each following lag from the previous */
+/* one in O(1): the sample that leaves the window is replaced by the new   */
+/* one, and the complex correlation is rotated by one sample (a sliding    */
+/* DFT at the bins of the tones, which are integer periods of SYMB_LEN).   */
+/* Starting over in every frame keeps the rounding of the recursion far    */
+/* below one LSB. The wideband level xcorr_wb is a running sum and exact.  */
+/*                                                                         */
+/* Tolerance: the rotation is exact for ideal sinusoids, while the integer */
+/* waveforms are truncated by up to one unit per tap. So the first new lag */
+/* of every frame is exact, and the following ones may differ from         */
+/* TONEDEMOD_DIRECT by up to                                               */
+/*   1 + 2*SYMB_LEN*xcorr_wb/32768                                         */
+/* i.e. about 0.25% of the wideband level. The soft bits in bits_out and   */
+/* the choice of the sampling instant may differ by as much; the hard      */
+/* decisions of clean CTM signals are the same.                            */
+/*                                                                         */
+/* Cost: the correlation is about a third of tonedemod() with              */
+/* TONEDEMOD_DIRECT, and the lowpass, which is a FIR filter of SYMB_LEN    */
+/* taps over five signals, is almost as expensive and is not changed.      */
+/* TONEDEMOD_SLIDING_DFT halves the correlation, which makes tonedemod()   */
+/* about 15% faster. The whole receiver gains about 5%, since most of its  */
+/* time goes to the search of the synchronisation (wait_for_sync.c).       */
+/* ----------------------------------------------------------------------- */
+
+void tonedemod_set_correlator(demod_state_t *demod_state,
+                              enum tonedemod_correlator correlator);
+
+
+/* ----------------------------------------------------------------------- */
+/* FUNCTION tonedemod_set_lag_tracking()                                   */
+/* *************************************                                   */
+/* Switches the lag tracking on or off (default: off).                     */
+/*                                                                         */
+/* Normally, the lowpass, the differences between the tones and the        */
+/* search of the maximum of diff_smooth run over all SYMB_LEN lags. While  */
+/* demod_state->locked is set, the sampling correction keeps the maximum   */
+/* where it is, within one lag per frame. So the tracking only evaluates   */
+/* the lags within TONEDEMOD_TRACK_WIDTH of the last maximum; the other    */
+/* lags of diff_smooth keep their value, and catch up with the updates    */
+/* they have missed once they are evaluated again. The full search is     */
+/* done in every frame with a sampling correction (diff_smooth is         */
+/* rotated, so the lags at the edges of the window come from outside) and */
+/* in the TONEDEMOD_TRACK_STEADY frames after it, so that a receiver that */
+/* corrects often (a large clock drift) does not track at all; in every   */
+/* TONEDEMOD_TRACK_PERIOD-th frame; and after the lock is lost, when the  */
+/* soft bits of a symbol are not reliable, when max_diff drops to         */
+/* TONEDEMOD_TRACK_MIN_DIFF or below, or when the maximum has hit the     */
+/* edge of the window. The correlations are calculated for all lags       */
+/* anyway, as the following frames need them.                             */
+/*                                                                         */
+/* The soft bits may differ slightly from those of the full search, as     */
+/* diff_smooth differs outside the window; the decisions of a locked       */
+/* receiver are the same in practice, also with a clock drift of a few     */
+/* thousand ppm between the transmitter and the receiver.                  */
+/* ----------------------------------------------------------------------- */
+
+void tonedemod_set_lag_tracking(demod_state_t *demod_state, Bool on);
+
+
+/* ----------------------------------------------------------------------- */
+/* FUNCTION tonedemod_in_place()                                           */
+/* *****************************                                           */
+/* Same as tonedemod(), but the samples are read where they are instead   */
+/* of being copied into demod_state->buffer_tone_rx, which is not used.    */
+/* The TONEDEMOD_HISTORY_LEN-num_in_samples samples in front of            */
+/* in_samples must be the previous input of the demodulator (zeros at the  */
+/* start), e.g. in a window_state_t with a history of                      */
+/* TONEDEMOD_HISTORY_LEN samples (see fifo.h).                             */
+/* ----------------------------------------------------------------------- */
+
+#define TONEDEMOD_HISTORY_LEN (3*SYMB_LEN)
+
+void tonedemod_in_place(Shortint *bits_out,
+                        const Shortint *in_samples,
+                        Shortint num_in_samples,
+                        Shortint *ptr_sampling_correction,
+                        demod_state_t *demod_state);
+
 #endif
 
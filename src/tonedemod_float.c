@@ -0,0 +1,471 @@
+/*
+*******************************************************************************
+*
+*      File             : tonedemod_float.c
+*      Purpose          : Single-precision version of the demodulator for
+*                         the Cellular Text Telephone Modem
+*
+*******************************************************************************
+*/
+
+/*
+*******************************************************************************
+*                         MODULE INCLUDE FILE AND VERSION ID
+*******************************************************************************
+*/
+
+#include "tonedemod_float.h"
+#include "tonedemod.h"
+#include "ctm_defines.h"
+
+#include <typedefs.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#if defined(__AVX__) && !defined(TONEDEMOD_SCALAR)
+#define FLOAT_AVX
+#include <immintrin.h>
+#if defined(__FMA__)
+#define madd_ps(a, b, c)  _mm256_fmadd_ps(a, b, c)
+#else
+#define madd_ps(a, b, c)  _mm256_add_ps(_mm256_mul_ps(a, b), c)
+#endif
+#endif
+
+const char tonedemod_float_id[] = "@(#)$Id: $" tonedemod_float_h;
+
+/*
+*******************************************************************************
+*              PRIVATE PROGRAM CODE AND VARIABLES
+*******************************************************************************
+*/
+
+/* output lags of the lowpass computed at a time, two per AVX register */
+#define LP_BLOCK  (SYMB_LEN/2)
+
+static void rotate_right_float(float *samples)
+{
+  Shortint  cnt;
+  float     tmp_value;
+
+  tmp_value = samples[SYMB_LEN-1];
+  for (cnt=SYMB_LEN-1; cnt>0; cnt--)
+    samples[cnt] = samples[cnt-1];
+  samples[0]=tmp_value;
+}
+
+static void rotate_left_float(float *samples)
+{
+  Shortint  cnt;
+  float     tmp_value;
+
+  tmp_value = samples[0];
+  for (cnt=0; cnt<SYMB_LEN-1; cnt++)
+    samples[cnt] = samples[cnt+1];
+  samples[SYMB_LEN-1]=tmp_value;
+}
+
+/* float to Shortint, truncated towards zero like the integer division */
+static Shortint float2short(float value)
+{
+  if (value > 32767.0f)
+    return 32767;
+  if (value < -32767.0f)
+    return -32767;
+  return (Shortint)value;
+}
+
+/* ---------------------------------------------------------------------- */
+
+/* The correlations of the SYMB_LEN+1 lags starting at samples[0] with    */
+/* the tone waveforms, as magnitudes, and the wideband levels.            */
+/*                                                                        */
+/* With the cosine and sine waveforms c and s of a tone (see phasor), the */
+/* window sums R(lag) = sum(x[lag+k]*c[lag+k]), I(lag) = sum(x[lag+k]*    */
+/* s[lag+k]) (k = 0 ... SYMB_LEN-1) move by one lag with                  */
+/*   R(lag+1) = R(lag) + (x[lag+SYMB_LEN]-x[lag])*c[lag]                  */
+/* and the same for I, as the waveforms are periodic in SYMB_LEN. As c    */
+/* and s are A*cos and A*sin of the same phase, the correlation with the  */
+/* sine waveform starting at lag is (c[lag]*I(lag)-s[lag]*R(lag))/A, see  */
+/* demix. The wideband level is a running sum of the magnitudes, exact    */
+/* in float.                                                              */
+
+#if defined(FLOAT_AVX)
+
+static void correlate_float(float xcorr_abs[][4], float *xcorr_wb,
+                            const Shortint *samples,
+                            const demod_float_state_t *demod_state)
+{
+  const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+  Shortint  lag, cnt;
+  float     sum_wb;
+  __m256    sums, sums1, prod;
+  __m128    xcorr;
+
+  sums   = _mm256_setzero_ps();
+  sums1  = _mm256_setzero_ps();
+  sum_wb = 0.0f;
+  for (cnt=0; cnt<SYMB_LEN; cnt+=2)
+    {
+      sums  = madd_ps(_mm256_set1_ps(samples[cnt]),
+                      _mm256_loadu_ps(demod_state->phasor[cnt]), sums);
+      sums1 = madd_ps(_mm256_set1_ps(samples[cnt+1]),
+                      _mm256_loadu_ps(demod_state->phasor[cnt+1]), sums1);
+      sum_wb += (float)(abs(samples[cnt])+abs(samples[cnt+1]));
+    }
+  sums = _mm256_add_ps(sums, sums1);
+
+  for (lag=0; lag<=SYMB_LEN; lag++)
+    {
+      prod  = _mm256_mul_ps(sums, _mm256_loadu_ps(demod_state->demix[lag]));
+      xcorr = _mm_add_ps(_mm256_castps256_ps128(prod),
+                         _mm256_extractf128_ps(prod, 1));
+      _mm_storeu_ps(xcorr_abs[lag], _mm_and_ps(xcorr, abs_mask));
+      xcorr_wb[lag] = sum_wb*(1.0f/SYMB_LEN);
+
+      if (lag<SYMB_LEN)
+        {
+          sums = madd_ps(_mm256_set1_ps((float)(samples[lag+SYMB_LEN]-
+                                                samples[lag])),
+                         _mm256_loadu_ps(demod_state->phasor[lag]), sums);
+          sum_wb += (float)(abs(samples[lag+SYMB_LEN])-abs(samples[lag]));
+        }
+    }
+}
+
+/* lp[lag][tone] = sum(xcorr_abs[SYMB_LEN+lag-cnt][tone]*lowpass[cnt]),   */
+/* for the SYMB_LEN lags; the last coefficient of the lowpass is 0        */
+
+static void lowpass_float(float lp[][4], const float xcorr_abs[][4],
+                          const float *lowpass)
+{
+  Shortint  first, cnt, vec;
+  __m256    coeff;
+  __m256    acc[LP_BLOCK/2];
+
+  for (first=0; first<SYMB_LEN; first+=LP_BLOCK)
+    {
+      for (vec=0; vec<LP_BLOCK/2; vec++)
+        acc[vec] = _mm256_setzero_ps();
+      for (cnt=0; cnt<SYMB_LEN-1; cnt++)
+        {
+          const float *src = xcorr_abs[SYMB_LEN+first-cnt];
+
+          coeff = _mm256_set1_ps(lowpass[cnt]);
+          for (vec=0; vec<LP_BLOCK/2; vec++)
+            acc[vec] = madd_ps(_mm256_loadu_ps(src+8*vec), coeff, acc[vec]);
+        }
+      for (vec=0; vec<LP_BLOCK/2; vec++)
+        _mm256_storeu_ps(lp[first+2*vec], acc[vec]);
+    }
+}
+
+#else
+
+static void correlate_float(float xcorr_abs[][4], float *xcorr_wb,
+                            const Shortint *samples,
+                            const demod_float_state_t *demod_state)
+{
+  Shortint  lag, cnt, lane;
+  float     sum_wb, delta;
+  float     sums[8];
+
+  for (lane=0; lane<8; lane++)
+    sums[lane] = 0.0f;
+  sum_wb = 0.0f;
+  for (cnt=0; cnt<SYMB_LEN; cnt++)
+    {
+      for (lane=0; lane<8; lane++)
+        sums[lane] += samples[cnt]*demod_state->phasor[cnt][lane];
+      sum_wb += (float)abs(samples[cnt]);
+    }
+
+  for (lag=0; lag<=SYMB_LEN; lag++)
+    {
+      for (lane=0; lane<4; lane++)
+        xcorr_abs[lag][lane]
+          = fabsf(sums[lane]*demod_state->demix[lag][lane] +
+                  sums[lane+4]*demod_state->demix[lag][lane+4]);
+      xcorr_wb[lag] = sum_wb*(1.0f/SYMB_LEN);
+
+      if (lag<SYMB_LEN)
+        {
+          delta = (float)(samples[lag+SYMB_LEN]-samples[lag]);
+          for (lane=0; lane<8; lane++)
+            sums[lane] += delta*demod_state->phasor[lag][lane];
+          sum_wb += (float)(abs(samples[lag+SYMB_LEN])-abs(samples[lag]));
+        }
+    }
+}
+
+static void lowpass_float(float lp[][4], const float xcorr_abs[][4],
+                          const float *lowpass)
+{
+  Shortint  first, cnt, lane;
+  float     acc[4*LP_BLOCK];
+
+  for (first=0; first<SYMB_LEN; first+=LP_BLOCK)
+    {
+      for (lane=0; lane<4*LP_BLOCK; lane++)
+        acc[lane] = 0.0f;
+      for (cnt=0; cnt<SYMB_LEN-1; cnt++)
+        {
+          const float *src = xcorr_abs[SYMB_LEN+first-cnt];
+
+          for (lane=0; lane<4*LP_BLOCK; lane++)
+            acc[lane] += src[lane]*lowpass[cnt];
+        }
+      for (lane=0; lane<4*LP_BLOCK; lane++)
+        lp[first+lane/4][lane%4] = acc[lane];
+    }
+}
+
+#endif
+
+/* ---------------------------------------------------------------------- */
+
+/* see demodulate() in tonedemod.c */
+
+static void demodulate_float(Shortint *bits_out,
+                             const Shortint *buffer_tone_rx,
+                             Shortint num_in_samples,
+                             Shortint *ptr_sampling_correction,
+                             demod_float_state_t *demod_state)
+{
+  static const float alpha           = 32113.0f/32768.0f;
+  static const float one_minus_alpha =   655.0f/32768.0f;
+  static const float alpha2          = 32440.0f/32768.0f;
+
+  Shortint  cnt, lag, tone, index_max;
+  Shortint  gain;
+  Shortint  soft_value;
+  float     max_diff;
+  float     max_diff_smooth;
+  float     soft;
+  float     xcorr0, xcorr1, xcorr2, xcorr3, xcorrw;
+
+  float     xcorr_lp[SYMB_LEN][4];
+  float     diff[SYMB_LEN];
+
+  switch (num_in_samples) {
+  case SYMB_LEN-1:
+    rotate_right_float(demod_state->diff_smooth);
+    break;
+  case SYMB_LEN+1:
+    rotate_left_float(demod_state->diff_smooth);
+    break;
+  case SYMB_LEN:
+    break;
+  default:
+    fprintf(stderr, "tonedemod_float: Invalid value for num_in_samples!\n");
+    exit(1);
+  }
+
+  /* The first SYMB_LEN-1 correlation values are those of the last frame */
+  for (lag=0; lag<SYMB_LEN-1; lag++)
+    {
+      for (tone=0; tone<4; tone++)
+        demod_state->xcorr_abs[lag][tone]
+          = demod_state->xcorr_abs[lag+num_in_samples][tone];
+      demod_state->xcorr_wb[lag] = demod_state->xcorr_wb[lag+num_in_samples];
+    }
+
+  /* Calculate the remaining correlation values */
+  correlate_float(demod_state->xcorr_abs+SYMB_LEN-1,
+                  demod_state->xcorr_wb+SYMB_LEN-1,
+                  buffer_tone_rx+SYMB_LEN-1, demod_state);
+
+  /* Calculate the low-pass filtered cross-correlations */
+  lowpass_float(xcorr_lp, demod_state->xcorr_abs, demod_state->lowpass);
+
+  /* Calculate the sum of all possible differences between the */
+  /* low-pass-filtered correlations.                           */
+  for (lag=0; lag<SYMB_LEN; lag++)
+    diff[lag] = (fabsf(xcorr_lp[lag][0]-xcorr_lp[lag][1]) +
+                 fabsf(xcorr_lp[lag][0]-xcorr_lp[lag][2]) +
+                 fabsf(xcorr_lp[lag][0]-xcorr_lp[lag][3]) +
+                 fabsf(xcorr_lp[lag][1]-xcorr_lp[lag][2]) +
+                 fabsf(xcorr_lp[lag][1]-xcorr_lp[lag][3]) +
+                 fabsf(xcorr_lp[lag][2]-xcorr_lp[lag][3]))*(1.0f/6.0f);
+  max_diff = 0.0f;
+  for (lag=0; lag<SYMB_LEN; lag++)
+    if (diff[lag]>max_diff)
+      max_diff = diff[lag];
+
+  /* The adaptive gain of tonedemod() is kept, as it weights the actual */
+  /* frame against the previous ones in diff_smooth.                    */
+  if (max_diff<2048.0f)
+    gain=4;
+  else if (max_diff<4096.0f)
+    gain=3;
+  else if (max_diff<8192.0f)
+    gain=2;
+  else if (max_diff<16384.0f)
+    gain=1;
+  else
+    gain=0;
+
+  /* Update the smoothed difference; what would be less than one LSB in */
+  /* tonedemod() is cleared, so that silence ends in zeros as there.    */
+  for (lag=0; lag<SYMB_LEN; lag++)
+    {
+      if (max_diff > 4.0f)
+        demod_state->diff_smooth[lag] = alpha*demod_state->diff_smooth[lag] +
+          one_minus_alpha*(float)(1<<gain)*diff[lag];
+      else
+        demod_state->diff_smooth[lag] = alpha2*demod_state->diff_smooth[lag];
+      if (demod_state->diff_smooth[lag] < 1.0f)
+        demod_state->diff_smooth[lag] = 0.0f;
+    }
+
+  /* Search the maximum of the smoothed difference */
+  index_max = 0;
+  max_diff_smooth = 0.0f;
+  for (lag=0; lag<SYMB_LEN; lag++)
+    if (demod_state->diff_smooth[lag] > max_diff_smooth)
+      {
+        max_diff_smooth = demod_state->diff_smooth[lag];
+        index_max       = lag;
+      }
+
+  /* Calculate the soft bits from the cross-correlations at the index   */
+  /* that has been determined previously; the wideband level is needed */
+  /* there only.                                                       */
+  xcorr0 = xcorr_lp[index_max][0];
+  xcorr1 = xcorr_lp[index_max][1];
+  xcorr2 = xcorr_lp[index_max][2];
+  xcorr3 = xcorr_lp[index_max][3];
+  xcorrw = 0.0f;
+  for (cnt=0; cnt<SYMB_LEN-1; cnt++)
+    xcorrw += demod_state->xcorr_wb[SYMB_LEN+index_max-cnt]*
+      demod_state->lowpass[cnt];
+
+  if      ((xcorr0 >= xcorr1) && (xcorr0 >= xcorr2) && (xcorr0 >= xcorr3))
+    {
+      soft       = xcorr0-(xcorr1+xcorr2+xcorr3)*(1.0f/3.0f);
+      soft_value = float2short(soft);
+      bits_out[0] = -soft_value;
+      bits_out[1] = -soft_value;
+    }
+  else if ((xcorr1 >= xcorr0) && (xcorr1 >= xcorr2) && (xcorr1 >= xcorr3))
+    {
+      soft       = xcorr1-(xcorr0+xcorr2+xcorr3)*(1.0f/3.0f);
+      soft_value = float2short(soft);
+      bits_out[0] = -soft_value;
+      bits_out[1] =  soft_value;
+    }
+  else if ((xcorr2 >= xcorr0) && (xcorr2 >= xcorr1) && (xcorr2 >= xcorr3))
+    {
+      soft       = xcorr2-(xcorr0+xcorr1+xcorr3)*(1.0f/3.0f);
+      soft_value = float2short(soft);
+      bits_out[0] =  soft_value;
+      bits_out[1] = -soft_value;
+    }
+  else
+    {
+      soft       = xcorr3-(xcorr0+xcorr1+xcorr2)*(1.0f/3.0f);
+      soft_value = float2short(soft);
+      bits_out[0] =  soft_value;
+      bits_out[1] =  soft_value;
+    }
+
+  if (7.0f*soft > xcorrw+10.0f)
+    {
+      bits_out[0] = (bits_out[0] | 0x0001);
+      bits_out[1] = (bits_out[1] | 0x0001);
+    }
+  else
+    {
+      bits_out[0] = (bits_out[0] & 0xFFFE);
+      bits_out[1] = (bits_out[1] & 0xFFFE);
+    }
+
+  /* Calculate the sampling_correction for the next frame. */
+  *ptr_sampling_correction = 0;
+
+  if (max_diff>40.0f)
+    {
+      if (index_max < SYMB_LEN/2)
+        *ptr_sampling_correction = -1;
+
+      if (index_max > SYMB_LEN/2)
+        *ptr_sampling_correction = 1;
+    }
+}
+
+/*
+*******************************************************************************
+*                         PUBLIC PROGRAM CODE
+*******************************************************************************
+*/
+
+void init_tonedemod_float(demod_float_state_t *demod_state)
+{
+  Shortint cnt, tone;
+  float    scale;
+
+  for (tone=0; tone<4; tone++)
+    {
+      /* the peak of the cosine waveform is its first sample */
+      scale = 1.0f/(tonedemod_waveforms_cos[tone][0]*32768.0f);
+      for (cnt=0 ; cnt<SYMB_LEN ; cnt++)
+        {
+          demod_state->phasor[cnt][tone]   = tonedemod_waveforms_cos[tone][cnt];
+          demod_state->phasor[cnt][tone+4] = tonedemod_waveforms[tone][cnt];
+        }
+      for (cnt=0 ; cnt<=SYMB_LEN ; cnt++)
+        {
+          demod_state->demix[cnt][tone]
+            = -tonedemod_waveforms[tone][cnt%SYMB_LEN]*scale;
+          demod_state->demix[cnt][tone+4]
+            = tonedemod_waveforms_cos[tone][cnt%SYMB_LEN]*scale;
+        }
+    }
+  for (cnt=0 ; cnt<SYMB_LEN ; cnt++)
+    {
+      demod_state->lowpass[cnt]     = tonedemod_lowpass_ir[cnt]/32768.0f;
+      demod_state->diff_smooth[cnt] = 0.0f;
+    }
+  for (cnt=0 ; cnt<2*SYMB_LEN ; cnt++)
+    {
+      for (tone=0; tone<4; tone++)
+        demod_state->xcorr_abs[cnt][tone] = 0.0f;
+      demod_state->xcorr_wb[cnt] = 0.0f;
+    }
+  for (cnt=0 ; cnt<3*SYMB_LEN ; cnt++)
+    demod_state->buffer_tone_rx[cnt] = 0;
+}
+
+void tonedemod_float(Shortint *bits_out,
+                     Shortint *in_samples,
+                     Shortint num_in_samples,
+                     Shortint *ptr_sampling_correction,
+                     demod_float_state_t *demod_state)
+{
+  Shortint cnt;
+
+  if ((num_in_samples>=SYMB_LEN-1) && (num_in_samples<=SYMB_LEN+1))
+    {
+      for (cnt=0; cnt<3*SYMB_LEN-num_in_samples; cnt++)
+        demod_state->buffer_tone_rx[cnt]
+          = demod_state->buffer_tone_rx[cnt+num_in_samples];
+
+      for (cnt=0; cnt<num_in_samples; cnt++)
+        demod_state->buffer_tone_rx[cnt+3*SYMB_LEN-num_in_samples]
+          = in_samples[cnt];
+    }
+
+  demodulate_float(bits_out, demod_state->buffer_tone_rx, num_in_samples,
+                   ptr_sampling_correction, demod_state);
+}
+
+void tonedemod_float_in_place(Shortint *bits_out,
+                              const Shortint *in_samples,
+                              Shortint num_in_samples,
+                              Shortint *ptr_sampling_correction,
+                              demod_float_state_t *demod_state)
+{
+  demodulate_float(bits_out, in_samples+num_in_samples-TONEDEMOD_HISTORY_LEN,
+                   num_in_samples, ptr_sampling_correction, demod_state);
+}
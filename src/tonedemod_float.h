@@ -0,0 +1,115 @@
+/*
+*******************************************************************************
+*
+*      File             : tonedemod_float.h
+*      Purpose          : Single-precision version of the demodulator for
+*                         the Cellular Text Telephone Modem
+*
+*                         Definition of the type demod_float_state_t and of
+*                         the functions init_tonedemod_float(),
+*                         tonedemod_float() and tonedemod_float_in_place()
+*
+*      The same decisions as tonedemod(), on float instead of 16 bit fixed
+*      point, for receivers that need throughput more than bit-exactness.
+*      The range of float allows two shortcuts that the 16 bit kernels
+*      cannot take:
+*
+*      - the correlations with the four tones are those of a sliding
+*        complex DFT over SYMB_LEN samples: the window sums of
+*        sample*cos and sample*sin of the four tones fill the eight lanes
+*        of an AVX register, and moving the window by one lag is a single
+*        multiply-add; the wideband level is a running sum as well.
+*      - the lowpass filters the magnitudes of all four tones at two lags
+*        per AVX register, and that of the wideband level is computed at
+*        the chosen sampling instant only, the one place where it is used.
+*
+*      With __AVX__ (and __FMA__, if set), these run on explicit AVX
+*      intrinsics; otherwise, or with TONEDEMOD_SCALAR, on plain C that
+*      the compiler may vectorize. Neither is bit-exact with tonedemod():
+*      the soft bits have the same scale, but differ in the last bits, and
+*      near the edges of the decisions, so can the choice of the sampling
+*      instant (ctmcompare reports the agreement with the fixed point
+*      version). The correlator and lag tracking settings of tonedemod()
+*      do not apply here.
+*
+*******************************************************************************
+*/
+
+#ifndef tonedemod_float_h
+#define tonedemod_float_h "$Id: $"
+
+/*
+*******************************************************************************
+*                         INCLUDE FILES
+*******************************************************************************
+*/
+
+#include "ctm_defines.h"
+#include "tonedemod.h"
+
+#include <typedefs.h>
+
+/*
+*******************************************************************************
+*                         DECLARATION OF PROTOTYPES
+*******************************************************************************
+*/
+
+typedef struct {
+  Shortint  buffer_tone_rx[3*SYMB_LEN];  /* used by tonedemod_float() only */
+
+  /* magnitudes of the correlations with the four tones and wideband    */
+  /* levels of the last 2*SYMB_LEN lags; xcorr_abs[lag][tone]           */
+  float     xcorr_abs[2*SYMB_LEN][4];
+  float     xcorr_wb[2*SYMB_LEN];
+  float     diff_smooth[SYMB_LEN];
+
+  /* tables derived from those of tonedemod():                           */
+  /* phasor[cnt] = cosine waveforms of the tones 0..3, sine waveforms of */
+  /* the tones 0..3; demix[lag] turns the window sums of the sliding DFT */
+  /* at lag into the correlations with the waveforms of tonedemod();     */
+  /* lowpass = tonedemod_lowpass_ir/32768                                */
+  float     phasor[SYMB_LEN][8];
+  float     demix[SYMB_LEN+1][8];
+  float     lowpass[SYMB_LEN];
+} demod_float_state_t;
+
+
+/* ----------------------------------------------------------------------- */
+/* FUNCTION init_tonedemod_float()                                         */
+/* *******************************                                         */
+/* Initialization of one instance of the single-precision demodulator.     */
+/* ----------------------------------------------------------------------- */
+
+void init_tonedemod_float(demod_float_state_t *demod_state);
+
+
+/* ----------------------------------------------------------------------- */
+/* FUNCTION tonedemod_float()                                              */
+/* **************************                                              */
+/* Same interface as tonedemod(): the two soft bits of the frame of        */
+/* num_in_samples (SYMB_LEN-1 ... SYMB_LEN+1) samples, and the sampling    */
+/* correction for the next frame.                                          */
+/* ----------------------------------------------------------------------- */
+
+void tonedemod_float(Shortint *bits_out,
+                     Shortint *rx_tone_vec,
+                     Shortint num_in_samples,
+                     Shortint *ptr_sampling_correction,
+                     demod_float_state_t *demod_state);
+
+
+/* ----------------------------------------------------------------------- */
+/* FUNCTION tonedemod_float_in_place()                                     */
+/* ***********************************                                     */
+/* Same as tonedemod_in_place(): the TONEDEMOD_HISTORY_LEN-num_in_samples  */
+/* samples in front of in_samples must be the previous input.              */
+/* ----------------------------------------------------------------------- */
+
+void tonedemod_float_in_place(Shortint *bits_out,
+                              const Shortint *in_samples,
+                              Shortint num_in_samples,
+                              Shortint *ptr_sampling_correction,
+                              demod_float_state_t *demod_state);
+
+#endif
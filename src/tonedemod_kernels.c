@@ -0,0 +1,406 @@
+/*
+*******************************************************************************
+*
+*      File             : tonedemod_kernels.c
+*      Purpose          : Inner loops of the CTM tone demodulator, with SIMD
+*                         versions for AVX2, SSE2 and NEON
+*
+*******************************************************************************
+*/
+
+/*
+*******************************************************************************
+*                         MODULE INCLUDE FILE AND VERSION ID
+*******************************************************************************
+*/
+
+#include "tonedemod_kernels.h"
+#include "ctm_defines.h"
+
+#include <typedefs.h>
+#include <stdlib.h>
+
+/* The vector versions load eight samples at a time. */
+#if !defined(TONEDEMOD_SCALAR) && SYMB_LEN%8 == 0
+#if defined(__AVX2__)
+#define KERNELS_AVX2
+#define KERNELS_SSE2
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#define KERNELS_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define KERNELS_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+const char tonedemod_kernels_id[] = "@(#)$Id: $" tonedemod_kernels_h;
+
+/*
+*******************************************************************************
+*              PRIVATE PROGRAM CODE AND VARIABLES
+*******************************************************************************
+*/
+
+/* ---------------------------------------------------------------------- */
+/* acc_t holds partial sums of a dot product over SYMB_LEN taps:          */
+/*   dot_symb(a, b)      sum(a[k]*b[k])                                   */
+/*   dot_abs_symb(a)     sum(abs(a[k]))                                   */
+/*   reduce4(sums, ...)  the four complete sums                           */
+/* ---------------------------------------------------------------------- */
+
+#if defined(KERNELS_SSE2)
+
+typedef __m128i acc_t;
+
+static inline acc_t acc_zero(void)
+{
+  return _mm_setzero_si128();
+}
+
+static inline acc_t dot_symb(const Shortint *a, const Shortint *b)
+{
+  acc_t    acc;
+  Shortint cnt = 0;
+
+#if defined(KERNELS_AVX2)
+  __m256i  acc256 = _mm256_setzero_si256();
+
+  for (; cnt+16<=SYMB_LEN; cnt+=16)
+    acc256 = _mm256_add_epi32(acc256,
+      _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *)(a+cnt)),
+                        _mm256_loadu_si256((const __m256i *)(b+cnt))));
+  acc = _mm_add_epi32(_mm256_castsi256_si128(acc256),
+                      _mm256_extracti128_si256(acc256, 1));
+#else
+  acc = _mm_setzero_si128();
+#endif
+  for (; cnt<SYMB_LEN; cnt+=8)
+    acc = _mm_add_epi32(acc,
+      _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(a+cnt)),
+                     _mm_loadu_si128((const __m128i *)(b+cnt))));
+  return acc;
+}
+
+/* abs(a) = a*sign(a), with the product in 32 bits (also for -32768) */
+static inline acc_t dot_abs_symb(const Shortint *a)
+{
+  const __m128i one = _mm_set1_epi16(1);
+  acc_t    acc = _mm_setzero_si128();
+  __m128i  x;
+  Shortint cnt;
+
+  for (cnt=0; cnt<SYMB_LEN; cnt+=8)
+    {
+      x   = _mm_loadu_si128((const __m128i *)(a+cnt));
+      acc = _mm_add_epi32(acc,
+              _mm_madd_epi16(x, _mm_or_si128(_mm_srai_epi16(x, 15), one)));
+    }
+  return acc;
+}
+
+static inline void reduce4(Longint sums[4], acc_t a, acc_t b, acc_t c, acc_t d)
+{
+  __m128i ab, cd;
+
+  ab = _mm_add_epi32(_mm_unpacklo_epi32(a, b), _mm_unpackhi_epi32(a, b));
+  cd = _mm_add_epi32(_mm_unpacklo_epi32(c, d), _mm_unpackhi_epi32(c, d));
+  _mm_storeu_si128((__m128i *)sums,
+                   _mm_add_epi32(_mm_unpacklo_epi64(ab, cd),
+                                 _mm_unpackhi_epi64(ab, cd)));
+}
+
+#elif defined(KERNELS_NEON)
+
+typedef int32x4_t acc_t;
+
+static inline acc_t acc_zero(void)
+{
+  return vdupq_n_s32(0);
+}
+
+static inline acc_t dot_symb(const Shortint *a, const Shortint *b)
+{
+  acc_t     acc = vdupq_n_s32(0);
+  int16x8_t x, y;
+  Shortint  cnt;
+
+  for (cnt=0; cnt<SYMB_LEN; cnt+=8)
+    {
+      x   = vld1q_s16(a+cnt);
+      y   = vld1q_s16(b+cnt);
+      acc = vmlal_s16(acc, vget_low_s16(x), vget_low_s16(y));
+      acc = vmlal_s16(acc, vget_high_s16(x), vget_high_s16(y));
+    }
+  return acc;
+}
+
+static inline acc_t dot_abs_symb(const Shortint *a)
+{
+  acc_t     acc = vdupq_n_s32(0);
+  int16x8_t x, sign;
+  Shortint  cnt;
+
+  for (cnt=0; cnt<SYMB_LEN; cnt+=8)
+    {
+      x    = vld1q_s16(a+cnt);
+      sign = vorrq_s16(vshrq_n_s16(x, 15), vdupq_n_s16(1));
+      acc  = vmlal_s16(acc, vget_low_s16(x), vget_low_s16(sign));
+      acc  = vmlal_s16(acc, vget_high_s16(x), vget_high_s16(sign));
+    }
+  return acc;
+}
+
+static inline void reduce4(Longint sums[4], acc_t a, acc_t b, acc_t c, acc_t d)
+{
+  vst1q_s32(sums, vpaddq_s32(vpaddq_s32(a, b), vpaddq_s32(c, d)));
+}
+
+#else
+
+typedef Longint acc_t;
+
+static inline acc_t acc_zero(void)
+{
+  return 0L;
+}
+
+static inline acc_t dot_symb(const Shortint *a, const Shortint *b)
+{
+  Longint  sum = 0L;
+  Shortint cnt;
+
+  for (cnt=0; cnt<SYMB_LEN; cnt++)
+    sum += (Longint)a[cnt]*(Longint)b[cnt];
+  return sum;
+}
+
+static inline acc_t dot_abs_symb(const Shortint *a)
+{
+  Longint  sum = 0L;
+  Shortint cnt;
+
+  for (cnt=0; cnt<SYMB_LEN; cnt++)
+    sum += (Longint)abs(a[cnt]);
+  return sum;
+}
+
+static inline void reduce4(Longint sums[4], acc_t a, acc_t b, acc_t c, acc_t d)
+{
+  sums[0] = a;
+  sums[1] = b;
+  sums[2] = c;
+  sums[3] = d;
+}
+
+#endif
+
+/*
+*******************************************************************************
+*                         PUBLIC PROGRAM CODE
+*******************************************************************************
+*/
+
+void tonedemod_correlate(Shortint *const xcorr[4], Shortint *xcorr_wb,
+                         const Shortint *samples,
+                         const Shortint *const waveforms[4],
+                         Shortint num_lags)
+{
+  Longint  sums[4];
+  Shortint lag, cnt;
+
+  for (lag=0; lag<num_lags; lag++)
+    {
+      reduce4(sums,
+              dot_symb(samples+lag, waveforms[0]),
+              dot_symb(samples+lag, waveforms[1]),
+              dot_symb(samples+lag, waveforms[2]),
+              dot_symb(samples+lag, waveforms[3]));
+      for (cnt=0; cnt<4; cnt++)
+        xcorr[cnt][lag] = sums[cnt]>>15;
+    }
+
+  /* the wideband level, four lags at a time */
+  for (lag=0; lag<num_lags; lag+=4)
+    {
+      reduce4(sums,
+              dot_abs_symb(samples+lag),
+              lag+1<num_lags ? dot_abs_symb(samples+lag+1) : acc_zero(),
+              lag+2<num_lags ? dot_abs_symb(samples+lag+2) : acc_zero(),
+              lag+3<num_lags ? dot_abs_symb(samples+lag+3) : acc_zero());
+      for (cnt=0; cnt<4 && lag+cnt<num_lags; cnt++)
+        xcorr_wb[lag+cnt] = sums[cnt]/SYMB_LEN;
+    }
+}
+
+void tonedemod_abs(Shortint *out, const Shortint *in, Shortint len)
+{
+  Shortint cnt = 0;
+
+#if defined(KERNELS_AVX2)
+  for (; cnt+16<=len; cnt+=16)
+    _mm256_storeu_si256((__m256i *)(out+cnt),
+      _mm256_abs_epi16(_mm256_loadu_si256((const __m256i *)(in+cnt))));
+#endif
+#if defined(KERNELS_SSE2)
+  for (; cnt+8<=len; cnt+=8)
+    {
+      __m128i x = _mm_loadu_si128((const __m128i *)(in+cnt));
+      _mm_storeu_si128((__m128i *)(out+cnt),
+        _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x)));
+    }
+#elif defined(KERNELS_NEON)
+  for (; cnt+8<=len; cnt+=8)
+    vst1q_s16(out+cnt, vabsq_s16(vld1q_s16(in+cnt)));
+#endif
+  for (; cnt<len; cnt++)
+    out[cnt] = abs(in[cnt]);
+}
+
+void tonedemod_lowpass(Shortint *const out[5], const Shortint *const in[5],
+                       const Shortint *taps, Shortint num_lags)
+{
+  Longint  sums[4];
+  Shortint lag, cnt;
+
+  for (lag=0; lag<num_lags; lag++)
+    {
+      reduce4(sums,
+              dot_symb(in[0]+lag, taps),
+              dot_symb(in[1]+lag, taps),
+              dot_symb(in[2]+lag, taps),
+              dot_symb(in[3]+lag, taps));
+      for (cnt=0; cnt<4; cnt++)
+        out[cnt][lag] = sums[cnt]>>15;
+    }
+
+  /* the fifth signal, four lags at a time */
+  for (lag=0; lag<num_lags; lag+=4)
+    {
+      reduce4(sums,
+              dot_symb(in[4]+lag, taps),
+              lag+1<num_lags ? dot_symb(in[4]+lag+1, taps) : acc_zero(),
+              lag+2<num_lags ? dot_symb(in[4]+lag+2, taps) : acc_zero(),
+              lag+3<num_lags ? dot_symb(in[4]+lag+3, taps) : acc_zero());
+      for (cnt=0; cnt<4 && lag+cnt<num_lags; cnt++)
+        out[4][lag+cnt] = sums[cnt]>>15;
+    }
+}
+
+void tonedemod_diff(Shortint *diff, const Shortint *const xcorr_lp[4],
+                    Shortint len)
+{
+  Shortint cnt = 0;
+  Longint  sum;
+
+#if defined(KERNELS_AVX2)
+  {
+    const __m256i mul = _mm256_set1_epi32(DIV6_MUL);
+    __m256i t0, t1, t2, t3, s, even, odd;
+
+    for (; cnt+8<=len; cnt+=8)
+      {
+        t0 = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(xcorr_lp[0]+cnt)));
+        t1 = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(xcorr_lp[1]+cnt)));
+        t2 = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(xcorr_lp[2]+cnt)));
+        t3 = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(xcorr_lp[3]+cnt)));
+        s  = _mm256_add_epi32(
+               _mm256_add_epi32(
+                 _mm256_add_epi32(_mm256_abs_epi32(_mm256_sub_epi32(t0, t1)),
+                                  _mm256_abs_epi32(_mm256_sub_epi32(t0, t2))),
+                 _mm256_add_epi32(_mm256_abs_epi32(_mm256_sub_epi32(t0, t3)),
+                                  _mm256_abs_epi32(_mm256_sub_epi32(t1, t2)))),
+               _mm256_add_epi32(_mm256_abs_epi32(_mm256_sub_epi32(t1, t3)),
+                                _mm256_abs_epi32(_mm256_sub_epi32(t2, t3))));
+
+        /* s/6 in 64 bit products, even and odd lanes */
+        even = _mm256_srli_epi64(_mm256_mul_epu32(s, mul), DIV6_SHIFT);
+        odd  = _mm256_srli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(s, 32), mul),
+                                 DIV6_SHIFT);
+        s    = _mm256_or_si256(even, _mm256_slli_epi64(odd, 32));
+
+        /* truncate to Shortint, as the cast does */
+        s = _mm256_srai_epi32(_mm256_slli_epi32(s, 16), 16);
+        s = _mm256_permute4x64_epi64(_mm256_packs_epi32(s, s), 0x08);
+        _mm_storeu_si128((__m128i *)(diff+cnt), _mm256_castsi256_si128(s));
+      }
+  }
+#elif defined(KERNELS_SSE2)
+  {
+    const __m128i mul = _mm_set1_epi32(DIV6_MUL);
+    __m128i t0, t1, t2, t3, d, s, even, odd;
+
+#define LOAD_EPI16_EPI32(p) \
+    _mm_srai_epi32(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)(p)), \
+                                      _mm_loadl_epi64((const __m128i *)(p))), 16)
+#define ABS_DIFF_EPI32(a, b) \
+    (d = _mm_sub_epi32(a, b), \
+     _mm_sub_epi32(_mm_xor_si128(d, _mm_srai_epi32(d, 31)), _mm_srai_epi32(d, 31)))
+
+    for (; cnt+4<=len; cnt+=4)
+      {
+        t0 = LOAD_EPI16_EPI32(xcorr_lp[0]+cnt);
+        t1 = LOAD_EPI16_EPI32(xcorr_lp[1]+cnt);
+        t2 = LOAD_EPI16_EPI32(xcorr_lp[2]+cnt);
+        t3 = LOAD_EPI16_EPI32(xcorr_lp[3]+cnt);
+        s  = ABS_DIFF_EPI32(t0, t1);
+        s  = _mm_add_epi32(s, ABS_DIFF_EPI32(t0, t2));
+        s  = _mm_add_epi32(s, ABS_DIFF_EPI32(t0, t3));
+        s  = _mm_add_epi32(s, ABS_DIFF_EPI32(t1, t2));
+        s  = _mm_add_epi32(s, ABS_DIFF_EPI32(t1, t3));
+        s  = _mm_add_epi32(s, ABS_DIFF_EPI32(t2, t3));
+
+        /* s/6 in 64 bit products, even and odd lanes */
+        even = _mm_srli_epi64(_mm_mul_epu32(s, mul), DIV6_SHIFT);
+        odd  = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(s, 32), mul),
+                              DIV6_SHIFT);
+        s    = _mm_or_si128(even, _mm_slli_epi64(odd, 32));
+
+        /* truncate to Shortint, as the cast does */
+        s = _mm_srai_epi32(_mm_slli_epi32(s, 16), 16);
+        _mm_storel_epi64((__m128i *)(diff+cnt), _mm_packs_epi32(s, s));
+      }
+
+#undef LOAD_EPI16_EPI32
+#undef ABS_DIFF_EPI32
+  }
+#elif defined(KERNELS_NEON)
+  {
+    int32x4_t  t0, t1, t2, t3, s;
+    uint32x4_t q;
+
+    for (; cnt+4<=len; cnt+=4)
+      {
+        t0 = vmovl_s16(vld1_s16(xcorr_lp[0]+cnt));
+        t1 = vmovl_s16(vld1_s16(xcorr_lp[1]+cnt));
+        t2 = vmovl_s16(vld1_s16(xcorr_lp[2]+cnt));
+        t3 = vmovl_s16(vld1_s16(xcorr_lp[3]+cnt));
+        s  = vabdq_s32(t0, t1);
+        s  = vabaq_s32(s, t0, t2);
+        s  = vabaq_s32(s, t0, t3);
+        s  = vabaq_s32(s, t1, t2);
+        s  = vabaq_s32(s, t1, t3);
+        s  = vabaq_s32(s, t2, t3);
+
+        /* s/6 in 64 bit products; the narrowing truncates as the cast */
+        q  = vreinterpretq_u32_s32(s);
+        q  = vcombine_u32(
+               vshrn_n_u64(vmull_n_u32(vget_low_u32(q), DIV6_MUL), DIV6_SHIFT),
+               vshrn_n_u64(vmull_n_u32(vget_high_u32(q), DIV6_MUL), DIV6_SHIFT));
+        vst1_s16(diff+cnt, vreinterpret_s16_u16(vmovn_u32(q)));
+      }
+  }
+#endif
+
+  for (; cnt<len; cnt++)
+    {
+      sum = (labs((Longint)xcorr_lp[0][cnt]-(Longint)xcorr_lp[1][cnt]) +
+             labs((Longint)xcorr_lp[0][cnt]-(Longint)xcorr_lp[2][cnt]) +
+             labs((Longint)xcorr_lp[0][cnt]-(Longint)xcorr_lp[3][cnt]) +
+             labs((Longint)xcorr_lp[1][cnt]-(Longint)xcorr_lp[2][cnt]) +
+             labs((Longint)xcorr_lp[1][cnt]-(Longint)xcorr_lp[3][cnt]) +
+             labs((Longint)xcorr_lp[2][cnt]-(Longint)xcorr_lp[3][cnt]));
+      diff[cnt] = (Shortint)(sum/6);
+    }
+}
@@ -0,0 +1,124 @@
+/*
+*******************************************************************************
+*
+*      File             : tonedemod_kernels.h
+*      Purpose          : Inner loops of the CTM tone demodulator on 16 bit
+*                         data: correlation with the tone waveforms,
+*                         magnitudes, lowpass and differences of the tones
+*
+*      The kernels are written with the 16 bit multiply-add instructions of
+*      AVX2, SSE2 or NEON (aarch64), whichever the compiler is allowed to
+*      use (e.g. "make ARCHFLAGS=-mavx2"), and in plain C otherwise, or if
+*      TONEDEMOD_SCALAR is defined. The products of Shortint values and
+*      their sums over SYMB_LEN taps are exact in 32 bits, so every version
+*      gives the same results, bit for bit, as the loops of tonedemod()
+*      that they replace; only the order of the additions differs.
+*
+*******************************************************************************
+*/
+
+#ifndef tonedemod_kernels_h
+#define tonedemod_kernels_h "$Id: $"
+
+/*
+*******************************************************************************
+*                         INCLUDE FILES
+*******************************************************************************
+*/
+
+#include "ctm_defines.h"
+
+#include <typedefs.h>
+
+/*
+*******************************************************************************
+*                         DECLARATION OF PROTOTYPES
+*******************************************************************************
+*/
+
+/* x/6 = (x*DIV6_MUL)>>DIV6_SHIFT for 0 <= x <= 6*65535 (checked for */
+/* every x of this range by ctmcheck), see tonedemod_diff()          */
+#define DIV6_MUL   174763   /* = ceil(2^20/6) */
+#define DIV6_SHIFT 20
+
+/*
+*******************************************************************************
+*
+*     Function        : tonedemod_correlate
+*     In              : samples         num_lags+SYMB_LEN-1 input samples
+*                       waveforms       the four tone waveforms,
+*                                       SYMB_LEN samples each
+*                       num_lags        number of lags
+*     Out             : xcorr           per tone, num_lags correlations
+*                                       sum(samples[lag+k]*waveform[k])>>15
+*                       xcorr_wb        num_lags wideband levels
+*                                       sum(abs(samples[lag+k]))/SYMB_LEN
+*     Return          : -
+*     Information     : the sums run over k = 0 ... SYMB_LEN-1
+*
+*******************************************************************************
+*/
+
+void tonedemod_correlate(Shortint *const xcorr[4], Shortint *xcorr_wb,
+                         const Shortint *samples,
+                         const Shortint *const waveforms[4],
+                         Shortint num_lags);
+
+/*
+*******************************************************************************
+*
+*     Function        : tonedemod_abs
+*     In              : in              len values
+*     Out             : out             (Shortint)abs(in[i])
+*     Return          : -
+*     Information     : -32768 stays -32768, as with abs() and a cast
+*
+*******************************************************************************
+*/
+
+void tonedemod_abs(Shortint *out, const Shortint *in, Shortint len);
+
+/*
+*******************************************************************************
+*
+*     Function        : tonedemod_lowpass
+*     In              : in              five signals, num_lags+SYMB_LEN-1
+*                                       samples each
+*                       taps            SYMB_LEN filter taps, in the order
+*                                       in which they meet the samples
+*                       num_lags        number of output values
+*     Out             : out             per signal, num_lags values
+*                                       sum(in[lag+k]*taps[k])>>15
+*     Return          : -
+*     Information     : the four tones and the wideband level of tonedemod()
+*                       are filtered in one go; the sums run over
+*                       k = 0 ... SYMB_LEN-1
+*
+*******************************************************************************
+*/
+
+void tonedemod_lowpass(Shortint *const out[5], const Shortint *const in[5],
+                       const Shortint *taps, Shortint num_lags);
+
+/*
+*******************************************************************************
+*
+*     Function        : tonedemod_diff
+*     In              : xcorr_lp        the four lowpass filtered tones,
+*                                       len values each
+*     Out             : diff            len values, the sum of the six
+*                                       absolute differences between the
+*                                       tones, divided by 6
+*     Return          : -
+*     Information     : the vector versions divide by a multiplication with
+*                       ceil(2^20/6) and a shift by 20 bits, which is exact
+*                       for all sums of six differences of Shortint values
+*                       (up to 6*65535)
+*
+*******************************************************************************
+*/
+
+void tonedemod_diff(Shortint *diff, const Shortint *const xcorr_lp[4],
+                    Shortint len);
+
+#endif
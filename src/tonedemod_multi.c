@@ -0,0 +1,913 @@
+/*
+*******************************************************************************
+*
+*      File             : tonedemod_multi.c
+*      Purpose          : CTM tone demodulator for several channels at once,
+*                         with SIMD versions for AVX2 and SSE2
+*
+*******************************************************************************
+*/
+
+/*
+*******************************************************************************
+*                         MODULE INCLUDE FILE AND VERSION ID
+*******************************************************************************
+*/
+
+#include "tonedemod_multi.h"
+#include "tonedemod_kernels.h"
+#include "tonedemod.h"
+#include "ctm_defines.h"
+
+#include <typedefs.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* The vector versions hold the eight lanes in one register of 16 bit */
+/* values, and in one (AVX2) or two (SSE2) registers of 32 bit ones. */
+#if !defined(TONEDEMOD_SCALAR) && TONEDEMOD_LANES == 8 && SYMB_LEN%8 == 0
+#if defined(__AVX2__)
+#define MULTI_AVX2
+#define MULTI_SSE2
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#define MULTI_SSE2
+#include <emmintrin.h>
+#endif
+#endif
+
+const char tonedemod_multi_id[] = "@(#)$Id: $" tonedemod_multi_h;
+
+/*
+*******************************************************************************
+*              PRIVATE PROGRAM CODE AND VARIABLES
+*******************************************************************************
+*/
+
+/* lags of the filters that are calculated at once, and the lags of */
+/* the correlation, rounded up to a multiple of them                 */
+#define LAG_BLOCK 4
+#define NUM_CORR_LAGS (SYMB_LEN+1)
+#define NUM_CORR_BLOCKS (((NUM_CORR_LAGS+LAG_BLOCK-1)/LAG_BLOCK)*LAG_BLOCK)
+
+/* ---------------------------------------------------------------------- */
+/* lanes16_t holds one Shortint of each lane, lanes32_t one Longint of    */
+/* each lane, or a pair of Shortint values (the first one in the lower    */
+/* 16 bits), which the multiply-add l32_madd() works on:                  */
+/*   l32_madd(l32_pair(a, b), l32_pair(c, d)) = a*c+b*d in each lane      */
+/* The narrowing l32_narrow() truncates, as a cast to Shortint does.      */
+/* ---------------------------------------------------------------------- */
+
+#if defined(MULTI_SSE2)
+
+typedef __m128i lanes16_t;
+
+static inline lanes16_t l16_load(const Shortint *p)
+{
+  return _mm_loadu_si128((const __m128i *)p);
+}
+
+static inline void l16_store(Shortint *p, lanes16_t a)
+{
+  _mm_storeu_si128((__m128i *)p, a);
+}
+
+static inline lanes16_t l16_set1(Shortint a)
+{
+  return _mm_set1_epi16(a);
+}
+
+static inline lanes16_t l16_max(lanes16_t a, lanes16_t b)
+{
+  return _mm_max_epi16(a, b);
+}
+
+/* -32768 stays -32768, as with abs() and a cast */
+static inline lanes16_t l16_abs(lanes16_t a)
+{
+  return _mm_max_epi16(a, _mm_sub_epi16(_mm_setzero_si128(), a));
+}
+
+/* c where a > b, else d */
+static inline lanes16_t l16_select_gt(lanes16_t a, lanes16_t b,
+                                      lanes16_t c, lanes16_t d)
+{
+  __m128i mask = _mm_cmpgt_epi16(a, b);
+
+  return _mm_or_si128(_mm_and_si128(mask, c), _mm_andnot_si128(mask, d));
+}
+
+/* the rows of an 8x8 matrix become its columns */
+static inline void transpose8(__m128i r[8])
+{
+  __m128i a0, a1, a2, a3, a4, a5, a6, a7;
+  __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+
+  a0 = _mm_unpacklo_epi16(r[0], r[1]);
+  a1 = _mm_unpackhi_epi16(r[0], r[1]);
+  a2 = _mm_unpacklo_epi16(r[2], r[3]);
+  a3 = _mm_unpackhi_epi16(r[2], r[3]);
+  a4 = _mm_unpacklo_epi16(r[4], r[5]);
+  a5 = _mm_unpackhi_epi16(r[4], r[5]);
+  a6 = _mm_unpacklo_epi16(r[6], r[7]);
+  a7 = _mm_unpackhi_epi16(r[6], r[7]);
+  b0 = _mm_unpacklo_epi32(a0, a2);
+  b1 = _mm_unpackhi_epi32(a0, a2);
+  b2 = _mm_unpacklo_epi32(a1, a3);
+  b3 = _mm_unpackhi_epi32(a1, a3);
+  b4 = _mm_unpacklo_epi32(a4, a6);
+  b5 = _mm_unpackhi_epi32(a4, a6);
+  b6 = _mm_unpacklo_epi32(a5, a7);
+  b7 = _mm_unpackhi_epi32(a5, a7);
+  r[0] = _mm_unpacklo_epi64(b0, b4);
+  r[1] = _mm_unpackhi_epi64(b0, b4);
+  r[2] = _mm_unpacklo_epi64(b1, b5);
+  r[3] = _mm_unpackhi_epi64(b1, b5);
+  r[4] = _mm_unpacklo_epi64(b2, b6);
+  r[5] = _mm_unpackhi_epi64(b2, b6);
+  r[6] = _mm_unpacklo_epi64(b3, b7);
+  r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+/* rows[i] = the element i of every lane, for 0 <= i < num (num is a */
+/* multiple of 8)                                                    */
+static void gather_rows(lanes16_t *rows, const Shortint *const lanes[TONEDEMOD_LANES],
+                        Shortint num)
+{
+  __m128i  r[8];
+  Shortint i, cnt;
+
+  for (i=0; i<num; i+=8)
+    {
+      for (cnt=0; cnt<8; cnt++)
+        r[cnt] = _mm_loadu_si128((const __m128i *)(lanes[cnt]+i));
+      transpose8(r);
+      for (cnt=0; cnt<8; cnt++)
+        rows[i+cnt] = r[cnt];
+    }
+}
+
+/* the element i of every lane = rows[i], for 0 <= i < num */
+static void scatter_rows(Shortint *const lanes[TONEDEMOD_LANES],
+                         const lanes16_t *rows, Shortint num)
+{
+  __m128i  r[8];
+  Shortint i, cnt, lane;
+
+  for (i=0; i+8<=num; i+=8)
+    {
+      for (cnt=0; cnt<8; cnt++)
+        r[cnt] = rows[i+cnt];
+      transpose8(r);
+      for (cnt=0; cnt<8; cnt++)
+        _mm_storeu_si128((__m128i *)(lanes[cnt]+i), r[cnt]);
+    }
+  for (; i<num; i++)
+    for (lane=0; lane<8; lane++)
+      lanes[lane][i] = ((const Shortint *)&rows[i])[lane];
+}
+
+static inline Shortint l16_lane(const lanes16_t *a, Shortint lane)
+{
+  return ((const Shortint *)a)[lane];
+}
+
+#else
+
+typedef struct { Shortint v[TONEDEMOD_LANES]; } lanes16_t;
+
+static inline lanes16_t l16_load(const Shortint *p)
+{
+  lanes16_t r;
+
+  memcpy(r.v, p, sizeof(r.v));
+  return r;
+}
+
+static inline void l16_store(Shortint *p, lanes16_t a)
+{
+  memcpy(p, a.v, sizeof(a.v));
+}
+
+static inline lanes16_t l16_set1(Shortint a)
+{
+  lanes16_t r;
+  Shortint  lane;
+
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    r.v[lane] = a;
+  return r;
+}
+
+static inline lanes16_t l16_max(lanes16_t a, lanes16_t b)
+{
+  Shortint lane;
+
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    if (b.v[lane] > a.v[lane])
+      a.v[lane] = b.v[lane];
+  return a;
+}
+
+static inline lanes16_t l16_abs(lanes16_t a)
+{
+  Shortint lane;
+
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    a.v[lane] = abs(a.v[lane]);
+  return a;
+}
+
+static inline lanes16_t l16_select_gt(lanes16_t a, lanes16_t b,
+                                      lanes16_t c, lanes16_t d)
+{
+  Shortint lane;
+
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    if (a.v[lane] > b.v[lane])
+      d.v[lane] = c.v[lane];
+  return d;
+}
+
+static void gather_rows(lanes16_t *rows,
+                        const Shortint *const lanes[TONEDEMOD_LANES],
+                        Shortint num)
+{
+  Shortint i, lane;
+
+  for (i=0; i<num; i++)
+    for (lane=0; lane<TONEDEMOD_LANES; lane++)
+      rows[i].v[lane] = lanes[lane][i];
+}
+
+static void scatter_rows(Shortint *const lanes[TONEDEMOD_LANES],
+                         const lanes16_t *rows, Shortint num)
+{
+  Shortint i, lane;
+
+  for (i=0; i<num; i++)
+    for (lane=0; lane<TONEDEMOD_LANES; lane++)
+      lanes[lane][i] = rows[i].v[lane];
+}
+
+static inline Shortint l16_lane(const lanes16_t *a, Shortint lane)
+{
+  return a->v[lane];
+}
+
+#endif
+
+#if defined(MULTI_AVX2)
+
+typedef __m256i lanes32_t;
+
+static inline lanes32_t l32_zero(void)
+{
+  return _mm256_setzero_si256();
+}
+
+static inline lanes32_t l32_set1(Longint a)
+{
+  return _mm256_set1_epi32(a);
+}
+
+static inline lanes32_t l32_add(lanes32_t a, lanes32_t b)
+{
+  return _mm256_add_epi32(a, b);
+}
+
+static inline lanes32_t l32_sub(lanes32_t a, lanes32_t b)
+{
+  return _mm256_sub_epi32(a, b);
+}
+
+static inline lanes32_t l32_abs(lanes32_t a)
+{
+  return _mm256_abs_epi32(a);
+}
+
+static inline lanes32_t l32_madd(lanes32_t a, lanes32_t b)
+{
+  return _mm256_madd_epi16(a, b);
+}
+
+static inline lanes32_t l32_pair(lanes16_t a, lanes16_t b)
+{
+  return _mm256_inserti128_si256(
+           _mm256_castsi128_si256(_mm_unpacklo_epi16(a, b)),
+           _mm_unpackhi_epi16(a, b), 1);
+}
+
+static inline lanes32_t l32_widen(lanes16_t a)
+{
+  return _mm256_cvtepi16_epi32(a);
+}
+
+/* a>>15, truncated to Shortint */
+static inline lanes16_t l32_narrow15(lanes32_t a)
+{
+  a = _mm256_srai_epi32(_mm256_slli_epi32(a, 1), 16);
+  a = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, a), 0x08);
+  return _mm256_castsi256_si128(a);
+}
+
+/* a truncated to Shortint */
+static inline lanes16_t l32_narrow(lanes32_t a)
+{
+  a = _mm256_srai_epi32(_mm256_slli_epi32(a, 16), 16);
+  a = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, a), 0x08);
+  return _mm256_castsi256_si128(a);
+}
+
+/* (a*mul)>>shift for 0 <= a, in 64 bit products of the even and odd */
+/* lanes; the quotients must be below 2^32                           */
+static inline lanes32_t l32_div(lanes32_t a, Longint mul, Shortint shift)
+{
+  const __m256i m = _mm256_set1_epi32(mul);
+  const __m128i s = _mm_cvtsi32_si128(shift);
+  __m256i even, odd;
+
+  even = _mm256_srl_epi64(_mm256_mul_epu32(a, m), s);
+  odd  = _mm256_srl_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), m), s);
+  return _mm256_or_si256(even, _mm256_slli_epi64(odd, 32));
+}
+
+#elif defined(MULTI_SSE2)
+
+typedef struct { __m128i lo, hi; } lanes32_t;
+
+static inline lanes32_t l32_zero(void)
+{
+  lanes32_t r;
+
+  r.lo = _mm_setzero_si128();
+  r.hi = r.lo;
+  return r;
+}
+
+static inline lanes32_t l32_set1(Longint a)
+{
+  lanes32_t r;
+
+  r.lo = _mm_set1_epi32(a);
+  r.hi = r.lo;
+  return r;
+}
+
+static inline lanes32_t l32_add(lanes32_t a, lanes32_t b)
+{
+  a.lo = _mm_add_epi32(a.lo, b.lo);
+  a.hi = _mm_add_epi32(a.hi, b.hi);
+  return a;
+}
+
+static inline lanes32_t l32_sub(lanes32_t a, lanes32_t b)
+{
+  a.lo = _mm_sub_epi32(a.lo, b.lo);
+  a.hi = _mm_sub_epi32(a.hi, b.hi);
+  return a;
+}
+
+static inline lanes32_t l32_abs(lanes32_t a)
+{
+  __m128i sign;
+
+  sign = _mm_srai_epi32(a.lo, 31);
+  a.lo = _mm_sub_epi32(_mm_xor_si128(a.lo, sign), sign);
+  sign = _mm_srai_epi32(a.hi, 31);
+  a.hi = _mm_sub_epi32(_mm_xor_si128(a.hi, sign), sign);
+  return a;
+}
+
+static inline lanes32_t l32_madd(lanes32_t a, lanes32_t b)
+{
+  a.lo = _mm_madd_epi16(a.lo, b.lo);
+  a.hi = _mm_madd_epi16(a.hi, b.hi);
+  return a;
+}
+
+static inline lanes32_t l32_pair(lanes16_t a, lanes16_t b)
+{
+  lanes32_t r;
+
+  r.lo = _mm_unpacklo_epi16(a, b);
+  r.hi = _mm_unpackhi_epi16(a, b);
+  return r;
+}
+
+static inline lanes32_t l32_widen(lanes16_t a)
+{
+  lanes32_t r;
+
+  r.lo = _mm_srai_epi32(_mm_unpacklo_epi16(a, a), 16);
+  r.hi = _mm_srai_epi32(_mm_unpackhi_epi16(a, a), 16);
+  return r;
+}
+
+static inline lanes16_t l32_narrow15(lanes32_t a)
+{
+  return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a.lo, 1), 16),
+                         _mm_srai_epi32(_mm_slli_epi32(a.hi, 1), 16));
+}
+
+static inline lanes16_t l32_narrow(lanes32_t a)
+{
+  return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a.lo, 16), 16),
+                         _mm_srai_epi32(_mm_slli_epi32(a.hi, 16), 16));
+}
+
+static inline __m128i div_epu32(__m128i a, __m128i m, __m128i s)
+{
+  __m128i even, odd;
+
+  even = _mm_srl_epi64(_mm_mul_epu32(a, m), s);
+  odd  = _mm_srl_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), m), s);
+  return _mm_or_si128(even, _mm_slli_epi64(odd, 32));
+}
+
+static inline lanes32_t l32_div(lanes32_t a, Longint mul, Shortint shift)
+{
+  const __m128i m = _mm_set1_epi32(mul);
+  const __m128i s = _mm_cvtsi32_si128(shift);
+
+  a.lo = div_epu32(a.lo, m, s);
+  a.hi = div_epu32(a.hi, m, s);
+  return a;
+}
+
+#else
+
+typedef struct { Longint v[TONEDEMOD_LANES]; } lanes32_t;
+
+static inline lanes32_t l32_set1(Longint a)
+{
+  lanes32_t r;
+  Shortint  lane;
+
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    r.v[lane] = a;
+  return r;
+}
+
+static inline lanes32_t l32_zero(void)
+{
+  return l32_set1(0L);
+}
+
+static inline lanes32_t l32_add(lanes32_t a, lanes32_t b)
+{
+  Shortint lane;
+
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    a.v[lane] += b.v[lane];
+  return a;
+}
+
+static inline lanes32_t l32_sub(lanes32_t a, lanes32_t b)
+{
+  Shortint lane;
+
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    a.v[lane] -= b.v[lane];
+  return a;
+}
+
+static inline lanes32_t l32_abs(lanes32_t a)
+{
+  Shortint lane;
+
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    a.v[lane] = labs(a.v[lane]);
+  return a;
+}
+
+static inline lanes32_t l32_madd(lanes32_t a, lanes32_t b)
+{
+  Shortint lane;
+
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    a.v[lane] = (Longint)(Shortint)a.v[lane]*(Longint)(Shortint)b.v[lane] +
+                (Longint)(Shortint)(a.v[lane]>>16)*
+                (Longint)(Shortint)(b.v[lane]>>16);
+  return a;
+}
+
+static inline lanes32_t l32_pair(lanes16_t a, lanes16_t b)
+{
+  lanes32_t r;
+  Shortint  lane;
+
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    r.v[lane] = (Longint)((ULongint)(UShortint)a.v[lane] |
+                          ((ULongint)(UShortint)b.v[lane] << 16));
+  return r;
+}
+
+static inline lanes32_t l32_widen(lanes16_t a)
+{
+  lanes32_t r;
+  Shortint  lane;
+
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    r.v[lane] = a.v[lane];
+  return r;
+}
+
+static inline lanes16_t l32_narrow15(lanes32_t a)
+{
+  lanes16_t r;
+  Shortint  lane;
+
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    r.v[lane] = (Shortint)(a.v[lane]>>15);
+  return r;
+}
+
+static inline lanes16_t l32_narrow(lanes32_t a)
+{
+  lanes16_t r;
+  Shortint  lane;
+
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    r.v[lane] = (Shortint)a.v[lane];
+  return r;
+}
+
+static inline lanes32_t l32_div(lanes32_t a, Longint mul, Shortint shift)
+{
+  Shortint lane;
+
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    a.v[lane] = (Longint)(((unsigned long long)(ULongint)a.v[lane]*
+                           (unsigned long long)mul) >> shift);
+  return a;
+}
+
+#endif
+
+/* ---------------------------------------------------------------------- */
+
+/* taps[m] = the filter taps 2*m and 2*m+1, in every lane */
+static void tap_pairs(lanes32_t *taps, const Shortint *filter)
+{
+  Shortint m;
+
+  for (m=0; m<SYMB_LEN/2; m++)
+    taps[m] = l32_set1((Longint)((ULongint)(UShortint)filter[2*m] |
+                                 ((ULongint)(UShortint)filter[2*m+1] << 16)));
+}
+
+/* out[lag] = sum(pairs[lag+2*m]*taps[m])>>15 over m = 0 ... SYMB_LEN/2-1, */
+/* for 0 <= lag < num_lags (a multiple of LAG_BLOCK), where pairs[i]       */
+/* holds the inputs i and i+1 of every lane                                */
+static void fir_lanes(lanes16_t *out, const lanes32_t *pairs,
+                      const lanes32_t *taps, Shortint num_lags)
+{
+  lanes32_t acc0, acc1, acc2, acc3;
+  Shortint  lag, m;
+
+  for (lag=0; lag<num_lags; lag+=LAG_BLOCK)
+    {
+      acc0 = l32_zero();
+      acc1 = l32_zero();
+      acc2 = l32_zero();
+      acc3 = l32_zero();
+      for (m=0; m<SYMB_LEN/2; m++)
+        {
+          acc0 = l32_add(acc0, l32_madd(pairs[lag+2*m],   taps[m]));
+          acc1 = l32_add(acc1, l32_madd(pairs[lag+2*m+1], taps[m]));
+          acc2 = l32_add(acc2, l32_madd(pairs[lag+2*m+2], taps[m]));
+          acc3 = l32_add(acc3, l32_madd(pairs[lag+2*m+3], taps[m]));
+        }
+      out[lag]   = l32_narrow15(acc0);
+      out[lag+1] = l32_narrow15(acc1);
+      out[lag+2] = l32_narrow15(acc2);
+      out[lag+3] = l32_narrow15(acc3);
+    }
+}
+
+/* per lane: diff_smooth rotated as in demodulate(), the correlations of */
+/* the last frame shifted by the new samples                             */
+static void shift_state(demod_state_t *demod_state, Shortint num_in_samples)
+{
+  Shortint *const xcorr[5] = { demod_state->xcorr_t0, demod_state->xcorr_t1,
+                               demod_state->xcorr_t2, demod_state->xcorr_t3,
+                               demod_state->xcorr_wb };
+  Shortint  tmp_value, sig;
+
+  if (num_in_samples == SYMB_LEN-1)
+    {
+      tmp_value = demod_state->diff_smooth[SYMB_LEN-1];
+      memmove(demod_state->diff_smooth+1, demod_state->diff_smooth,
+              (SYMB_LEN-1)*sizeof(Shortint));
+      demod_state->diff_smooth[0] = tmp_value;
+    }
+  else if (num_in_samples == SYMB_LEN+1)
+    {
+      tmp_value = demod_state->diff_smooth[0];
+      memmove(demod_state->diff_smooth, demod_state->diff_smooth+1,
+              (SYMB_LEN-1)*sizeof(Shortint));
+      demod_state->diff_smooth[SYMB_LEN-1] = tmp_value;
+    }
+
+  for (sig=0; sig<5; sig++)
+    memcpy(xcorr[sig], xcorr[sig]+num_in_samples,
+           (SYMB_LEN-1)*sizeof(Shortint));
+}
+
+/* the soft bits of a lane from the lowpass filtered correlations at */
+/* index_max, and the tracking state and the sampling correction, as */
+/* in demodulate() with the full search                              */
+static void decide_lane(Shortint *bits_out, Shortint *ptr_sampling_correction,
+                        demod_state_t *demod_state,
+                        const Shortint xcorr_lp[5], Shortint max_diff,
+                        Shortint index_max)
+{
+  Shortint  xcorr0 = xcorr_lp[0];
+  Shortint  xcorr1 = xcorr_lp[1];
+  Shortint  xcorr2 = xcorr_lp[2];
+  Shortint  xcorr3 = xcorr_lp[3];
+  Shortint  xcorrw = xcorr_lp[4];
+  Shortint  soft_value;
+  Bool      reliable;
+
+  if      ((xcorr0 >= xcorr1) && (xcorr0 >= xcorr2) && (xcorr0 >= xcorr3))
+    {
+      soft_value =
+        xcorr0-(Shortint)(((Longint)xcorr1+(Longint)xcorr2+(Longint)xcorr3)/3);
+      bits_out[0] = -soft_value;
+      bits_out[1] = -soft_value;
+    }
+  else if ((xcorr1 >= xcorr0) && (xcorr1 >= xcorr2) && (xcorr1 >= xcorr3))
+    {
+      soft_value =
+        xcorr1-(Shortint)(((Longint)xcorr0+(Longint)xcorr2+(Longint)xcorr3)/3);
+      bits_out[0] = -soft_value;
+      bits_out[1] =  soft_value;
+    }
+  else if ((xcorr2 >= xcorr0) && (xcorr2 >= xcorr1) && (xcorr2 >= xcorr3))
+    {
+      soft_value =
+        xcorr2-(Shortint)(((Longint)xcorr0+(Longint)xcorr1+(Longint)xcorr3)/3);
+      bits_out[0] =  soft_value;
+      bits_out[1] = -soft_value;
+    }
+  else
+    {
+      soft_value =
+        xcorr3-(Shortint)(((Longint)xcorr0+(Longint)xcorr1+(Longint)xcorr2)/3);
+      bits_out[0] =  soft_value;
+      bits_out[1] =  soft_value;
+    }
+
+  reliable = (7L*(Longint)soft_value > (Longint)(xcorrw+10));
+  if (reliable)
+    {
+      bits_out[0] = (bits_out[0] | 0x0001);
+      bits_out[1] = (bits_out[1] | 0x0001);
+    }
+  else
+    {
+      bits_out[0] = (bits_out[0] & 0xFFFE);
+      bits_out[1] = (bits_out[1] & 0xFFFE);
+    }
+
+  if (max_diff > TONEDEMOD_TRACK_MIN_DIFF && reliable)
+    demod_state->track_index = index_max;
+  else
+    demod_state->track_index = -1;
+  demod_state->track_frames = 0;
+
+  *ptr_sampling_correction = 0;
+  if (max_diff>40)
+    {
+      if (index_max < SYMB_LEN/2)
+        *ptr_sampling_correction = -1;
+      if (index_max > SYMB_LEN/2)
+        *ptr_sampling_correction = 1;
+    }
+}
+
+/*
+*******************************************************************************
+*                         PUBLIC PROGRAM CODE
+*******************************************************************************
+*/
+
+Bool tonedemod_multi_supported(const demod_state_t *demod_state)
+{
+  Shortint lag;
+
+  if (demod_state->correlator != TONEDEMOD_DIRECT || demod_state->lag_tracking)
+    return false;
+  for (lag=0; lag<SYMB_LEN; lag++)
+    if (demod_state->diff_age[lag] != 0)
+      return false;
+  return true;
+}
+
+void tonedemod_multi(Shortint bits_out[TONEDEMOD_LANES][2],
+                     const Shortint *const in_samples[TONEDEMOD_LANES],
+                     const Shortint num_in_samples[TONEDEMOD_LANES],
+                     Shortint sampling_correction[TONEDEMOD_LANES],
+                     demod_state_t *const demod_states[TONEDEMOD_LANES])
+{
+  static const Longint  alpha           = 32113; /* = 32768*0.98 */
+  static const Longint  one_minus_alpha = 655;   /* = 32768*0.02 */
+  static const Longint  alpha2          = 32440; /* = 32768*0.99 */
+  static const Shortint idle_samples[TONEDEMOD_HISTORY_LEN] = { 0 };
+
+  demod_state_t  idle_state;
+  demod_state_t *state[TONEDEMOD_LANES];
+  const Shortint *samples[TONEDEMOD_LANES];
+  Shortint      *xcorr[5][TONEDEMOD_LANES];
+  const Shortint *xcorr_in[5][TONEDEMOD_LANES];
+  Shortint      *diff_smooth[TONEDEMOD_LANES];
+  Shortint       max_diff[TONEDEMOD_LANES];
+  Shortint       index_max[TONEDEMOD_LANES];
+  Shortint       weight_old[TONEDEMOD_LANES];
+  Shortint       weight_new[TONEDEMOD_LANES];
+  Shortint       xcorr_lp[5];
+  Shortint       lane, sig, lag, gain;
+
+  /* element [i][lane] of the samples, of the magnitudes of the       */
+  /* correlations over 2*SYMB_LEN lags, of the new correlations, of   */
+  /* their lowpass, of the differences and of diff_smooth; pairs of   */
+  /* consecutive samples or magnitudes for the multiply-adds          */
+  lanes16_t x[2*SYMB_LEN];
+  lanes16_t x_abs[5][2*SYMB_LEN];
+  lanes16_t x_corr[5][NUM_CORR_BLOCKS];
+  lanes16_t x_lp[5][SYMB_LEN];
+  lanes16_t x_diff[SYMB_LEN];
+  lanes16_t x_smooth[SYMB_LEN];
+  lanes32_t pairs[NUM_CORR_BLOCKS+SYMB_LEN-2];
+  lanes32_t taps[SYMB_LEN/2];
+  lanes32_t t0, t1, t2, t3, sum, weights;
+  lanes16_t max_lanes, best, index;
+
+  /* The lanes that are not used demodulate silence in a state of */
+  /* their own, which is thrown away.                             */
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    if (in_samples[lane] == NULL)
+      break;
+  if (lane < TONEDEMOD_LANES)
+    init_tonedemod(&idle_state);
+
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    {
+      if (in_samples[lane] == NULL)
+        {
+          state[lane]   = &idle_state;
+          samples[lane] = idle_samples+SYMB_LEN-1;
+        }
+      else
+        {
+          if (num_in_samples[lane] < SYMB_LEN-1 ||
+              num_in_samples[lane] > SYMB_LEN+1)
+            {
+              fprintf(stderr, "tonedemod_multi: Invalid value for num_in_samples!\n");
+              exit(1);
+            }
+          state[lane]   = demod_states[lane];
+          samples[lane] = in_samples[lane]+num_in_samples[lane]-
+                          TONEDEMOD_HISTORY_LEN+SYMB_LEN-1;
+          shift_state(state[lane], num_in_samples[lane]);
+          if (num_in_samples[lane] != SYMB_LEN)
+            state[lane]->steady_frames = 0;
+          else if (state[lane]->steady_frames < TONEDEMOD_TRACK_STEADY)
+            state[lane]->steady_frames++;
+        }
+      xcorr[0][lane]    = state[lane]->xcorr_t0;
+      xcorr[1][lane]    = state[lane]->xcorr_t1;
+      xcorr[2][lane]    = state[lane]->xcorr_t2;
+      xcorr[3][lane]    = state[lane]->xcorr_t3;
+      xcorr[4][lane]    = state[lane]->xcorr_wb;
+      diff_smooth[lane] = state[lane]->diff_smooth;
+      for (sig=0; sig<5; sig++)
+        xcorr_in[sig][lane] = xcorr[sig][lane];
+    }
+
+  /* the samples of the lags SYMB_LEN-1 ... 2*SYMB_LEN-1, and the old */
+  /* correlations of the lags before them (the last one of which is   */
+  /* replaced below)                                                   */
+  gather_rows(x, samples, 2*SYMB_LEN);
+  for (sig=0; sig<5; sig++)
+    {
+      gather_rows(x_abs[sig], xcorr_in[sig], SYMB_LEN);
+      for (lag=0; lag<SYMB_LEN; lag++)
+        x_abs[sig][lag] = l16_abs(x_abs[sig][lag]);
+    }
+
+  /* the correlations with the tones, as in tonedemod_correlate() */
+  for (lag=0; lag<2*SYMB_LEN-1; lag++)
+    pairs[lag] = l32_pair(x[lag], x[lag+1]);
+  for (; lag<NUM_CORR_BLOCKS+SYMB_LEN-2; lag++)
+    pairs[lag] = l32_zero();
+  for (sig=0; sig<4; sig++)
+    {
+      tap_pairs(taps, tonedemod_waveforms[sig]);
+      fir_lanes(x_corr[sig], pairs, taps, NUM_CORR_BLOCKS);
+    }
+
+  /* the wideband level, as a running sum of the magnitudes */
+  sum = l32_zero();
+  for (lag=0; lag<SYMB_LEN; lag++)
+    sum = l32_add(sum, l32_abs(l32_widen(x[lag])));
+  for (lag=0; lag<NUM_CORR_LAGS; lag++)
+    {
+      x_corr[4][lag] = l32_narrow(l32_div(sum, DIV_SYMB_MUL, DIV_SYMB_SHIFT));
+      if (lag < SYMB_LEN)
+        sum = l32_add(sum, l32_sub(l32_abs(l32_widen(x[lag+SYMB_LEN])),
+                                   l32_abs(l32_widen(x[lag]))));
+    }
+
+  for (sig=0; sig<5; sig++)
+    {
+      for (lane=0; lane<TONEDEMOD_LANES; lane++)
+        xcorr[sig][lane] += SYMB_LEN-1;
+      scatter_rows(xcorr[sig], x_corr[sig], NUM_CORR_LAGS);
+      for (lag=0; lag<NUM_CORR_LAGS; lag++)
+        x_abs[sig][SYMB_LEN-1+lag] = l16_abs(x_corr[sig][lag]);
+    }
+
+  /* the lowpass, as in tonedemod_lowpass() */
+  tap_pairs(taps, tonedemod_lowpass_ir_rev);
+  for (sig=0; sig<5; sig++)
+    {
+      for (lag=1; lag<2*SYMB_LEN-1; lag++)
+        pairs[lag-1] = l32_pair(x_abs[sig][lag], x_abs[sig][lag+1]);
+      fir_lanes(x_lp[sig], pairs, taps, SYMB_LEN);
+    }
+
+  /* the differences, as in tonedemod_diff(), and their maximum */
+  max_lanes = l16_set1(0);
+  for (lag=0; lag<SYMB_LEN; lag++)
+    {
+      t0  = l32_widen(x_lp[0][lag]);
+      t1  = l32_widen(x_lp[1][lag]);
+      t2  = l32_widen(x_lp[2][lag]);
+      t3  = l32_widen(x_lp[3][lag]);
+      sum = l32_add(l32_add(l32_add(l32_abs(l32_sub(t0, t1)),
+                                    l32_abs(l32_sub(t0, t2))),
+                            l32_add(l32_abs(l32_sub(t0, t3)),
+                                    l32_abs(l32_sub(t1, t2)))),
+                    l32_add(l32_abs(l32_sub(t1, t3)),
+                            l32_abs(l32_sub(t2, t3))));
+      x_diff[lag] = l32_narrow(l32_div(sum, DIV6_MUL, DIV6_SHIFT));
+      max_lanes   = l16_max(max_lanes, x_diff[lag]);
+    }
+
+  /* The smoothing of diff as one multiply-add per lag and lane, */
+  /* diff<<gain being diff*(one_minus_alpha<<gain).              */
+  l16_store(max_diff, max_lanes);
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    {
+      if (max_diff[lane]<2048)
+        gain=4;
+      else if (max_diff[lane]<4096)
+        gain=3;
+      else if (max_diff[lane]<8192)
+        gain=2;
+      else if (max_diff[lane]<16384)
+        gain=1;
+      else
+        gain=0;
+
+      if (max_diff[lane] > 4)
+        {
+          weight_old[lane] = alpha;
+          weight_new[lane] = one_minus_alpha<<gain;
+        }
+      else
+        {
+          weight_old[lane] = alpha2;
+          weight_new[lane] = 0;
+        }
+    }
+  weights = l32_pair(l16_load(weight_old), l16_load(weight_new));
+
+  /* update diff_smooth and search its maximum */
+  gather_rows(x_smooth, (const Shortint *const *)diff_smooth, SYMB_LEN);
+  best  = l16_set1(0);
+  index = l16_set1(0);
+  for (lag=0; lag<SYMB_LEN; lag++)
+    {
+      x_smooth[lag] =
+        l32_narrow15(l32_madd(l32_pair(x_smooth[lag], x_diff[lag]), weights));
+      index = l16_select_gt(x_smooth[lag], best, l16_set1(lag), index);
+      best  = l16_max(best, x_smooth[lag]);
+    }
+  scatter_rows(diff_smooth, x_smooth, SYMB_LEN);
+
+  /* the soft bits at the maximum, and the sampling correction */
+  l16_store(index_max, index);
+  for (lane=0; lane<TONEDEMOD_LANES; lane++)
+    if (in_samples[lane] != NULL)
+      {
+        for (sig=0; sig<5; sig++)
+          xcorr_lp[sig] = l16_lane(&x_lp[sig][index_max[lane]], lane);
+        decide_lane(bits_out[lane], &sampling_correction[lane], state[lane],
+                    xcorr_lp, max_diff[lane], index_max[lane]);
+      }
+}
@@ -0,0 +1,94 @@
+/*
+*******************************************************************************
+*
+*      File             : tonedemod_multi.h
+*      Purpose          : CTM tone demodulator for several channels at once
+*
+*      tonedemod_multi() does what tonedemod_in_place() does, for up to
+*      TONEDEMOD_LANES channels and one symbol of each. The state of every
+*      channel stays in its own demod_state_t; it is copied into structure
+*      of arrays form (element [i][lane]) for the call, so that each 16 bit
+*      multiply-add instruction of AVX2 or SSE2 works on all the lanes at
+*      once, and copied back. The channels of one call need not be the
+*      same in the next one.
+*
+*      The results are the same, bit for bit, as those of
+*      tonedemod_in_place() with the same state, including the new state.
+*      Only demodulators with the TONEDEMOD_DIRECT correlator and without
+*      lag tracking can be run this way, see tonedemod_multi_supported().
+*
+*******************************************************************************
+*/
+
+#ifndef tonedemod_multi_h
+#define tonedemod_multi_h "$Id: $"
+
+/*
+*******************************************************************************
+*                         INCLUDE FILES
+*******************************************************************************
+*/
+
+#include "ctm_defines.h"
+#include "tonedemod.h"
+
+#include <typedefs.h>
+
+/*
+*******************************************************************************
+*                         DECLARATION OF PROTOTYPES
+*******************************************************************************
+*/
+
+/* channels demodulated by one call of tonedemod_multi() */
+#define TONEDEMOD_LANES 8
+
+/* x/SYMB_LEN = (x*DIV_SYMB_MUL)>>DIV_SYMB_SHIFT for 0 <= x <=   */
+/* SYMB_LEN*32768 (checked for every x of this range by ctmcheck), */
+/* the wideband level of a lag                                     */
+#define DIV_SYMB_SHIFT 27
+#define DIV_SYMB_MUL   (((1L<<DIV_SYMB_SHIFT)+SYMB_LEN-1)/SYMB_LEN)
+
+/*
+*******************************************************************************
+*
+*     Function        : tonedemod_multi_supported
+*     In              : demod_state     state of one demodulator
+*     Out             : -
+*     Return          : true if tonedemod_multi() can run it
+*     Information     : false with the TONEDEMOD_SLIDING_DFT correlator,
+*                       with lag tracking, and as long as the lags that the
+*                       tracking has skipped have not caught up (diff_age)
+*
+*******************************************************************************
+*/
+
+Bool tonedemod_multi_supported(const demod_state_t *demod_state);
+
+/*
+*******************************************************************************
+*
+*     Function        : tonedemod_multi
+*     In              : in_samples      per lane, the new samples, with the
+*                                       history in front of them, as for
+*                                       tonedemod_in_place(); NULL if the
+*                                       lane is not used
+*                       num_in_samples  per lane, SYMB_LEN-1, SYMB_LEN or
+*                                       SYMB_LEN+1
+*     In/Out          : demod_states    per lane, the demodulator
+*                                       (tonedemod_multi_supported())
+*     Out             : bits_out        per lane, the two soft bits
+*                       sampling_correction  per lane, -1, 0 or 1
+*     Return          : -
+*     Information     : the lanes that are not used are not touched
+*
+*******************************************************************************
+*/
+
+void tonedemod_multi(Shortint bits_out[TONEDEMOD_LANES][2],
+                     const Shortint *const in_samples[TONEDEMOD_LANES],
+                     const Shortint num_in_samples[TONEDEMOD_LANES],
+                     Shortint sampling_correction[TONEDEMOD_LANES],
+                     demod_state_t *const demod_states[TONEDEMOD_LANES]);
+
+#endif
@@ -26,57 +26,102 @@
 
 #include "tonemod.h"
 #include "ctm_defines.h"
-#include "sin_fip.h"
 
 #include <typedefs.h>
 #include <stdlib.h>
 #include <stdio.h>    
+#include <string.h>
 
 const char tonemod_id[] = "@(#)$Id: $" tonemod_h;
 
 /*
 ******************************************************************************
-*                         PUBLIC PROGRAM CODE
+*                         CONSTANT TABLES
 ******************************************************************************
 */
 
+/* All possible output waveforms, shared by all modulator instances       */
+/* (0<=cnt<SYMB_LEN):                                                     */
+/* waveforms[k][cnt] = 8*sin_fip2047(((160/SYMB_LEN)*cnt*NCYCLES_k)%160)  */
+#if SYMB_LEN==40
+static const Shortint waveforms[4][SYMB_LEN] = {
+  {
+         0,   5064,   9624,  13248,  15576,  16376,  15576,  13248,   9624,   5064,
+         0,  -5064,  -9624, -13248, -15576, -16376, -15576, -13248,  -9624,  -5064,
+         0,   5064,   9624,  13248,  15576,  16376,  15576,  13248,   9624,   5064,
+         0,  -5064,  -9624, -13248, -15576, -16376, -15576, -13248,  -9624,  -5064 },
+  {
+         0,   7432,  13248,  16176,  15576,  11576,   5064,  -2560,  -9624, -14592,
+    -16376, -14592,  -9624,  -2560,   5064,  11576,  15576,  16176,  13248,   7432,
+         0,  -7432, -13248, -16176, -15576, -11576,  -5064,   2560,   9624,  14592,
+     16376,  14592,   9624,   2560,  -5064, -11576, -15576, -16176, -13248,  -7432 },
+  {
+         0,   9624,  15576,  15576,   9624,      0,  -9624, -15576, -15576,  -9624,
+         0,   9624,  15576,  15576,   9624,      0,  -9624, -15576, -15576,  -9624,
+         0,   9624,  15576,  15576,   9624,      0,  -9624, -15576, -15576,  -9624,
+         0,   9624,  15576,  15576,   9624,      0,  -9624, -15576, -15576,  -9624 },
+  {
+         0,  11576,  16376,  11576,      0, -11576, -16376, -11576,      0,  11576,
+     16376,  11576,      0, -11576, -16376, -11576,      0,  11576,  16376,  11576,
+         0, -11576, -16376, -11576,      0,  11576,  16376,  11576,      0, -11576,
+    -16376, -11576,      0,  11576,  16376,  11576,      0, -11576, -16376, -11576 }};
+#endif
+#if SYMB_LEN==32
+static const Shortint waveforms[4][SYMB_LEN] = {
+  {
+         0,   6264,  11576,  15128,  16376,  15128,  11576,   6264,      0,  -6264,
+    -11576, -15128, -16376, -15128, -11576,  -6264,      0,   6264,  11576,  15128,
+     16376,  15128,  11576,   6264,      0,  -6264, -11576, -15128, -16376, -15128,
+    -11576,  -6264 },
+  {
+         0,   9096,  15128,  16064,  11576,   3192,  -6264, -13616, -16376, -13616,
+     -6264,   3192,  11576,  16064,  15128,   9096,      0,  -9096, -15128, -16064,
+    -11576,  -3192,   6264,  13616,  16376,  13616,   6264,  -3192, -11576, -16064,
+    -15128,  -9096 },
+  {
+         0,  11576,  16376,  11576,      0, -11576, -16376, -11576,      0,  11576,
+     16376,  11576,      0, -11576, -16376, -11576,      0,  11576,  16376,  11576,
+         0, -11576, -16376, -11576,      0,  11576,  16376,  11576,      0, -11576,
+    -16376, -11576 },
+  {
+         0,  13616,  15128,   3192, -11576, -16064,  -6264,   9096,  16376,   9096,
+     -6264, -16064, -11576,   3192,  15128,  13616,      0, -13616, -15128,  -3192,
+     11576,  16064,   6264,  -9096, -16376,  -9096,   6264,  16064,  11576,  -3192,
+    -15128, -13616 }};
+#endif
 
-/* ---------------------------------------------------------------------- */
-/* Define an array for storing all possible waveforms. This array has to  */
-/* be initialized using the function init_tonemod(), before the function  */
-/* tonemod() can be used. The scope of this array is limited to this      */
-/* module tonemod.c                                                       */
-/* ---------------------------------------------------------------------- */
+/*
+******************************************************************************
+*                         PUBLIC PROGRAM CODE
+******************************************************************************
+*/
 
-Shortint waveforms[SYMB_LEN][4];
 
 /* ---------------------------------------------------------------------- */
 /* Function init_tonemod()                                                */
 /* ***********************                                                */
 /* This function has to be executed before tonemod() can be used.         */
-/* This function initializes the array waveforms[][]                      */
 /* ---------------------------------------------------------------------- */
 
 void init_tonemod(mod_state_t  *mod_state)
 {
-  Shortint cnt;
-
-  for (cnt=0 ; cnt<SYMB_LEN; cnt++)
-    {
-      waveforms[cnt][0] = 
-        8*sin_fip2047((Shortint)(((160/SYMB_LEN)*cnt*NCYCLES_0)%160));
-      waveforms[cnt][1] = 
-        8*sin_fip2047((Shortint)(((160/SYMB_LEN)*cnt*NCYCLES_1)%160));
-      waveforms[cnt][2] = 
-        8*sin_fip2047((Shortint)(((160/SYMB_LEN)*cnt*NCYCLES_2)%160));
-      waveforms[cnt][3] = 
-        8*sin_fip2047((Shortint)(((160/SYMB_LEN)*cnt*NCYCLES_3)%160));
-    }
   /* Set Counter to its idle value */
   mod_state->cntModulatedSamples = SYMB_LEN;
+  mod_state->actualBits[0]       = GUARD_BIT_SYMBOL;
+  mod_state->actualBits[1]       = GUARD_BIT_SYMBOL;
+}
+
 
-  /* Set up fifo buffer for tx bits */
-  Shortint_fifo_init(&(mod_state->txbits_fifo_state), 2*LENGTH_TX_BITS);
+/* ---------------------------------------------------------------------- */
+/* Function exit_tonemod()                                                */
+/* ***********************                                                */
+/* Counterpart of init_tonemod(); the modulator does not allocate any     */
+/* memory.                                                                */
+/* ---------------------------------------------------------------------- */
+
+void exit_tonemod(mod_state_t  *mod_state)
+{
+  (void)mod_state;
 }
 
 
@@ -89,22 +134,22 @@ void init_tonemod(mod_state_t  *mod_state)
 /* The number samples that are generated by each call of this function    */
 /* can now be chosen without any constraints and must no longer be a      */
 /* multiple of SYMB_LEN.                                                  */
+/*                                                                        */
+/* The samples are generated a symbol (or the rest of it, at the edges of */
+/* tones_out) at a time, by a copy of the waveform or by zero-filling.    */
 /* ---------------------------------------------------------------------- */
 
 void tonemod(Shortint     *tones_out,
-             Shortint     *bits_in,
              Shortint      num_samples_tones_out,
-             Shortint      num_bits_in,
+             fifo_state_t *bits_fifo,
              mod_state_t  *mod_state)
 {
   Shortint cntSamples;
+  Shortint numSamples;
+  Shortint numBits;
+  Shortint tone;
 
-  /* Push the input bits into the fifo buffer */
-  if (num_bits_in>0)
-    Shortint_fifo_push(&(mod_state->txbits_fifo_state), bits_in, num_bits_in);
-  
-  /* Generate as many samples as required */
-  for (cntSamples=0; cntSamples<num_samples_tones_out; cntSamples++)
+  for (cntSamples=0; cntSamples<num_samples_tones_out; cntSamples+=numSamples)
     {
       /* Check whether previous symbol was terminated */
       if (mod_state->cntModulatedSamples==SYMB_LEN)
@@ -116,42 +161,37 @@ void tonemod(Shortint     *tones_out,
           mod_state->cntModulatedSamples = 0;
           
           /* ... unless there are one or two bits for transmission */
-          if (Shortint_fifo_check(&(mod_state->txbits_fifo_state))>=2)
-            Shortint_fifo_pop(&(mod_state->txbits_fifo_state), 
-                              mod_state->actualBits, 2);
-          else if (Shortint_fifo_check(&(mod_state->txbits_fifo_state))==1)
-            Shortint_fifo_pop(&(mod_state->txbits_fifo_state), 
-                              mod_state->actualBits, 1);
+          if (bits_fifo == NULL)
+            {
+              mod_state->actualBits[0] = 1;
+              mod_state->actualBits[1] = 1;
+            }
+          else if ((numBits = Shortint_fifo_check(bits_fifo)) > 0)
+            Shortint_fifo_pop(bits_fifo, mod_state->actualBits, 
+                              numBits>=2 ? 2 : 1);
         }
 
+      /* The rest of the actual symbol, or what fits into tones_out */
+      numSamples = SYMB_LEN-mod_state->cntModulatedSamples;
+      if (numSamples > num_samples_tones_out-cntSamples)
+        numSamples = num_samples_tones_out-cntSamples;
+
       /* Generate the Output Waveforms */
       if ((abs(mod_state->actualBits[0])==GUARD_BIT_SYMBOL) && 
           (abs(mod_state->actualBits[1])==GUARD_BIT_SYMBOL))
         {
           /* If both bits are carrying the guard symbol --> zero output */
-          tones_out[cntSamples] = 0;
+          memset(tones_out+cntSamples, 0, numSamples*sizeof(Shortint));
         }
       else
         {
-          if (mod_state->actualBits[0]<=0)
-            {
-              if (mod_state->actualBits[1]<=0)
-                tones_out[cntSamples] 
-                  = waveforms[mod_state->cntModulatedSamples][0];
-              else
-                tones_out[cntSamples] 
-                  = waveforms[mod_state->cntModulatedSamples][1];
-            }
-          else
-            {
-              if (mod_state->actualBits[1]<=0)
-                tones_out[cntSamples] 
-                  = waveforms[mod_state->cntModulatedSamples][2];
-              else
-                tones_out[cntSamples] 
-                  = waveforms[mod_state->cntModulatedSamples][3];
-            }
+          tone = (mod_state->actualBits[0]<=0) ? 0 : 2;
+          if (mod_state->actualBits[1]>0)
+            tone++;
+          memcpy(tones_out+cntSamples, 
+                 waveforms[tone]+mod_state->cntModulatedSamples,
+                 numSamples*sizeof(Shortint));
         }
-      (mod_state->cntModulatedSamples)++;
+      mod_state->cntModulatedSamples += numSamples;
     }
 }
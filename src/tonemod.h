@@ -4,6 +4,8 @@
 *
 *      Changes since October 13, 2000:
 *      - The type mod_state_t includes a new member txbits_fifo_state now.
+*      - tonemod() pops the bits directly from the fifo buffer of the
+*        transmitter; txbits_fifo_state has been removed again.
 *
 *******************************************************************************
 *
@@ -24,6 +26,7 @@
 
 #include <typedefs.h>
 #include <fifo.h>
+#include "ctm_defines.h"
 
 /*
 *******************************************************************************
@@ -37,7 +40,6 @@
 typedef struct {
   Shortint      cntModulatedSamples;
   Shortint      actualBits[2];
-  fifo_state_t  txbits_fifo_state;
 } mod_state_t;
 
 
@@ -49,24 +51,34 @@ typedef struct {
 
 void init_tonemod(mod_state_t  *mod_state);
 
+/* ---------------------------------------------------------------------- */
+/* Function exit_tonemod()                                                */
+/* ***********************                                                */
+/* Counterpart of init_tonemod(); the modulator does not allocate any     */
+/* memory.                                                                */
+/* ---------------------------------------------------------------------- */
+
+void exit_tonemod(mod_state_t  *mod_state);
+
 
 /* ---------------------------------------------------------------------- */
 /* Function tonemod()                                                     */
 /* ******************                                                     */
 /* Modulator of the Cellular Text Telephone Modem.                        */
-/* The input vector bits_in must contain the bits that have to be         */
-/* transmitted. The length of bits_in must be even because always two     */
-/* bits are coded in parallel.                                            */
+/* Generates num_samples_tones_out samples into tones_out. At the start   */
+/* of each symbol, the next two bits are popped from bits_fifo, because   */
+/* always two bits are coded in parallel within a symbol of SYMB_LEN      */
+/* audio samples. If the fifo contains one bit only, it is coded together */
+/* with a guard bit; if it is empty, a symbol of zero-valued samples is   */
+/* generated. A symbol may span several calls.                            */
 /* Bits are either unipolar (i.e. {0, 1}) or bipolar (i.e. {-1, +1)}.     */
-/* The length of the output vector tones_out must be 20 times longer than */
-/* the length of bits_in, since each pair of two bits is coded within a   */
-/* frame of 40 audio samples.                                             */
+/* If bits_fifo is NULL, every symbol carries the bits {1, 1}, i.e. the   */
+/* output is a pure sine (see ctm_transmitter()).                         */
 /* ---------------------------------------------------------------------- */
 
-void tonemod(Shortint    *tones_out,
-             Shortint    *bits_in,
-             Shortint     num_samples_tones_out,
-             Shortint     num_bits_in,
-             mod_state_t *mod_state);
+void tonemod(Shortint     *tones_out,
+             Shortint      num_samples_tones_out,
+             fifo_state_t *bits_fifo,
+             mod_state_t  *mod_state);
 
 #endif
@@ -188,6 +188,11 @@ typedef int Bool;
 #define PCLINUX
 #define PLATFORM "PCLINUX"
 #define LSBFIRST
+#elif defined(__linux__) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+/* any little endian Linux, e.g. x86_64 or arm64 */
+#define PCLINUX
+#define PLATFORM "PCLINUX"
+#define LSBFIRST
 #elif defined(__OpenBSD__) && (__BYTE_ORDER == __LITTLE_ENDIAN)
 #define LSBFIRST
 #else
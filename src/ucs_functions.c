@@ -200,7 +200,7 @@ Bool transformUTF2UCS(UShortint     *ptr_ucsCode,
                       fifo_state_t  *ptr_octet_fifo_state)
 {
   Shortint         numAvailOctets;
-  static Shortint  octetBuffer[5];
+  Shortint         octetBuffer[5];
   
   numAvailOctets = Shortint_fifo_check(ptr_octet_fifo_state);
   if (numAvailOctets>5)
@@ -18,6 +18,33 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+/* The add-compare-select runs over NUM_NODES/2 lanes of 32 bit metrics */
+/* (Longint is int wherever int has 32 bits, see typedefs.h).           */
+#if !defined(VITERBI_SCALAR) && NUM_NODES == 16 && INT_MAX == 2147483647
+#if defined(__AVX2__)
+#define VITERBI_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#define VITERBI_SSE2
+#include <emmintrin.h>
+#endif
+#endif
+
+
+/********************************************************************/
+/* Output of each node when the input is 0, shared by all decoders. */
+/* For node 2*i, the output bit p (counted from the MSB) is the     */
+/* parity of the lower CHC_K-1 bits of (2*i & poly_p), with the     */
+/* polynomials of polynomials(); node 2*i+1 has the inverted bits.  */
+/********************************************************************/
+
+#if CHC_RATE==4 && CHC_K==5
+static const Shortint base_output[NUM_NODES] = {
+   0, 15,  7,  8, 13,  2, 10,  5,  3, 12,  4, 11, 14,  1,  9,  6 };
+#else
+#error "base_output[] has to be recalculated for CHC_RATE and CHC_K"
+#endif
+
 
 /**************************************************/
 /* Forward declarations of locally used functions */
@@ -27,13 +54,22 @@ Shortint hamming_distance (Shortint a, Shortint b);
 /* Returns the Hamming distance between two words of length = CHC_RATE    */
 /* This function is used when a hard-decision decoding is performed       */
 
-Longint distance (Shortint* analog, Shortint  binary);
-/* This function is used instead 'hamming_distance' when a soft-decision  */
-/* decoding is performed                                                  */
+static void branch_metrics (const Shortint* analog,
+                            Longint branch[4][NUM_NODES/2]);
+/* Calculates the soft-decision distances between the CHC_RATE gross bits */
+/* in analog and the 2^CHC_RATE possible outputs of the encoder, once per */
+/* step, and arranges them in the order used by acs()                     */
+
+static UShortint acs (Longint* metric, Longint branch[4][NUM_NODES/2],
+                      Shortint* min_node);
+/* Add-compare-select: calculates the new metrics of all nodes, one       */
+/* butterfly per lane, and renormalizes them. Returns the decision bits   */
+/* of the new nodes (see viterbi_t) and the first node with the lowest    */
+/* metric.                                                                */
 
-void butterfly (Shortint num, Shortint* inputvalue, node_t *nodes);
-/* Calculates the new metrics of 4 paths in the trellis diagram at a time */
-/* These four paths define a 'butterfly'                                  */
+static Shortint traceback (const viterbi_t* viterbi_state, Shortint node);
+/* Returns the oldest bit, BLOCK*CHC_K-1 steps back, of the path ending   */
+/* in node                                                                */
 
 
 /***********************************************************************/
@@ -48,9 +84,7 @@ void butterfly (Shortint num, Shortint* inputvalue, node_t *nodes);
 
 void viterbi_init (viterbi_t* viterbi_state)
 {
-  Shortint polya, polyb, polyc, polyd;
-  Shortint out[CHC_RATE];   
-  Shortint i,j,p,temp;
+  Shortint i,p;
   
   /* Initialize number of steps */
   
@@ -59,54 +93,13 @@ void viterbi_init (viterbi_t* viterbi_state)
   /* Initialize nodes */
   
   for (i=0; i<NUM_NODES; i++)
-    {
-      viterbi_state->nodes[i].metric    = 0;
-      viterbi_state->nodes[i].oldmetric = 0;
-      for (p=0; p<BLOCK*CHC_K; p++)
-        {
-          viterbi_state->nodes[i].path[p] = -1;
-          viterbi_state->nodes[i].temppath[p] = -1;
-        }
-    }
-  
-  /* Get the polynomials to be used */
+    viterbi_state->metric[i] = 0;
   
-  polynomials (CHC_RATE, CHC_K, &polya, &polyb, &polyc, &polyd);  
+  /* Initialize the survivor memory */
   
-  /* Calculate base_output for each node */
-  
-  for (i=0; i < NUM_NODES/2; i++)
-    {  
-      temp = 2*i;
-      
-      out[0] = temp & polya;
-      out[1] = temp & polyb;
-      if (CHC_RATE>2)
-        out[2] = temp & polyc;
-      if (CHC_RATE>3)
-        out[3] = temp & polyd;
-      
-      for (p=0; p<CHC_RATE; p++)
-        {
-          temp = 0;
-          for (j=0; j<CHC_K-1; j++)
-            {
-              temp += (out[p] >> j) & 0x1;  
-            }
-          out[p] = temp%2;
-        }
-      
-      temp = 0;
-      for (p=0; p<CHC_RATE; p++)
-        temp += (1<<p) * out[CHC_RATE-1-p];
-      
-      viterbi_state->nodes[2*i].base_output = temp;
-      
-      /* To calculate the base_output of the following node, */
-      /* just invert the bits                                */
-      
-      viterbi_state->nodes[2*i+1].base_output = ~temp & ((1<<CHC_RATE)-1);
-    }
+  viterbi_state->newest = 0;
+  for (p=0; p<BLOCK*CHC_K; p++)
+    viterbi_state->decisions[p] = 0;
 }
 
 
@@ -135,15 +128,13 @@ void viterbi_reinit(viterbi_t* viterbi_state)
   /* Initialize nodes */
   
   for (i=0; i<NUM_NODES; i++)
-    {
-      viterbi_state->nodes[i].metric    = 0;
-      viterbi_state->nodes[i].oldmetric = 0;
-      for (p=0; p<BLOCK*CHC_K; p++)
-        {
-          viterbi_state->nodes[i].path[p] = -1;
-          viterbi_state->nodes[i].temppath[p] = -1;
-        }
-    }
+    viterbi_state->metric[i] = 0;
+  
+  /* Initialize the survivor memory */
+  
+  viterbi_state->newest = 0;
+  for (p=0; p<BLOCK*CHC_K; p++)
+    viterbi_state->decisions[p] = 0;
 }
 
 /***********************************************************************/
@@ -171,10 +162,10 @@ void  viterbi_exec(Shortint*  inputword, Shortint  length_input,
                    Shortint*  out,       Shortint* num_valid_out_bits,
                    viterbi_t* viterbi_state)
 {
-  Shortint i,j,p;
-  Longint biggest;
+  Shortint j;
+  UShortint decisions;
+  Longint branch[4][NUM_NODES/2];
   Shortint min_metric;
-  Shortint input_norm[CHC_RATE];
   Shortint groups;
   
   *num_valid_out_bits = 0;
@@ -190,52 +181,24 @@ void  viterbi_exec(Shortint*  inputword, Shortint  length_input,
   
   for (j=0; j<groups; j++)
     {
-      for (i=0; i<CHC_RATE; i++)
-        input_norm[i] = inputword[CHC_RATE*j+i];
+      /* Calculate the new metrics and find the path with the lowest */
+      /* metric                                                       */
       
-      /* Calculate the new metrics */
+      branch_metrics (inputword+CHC_RATE*j, branch);
+      decisions = acs (viterbi_state->metric, branch, &min_metric);
       
-      for (i=0; i<NUM_NODES/2; i++)
-        butterfly ((Shortint)(2*i), input_norm, viterbi_state->nodes);
+      /* Store the decisions in the survivor memory */
       
-      /* Update the metrics and the paths */
+      viterbi_state->newest = (viterbi_state->newest+1) % (BLOCK*CHC_K);
+      viterbi_state->decisions[viterbi_state->newest] = decisions;
       
-      for (i=0; i<NUM_NODES; i++)
-        {
-          viterbi_state->nodes[i].oldmetric = viterbi_state->nodes[i].metric;
-          
-          for (p=0; p<viterbi_state->number_of_steps; p++)
-            viterbi_state->nodes[i].temppath[p] = viterbi_state->nodes[viterbi_state->nodes[i].continue_path_from].path[p];
-          viterbi_state->nodes[i].temppath[viterbi_state->number_of_steps] = viterbi_state->nodes[i].new_entry;
-        }
-      
-      /* Find the path with the lowest metric */
-      
-      biggest = maxLongint;
-      min_metric = 0;
-      
-      for (i=0; i<NUM_NODES; i++)
-        {
-          for (p=0; p<BLOCK*CHC_K; p++)
-            viterbi_state->nodes[i].path[p] 
-              = viterbi_state->nodes[i].temppath[p];
-          
-          if (viterbi_state->nodes[i].metric < biggest)
-            {
-              biggest = viterbi_state->nodes[i].metric;
-              min_metric = i;
-            }
-        }
+      /* Once BLOCK*CHC_K steps have been made, each step decides on */
+      /* the oldest bit of the path with the lowest metric           */
       
       if (viterbi_state->number_of_steps >= BLOCK*CHC_K-1)
         {
-          out[*num_valid_out_bits] = viterbi_state->nodes[min_metric].path[0];
+          out[*num_valid_out_bits] = traceback(viterbi_state, min_metric);
           (*num_valid_out_bits)++;
-          
-          for (i=0; i<NUM_NODES; i++)
-            for (p=0; p<BLOCK*CHC_K-1; p++)
-              viterbi_state->nodes[i].path[p] 
-                = viterbi_state->nodes[i].path[p+1];
         }
       else 
         viterbi_state->number_of_steps ++;
@@ -258,32 +221,24 @@ Shortint hamming_distance (Shortint a, Shortint b)
   return (tmp);
 }
 
-Longint distance (Shortint * analog, Shortint  binary)
+/* The distance of an analog gross bit a, clipped to [-16383,16383],     */
+/* from the bit 0 (-16383) is a+16383, from the bit 1 (16383) it is      */
+/* 16383-a. Bit CHC_RATE-1-ii of an output word goes with analog[ii].    */
+/* branch[0] and branch[1] are the distances of the lanes' even and odd  */
+/* node from the outputs towards node lane, branch[2] and branch[3] from */
+/* the inverted outputs towards node lane+NUM_NODES/2.                   */
+
+static void branch_metrics (const Shortint* analog,
+                            Longint branch[4][NUM_NODES/2])
 {
-  /* Example:  analog = [13423,22432,-12555] binary = [1,1,0] */
-  Shortint ii;
-  Shortint temp;
-  Longint  dist;
+  Longint  dist[1<<CHC_RATE];
+  Longint  dist0[CHC_RATE], dist1[CHC_RATE];
+  Shortint ii, word;
   Shortint analog_tmp;
   
-  temp = 0;
-  dist = 0;
-  
-  binary &= (1<<CHC_RATE)-1;
-  
-  /* We transform 0 -> -16383, 1 -> 16383 */
+  dist[0] = 0;
   for (ii=0; ii<CHC_RATE; ii++)
-    {  
-      temp = (binary >> ii) & 0x1;
-      if (temp == 0)
-        temp = -16383;
-      else if (temp == 1)
-        temp = 16383;
-      else
-        {
-          fprintf(stderr, "\nError: Error calculating the path metrics.\n");
-          exit(1);
-        }
+    {
       analog_tmp = analog[CHC_RATE-1-ii];
       
       if (analog_tmp > 16383)
@@ -291,48 +246,195 @@ Longint distance (Shortint * analog, Shortint  binary)
       else if (analog_tmp < -16383)
         analog_tmp = -16383;
       
-      dist += abs(temp-analog_tmp);
+      dist0[ii] = (Longint)analog_tmp + 16383;
+      dist1[ii] = 16383 - (Longint)analog_tmp;
+      dist[0] += dist0[ii];
+    }
+  
+  /* words with bit ii set differ from those without only there */
+  for (ii=0; ii<CHC_RATE; ii++)
+    for (word=0; word<(1<<ii); word++)
+      dist[word+(1<<ii)] = dist[word] - dist0[ii] + dist1[ii];
+  
+  for (ii=0; ii<NUM_NODES/2; ii++)
+    {
+      branch[0][ii] = dist[base_output[2*ii]];
+      branch[1][ii] = dist[base_output[2*ii+1]];
+      branch[2][ii] = dist[base_output[2*ii]   ^ ((1<<CHC_RATE)-1)];
+      branch[3][ii] = dist[base_output[2*ii+1] ^ ((1<<CHC_RATE)-1)];
     }
-  return(dist);
 }
 
 
-void butterfly (Shortint num, Shortint* inputvalue, node_t *nodes)
+/* For lane i, the butterfly of the old nodes 2*i and 2*i+1 gives the new */
+/* nodes i (path bit 0) and i+NUM_NODES/2 (path bit 1). Each new node     */
+/* continues the path with the lower metric, that of the even node on a   */
+/* tie, and its decision bit is set if it is the odd one. Subtracting the */
+/* lowest metric keeps all metrics within a few branch metrics; it does   */
+/* not change any decision.                                               */
+
+#if defined(VITERBI_AVX2)
+
+static UShortint acs (Longint* metric, Longint branch[4][NUM_NODES/2],
+                      Shortint* min_node)
+{
+  const __m256i even_odd = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+  __m256i  lo, hi, even, odd;
+  __m256i  path0, path1, path2, path3, min;
+  Longint  decisions, mask;
+  
+  /* metrics of the even and of the odd nodes */
+  lo   = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)metric),
+                                     even_odd);
+  hi   = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)(metric+8)),
+                                     even_odd);
+  even = _mm256_permute2x128_si256(lo, hi, 0x20);
+  odd  = _mm256_permute2x128_si256(lo, hi, 0x31);
+  
+  path0 = _mm256_add_epi32(even, _mm256_loadu_si256((const __m256i *)branch[0]));
+  path1 = _mm256_add_epi32(odd,  _mm256_loadu_si256((const __m256i *)branch[1]));
+  path2 = _mm256_add_epi32(even, _mm256_loadu_si256((const __m256i *)branch[2]));
+  path3 = _mm256_add_epi32(odd,  _mm256_loadu_si256((const __m256i *)branch[3]));
+  
+  decisions = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(path0, path1)))
+    | (_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(path2, path3))) << 8);
+  lo = _mm256_min_epi32(path0, path1);
+  hi = _mm256_min_epi32(path2, path3);
+  
+  /* renormalization */
+  min = _mm256_min_epi32(lo, hi);
+  min = _mm256_min_epi32(min, _mm256_permute2x128_si256(min, min, 0x01));
+  min = _mm256_min_epi32(min, _mm256_shuffle_epi32(min, 0x4E));
+  min = _mm256_min_epi32(min, _mm256_shuffle_epi32(min, 0xB1));
+  
+  mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(lo, min)))
+    | (_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(hi, min))) << 8);
+  for (*min_node=0; (mask & 0x1) == 0; (*min_node)++)
+    mask >>= 1;
+  
+  _mm256_storeu_si256((__m256i *)metric,     _mm256_sub_epi32(lo, min));
+  _mm256_storeu_si256((__m256i *)(metric+8), _mm256_sub_epi32(hi, min));
+  
+  return (UShortint)decisions;
+}
+
+#elif defined(VITERBI_SSE2)
+
+/* SSE2 has no min_epi32 */
+static inline __m128i min_epi32(__m128i a, __m128i b)
 {
-  Longint my_metric         = nodes[num].oldmetric;
-  Longint my_friends_metric = nodes[num+1].oldmetric;
-  Longint path0, path1;
+  __m128i gt = _mm_cmpgt_epi32(a, b);
   
-  path0 = my_metric         + distance(inputvalue, nodes[num].base_output);  
-  path1 = my_friends_metric + distance(inputvalue, nodes[num+1].base_output);
+  return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+}
+
+static inline __m128i select_lanes(__m128i a, __m128i b, Shortint odd)
+{
+  __m128 x = _mm_castsi128_ps(a), y = _mm_castsi128_ps(b);
+  
+  return _mm_castps_si128(odd ? _mm_shuffle_ps(x, y, _MM_SHUFFLE(3,1,3,1))
+                              : _mm_shuffle_ps(x, y, _MM_SHUFFLE(2,0,2,0)));
+}
+
+static UShortint acs (Longint* metric, Longint branch[4][NUM_NODES/2],
+                      Shortint* min_node)
+{
+  __m128i  old[4], new_metric[4], min;
+  __m128i  even, odd, path0, path1, path2, path3;
+  Longint  decisions = 0, mask = 0;
+  Shortint half;
   
-  if (path0>path1)
+  for (half=0; half<4; half++)
+    old[half] = _mm_loadu_si128((const __m128i *)(metric+4*half));
+  
+  /* lanes 0..3 and 4..7 */
+  for (half=0; half<2; half++)
     {
-      nodes[num/2].metric = path1;
-      nodes[num/2].continue_path_from = num+1;
+      even  = select_lanes(old[2*half], old[2*half+1], 0);
+      odd   = select_lanes(old[2*half], old[2*half+1], 1);
+      
+      path0 = _mm_add_epi32(even, _mm_loadu_si128((const __m128i *)(branch[0]+4*half)));
+      path1 = _mm_add_epi32(odd,  _mm_loadu_si128((const __m128i *)(branch[1]+4*half)));
+      path2 = _mm_add_epi32(even, _mm_loadu_si128((const __m128i *)(branch[2]+4*half)));
+      path3 = _mm_add_epi32(odd,  _mm_loadu_si128((const __m128i *)(branch[3]+4*half)));
+      
+      decisions |= (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(path0, path1))) << (4*half))
+        | (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(path2, path3))) << (4*half+8));
+      new_metric[half]   = min_epi32(path0, path1);
+      new_metric[half+2] = min_epi32(path2, path3);
     }
-  else
+  
+  /* renormalization */
+  min = min_epi32(min_epi32(new_metric[0], new_metric[1]),
+                  min_epi32(new_metric[2], new_metric[3]));
+  min = min_epi32(min, _mm_shuffle_epi32(min, 0x4E));
+  min = min_epi32(min, _mm_shuffle_epi32(min, 0xB1));
+  
+  for (half=0; half<4; half++)
     {
-      nodes[num/2].metric = path0;
-      nodes[num/2].continue_path_from = num;
+      mask |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(new_metric[half], min)))
+        << (4*half);
+      _mm_storeu_si128((__m128i *)(metric+4*half), _mm_sub_epi32(new_metric[half], min));
     }
-  nodes[num/2].new_entry = 0;
+  for (*min_node=0; (mask & 0x1) == 0; (*min_node)++)
+    mask >>= 1;
   
-  path0 = (my_metric         
-           + distance(inputvalue, (Shortint)(~nodes[num].base_output)));  
-  path1 = (my_friends_metric 
-           + distance(inputvalue, (Shortint)(~nodes[num+1].base_output)));
+  return (UShortint)decisions;
+}
+
+#else
+
+static UShortint acs (Longint* metric, Longint branch[4][NUM_NODES/2],
+                      Shortint* min_node)
+{
+  Longint   new_metric[NUM_NODES];
+  Longint   path0, path1, min;
+  UShortint decisions = 0;
+  Shortint  i;
   
-  if (path0>path1)
+  for (i=0; i<NUM_NODES/2; i++)
     {
-      nodes[num/2+NUM_NODES/2].metric = path1;
-      nodes[num/2+NUM_NODES/2].continue_path_from = num+1;
+      path0 = metric[2*i]   + branch[0][i];
+      path1 = metric[2*i+1] + branch[1][i];
+      if (path0>path1)
+        decisions |= 1 << i;
+      new_metric[i] = (path0>path1) ? path1 : path0;
+      
+      path0 = metric[2*i]   + branch[2][i];
+      path1 = metric[2*i+1] + branch[3][i];
+      if (path0>path1)
+        decisions |= 1 << (i+NUM_NODES/2);
+      new_metric[i+NUM_NODES/2] = (path0>path1) ? path1 : path0;
     }
-  else
+  
+  /* renormalization */
+  min = maxLongint;
+  *min_node = 0;
+  for (i=0; i<NUM_NODES; i++)
+    if (new_metric[i] < min)
+      {
+        min = new_metric[i];
+        *min_node = i;
+      }
+  for (i=0; i<NUM_NODES; i++)
+    metric[i] = new_metric[i] - min;
+  
+  return decisions;
+}
+
+#endif
+
+
+static Shortint traceback (const viterbi_t* viterbi_state, Shortint node)
+{
+  Shortint step;
+  Shortint index = viterbi_state->newest;
+  
+  for (step=0; step<BLOCK*CHC_K-1; step++)
     {
-      nodes[num/2+NUM_NODES/2].metric = path0;
-      nodes[num/2+NUM_NODES/2].continue_path_from = num;
+      node = 2*(node%(NUM_NODES/2))
+        + ((viterbi_state->decisions[index] >> node) & 0x1);
+      index = (index == 0) ? BLOCK*CHC_K-1 : index-1;
     }
-  nodes[num/2+NUM_NODES/2].new_entry = 1;
+  return (node >= NUM_NODES/2);
 }
-
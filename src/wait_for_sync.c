@@ -28,56 +28,63 @@ const char wait_for_sync_id[] = "@(#)$Id: $" wait_for_sync_h;
 
 /*
 *******************************************************************************
-*                         PUBLIC PROGRAM CODE
+*                         CONSTANT TABLES
 *******************************************************************************
 */
 
-void init_wait_for_sync(wait_for_sync_state_t *ptr_wait_state,
-                        Shortint B, Shortint D,
-                        Shortint num_sync_lines2)
+/* The tables of the sync detector for the interleaver of ctm_defines.h,  */
+/* as calculated by calc_sync_tables(). The preamble is the beginning of  */
+/* m_sequence_63.                                                         */
+#if intlvB==8 && intlvD==2 && deintSyncLns==0 && RESYNC_SEQ_LENGTH==32
+#define SYNC_LENGTH_SHIFT_REG 144
+#define SYNC_OFFSET            32
+
+static const Shortint sync_index_vec[56] = {
+   33,  34,  35,  36,  37,  38,  39,  41,  42,  43,  44,  45,  46,  47,
+   50,  51,  52,  53,  54,  55,  58,  59,  60,  61,  62,  63,  67,  68,
+   69,  70,  71,  75,  76,  77,  78,  79,  84,  85,  86,  87,  92,  93,
+   94,  95, 101, 102, 103, 109, 110, 111, 118, 119, 126, 127, 135, 143 };
+
+/* m_sequence_63 XOR-ed with the scrambling sequence */
+static const Shortint m_sequence_resync[RESYNC_SEQ_LENGTH] = {
+   1,  1,  1, -1, -1,  1, -1,  1,  1,  1, -1,  1,  1,  1, -1,  1,
+  -1,  1,  1, -1, -1, -1, -1,  1,  1,  1, -1, -1, -1, -1,  1, -1 };
+
+static const Shortint resync_index_vec[RESYNC_SEQ_LENGTH] = {
+    0,  17,  34,  51,  68,  85, 102, 119,   8,  25,  42,  59,  76,  93, 110, 127,
+   16,  33,  50,  67,  84, 101, 118, 135,  24,  41,  58,  75,  92, 109, 126, 143 };
+#endif
+
+
+/*
+*******************************************************************************
+*                         PRIVATE PROGRAM CODE
+*******************************************************************************
+*/
+
+/* Calculates the sequences and the index vectors of ptr_wait_state for   */
+/* the interleaver (B, D, num_sync_lines2), together with                 */
+/* length_shift_reg and offset. The tables are stored in sync_tables.     */
+
+static void calc_sync_tables(wait_for_sync_state_t *ptr_wait_state,
+                             Shortint B, Shortint D,
+                             Shortint num_sync_lines2)
 {
   Shortint cnt;
   Shortint seq_length;
+  Shortint seq_length_resync;
   Shortint maxindex;
   Shortint cntDiag;
   Shortint cntRow;
   Shortint cntResyncBits;
   Shortint index;
-  Shortint num_dummy_bits;
   Shortint num_add_bits;
   Shortint i, j, k;
-  Shortint *scrambling_sequence;
-
-  /* Calculate the length of the preamble */
-  
-  num_dummy_bits  = B*(B-1)*D/2;       /* dummy bits of the interleaver */
-  num_add_bits    = num_sync_lines2*B; /* additional bits               */
+  Shortint scrambling_sequence[30];
+  Shortint *m_seq, *m_seq_resync, *sync_index, *resync_index;
 
-  ptr_wait_state->num_sync_bits = num_dummy_bits+num_add_bits;
+  num_add_bits = num_sync_lines2*B;    /* additional bits               */
 
-  /* Allocate memory for a vector containing the positions of the initial */
-  /* sync sequence (preamble). The preamble is located in the upper-right */
-  /* triangular area of the interleaver matrix.                           */
-  
-  ptr_wait_state->sync_index_vec
-    = (Shortint*)calloc(ptr_wait_state->num_sync_bits, sizeof(Shortint));
-  
-  /* Calculate the elements of sync_index_vec: first, the additional bits */
-  for (cnt=0; cnt<num_add_bits; cnt++)
-    ptr_wait_state->sync_index_vec[cnt] = cnt;
-  
-  /* Now calculate the positions of the interleaver's dummy bits */
-  cnt = num_add_bits;
-  for (i=0; i<B-1; i++)
-    for (j=0; j<D; j++)
-      for (k=i+1; k<B; k++)
-        {
-          ptr_wait_state->sync_index_vec[cnt] = num_add_bits + D*B*i + B*j + k;
-          cnt++;
-        }
-  
-  maxindex = ptr_wait_state->sync_index_vec[ptr_wait_state->num_sync_bits-1];
-  
   /* Determine the next value (2^n)-1 that is          */
   /* greater or equal to ptr_wait_state->num_sync_bits */
   
@@ -89,59 +96,66 @@ void init_wait_for_sync(wait_for_sync_state_t *ptr_wait_state,
         break;
       }
 
-  /* Calculate the m-sequence of the according length */
-  ptr_wait_state->m_sequence
-    = (Shortint*)calloc(seq_length, sizeof(Shortint));
-  if (ptr_wait_state->m_sequence==(Shortint*)NULL)
-    {
-      fprintf(stderr,"Error while allocating memory for m-sequence\n");
-      exit(1);
-    }
-  m_sequence(ptr_wait_state->m_sequence, seq_length);
-
   /* Determine the next value (2^n)-1 that is */
   /* greater or equal to RESYNC_SEQ_LENGTH    */
   
-  seq_length = 0;
+  seq_length_resync = 0;
   for (cnt=2; cnt<10; cnt++)
     if ((1<<cnt)-1 >= RESYNC_SEQ_LENGTH)
       {
-        seq_length = (1<<cnt)-1;
+        seq_length_resync = (1<<cnt)-1;
         break;
       }
-  
-  /* Calculate the m-sequence of the according length */
-  
-  ptr_wait_state->m_sequence_resync 
-    = (Shortint*)calloc(seq_length, sizeof(Shortint));
-  if (ptr_wait_state->m_sequence_resync==(Shortint*)NULL)
+
+  /* Allocate memory for the m-sequences of the according lengths, for a  */
+  /* vector containing the positions of the initial sync sequence         */
+  /* (preamble), and for a vector containing the positions where the      */
+  /* elements of the resync sequence are located (the resync sequence is  */
+  /* spread inside the bitstream coming from the demodulator due to the   */
+  /* interleaving).                                                       */
+
+  ptr_wait_state->sync_tables
+    = (Shortint*)calloc(seq_length + seq_length_resync +
+                        ptr_wait_state->num_sync_bits + RESYNC_SEQ_LENGTH,
+                        sizeof(Shortint));
+  if (ptr_wait_state->sync_tables==(Shortint*)NULL)
     {
       fprintf(stderr,"Error while allocating memory for m-sequence\n");
       exit(1);
     }
-  m_sequence(ptr_wait_state->m_sequence_resync, seq_length);
+  m_seq        = ptr_wait_state->sync_tables;
+  m_seq_resync = m_seq + seq_length;
+  sync_index   = m_seq_resync + seq_length_resync;
+  resync_index = sync_index + ptr_wait_state->num_sync_bits;
+
+  /* The preamble is located in the upper-right triangular area of the    */
+  /* interleaver matrix. Calculate the elements of sync_index_vec: first, */
+  /* the additional bits                                                  */
+  for (cnt=0; cnt<num_add_bits; cnt++)
+    sync_index[cnt] = cnt;
   
-  /* The m-sequence has to be XOR-ed with the scrambling sequence */
+  /* Now calculate the positions of the interleaver's dummy bits */
+  cnt = num_add_bits;
+  for (i=0; i<B-1; i++)
+    for (j=0; j<D; j++)
+      for (k=i+1; k<B; k++)
+        {
+          sync_index[cnt] = num_add_bits + D*B*i + B*j + k;
+          cnt++;
+        }
   
-  scrambling_sequence = (Shortint*)calloc(B, sizeof(Shortint));
-  generate_scrambling_sequence(scrambling_sequence, B);
+  maxindex = sync_index[ptr_wait_state->num_sync_bits-1];
   
-  for (cnt=0; cnt<seq_length; cnt++)
-    ptr_wait_state->m_sequence_resync[cnt] 
-      = ptr_wait_state->m_sequence_resync[cnt] * scrambling_sequence[cnt % B];
-  free(scrambling_sequence);
+  /* Calculate the m-sequences */
+  m_sequence(m_seq, seq_length);
+  m_sequence(m_seq_resync, seq_length_resync);
   
-  /* Allocate vector containing the positions where the elements of the  */
-  /* resync sequence are located (the resync sequence is spread inside   */
-    /* the bitstream coming from the demodulator due to the interleaving). */
+  /* The resync m-sequence has to be XOR-ed with the scrambling sequence */
   
-  ptr_wait_state->resync_index_vec 
-    = (Shortint*)calloc(RESYNC_SEQ_LENGTH, sizeof(Shortint));
-  if (ptr_wait_state->resync_index_vec==(Shortint*)NULL)
-    {
-      fprintf(stderr,"Error while allocating memory for resync_index_vec\n");
-      exit(1);
-    }
+  generate_scrambling_sequence(scrambling_sequence, B);
+  
+  for (cnt=0; cnt<seq_length_resync; cnt++)
+    m_seq_resync[cnt] = m_seq_resync[cnt] * scrambling_sequence[cnt % B];
   
   /* Calculate the positions of the resync sequence elements and  */
   /* determine the required length of the shift register.         */
@@ -155,7 +169,7 @@ void init_wait_for_sync(wait_for_sync_state_t *ptr_wait_state,
           {
             index = cntDiag*B + cntRow*(D*B+1);
             
-            ptr_wait_state->resync_index_vec[cntResyncBits] = index;
+            resync_index[cntResyncBits] = index;
             
             if ((index+1) > ptr_wait_state->length_shift_reg)
               ptr_wait_state->length_shift_reg = index+1;
@@ -163,15 +177,6 @@ void init_wait_for_sync(wait_for_sync_state_t *ptr_wait_state,
           }
       }
 
-  /* Allocate memory for the shift registers */
-  
-  ptr_wait_state->shift_reg 
-    = (Shortint*)calloc(ptr_wait_state->length_shift_reg, sizeof(Shortint));
-  ptr_wait_state->xcorr1_shiftreg 
-    = (Shortint*)calloc(ptr_wait_state->length_shift_reg, sizeof(Shortint));
-  ptr_wait_state->xcorr2_shiftreg 
-    = (Shortint*)calloc(ptr_wait_state->length_shift_reg, sizeof(Shortint));
-  
   /* Since the resync sequence is spread over a longer time interval than */
   /* the preamble, for the detection of the preamble the shift register   */
   /* is longer than required. Since the register contains the most actual */
@@ -181,7 +186,59 @@ void init_wait_for_sync(wait_for_sync_state_t *ptr_wait_state,
   
   ptr_wait_state->offset = ptr_wait_state->length_shift_reg - maxindex -1;
   for (cnt=0; cnt<ptr_wait_state->num_sync_bits; cnt++)
-    ptr_wait_state->sync_index_vec[cnt] += ptr_wait_state->offset;
+    sync_index[cnt] += ptr_wait_state->offset;
+
+  ptr_wait_state->m_sequence        = m_seq;
+  ptr_wait_state->m_sequence_resync = m_seq_resync;
+  ptr_wait_state->sync_index_vec    = sync_index;
+  ptr_wait_state->resync_index_vec  = resync_index;
+}
+
+
+/*
+*******************************************************************************
+*                         PUBLIC PROGRAM CODE
+*******************************************************************************
+*/
+
+void init_wait_for_sync(wait_for_sync_state_t *ptr_wait_state,
+                        Shortint B, Shortint D,
+                        Shortint num_sync_lines2)
+{
+  Shortint num_dummy_bits;
+  Shortint num_add_bits;
+
+  /* Calculate the length of the preamble */
+  
+  num_dummy_bits  = B*(B-1)*D/2;       /* dummy bits of the interleaver */
+  num_add_bits    = num_sync_lines2*B; /* additional bits               */
+
+  ptr_wait_state->num_sync_bits = num_dummy_bits+num_add_bits;
+  ptr_wait_state->sync_tables   = (Shortint*)NULL;
+
+#ifdef SYNC_LENGTH_SHIFT_REG
+  if (B==intlvB && D==intlvD && num_sync_lines2==deintSyncLns)
+    {
+      /* the interleaver of ctm_defines.h: the tables are constant */
+      ptr_wait_state->m_sequence        = m_sequence_63;
+      ptr_wait_state->m_sequence_resync = m_sequence_resync;
+      ptr_wait_state->sync_index_vec    = sync_index_vec;
+      ptr_wait_state->resync_index_vec  = resync_index_vec;
+      ptr_wait_state->length_shift_reg  = SYNC_LENGTH_SHIFT_REG;
+      ptr_wait_state->offset            = SYNC_OFFSET;
+    }
+  else
+#endif
+    calc_sync_tables(ptr_wait_state, B, D, num_sync_lines2);
+
+  /* Allocate memory for the shift registers */
+  
+  ptr_wait_state->shift_reg 
+    = (Shortint*)calloc(ptr_wait_state->length_shift_reg, sizeof(Shortint));
+  ptr_wait_state->xcorr1_shiftreg 
+    = (Shortint*)calloc(ptr_wait_state->length_shift_reg, sizeof(Shortint));
+  ptr_wait_state->xcorr2_shiftreg 
+    = (Shortint*)calloc(ptr_wait_state->length_shift_reg, sizeof(Shortint));
   
   ptr_wait_state->sync_found         = false;
   ptr_wait_state->alreadyCTMreceived = false;
@@ -199,6 +256,15 @@ void reinit_wait_for_sync(wait_for_sync_state_t *ptr_wait_state)
 }
 
 
+void exit_wait_for_sync(wait_for_sync_state_t *ptr_wait_state)
+{
+  free(ptr_wait_state->sync_tables);
+  free(ptr_wait_state->shift_reg);
+  free(ptr_wait_state->xcorr1_shiftreg);
+  free(ptr_wait_state->xcorr2_shiftreg);
+}
+
+
 /* *************************************************************************/
 
 
@@ -324,7 +390,7 @@ Bool wait_for_sync(Shortint *out_bits,
         {
           actual_sample = ptr_wait_state->m_sequence[cnt] * in_bits[sampl_cnt];
           sampleIsTone  = (((actual_sample & 0x0001)!=0) || 
-                           (ptr_wait_state->cntSymbolsSinceEndOfBurst<600));
+                           (ptr_wait_state->cntSymbolsSinceEndOfBurst<NUM_SYMBOLS_AFTER_BURST));
           index = (ptr_wait_state->length_shift_reg-1
                    -ptr_wait_state->sync_index_vec[cnt]);
           if (sampleIsTone && 
@@ -352,7 +418,7 @@ Bool wait_for_sync(Shortint *out_bits,
           actual_sample 
             = ptr_wait_state->m_sequence_resync[cnt] * in_bits[sampl_cnt];
           sampleIsTone  = (((actual_sample & 0x0001)!=0) || 
-                           (ptr_wait_state->cntSymbolsSinceEndOfBurst<600));
+                           (ptr_wait_state->cntSymbolsSinceEndOfBurst<NUM_SYMBOLS_AFTER_BURST));
           index = (ptr_wait_state->length_shift_reg-1
                    -ptr_wait_state->resync_index_vec[cnt]);
           if (sampleIsTone)
@@ -517,6 +583,14 @@ void generate_resync_sequence(Shortint *sequence)
         break;
       }
   
+  /* the m-sequence of length 63 is a constant table */
+  if (seq_length_tmp == 63)
+    {
+      for (cnt=0; cnt<RESYNC_SEQ_LENGTH; cnt++)
+        sequence[cnt] = m_sequence_63[cnt];
+      return;
+    }
+  
   /* allocate + calculate the m-sequence of length (2^n)-1 */
   sequence_tmp = (Shortint*)calloc(seq_length_tmp,sizeof(Shortint));
   if (sequence_tmp==(Shortint*)NULL)
@@ -19,6 +19,16 @@
 
 #include "typedefs.h"
 
+/*
+*******************************************************************************
+*                         DEFINITION OF CONSTANTS
+*******************************************************************************
+*/
+
+/* For this number of symbols after the end of a burst, all received */
+/* bits are taken as tones by the correlators.                       */
+#define NUM_SYMBOLS_AFTER_BURST 600
+
 /*
 *******************************************************************************
 *                         DECLARATION OF PROTOTYPES
@@ -27,10 +37,14 @@
 
 typedef struct {
   Shortint *shift_reg;         /* shift register                           */
-  Shortint *m_sequence;        /* maximum length sequence (preamble)       */
-  Shortint *m_sequence_resync; /* maximum length sequence (resync)         */
-  Shortint *sync_index_vec;    /* positions/indices of the preamble        */
-  Shortint *resync_index_vec;  /* positions/indices of the resync sequence */
+  const Shortint *m_sequence;        /* maximum length sequence (preamble) */
+  const Shortint *m_sequence_resync; /* maximum length sequence (resync)   */
+  const Shortint *sync_index_vec;    /* positions/indices of the preamble  */
+  const Shortint *resync_index_vec;  /* positions/indices of the resync    */
+                                     /* sequence                           */
+  Shortint *sync_tables;       /* memory of the tables above if they are   */
+                               /* not the constant tables of the inter-    */
+                               /* leaver of ctm_defines.h, or NULL         */
   Shortint length_shift_reg;   /* length of the vector shift_reg           */
   Shortint offset;             /*                                          */
   Shortint num_sync_bits;      /* length of the preamble                   */
@@ -73,6 +87,15 @@ void init_wait_for_sync(wait_for_sync_state_t *ptr_wait_state,
 void reinit_wait_for_sync(wait_for_sync_state_t *ptr_wait_state);
 
 
+/* ----------------------------------------------------------------------- */
+/* Function exit_wait_for_sync()                                           */
+/* *****************************                                           */
+/* Releases the memory that has been allocated by init_wait_for_sync().    */
+/* ----------------------------------------------------------------------- */
+
+void exit_wait_for_sync(wait_for_sync_state_t *ptr_wait_state);
+
+
 
 /* ----------------------------------------------------------------------- */
 /* Function wait_for_sync()                                                */
@@ -0,0 +1,353 @@
+/*
+*******************************************************************************
+*
+*      File             : workpool.c
+*      Purpose          : fixed pool of worker threads with per-worker
+*                         deques and work stealing
+*
+*******************************************************************************
+*/
+
+/*
+*******************************************************************************
+*                         MODULE INCLUDE FILE AND VERSION ID
+*******************************************************************************
+*/
+
+#include "workpool.h"
+
+#include <stdlib.h>
+#include <err.h>
+#include <pthread.h>
+#include <sched.h>
+
+const char workpool_id[] = "@(#)$Id: $" workpool_h;
+
+/*
+*******************************************************************************
+*                         LOCAL DATA
+*******************************************************************************
+*/
+
+#define WORKPOOL_INITIAL_DEQUE_SIZE 64   /* must be a power of two */
+
+struct workpool_task {
+  workpool_fn_t  fn;
+  void          *arg;
+};
+
+/* Ring buffer deque; top and bottom only ever grow, the slot of an */
+/* index is (index & mask). The owner works at the bottom, thieves  */
+/* at the top. The statistics are updated atomically, as they are   */
+/* read by other threads without the lock.                          */
+struct workpool_deque {
+  pthread_mutex_t        lock;
+  struct workpool_task  *tasks;
+  ULongint               mask;
+  ULongint               top;
+  ULongint               bottom;
+  ULongint               max_depth;
+  ULongint               executed;
+  ULongint               stolen;
+};
+
+struct workpool_worker {
+  workpool_t  *pool;
+  int          index;
+  pthread_t    thread;
+};
+
+/* queued, pending, sleepers and next_worker are updated atomically;  */
+/* the lock is only taken by workers going to sleep or waking up, and */
+/* when pending drops to 0. A task is counted in queued before it is  */
+/* pushed and until after it has been taken, so queued is never lower */
+/* than the number of tasks in the deques, and no worker sleeps while */
+/* one is waiting.                                                    */
+struct workpool {
+  int                      num_workers;
+  struct workpool_worker  *workers;
+  struct workpool_deque   *deques;
+
+  pthread_mutex_t          lock;
+  pthread_cond_t           work_cond;   /* signalled when tasks are queued  */
+  pthread_cond_t           done_cond;   /* signalled when pending drops to 0 */
+  int                      queued;      /* tasks sitting in the deques      */
+  int                      pending;     /* tasks submitted, not completed   */
+  int                      sleepers;    /* workers waiting for work_cond    */
+  ULongint                 next_worker;
+  Bool                     shutdown;
+};
+
+/*
+*******************************************************************************
+*                         LOCAL PROGRAM CODE
+*******************************************************************************
+*/
+
+static void deque_push_bottom(struct workpool_deque *dq, workpool_fn_t fn, void *arg)
+{
+  struct workpool_task *tasks;
+  ULongint size, cnt;
+
+  pthread_mutex_lock(&dq->lock);
+
+  size = dq->mask + 1;
+  if (dq->bottom - dq->top == size)
+  {
+    /* deque is full: double its size, keeping the order of the tasks */
+    if ((tasks = calloc(2*size, sizeof(struct workpool_task))) == NULL)
+      err(1, "workpool: calloc");
+    for (cnt = dq->top; cnt != dq->bottom; cnt++)
+      tasks[cnt & (2*size-1)] = dq->tasks[cnt & dq->mask];
+    free(dq->tasks);
+    dq->tasks = tasks;
+    dq->mask  = 2*size-1;
+  }
+
+  dq->tasks[dq->bottom & dq->mask].fn  = fn;
+  dq->tasks[dq->bottom & dq->mask].arg = arg;
+  dq->bottom++;
+  if (dq->bottom - dq->top > dq->max_depth)
+    __atomic_store_n(&dq->max_depth, dq->bottom - dq->top, __ATOMIC_RELAXED);
+
+  pthread_mutex_unlock(&dq->lock);
+}
+
+/* owner side: newest task first */
+static Bool deque_pop_bottom(struct workpool_deque *dq, struct workpool_task *task)
+{
+  Bool found = false;
+
+  pthread_mutex_lock(&dq->lock);
+  if (dq->bottom != dq->top)
+  {
+    dq->bottom--;
+    *task = dq->tasks[dq->bottom & dq->mask];
+    found = true;
+  }
+  pthread_mutex_unlock(&dq->lock);
+
+  return found;
+}
+
+/* thief side: oldest task first */
+static Bool deque_steal_top(struct workpool_deque *dq, struct workpool_task *task)
+{
+  Bool found = false;
+
+  pthread_mutex_lock(&dq->lock);
+  if (dq->bottom != dq->top)
+  {
+    *task = dq->tasks[dq->top & dq->mask];
+    dq->top++;
+    found = true;
+  }
+  pthread_mutex_unlock(&dq->lock);
+
+  return found;
+}
+
+static Bool workpool_take(workpool_t *pool, int self, struct workpool_task *task)
+{
+  int cnt, victim;
+
+  if (deque_pop_bottom(&pool->deques[self], task))
+    return true;
+
+  /* own deque is empty: try to steal, starting with the next worker */
+  for (cnt = 1; cnt < pool->num_workers; cnt++)
+  {
+    victim = (self + cnt) % pool->num_workers;
+    if (deque_steal_top(&pool->deques[victim], task))
+    {
+      __atomic_add_fetch(&pool->deques[self].stolen, 1, __ATOMIC_RELAXED);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static void *workpool_thread(void *arg)
+{
+  struct workpool_worker *worker = arg;
+  workpool_t             *pool   = worker->pool;
+  struct workpool_task    task;
+
+  for (;;)
+  {
+    if (workpool_take(pool, worker->index, &task))
+    {
+      __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+
+      task.fn(task.arg);
+      __atomic_add_fetch(&pool->deques[worker->index].executed, 1, __ATOMIC_RELAXED);
+
+      if (__atomic_sub_fetch(&pool->pending, 1, __ATOMIC_ACQ_REL) == 0)
+      {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->done_cond);
+        pthread_mutex_unlock(&pool->lock);
+      }
+      continue;
+    }
+
+    /* A task counted in queued, but not found, is being pushed or has */
+    /* just been taken by another worker: look again in a moment.      */
+    if (__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) > 0)
+    {
+      sched_yield();
+      continue;
+    }
+
+    /* Sleep until a task is queued. The submitter counts the task in */
+    /* queued before it reads sleepers, the worker counts itself in   */
+    /* sleepers before it reads queued: one of them sees the other.   */
+    pthread_mutex_lock(&pool->lock);
+    __atomic_add_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0 && !pool->shutdown)
+      pthread_cond_wait(&pool->work_cond, &pool->lock);
+    __atomic_sub_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0 && pool->shutdown)
+    {
+      pthread_mutex_unlock(&pool->lock);
+      break;
+    }
+    pthread_mutex_unlock(&pool->lock);
+  }
+
+  return NULL;
+}
+
+/*
+*******************************************************************************
+*                         PUBLIC PROGRAM CODE
+*******************************************************************************
+*/
+
+workpool_t *workpool_create(int num_workers)
+{
+  workpool_t *pool;
+  int cnt;
+
+  if (num_workers < 1)
+    errx(1, "workpool_create: at least one worker is required");
+
+  if ((pool = calloc(1, sizeof(workpool_t))) == NULL ||
+      (pool->workers = calloc(num_workers, sizeof(struct workpool_worker))) == NULL ||
+      (pool->deques = calloc(num_workers, sizeof(struct workpool_deque))) == NULL)
+    err(1, "workpool_create: calloc");
+
+  pool->num_workers = num_workers;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->work_cond, NULL);
+  pthread_cond_init(&pool->done_cond, NULL);
+
+  for (cnt = 0; cnt < num_workers; cnt++)
+  {
+    struct workpool_deque *dq = &pool->deques[cnt];
+
+    pthread_mutex_init(&dq->lock, NULL);
+    if ((dq->tasks = calloc(WORKPOOL_INITIAL_DEQUE_SIZE, sizeof(struct workpool_task))) == NULL)
+      err(1, "workpool_create: calloc");
+    dq->mask = WORKPOOL_INITIAL_DEQUE_SIZE-1;
+  }
+
+  for (cnt = 0; cnt < num_workers; cnt++)
+  {
+    pool->workers[cnt].pool  = pool;
+    pool->workers[cnt].index = cnt;
+    if (pthread_create(&pool->workers[cnt].thread, NULL, workpool_thread, &pool->workers[cnt]) != 0)
+      errx(1, "workpool_create: unable to start worker thread");
+  }
+
+  return pool;
+}
+
+void workpool_destroy(workpool_t *pool)
+{
+  int cnt;
+
+  workpool_wait(pool);
+
+  pthread_mutex_lock(&pool->lock);
+  pool->shutdown = true;
+  pthread_cond_broadcast(&pool->work_cond);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (cnt = 0; cnt < pool->num_workers; cnt++)
+    pthread_join(pool->workers[cnt].thread, NULL);
+
+  for (cnt = 0; cnt < pool->num_workers; cnt++)
+  {
+    pthread_mutex_destroy(&pool->deques[cnt].lock);
+    free(pool->deques[cnt].tasks);
+  }
+
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->work_cond);
+  pthread_cond_destroy(&pool->done_cond);
+  free(pool->deques);
+  free(pool->workers);
+  free(pool);
+}
+
+void workpool_submit(workpool_t *pool, workpool_fn_t fn, void *arg)
+{
+  int worker;
+
+  worker = __atomic_fetch_add(&pool->next_worker, 1, __ATOMIC_RELAXED)
+           % pool->num_workers;
+
+  __atomic_add_fetch(&pool->pending, 1, __ATOMIC_ACQ_REL);
+  __atomic_add_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+
+  deque_push_bottom(&pool->deques[worker], fn, arg);
+
+  if (__atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST) > 0)
+  {
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_signal(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+  }
+}
+
+void workpool_wait(workpool_t *pool)
+{
+  pthread_mutex_lock(&pool->lock);
+  while (__atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE) > 0)
+    pthread_cond_wait(&pool->done_cond, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+int workpool_num_workers(workpool_t *pool)
+{
+  return pool->num_workers;
+}
+
+int workpool_queue_depth(workpool_t *pool, int worker)
+{
+  struct workpool_deque *dq = &pool->deques[worker];
+  int depth;
+
+  pthread_mutex_lock(&dq->lock);
+  depth = (int)(dq->bottom - dq->top);
+  pthread_mutex_unlock(&dq->lock);
+
+  return depth;
+}
+
+int workpool_max_queue_depth(workpool_t *pool, int worker)
+{
+  return (int)__atomic_load_n(&pool->deques[worker].max_depth, __ATOMIC_RELAXED);
+}
+
+ULongint workpool_executed(workpool_t *pool, int worker)
+{
+  return __atomic_load_n(&pool->deques[worker].executed, __ATOMIC_RELAXED);
+}
+
+ULongint workpool_stolen(workpool_t *pool, int worker)
+{
+  return __atomic_load_n(&pool->deques[worker].stolen, __ATOMIC_RELAXED);
+}
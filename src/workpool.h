@@ -0,0 +1,83 @@
+/*
+*******************************************************************************
+*
+*      File             : workpool.h
+*      Purpose          : fixed pool of worker threads with per-worker
+*                         deques and work stealing
+*
+*      Tasks are distributed round-robin over the deques of the workers.
+*      Each worker takes its own tasks from the bottom of its deque (LIFO)
+*      and, when its deque runs empty, steals from the top of the other
+*      workers' deques (FIFO). Thus a few expensive tasks (e.g. channels
+*      in the middle of a CTM burst) do not keep the other workers idle.
+*
+*******************************************************************************
+*/
+#ifndef workpool_h
+#define workpool_h "$Id: $"
+
+/*
+*******************************************************************************
+*                         INCLUDE FILES
+*******************************************************************************
+*/
+
+#include <typedefs.h>
+
+/*
+*******************************************************************************
+*                         DECLARATION OF PROTOTYPES
+*******************************************************************************
+*/
+
+typedef void (*workpool_fn_t)(void *arg);
+
+typedef struct workpool workpool_t;
+
+/* ---------------------------------------------------------------------- */
+/* workpool_create:                                                       */
+/* Starts num_workers threads, each with an empty deque.                  */
+/* ---------------------------------------------------------------------- */
+
+workpool_t *workpool_create(int num_workers);
+
+/* ---------------------------------------------------------------------- */
+/* workpool_destroy:                                                      */
+/* Waits for all submitted tasks, stops the threads and frees the pool.   */
+/* ---------------------------------------------------------------------- */
+
+void workpool_destroy(workpool_t *pool);
+
+/* ---------------------------------------------------------------------- */
+/* workpool_submit:                                                       */
+/* Queues fn(arg) on the deque of the next worker (round-robin). It may   */
+/* be called from any thread at the same time, also from a task; it does */
+/* not wait for a lock of the pool unless a worker is asleep.             */
+/* ---------------------------------------------------------------------- */
+
+void workpool_submit(workpool_t *pool, workpool_fn_t fn, void *arg);
+
+/* ---------------------------------------------------------------------- */
+/* workpool_wait:                                                         */
+/* Blocks until all submitted tasks have been completed, including those  */
+/* submitted by other threads or tasks in the meantime.                   */
+/* ---------------------------------------------------------------------- */
+
+void workpool_wait(workpool_t *pool);
+
+/* ---------------------------------------------------------------------- */
+/* Statistics:                                                            */
+/* workpool_queue_depth()  number of tasks waiting in the worker's deque  */
+/* workpool_max_queue_depth()  highest queue depth seen so far            */
+/* workpool_executed()     number of tasks run by the worker so far       */
+/* workpool_stolen()       number of those taken from other workers       */
+/* They may be called from any thread while the workers run.              */
+/* ---------------------------------------------------------------------- */
+
+int workpool_num_workers(workpool_t *pool);
+int workpool_queue_depth(workpool_t *pool, int worker);
+int workpool_max_queue_depth(workpool_t *pool, int worker);
+ULongint workpool_executed(workpool_t *pool, int worker);
+ULongint workpool_stolen(workpool_t *pool, int worker);
+
+#endif